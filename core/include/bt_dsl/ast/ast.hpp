@@ -6,6 +6,7 @@
 #pragma once
 
 #include <cstddef>
+#include <cstdint>
 #include <gsl/span>
 #include <iterator>
 #include <optional>
@@ -25,6 +26,30 @@ struct TypeSymbol;  // Type-space symbol (extern type, type alias, builtin)
 struct NodeSymbol;  // Node-space symbol (extern node, tree)
 class ConstValue;   // Compile-time constant value
 
+/**
+ * Compact lexical address of a Value-space binding (set by NameResolver).
+ *
+ * `slot` is the symbol's dense index in the owning module's SymbolTable
+ * (see SymbolTable::symbol_at) and `depth` is the number of scope hops from
+ * the use site to the defining scope (0 for declaration sites). Later passes
+ * key per-variable state by slot instead of hashing names again.
+ */
+struct ResolvedBinding
+{
+  static constexpr uint32_t kInvalidSlot = UINT32_MAX;
+  /// Depth marker for symbols owned by an imported module's SymbolTable.
+  static constexpr uint16_t kImportedDepth = UINT16_MAX;
+
+  uint32_t slot = kInvalidSlot;
+  uint16_t depth = 0;
+
+  [[nodiscard]] bool is_valid() const noexcept { return slot != kInvalidSlot; }
+  [[nodiscard]] bool is_imported() const noexcept { return depth == kImportedDepth; }
+
+  /// True when `slot` indexes the current module's SymbolTable.
+  [[nodiscard]] bool is_local_slot() const noexcept { return is_valid() && !is_imported(); }
+};
+
 // ============================================================================
 // Base Classes
 // ============================================================================
@@ -195,6 +220,9 @@ public:
   /// Resolved symbol (set during NameResolver phase, nullptr before resolution)
   const Symbol * resolvedSymbol = nullptr;
 
+  /// Lexical address of resolvedSymbol (set during NameResolver phase)
+  ResolvedBinding binding;
+
   explicit VarRefExpr(std::string_view n, SourceRange r = {}) : NodeBase(r), name(n) {}
 };
 
@@ -360,6 +388,9 @@ class InlineBlackboardDecl
 public:
   std::string_view name;
 
+  /// Lexical address of the declared symbol (set during NameResolver phase)
+  ResolvedBinding binding;
+
   explicit InlineBlackboardDecl(std::string_view n, SourceRange r = {}) : NodeBase(r), name(n) {}
 };
 
@@ -410,6 +441,9 @@ public:
   TypeExpr * type;
   Expr * defaultValue = nullptr;
 
+  /// Lexical address of the declared symbol (set during NameResolver phase)
+  ResolvedBinding binding;
+
   ParamDecl(std::string_view n, TypeExpr * t, SourceRange r = {}) : NodeBase(r), name(n), type(t) {}
 
   ParamDecl(
@@ -496,6 +530,9 @@ public:
   /// Resolved symbol for assignment target (set during NameResolver phase)
   const Symbol * resolvedTarget = nullptr;
 
+  /// Lexical address of resolvedTarget (set during NameResolver phase)
+  ResolvedBinding targetBinding;
+
   AssignmentStmt(std::string_view t, AssignOp o, Expr * v, SourceRange r = {})
   : NodeBase(r), target(t), op(o), value(v)
   {
@@ -511,6 +548,9 @@ public:
   Expr * initialValue = nullptr;
   gsl::span<std::string_view> docs;
 
+  /// Lexical address of the declared symbol (set during NameResolver phase)
+  ResolvedBinding binding;
+
   explicit BlackboardDeclStmt(std::string_view n, SourceRange r = {}) : NodeBase(r), name(n) {}
 
   BlackboardDeclStmt(std::string_view n, TypeExpr * t, Expr * init, SourceRange r = {})
@@ -531,6 +571,9 @@ public:
   /// Evaluated constant value (set by ConstEvaluator, nullptr before)
   const ConstValue * evaluatedValue = nullptr;
 
+  /// Lexical address of the declared symbol (set during NameResolver phase)
+  ResolvedBinding binding;
+
   ConstDeclStmt(std::string_view n, Expr * v, SourceRange r = {}) : NodeBase(r), name(n), value(v)
   {
   }
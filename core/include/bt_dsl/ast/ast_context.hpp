@@ -20,6 +20,8 @@
 #include <utility>
 #include <vector>
 
+#include "bt_dsl/basic/counting_resource.hpp"
+
 namespace bt_dsl
 {
 
@@ -43,6 +45,7 @@ class AstNode;
  * - Nodes are allocated contiguously for better cache locality
  * - String interning reduces memory for repeated identifiers
  * - Destructor order is guaranteed (nodes destroyed in reverse order)
+ * - Arena blocks are counted, so bytes_reserved() is the exact footprint
  *
  * Example:
  * @code
@@ -63,7 +66,7 @@ public:
    * @param initialBufferSize Initial arena buffer size in bytes
    */
   explicit AstContext(size_t initialBufferSize = k_default_buffer_size)
-  : arena_(initialBufferSize), allocator_(&arena_), stringPool_(&arena_)
+  : arena_(initialBufferSize, &upstream_), allocator_(&arena_), stringPool_(&arena_)
   {
   }  // Set uses arena for internal allocations
 
@@ -223,6 +226,15 @@ public:
     return allocator_;
   }
 
+  /**
+   * Bytes the arena has obtained from the heap: nodes, arrays, interned
+   * strings and the string pool's buckets, plus unused block tails.
+   */
+  [[nodiscard]] size_t bytes_reserved() const noexcept { return upstream_.bytes_in_use(); }
+
+  /// Counts the arena's blocks (declared first: the arena releases into it)
+  CountingMemoryResource upstream_;
+
   /// Arena allocator - memory is freed only when destroyed
   std::pmr::monotonic_buffer_resource arena_;
 
@@ -0,0 +1,58 @@
+// bt_dsl/basic/counting_resource.hpp - Memory resource with byte accounting
+//
+// Upstream for the arenas, so their footprint can be reported exactly.
+//
+#pragma once
+
+#include <cstddef>
+#include <memory_resource>
+
+namespace bt_dsl
+{
+
+/**
+ * Forwards to another memory resource (the default resource unless given)
+ * and counts the bytes currently allocated through it.
+ *
+ * As the upstream of a std::pmr::monotonic_buffer_resource this is the
+ * arena's real footprint: every block it obtained, including unused tails.
+ */
+class CountingMemoryResource : public std::pmr::memory_resource
+{
+public:
+  explicit CountingMemoryResource(
+    std::pmr::memory_resource * upstream = std::pmr::get_default_resource()) noexcept
+  : upstream_(upstream)
+  {
+  }
+
+  CountingMemoryResource(const CountingMemoryResource &) = delete;
+  CountingMemoryResource & operator=(const CountingMemoryResource &) = delete;
+
+  /// Bytes allocated and not yet deallocated.
+  [[nodiscard]] size_t bytes_in_use() const noexcept { return bytes_; }
+
+private:
+  void * do_allocate(size_t bytes, size_t alignment) override
+  {
+    void * p = upstream_->allocate(bytes, alignment);
+    bytes_ += bytes;
+    return p;
+  }
+
+  void do_deallocate(void * p, size_t bytes, size_t alignment) override
+  {
+    upstream_->deallocate(p, bytes, alignment);
+    bytes_ -= bytes;
+  }
+
+  [[nodiscard]] bool do_is_equal(const std::pmr::memory_resource & other) const noexcept override
+  {
+    return this == &other;
+  }
+
+  std::pmr::memory_resource * upstream_;
+  size_t bytes_ = 0;
+};
+
+}  // namespace bt_dsl
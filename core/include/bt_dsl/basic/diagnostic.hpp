@@ -1,9 +1,14 @@
 // bt_dsl/basic/diagnostic.hpp - Diagnostic types for parsing/sema
 #pragma once
 
+#include <array>
 #include <cstdint>
+#include <iosfwd>
+#include <iterator>
 #include <optional>
 #include <string>
+#include <string_view>
+#include <type_traits>
 #include <vector>
 
 #include "bt_dsl/basic/source_manager.hpp"
@@ -25,6 +30,112 @@ enum class Severity : uint8_t {
   Hint,
 };
 
+/// Number of Severity values (for per-severity counters).
+inline constexpr size_t k_severity_count = 4;
+
+// ============================================================================
+// DiagnosticMessage
+// ============================================================================
+
+/**
+ * Diagnostic text, formatted only when it is read.
+ *
+ * Three forms:
+ * - owned string: any text converts implicitly and is copied
+ * - string literal: `DiagnosticMessage::literal("...")` stores a view, no
+ *   allocation
+ * - pattern + arguments: `DiagnosticMessage::format("unknown type '{}'", name)`
+ *   keeps the literal pattern and the arguments; `{}` placeholders are
+ *   substituted in order by str()
+ *
+ * Passes that run without a DiagnosticBag (silent re-checks) build messages
+ * lazily through their report_error overloads, so they pay for neither
+ * copying, concatenation nor formatting.
+ */
+class DiagnosticMessage
+{
+public:
+  DiagnosticMessage() = default;
+
+  /// Owned copy of a C string.
+  DiagnosticMessage(const char * text)  // NOLINT(google-explicit-constructor)
+  : owned_(text), is_owned_(true)
+  {
+  }
+
+  /// Owned text.
+  DiagnosticMessage(std::string text)  // NOLINT(google-explicit-constructor)
+  : owned_(std::move(text)), is_owned_(true)
+  {
+  }
+
+  /// Owned copy of a non-literal view.
+  DiagnosticMessage(std::string_view text)  // NOLINT(google-explicit-constructor)
+  : owned_(text), is_owned_(true)
+  {
+  }
+
+  /**
+   * View of a string literal, without copying.
+   *
+   * The text is not copied, so it must have static storage duration; pass
+   * anything else through the converting constructors.
+   */
+  template <size_t N>
+  [[nodiscard]] static DiagnosticMessage literal(const char (&text)[N]) noexcept
+  {
+    DiagnosticMessage m;
+    m.pattern_ = std::string_view(text, N - 1);
+    return m;
+  }
+
+  /**
+   * Deferred message from a literal pattern and arguments.
+   *
+   * The pattern is viewed like literal(); string-like arguments are copied,
+   * numbers are converted on capture, so the message does not depend on AST
+   * or type lifetimes.
+   */
+  template <size_t N, typename... Args>
+  [[nodiscard]] static DiagnosticMessage format(const char (&pattern)[N], const Args &... args)
+  {
+    DiagnosticMessage m = literal(pattern);
+    m.args_.reserve(sizeof...(Args));
+    (m.args_.push_back(to_arg(args)), ...);
+    return m;
+  }
+
+  /// Format the text.
+  [[nodiscard]] std::string str() const;
+
+  /// Check whether the formatted text would be empty.
+  [[nodiscard]] bool empty() const noexcept
+  {
+    return is_owned_ ? owned_.empty() : (pattern_.empty() && args_.empty());
+  }
+
+  /// Check whether formatting is still pending (pattern with arguments).
+  [[nodiscard]] bool is_deferred() const noexcept { return !args_.empty(); }
+
+  friend std::ostream & operator<<(std::ostream & os, const DiagnosticMessage & msg);
+
+private:
+  static std::string to_arg(std::string_view s) { return std::string(s); }
+  static std::string to_arg(const char * s) { return std::string(s); }
+  static std::string to_arg(const std::string & s) { return s; }
+  template <
+    typename T, typename = std::enable_if_t<std::is_arithmetic_v<T> && !std::is_same_v<T, bool>>>
+  static std::string to_arg(T v)
+  {
+    return std::to_string(v);
+  }
+
+  std::string_view pattern_;
+  std::string owned_;
+  std::vector<std::string> args_;
+  bool is_owned_ = false;
+};
+
 enum class LabelStyle {
   Primary,    // エラーの直接的な原因
   Secondary,  // 関連情報（補足）
@@ -33,7 +144,7 @@ enum class LabelStyle {
 struct Label
 {
   SourceRange range;
-  std::string message;
+  DiagnosticMessage message;
   LabelStyle style = LabelStyle::Primary;
 };
 
@@ -46,8 +157,8 @@ struct FixIt
 struct Diagnostic
 {
   Severity severity = Severity::Error;
-  std::string code;     // e.g., "E042"
-  std::string message;  // メインメッセージ
+  std::string code;           // e.g., "E042"
+  DiagnosticMessage message;  // メインメッセージ
 
   std::vector<Label> labels;
   std::vector<FixIt> fixits;
@@ -85,9 +196,9 @@ public:
   DiagnosticBuilder & with_code(std::string code);
 
   DiagnosticBuilder & with_label(
-    SourceRange range, std::string msg, LabelStyle style = LabelStyle::Primary);
+    SourceRange range, DiagnosticMessage msg, LabelStyle style = LabelStyle::Primary);
 
-  DiagnosticBuilder & with_secondary_label(SourceRange range, std::string msg);
+  DiagnosticBuilder & with_secondary_label(SourceRange range, DiagnosticMessage msg);
 
   DiagnosticBuilder & with_fixit(SourceRange range, std::string replacement);
 
@@ -99,6 +210,91 @@ private:
   bool active_ = true;
 };
 
+// ============================================================================
+// DiagnosticView
+// ============================================================================
+
+/**
+ * Non-owning view of the diagnostics of one severity in a DiagnosticBag.
+ *
+ * size() is O(1) (backed by the bag's counters); iteration skips other
+ * severities. Invalidated by any modification of the bag.
+ */
+class DiagnosticView
+{
+public:
+  class iterator
+  {
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = Diagnostic;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const Diagnostic *;
+    using reference = const Diagnostic &;
+
+    iterator() = default;
+    iterator(const Diagnostic * cur, const Diagnostic * end, Severity severity)
+    : cur_(cur), end_(end), severity_(severity)
+    {
+      skip();
+    }
+
+    reference operator*() const { return *cur_; }
+    pointer operator->() const { return cur_; }
+
+    iterator & operator++()
+    {
+      ++cur_;
+      skip();
+      return *this;
+    }
+    iterator operator++(int)
+    {
+      iterator tmp = *this;
+      ++*this;
+      return tmp;
+    }
+
+    bool operator==(const iterator & other) const { return cur_ == other.cur_; }
+    bool operator!=(const iterator & other) const { return cur_ != other.cur_; }
+
+  private:
+    void skip()
+    {
+      while (cur_ != end_ && cur_->severity != severity_) ++cur_;
+    }
+
+    const Diagnostic * cur_ = nullptr;
+    const Diagnostic * end_ = nullptr;
+    Severity severity_ = Severity::Error;
+  };
+
+  DiagnosticView(const std::vector<Diagnostic> & diags, Severity severity, size_t count)
+  : diags_(diags), severity_(severity), count_(count)
+  {
+  }
+
+  [[nodiscard]] iterator begin() const
+  {
+    const Diagnostic * first = diags_.data();
+    const Diagnostic * last = first + diags_.size();
+    return count_ == 0 ? iterator(last, last, severity_) : iterator(first, last, severity_);
+  }
+  [[nodiscard]] iterator end() const
+  {
+    const Diagnostic * last = diags_.data() + diags_.size();
+    return {last, last, severity_};
+  }
+
+  [[nodiscard]] size_t size() const noexcept { return count_; }
+  [[nodiscard]] bool empty() const noexcept { return count_ == 0; }
+
+private:
+  const std::vector<Diagnostic> & diags_;
+  Severity severity_;
+  size_t count_;
+};
+
 // ============================================================================
 // DiagnosticBag
 // ============================================================================
@@ -115,13 +311,13 @@ public:
 
   // Builder Starters
   DiagnosticBuilder report_error(
-    SourceRange range, std::string message, std::string label_message = "");
+    SourceRange range, DiagnosticMessage message, DiagnosticMessage label_message = {});
   DiagnosticBuilder report_warning(
-    SourceRange range, std::string message, std::string label_message = "");
+    SourceRange range, DiagnosticMessage message, DiagnosticMessage label_message = {});
   DiagnosticBuilder report_info(
-    SourceRange range, std::string message, std::string label_message = "");
+    SourceRange range, DiagnosticMessage message, DiagnosticMessage label_message = {});
   DiagnosticBuilder report_hint(
-    SourceRange range, std::string message, std::string label_message = "");
+    SourceRange range, DiagnosticMessage message, DiagnosticMessage label_message = {});
 
   // Add
   void add(Diagnostic && diag);
@@ -132,10 +328,23 @@ public:
   [[nodiscard]] bool empty() const { return diagnostics_.empty(); }
   [[nodiscard]] size_t size() const { return diagnostics_.size(); }
 
-  [[nodiscard]] std::vector<Diagnostic> errors() const;
-  [[nodiscard]] std::vector<Diagnostic> warnings() const;
-  [[nodiscard]] bool has_errors() const;
-  [[nodiscard]] bool has_warnings() const;
+  // Severity queries (O(1), backed by counters)
+  [[nodiscard]] size_t count(Severity severity) const noexcept
+  {
+    return counts_[static_cast<size_t>(severity)];
+  }
+  [[nodiscard]] size_t error_count() const noexcept { return count(Severity::Error); }
+  [[nodiscard]] size_t warning_count() const noexcept { return count(Severity::Warning); }
+  [[nodiscard]] bool has_errors() const noexcept { return error_count() > 0; }
+  [[nodiscard]] bool has_warnings() const noexcept { return warning_count() > 0; }
+
+  // Severity views (no copies)
+  [[nodiscard]] DiagnosticView by_severity(Severity severity) const
+  {
+    return {diagnostics_, severity, count(severity)};
+  }
+  [[nodiscard]] DiagnosticView errors() const { return by_severity(Severity::Error); }
+  [[nodiscard]] DiagnosticView warnings() const { return by_severity(Severity::Warning); }
 
   // Utilities
   void merge(DiagnosticBag && other);
@@ -146,6 +355,49 @@ public:
 
 private:
   std::vector<Diagnostic> diagnostics_;
+  std::array<size_t, k_severity_count> counts_{};
+};
+
+// ============================================================================
+// LazyErrorReporter
+// ============================================================================
+
+/**
+ * CRTP mixin with report_error overloads that build the message only when
+ * there is a bag to keep it, for passes that also run silently (no bag).
+ *
+ * `Derived` has a `DiagnosticBag * diags_` and a
+ * `report_error(SourceRange, DiagnosticMessage)` doing its bookkeeping; it
+ * befriends the mixin and brings the overloads into scope:
+ * @code
+ *   class MyPass : private LazyErrorReporter<MyPass> {
+ *     friend class LazyErrorReporter<MyPass>;
+ *     using LazyErrorReporter::report_error;
+ *     void report_error(SourceRange range, DiagnosticMessage message);
+ *     DiagnosticBag * diags_;
+ *   };
+ * @endcode
+ */
+template <typename Derived>
+class LazyErrorReporter
+{
+protected:
+  /// Report an error, copying the text only if there is a bag to keep it
+  void report_error(SourceRange range, const char * text)
+  {
+    Derived & self = static_cast<Derived &>(*this);
+    self.report_error(range, self.diags_ ? DiagnosticMessage(text) : DiagnosticMessage());
+  }
+
+  /// Report an error whose message `make_message()` builds only if there is a bag
+  template <
+    typename MakeMessage, typename = std::enable_if_t<std::is_invocable_v<MakeMessage &>>>
+  void report_error(SourceRange range, MakeMessage && make_message)
+  {
+    Derived & self = static_cast<Derived &>(*this);
+    self.report_error(
+      range, self.diags_ ? DiagnosticMessage(make_message()) : DiagnosticMessage());
+  }
 };
 
 }  // namespace bt_dsl
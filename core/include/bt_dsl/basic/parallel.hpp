@@ -0,0 +1,75 @@
+// bt_dsl/basic/parallel.hpp - Index-parallel loop over worker threads
+//
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace bt_dsl
+{
+
+/**
+ * Invoke `fn(i)` once for every i in [0, count), spreading indices over
+ * worker threads. The first exception thrown by any call is rethrown.
+ *
+ * @param jobs Maximum number of threads (0 = hardware concurrency)
+ * @param min_per_thread Fewest indices worth a thread of their own; below
+ *        that many the calling thread does all the work
+ */
+template <typename Fn>
+void parallel_for_each_index(
+  std::size_t count, unsigned jobs, Fn && fn, std::size_t min_per_thread = 1)
+{
+  if (jobs == 0) {
+    jobs = std::max(1U, std::thread::hardware_concurrency());
+  }
+  min_per_thread = std::max<std::size_t>(min_per_thread, 1);
+  const std::size_t threads =
+    std::min<std::size_t>(jobs, (count + min_per_thread - 1) / min_per_thread);
+
+  if (threads <= 1) {
+    for (std::size_t i = 0; i < count; ++i) {
+      fn(i);
+    }
+    return;
+  }
+
+  std::atomic<std::size_t> next{0};
+  std::exception_ptr error;
+  std::mutex error_mutex;
+
+  auto work = [&]() {
+    for (std::size_t i = next++; i < count; i = next++) {
+      try {
+        fn(i);
+      } catch (...) {
+        const std::lock_guard<std::mutex> lock(error_mutex);
+        if (!error) {
+          error = std::current_exception();
+        }
+        next = count;
+      }
+    }
+  };
+
+  std::vector<std::thread> workers;
+  workers.reserve(threads - 1);
+  for (std::size_t t = 1; t < threads; ++t) {
+    workers.emplace_back(work);
+  }
+  work();
+  for (auto & w : workers) {
+    w.join();
+  }
+
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
+
+}  // namespace bt_dsl
@@ -241,6 +241,11 @@ public:
   [[nodiscard]] std::string_view content() const noexcept { return content_; }
   [[nodiscard]] size_t size() const noexcept { return content_.size(); }
   [[nodiscard]] size_t line_count() const noexcept { return line_offsets_.size(); }
+  /// Byte offset at which each line starts (the first is 0)
+  [[nodiscard]] const std::vector<uint32_t> & line_offsets() const noexcept
+  {
+    return line_offsets_;
+  }
 
   [[nodiscard]] LineColumn get_line_column(uint32_t offset) const noexcept;
   [[nodiscard]] std::string_view get_line(uint32_t line_index) const noexcept;
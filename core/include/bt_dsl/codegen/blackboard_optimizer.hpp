@@ -0,0 +1,67 @@
+// bt_dsl/codegen/blackboard_optimizer.hpp - Blackboard key coalescing pass
+//
+// Shrinks the set of blackboard entries a generated tree creates at runtime.
+//
+#pragma once
+
+#include <cstddef>
+
+#include "bt_dsl/codegen/btcpp_model.hpp"
+
+namespace bt_dsl
+{
+
+/// What BlackboardKeyOptimizer changed.
+struct BlackboardKeyStats
+{
+  /// Distinct codegen-local keys (`name#N`) before the pass
+  size_t keys_before = 0;
+  /// Distinct codegen-local keys after the pass
+  size_t keys_after = 0;
+  /// `<Script>` nodes removed because they only wrote unread keys
+  size_t scripts_removed = 0;
+
+  BlackboardKeyStats & operator+=(const BlackboardKeyStats & other)
+  {
+    keys_before += other.keys_before;
+    keys_after += other.keys_after;
+    scripts_removed += other.scripts_removed;
+    return *this;
+  }
+};
+
+/**
+ * Optimization pass over codegen-local blackboard keys.
+ *
+ * Codegen gives every local variable, temporary and helper its own
+ * `name#N` key. This pass works per BehaviorTree:
+ *
+ * 1. **Dead writes**: a `<Script code="k := e"/>` (or `k = e`) whose key is
+ *    never read is removed from a Sequence, or replaced by
+ *    `<AlwaysSuccess/>` elsewhere. Repeats until nothing changes.
+ * 2. **Coalescing**: each key's lifetime is the pre-order interval between
+ *    its first and last occurrence. Under nodes that may interleave or
+ *    re-run their children (anything but Sequence, Fallback, ForceSuccess,
+ *    ForceFailure, Inverter) a lifetime is widened to the whole subtree.
+ *    Keys whose first occurrence is an unconditional `k := e`, whose
+ *    lifetimes do not overlap and whose types (BehaviorTreeModel::key_types)
+ *    are equal share one name; BT.CPP fixes an entry's type at its first
+ *    write.
+ *
+ * Keys whose first use is not a definition (e.g. nullable variables that
+ * start out unset) keep their own entry, since sharing would make them
+ * appear set; so do keys of unknown type. Globals (`@{g}`) and tree parameters are never touched.
+ */
+class BlackboardKeyOptimizer
+{
+public:
+  BlackboardKeyOptimizer() = default;
+
+  /// Optimize every BehaviorTree of a document.
+  static BlackboardKeyStats run(btcpp::Document & doc);
+
+  /// Optimize one BehaviorTree (nodes are rebuilt in its arena).
+  static BlackboardKeyStats run(btcpp::BehaviorTreeModel & tree);
+};
+
+}  // namespace bt_dsl
@@ -1,26 +1,221 @@
+// bt_dsl/codegen/btcpp_model.hpp - BehaviorTree.CPP intermediate model
+//
+// Tree nodes are immutable views into a per-tree ModelArena: tags and
+// attribute keys are interned, values are copied once and children are
+// stored as contiguous spans. Nodes are trivially copyable, so building and
+// rearranging a tree never copies strings or child vectors.
+//
 #pragma once
 
+#include <cstddef>
+#include <cstring>
+#include <gsl/span>
+#include <memory>
+#include <memory_resource>
 #include <optional>
 #include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 namespace bt_dsl::btcpp
 {
 
+// ============================================================================
+// ModelArena - storage for tree nodes
+// ============================================================================
+
+/**
+ * Arena that owns the strings and child arrays of a tree model.
+ *
+ * Memory is released all at once when the arena is destroyed. Stored strings
+ * are NUL-terminated, so views returned by intern()/store() can be passed to
+ * C APIs such as tinyxml2 without copying.
+ *
+ * An arena is not thread-safe; each tree is built in its own arena so trees
+ * can be converted in parallel.
+ */
+class ModelArena
+{
+public:
+  /// Default initial buffer size (4KB); most trees are small.
+  static constexpr size_t k_default_buffer_size = size_t{4} * size_t{1024};
+
+  explicit ModelArena(size_t initialBufferSize = k_default_buffer_size)
+  : arena_(initialBufferSize), stringPool_(&arena_)
+  {
+  }
+
+  // Non-copyable and non-movable (PMR resources are not movable)
+  ModelArena(const ModelArena &) = delete;
+  ModelArena & operator=(const ModelArena &) = delete;
+  ModelArena(ModelArena &&) = delete;
+  ModelArena & operator=(ModelArena &&) = delete;
+  ~ModelArena() = default;
+
+  /**
+   * Intern a string (tags, attribute keys) and return a stable view.
+   *
+   * @param s The string to intern
+   * @return View to the pooled copy; equal strings share storage
+   */
+  [[nodiscard]] std::string_view intern(std::string_view s)
+  {
+    auto it = stringPool_.find(s);
+    if (it != stringPool_.end()) {
+      return *it;
+    }
+    const std::string_view stored = store(s);
+    stringPool_.insert(stored);
+    return stored;
+  }
+
+  /**
+   * Copy a string (attribute values, text) into the arena without pooling.
+   *
+   * @param s The string to copy
+   * @return View to the arena copy
+   */
+  [[nodiscard]] std::string_view store(std::string_view s)
+  {
+    char * const ptr = static_cast<char *>(arena_.allocate(s.size() + 1U, 1));
+    std::memcpy(ptr, s.data(), s.size());
+    ptr[s.size()] = '\0';
+    bytes_ += s.size() + 1U;
+    return {ptr, s.size()};
+  }
+
+  /**
+   * Copy elements into an arena-allocated array.
+   *
+   * @tparam T Trivially copyable element type
+   * @param items Source elements
+   * @return A span over the arena copy (empty if items is empty)
+   */
+  template <typename T>
+  [[nodiscard]] gsl::span<const T> copy_array(gsl::span<const T> items)
+  {
+    static_assert(std::is_trivially_copyable_v<T>, "arena arrays must be trivially copyable");
+    if (items.empty()) return {};
+    const size_t bytes = sizeof(T) * items.size();
+    T * const ptr = static_cast<T *>(arena_.allocate(bytes, alignof(T)));
+    std::memcpy(ptr, items.data(), bytes);
+    bytes_ += bytes;
+    return {ptr, items.size()};
+  }
+
+  /// Total bytes handed out by this arena (excluding pool bookkeeping).
+  [[nodiscard]] size_t bytes_allocated() const noexcept { return bytes_; }
+
+private:
+  std::pmr::monotonic_buffer_resource arena_;
+  std::pmr::unordered_set<std::string_view> stringPool_;
+  size_t bytes_ = 0;
+};
+
+// ============================================================================
+// Tree Nodes
+// ============================================================================
+
 struct Attribute
 {
-  std::string key;
-  std::string value;
+  std::string_view key;
+  std::string_view value;
 };
 
+/**
+ * Immutable XML element of a behavior tree.
+ *
+ * All views point into the ModelArena of the owning BehaviorTreeModel (or of
+ * another arena kept alive by the same Document). Build nodes with
+ * NodeBuilder.
+ */
 struct Node
 {
-  std::string tag;
-  std::vector<Attribute> attributes;
-  std::vector<Node> children;
-  std::optional<std::string> text;
+  std::string_view tag;
+  gsl::span<const Attribute> attributes;
+  gsl::span<const Node> children;
+  std::optional<std::string_view> text;
 };
 
+static_assert(std::is_trivially_copyable_v<Node>, "btcpp::Node must stay a cheap view");
+
+/**
+ * Mutable staging area for one Node.
+ *
+ * Attributes and children are collected in scratch vectors and copied into
+ * the arena once by build(). Strings are copied into the arena as they are
+ * added, so arguments may be temporaries.
+ */
+class NodeBuilder
+{
+public:
+  NodeBuilder(ModelArena & arena, std::string_view tag) : arena_(&arena), tag_(arena.intern(tag))
+  {
+  }
+
+  /// Reopen a built node, e.g. to attach precondition attributes.
+  NodeBuilder(ModelArena & arena, const Node & node)
+  : arena_(&arena),
+    tag_(node.tag),
+    attributes_(node.attributes.begin(), node.attributes.end()),
+    children_(node.children.begin(), node.children.end()),
+    text_(node.text)
+  {
+  }
+
+  NodeBuilder & add_attribute(std::string_view key, std::string_view value)
+  {
+    attributes_.push_back(Attribute{arena_->intern(key), arena_->store(value)});
+    return *this;
+  }
+
+  NodeBuilder & add_child(const Node & child)
+  {
+    children_.push_back(child);
+    return *this;
+  }
+
+  NodeBuilder & add_children(gsl::span<const Node> children)
+  {
+    children_.insert(children_.end(), children.begin(), children.end());
+    return *this;
+  }
+
+  NodeBuilder & set_text(std::string_view text)
+  {
+    text_ = arena_->store(text);
+    return *this;
+  }
+
+  [[nodiscard]] std::string_view tag() const noexcept { return tag_; }
+  [[nodiscard]] size_t child_count() const noexcept { return children_.size(); }
+
+  /// Freeze the staged contents into the arena.
+  [[nodiscard]] Node build() const
+  {
+    Node n;
+    n.tag = tag_;
+    n.attributes = arena_->copy_array<Attribute>(attributes_);
+    n.children = arena_->copy_array<Node>(children_);
+    n.text = text_;
+    return n;
+  }
+
+private:
+  ModelArena * arena_;
+  std::string_view tag_;
+  std::vector<Attribute> attributes_;
+  std::vector<Node> children_;
+  std::optional<std::string_view> text_;
+};
+
+// ============================================================================
+// Document
+// ============================================================================
+
 enum class NodeModelKind {
   Action,
   Condition,
@@ -57,7 +252,13 @@ struct SubTreeModel
 struct BehaviorTreeModel
 {
   std::string id;
+  /// Storage for `root` and its descendants (shared so models stay copyable).
+  std::shared_ptr<ModelArena> arena = std::make_shared<ModelArena>();
   std::optional<Node> root;
+  /// DSL type of codegen-local keys (`name#N`) where codegen knows it. BT.CPP
+  /// fixes an entry's type at its first write, so keys may only share an
+  /// entry if their types are equal.
+  std::unordered_map<std::string, std::string> key_types;
 };
 
 struct Document
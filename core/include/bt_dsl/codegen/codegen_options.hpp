@@ -0,0 +1,66 @@
+// bt_dsl/codegen/codegen_options.hpp - Options shared by the code generators
+//
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_set>
+
+namespace bt_dsl
+{
+
+class TypeContext;
+
+/// Optimization level of the generated tree (`btc build -O0` / `-O1` / `-O2`).
+enum class OptimizationLevel : std::uint8_t {
+  O0,  ///< Emit the lowering as is
+  O1,  ///< Run PeepholeOptimizer (flatten controls, merge Scripts, dedup checks)
+  O2,  ///< O1, plus SubTree inlining and tree deduplication
+};
+
+/// Cost thresholds for inlining SubTree calls (see SubtreeOptimizer).
+struct SubtreeInlineLimits
+{
+  /// Callees with at most this many nodes are inlined at every call site
+  size_t max_nodes = 8;
+  /// Callees with a single call site are inlined up to this many nodes
+  size_t single_use_max_nodes = 64;
+};
+
+/**
+ * Optional transformations applied to the BT.CPP model before serialization.
+ *
+ * All passes are off by default so generated output stays stable unless a
+ * build opts in.
+ */
+struct CodegenOptions
+{
+  OptimizationLevel opt_level = OptimizationLevel::O0;
+
+  /// Reuse blackboard keys with disjoint lifetimes and drop write-only helpers
+  /// (see BlackboardKeyOptimizer).
+  bool coalesce_blackboard_keys = false;
+
+  /// Inline small and single-use SubTrees at their call sites (implied by -O2).
+  bool inline_subtrees = false;
+  SubtreeInlineLimits inline_limits;
+
+  /// Merge structurally identical BehaviorTrees under one ID (implied by -O2).
+  bool dedup_trees = false;
+
+  /// XML targets: minified output without declaration or indentation, and
+  /// short generated IDs for imported trees.
+  bool xml_compact = false;
+
+  /// XML targets: node models the runtime already has registered (e.g. from
+  /// plugin manifests), left out of TreeNodesModel.
+  std::unordered_set<std::string> known_node_models;
+
+  /// TypeContext the modules were type-checked in. When set, declared types
+  /// are taken from its memo (see get_resolved_type), which sees through
+  /// aliases; otherwise type annotations are read as written.
+  const TypeContext * types = nullptr;
+};
+
+}  // namespace bt_dsl
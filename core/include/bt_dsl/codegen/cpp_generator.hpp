@@ -0,0 +1,67 @@
+// bt_dsl/codegen/cpp_generator.hpp - BehaviorTree.CPP C++ source generator
+//
+// Emits a C++ translation unit that builds the tree through the
+// BehaviorTree.CPP v4 factory API instead of parsing generated XML at startup.
+//
+#pragma once
+
+#include <string>
+#include <string_view>
+
+#include "bt_dsl/codegen/btcpp_model.hpp"
+#include "bt_dsl/codegen/codegen_options.hpp"
+#include "bt_dsl/sema/resolution/module_graph.hpp"
+
+namespace bt_dsl
+{
+
+/**
+ * Serialize a BT.CPP intermediate model to C++ source.
+ *
+ * The generated translation unit defines, in namespace `bt_dsl_generated`:
+ *
+ * ```cpp
+ * // Check that every node used by the tree is registered with the declared ports.
+ * void validate_<name>(const BT::BehaviorTreeFactory & factory);
+ *
+ * // Build the main tree (validates first; throws BT::RuntimeError on mismatch).
+ * BT::Tree create_<name>(const BT::BehaviorTreeFactory & factory, BT::Blackboard::Ptr blackboard);
+ * BT::Tree create_<name>(const BT::BehaviorTreeFactory & factory);  // fresh blackboard
+ * ```
+ *
+ * Node instantiation mirrors BT.CPP's XML parser: attributes are routed to
+ * input/output ports by the registered manifest, `_skipIf` and friends become
+ * pre/post conditions, and `<SubTree>` creates a child blackboard with
+ * `{key}` remapping. Every BehaviorTree of the document becomes one builder
+ * function, so the tree shape and IDs match the XML output exactly.
+ */
+class BtCppSourceSerializer
+{
+public:
+  BtCppSourceSerializer() = default;
+
+  /**
+   * Serialize a document model to a C++ translation unit.
+   *
+   * @param doc Document model (same as used for XML output)
+   * @param name Suffix of the generated functions (sanitized to an identifier)
+   * @return UTF-8 C++ source
+   * @throws std::runtime_error if a SubTree references an unknown tree ID
+   */
+  [[nodiscard]] static std::string serialize(const btcpp::Document & doc, std::string_view name);
+};
+
+/**
+ * High-level C++ generator facade.
+ */
+class CppGenerator
+{
+public:
+  CppGenerator() = default;
+
+  /// Generate a single C++ translation unit, including reachable imported trees.
+  [[nodiscard]] static std::string generate_single_output(
+    const ModuleInfo & entry, std::string_view name, const CodegenOptions & options = {});
+};
+
+}  // namespace bt_dsl
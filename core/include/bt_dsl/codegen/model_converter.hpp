@@ -4,7 +4,10 @@
 //
 #pragma once
 
+#include <cstddef>
+#include <iosfwd>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace bt_dsl
@@ -37,6 +40,24 @@ struct ModelConvertResult
   int nodes_count;
 };
 
+/// Nodes read from one manifest file.
+struct ManifestFile
+{
+  std::string path;
+  std::vector<ManifestNode> nodes;
+  std::string error;  ///< Non-empty if the file could not be read or parsed
+};
+
+/// Nodes of several manifests, with each node ID declared once.
+struct ModelMergeResult
+{
+  std::vector<ManifestNode> nodes;
+  /// Declarations dropped because an identical one was already merged
+  size_t duplicates_merged = 0;
+  /// Declarations dropped because an earlier one with the same ID differs
+  std::vector<std::string> conflicts;
+};
+
 // ============================================================================
 // Model Converter
 // ============================================================================
@@ -46,6 +67,10 @@ struct ModelConvertResult
  *
  * This is useful for generating `extern node` declarations from existing
  * BehaviorTree.CPP node manifests (TreeNodesModel XML).
+ *
+ * Manifests are read in a single forward pass that reports elements as they
+ * are encountered; no DOM is built, so memory use is the input text plus the
+ * extracted nodes.
  */
 class ModelConverter
 {
@@ -57,7 +82,25 @@ public:
    * @return List of parsed nodes
    * @throws std::runtime_error if parsing fails
    */
-  [[nodiscard]] static std::vector<ManifestNode> parse_xml(const std::string & xml_content);
+  [[nodiscard]] static std::vector<ManifestNode> parse_xml(std::string_view xml_content);
+
+  /**
+   * Read and parse several manifest files in parallel.
+   *
+   * Errors are reported per file instead of being thrown.
+   *
+   * @param paths Manifest files
+   * @param jobs Maximum number of worker threads (0 = hardware concurrency)
+   * @return One entry per path, in the order of `paths`
+   */
+  [[nodiscard]] static std::vector<ManifestFile> parse_files(
+    const std::vector<std::string> & paths, unsigned jobs = 0);
+
+  /**
+   * Merge the nodes of several manifests, keeping the first declaration of
+   * each node ID. Files with an error are skipped.
+   */
+  [[nodiscard]] static ModelMergeResult merge(std::vector<ManifestFile> files);
 
   /**
    * Render nodes as BT-DSL extern declarations.
@@ -67,13 +110,16 @@ public:
    */
   [[nodiscard]] static std::string render_bt(const std::vector<ManifestNode> & nodes);
 
+  /// Render nodes as BT-DSL extern declarations directly into `out`.
+  static void render_bt(const std::vector<ManifestNode> & nodes, std::ostream & out);
+
   /**
    * Convenience function: parse XML and render to BT-DSL.
    *
    * @param xml_content The XML content to convert
    * @return Result containing BT-DSL text and node count
    */
-  [[nodiscard]] static ModelConvertResult convert(const std::string & xml_content);
+  [[nodiscard]] static ModelConvertResult convert(std::string_view xml_content);
 };
 
 }  // namespace bt_dsl
@@ -0,0 +1,171 @@
+// bt_dsl/codegen/model_keys.hpp - Blackboard key references in BT.CPP models
+//
+// Scanning helpers shared by the model optimizers, which rename and rebind
+// blackboard keys in attribute values and scripts.
+//
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+namespace bt_dsl::btcpp
+{
+
+namespace detail
+{
+
+[[nodiscard]] inline bool is_digit(char c) { return c >= '0' && c <= '9'; }
+
+[[nodiscard]] inline bool is_ident_start(char c)
+{
+  // Bytes >= 0x80 belong to UTF-8 identifiers.
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_' ||
+         static_cast<unsigned char>(c) >= 0x80U;
+}
+
+[[nodiscard]] inline bool is_ident_char(char c) { return is_ident_start(c) || is_digit(c); }
+
+}  // namespace detail
+
+// ============================================================================
+// Key Tokens
+// ============================================================================
+
+/// Length of the `name` or `name#N` token starting at `pos`, or 0 if there is none.
+[[nodiscard]] inline size_t key_length(std::string_view text, size_t pos)
+{
+  using detail::is_digit;
+  using detail::is_ident_char;
+
+  if (pos >= text.size() || !detail::is_ident_start(text[pos])) {
+    return 0;
+  }
+  size_t i = pos;
+  while (i < text.size() && is_ident_char(text[i])) {
+    ++i;
+  }
+  if (i + 1 < text.size() && text[i] == '#' && is_digit(text[i + 1])) {
+    ++i;
+    while (i < text.size() && is_digit(text[i])) {
+      ++i;
+    }
+  }
+  return i - pos;
+}
+
+/// Check whether `key` is a codegen-local key (`name#N`).
+[[nodiscard]] inline bool is_local_key(std::string_view key)
+{
+  return !key.empty() && key_length(key, 0) == key.size() &&
+         key.find('#') != std::string_view::npos;
+}
+
+/// Codegen-local key `name#N` split into its parts.
+struct LocalKey
+{
+  std::string_view name;
+  uint32_t number = 0;
+};
+
+[[nodiscard]] inline std::optional<LocalKey> as_local_key(std::string_view key)
+{
+  const size_t hash = key.find('#');
+  if (hash == std::string_view::npos || hash + 1U >= key.size()) {
+    return std::nullopt;
+  }
+  uint32_t n = 0;
+  for (const char c : key.substr(hash + 1U)) {
+    n = n * 10U + static_cast<uint32_t>(c - '0');
+  }
+  return LocalKey{key.substr(0, hash), n};
+}
+
+/// Key referenced by a whole `{key}` value (not `@{key}`).
+[[nodiscard]] inline std::optional<std::string_view> braced_key(std::string_view value)
+{
+  if (value.size() < 3U || value.front() != '{' || value.back() != '}') {
+    return std::nullopt;
+  }
+  const std::string_view inner = value.substr(1, value.size() - 2U);
+  if (key_length(inner, 0) != inner.size()) {
+    return std::nullopt;
+  }
+  return inner;
+}
+
+/// Check whether a value is a whole `@{global}` reference.
+[[nodiscard]] inline bool is_global_ref(std::string_view value)
+{
+  return value.size() > 3U && value.substr(0, 2) == "@{" && value.back() == '}' &&
+         key_length(value, 2) == value.size() - 3U;
+}
+
+/**
+ * Call `fn(offset, length, key, braced)` for every key reference in a script:
+ * bare `key` / `name#N` identifiers and `{key}` forms. Quoted strings and
+ * `@{global}` references are skipped.
+ */
+template <typename Fn>
+void for_each_script_key(std::string_view text, Fn && fn)
+{
+  size_t i = 0;
+  while (i < text.size()) {
+    const char c = text[i];
+    if (c == '\'') {
+      ++i;
+      while (i < text.size() && text[i] != '\'') {
+        i += (text[i] == '\\') ? 2U : 1U;
+      }
+      ++i;
+      continue;
+    }
+    if (c == '@' && i + 1 < text.size() && text[i + 1] == '{') {
+      const size_t close = text.find('}', i);
+      i = (close == std::string_view::npos) ? text.size() : close + 1U;
+      continue;
+    }
+    if (c == '{') {
+      const size_t len = key_length(text, i + 1U);
+      if (len > 0 && i + 1U + len < text.size() && text[i + 1U + len] == '}') {
+        fn(i, len + 2U, text.substr(i + 1U, len), true);
+        i += len + 2U;
+      } else {
+        ++i;
+      }
+      continue;
+    }
+    if (detail::is_ident_start(c) && (i == 0 || !detail::is_ident_char(text[i - 1]))) {
+      const size_t len = key_length(text, i);
+      fn(i, len, text.substr(i, len), false);
+      i += len;
+      continue;
+    }
+    ++i;
+  }
+}
+
+// ============================================================================
+// Attributes
+// ============================================================================
+
+/// How an attribute value refers to blackboard keys.
+enum class AttrKind : std::uint8_t {
+  Script,   // script expression (Script code, `_skipIf`, ...)
+  BareKey,  // entry name without braces (BlackboardExists/UnsetBlackboard `key`)
+  Port,     // port value; a key only as `{k}`
+};
+
+[[nodiscard]] inline AttrKind classify_attribute(std::string_view tag, std::string_view key)
+{
+  if ((tag == "Script" && key == "code") || (!key.empty() && key.front() == '_')) {
+    return AttrKind::Script;
+  }
+  if ((tag == "BlackboardExists" || tag == "UnsetBlackboard") && key == "key") {
+    return AttrKind::BareKey;
+  }
+  return AttrKind::Port;
+}
+
+}  // namespace bt_dsl::btcpp
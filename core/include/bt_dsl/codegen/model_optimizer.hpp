@@ -0,0 +1,20 @@
+// bt_dsl/codegen/model_optimizer.hpp - Optimization pipeline for generated models
+//
+#pragma once
+
+#include "bt_dsl/codegen/btcpp_model.hpp"
+#include "bt_dsl/codegen/codegen_options.hpp"
+
+namespace bt_dsl
+{
+
+/**
+ * Run the passes enabled by `options` over a converted document.
+ *
+ * Order: SubTree inlining, blackboard key coalescing, peephole, tree
+ * deduplication. Inlining comes first so the per-tree passes see the
+ * inlined bodies, and deduplication last so it compares final trees.
+ */
+void optimize_model(btcpp::Document & doc, const CodegenOptions & options);
+
+}  // namespace bt_dsl
@@ -0,0 +1,72 @@
+// bt_dsl/codegen/peephole_optimizer.hpp - Tree-structure peephole pass
+//
+// Removes control-flow scaffolding left behind by lowering.
+//
+#pragma once
+
+#include <cstddef>
+
+#include "bt_dsl/codegen/btcpp_model.hpp"
+
+namespace bt_dsl
+{
+
+/// What PeepholeOptimizer changed.
+struct PeepholeStats
+{
+  /// Nodes in the BehaviorTree bodies before the pass
+  size_t nodes_before = 0;
+  /// Nodes in the BehaviorTree bodies after the pass
+  size_t nodes_after = 0;
+  /// Sequence/Fallback nodes spliced into their parent or replaced by their only child
+  size_t controls_removed = 0;
+  /// `<Script>` nodes folded into the preceding Script
+  size_t scripts_merged = 0;
+  /// `<BlackboardExists>` checks that repeated an earlier, still valid check
+  size_t exists_removed = 0;
+
+  PeepholeStats & operator+=(const PeepholeStats & other)
+  {
+    nodes_before += other.nodes_before;
+    nodes_after += other.nodes_after;
+    controls_removed += other.controls_removed;
+    scripts_merged += other.scripts_merged;
+    exists_removed += other.exists_removed;
+    return *this;
+  }
+};
+
+/**
+ * Local rewrites over the BT.CPP model that save ticks without changing
+ * behavior. Children are simplified first, then:
+ *
+ * 1. **Flattening**: a Sequence (Fallback) directly inside a Sequence
+ *    (Fallback) is spliced into its parent.
+ * 2. **Unwrapping**: a Sequence or Fallback with a single child is replaced
+ *    by that child.
+ * 3. **Script merging**: adjacent `<Script>`s in a Sequence become one
+ *    Script whose statements are joined with `;`.
+ * 4. **Exists dedup**: in a Sequence, a `<BlackboardExists key="k"/>` is
+ *    dropped when an earlier sibling already checked `k` and only Scripts
+ *    and existence checks run in between (neither can remove an entry nor
+ *    return RUNNING).
+ *
+ * Only nodes without attributes (name, preconditions, ports) are merged or
+ * removed, so every precondition keeps the scope it was written for.
+ */
+class PeepholeOptimizer
+{
+public:
+  PeepholeOptimizer() = default;
+
+  /// Optimize every BehaviorTree of a document.
+  static PeepholeStats run(btcpp::Document & doc);
+
+  /// Optimize one BehaviorTree (nodes are rebuilt in its arena).
+  static PeepholeStats run(btcpp::BehaviorTreeModel & tree);
+
+  /// Number of nodes in a subtree, including `node` itself.
+  [[nodiscard]] static size_t count_nodes(const btcpp::Node & node);
+};
+
+}  // namespace bt_dsl
@@ -0,0 +1,70 @@
+// bt_dsl/codegen/subtree_optimizer.hpp - SubTree inlining and deduplication
+//
+// Cuts the number of SubTree instances BT.CPP has to create at runtime.
+//
+#pragma once
+
+#include <cstddef>
+
+#include "bt_dsl/codegen/btcpp_model.hpp"
+#include "bt_dsl/codegen/codegen_options.hpp"
+
+namespace bt_dsl
+{
+
+/// What SubtreeOptimizer changed.
+struct SubtreeStats
+{
+  /// `<SubTree>` call sites replaced by the callee body
+  size_t calls_inlined = 0;
+  /// Imported BehaviorTrees dropped because every call site was inlined
+  size_t trees_removed = 0;
+  /// BehaviorTrees dropped because an identical tree already exists
+  size_t trees_merged = 0;
+};
+
+/**
+ * Whole-document passes over the BehaviorTrees of a btcpp::Document.
+ *
+ * **Inlining** replaces `<SubTree ID="T" p="{k}"/>` by a copy of T's body in
+ * which the parameter `p` reads `k` directly and T's own `name#N` keys are
+ * renumbered into fresh keys of the caller. Each instance thus keeps private
+ * locals, as it had with its own SubTree blackboard. Preconditions on the
+ * call move to a `<Sequence>` around the copy. Callees are inlined first, and a call
+ * is left as is when:
+ * - the callee is recursive, or is not a BehaviorTree of the document;
+ * - an argument is a literal rather than a `{key}` / `@{key}` remap;
+ * - the callee is larger than SubtreeInlineLimits allows.
+ * Imported trees whose every call site was inlined are removed.
+ *
+ * **Deduplication** merges BehaviorTrees whose bodies and SubTree models are
+ * identical under one ID (the main tree, else the first entry-module tree,
+ * else the first in document order). It repeats until nothing changes,
+ * because redirecting calls can make their callers identical too.
+ *
+ * Only imported trees (`_SubTree_*` IDs) other than the main tree are ever
+ * removed. Trees of the entry module keep their IDs because the application
+ * may load them by name; a duplicate among them only loses its callers.
+ */
+class SubtreeOptimizer
+{
+public:
+  SubtreeOptimizer() = default;
+
+  /// Inline SubTree calls within the given cost thresholds.
+  static SubtreeStats inline_calls(btcpp::Document & doc, const SubtreeInlineLimits & limits);
+
+  /// Merge structurally identical BehaviorTrees.
+  static SubtreeStats deduplicate(btcpp::Document & doc);
+
+  /**
+   * Replace the mangled IDs of imported trees (`_SubTree_<module>_<name>`)
+   * by short generated ones (`_1`, `_2`, ...), updating calls and SubTree
+   * models. IDs of the entry module's trees are kept.
+   *
+   * @return Number of trees renamed
+   */
+  static size_t shorten_ids(btcpp::Document & doc);
+};
+
+}  // namespace bt_dsl
@@ -1,8 +1,12 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
+#include <string_view>
+#include <vector>
 
 #include "bt_dsl/codegen/btcpp_model.hpp"
+#include "bt_dsl/codegen/codegen_options.hpp"
 #include "bt_dsl/sema/resolution/module_graph.hpp"
 
 namespace bt_dsl
@@ -20,10 +24,34 @@ public:
   AstToBtCppModelConverter() = default;
 
   /// Convert a single module into a BT.CPP model (no import mangling).
-  [[nodiscard]] static btcpp::Document convert(const ModuleInfo & module);
+  [[nodiscard]] static btcpp::Document convert(
+    const ModuleInfo & module, const TypeContext * types = nullptr);
 
-  /// Convert an entry module (and its reachable imported trees) into a single BT.CPP model.
-  [[nodiscard]] static btcpp::Document convert_single_output(const ModuleInfo & entry);
+  /**
+   * Convert an entry module (and its reachable imported trees) into a single BT.CPP model.
+   *
+   * Tree XML IDs are assigned in a serial pre-pass; tree bodies are then
+   * converted in parallel. The result does not depend on `jobs`.
+   *
+   * @param entry Entry module
+   * @param jobs Maximum number of worker threads (0 = hardware concurrency, 1 = serial)
+   * @param types TypeContext the modules were checked in (see CodegenOptions::types)
+   */
+  [[nodiscard]] static btcpp::Document convert_single_output(
+    const ModuleInfo & entry, unsigned jobs = 0, const TypeContext * types = nullptr);
+};
+
+/// One file of a split XML output.
+struct XmlFile
+{
+  /// Path relative to the output directory (`/`-separated)
+  std::string relative_path;
+  std::string content;
+};
+
+enum class XmlFormat : std::uint8_t {
+  Pretty,   ///< XML declaration, one element per line, 4-space indent
+  Compact,  ///< No declaration and no whitespace between elements
 };
 
 /**
@@ -35,7 +63,19 @@ public:
   BtCppXmlSerializer() = default;
 
   /// Serialize a document model to a UTF-8 XML string.
-  [[nodiscard]] static std::string serialize(const btcpp::Document & doc);
+  [[nodiscard]] static std::string serialize(
+    const btcpp::Document & doc, XmlFormat format = XmlFormat::Pretty);
+
+  /**
+   * Serialize one file per BehaviorTree plus an index.
+   *
+   * The first file is the index (relative path empty; the caller names it).
+   * It `<include>`s `<tree_dir>/<ID>.xml` for each tree and holds
+   * `main_tree_to_execute` and the TreeNodesModel, so BT.CPP loads it like
+   * the single-file output. A change to one tree only changes its own file.
+   */
+  [[nodiscard]] static std::vector<XmlFile> serialize_split(
+    const btcpp::Document & doc, std::string_view tree_dir, XmlFormat format = XmlFormat::Pretty);
 };
 
 /**
@@ -49,8 +89,18 @@ public:
   /// Generate BehaviorTree.CPP XML for a single module.
   [[nodiscard]] static std::string generate(const ModuleInfo & module);
 
-  /// Generate a single-output BehaviorTree.CPP XML, including reachable imported trees.
-  [[nodiscard]] static std::string generate_single_output(const ModuleInfo & entry);
+  /**
+   * Generate a single-output BehaviorTree.CPP XML, including reachable imported trees.
+   *
+   * With `options.xml_compact` the output is minified and imported trees get
+   * short IDs; `options.known_node_models` are left out of TreeNodesModel.
+   */
+  [[nodiscard]] static std::string generate_single_output(
+    const ModuleInfo & entry, const CodegenOptions & options = {});
+
+  /// Like generate_single_output(), split per tree (see BtCppXmlSerializer::serialize_split).
+  [[nodiscard]] static std::vector<XmlFile> generate_split_output(
+    const ModuleInfo & entry, std::string_view tree_dir, const CodegenOptions & options = {});
 };
 
 }  // namespace bt_dsl
@@ -8,9 +8,12 @@
 #include <filesystem>
 #include <optional>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include "bt_dsl/basic/diagnostic.hpp"
+#include "bt_dsl/codegen/codegen_options.hpp"
+#include "bt_dsl/driver/output_writer.hpp"
 #include "bt_dsl/project/project_config.hpp"
 #include "bt_dsl/sema/resolution/module_graph.hpp"
 #include "bt_dsl/sema/types/type.hpp"
@@ -24,7 +27,7 @@ namespace bt_dsl
 
 enum class CompileMode {
   Check,  ///< Syntax and semantic analysis only (no codegen)
-  Build,  ///< Full build including XML generation
+  Build,  ///< Full build including code generation (XML or C++, per target)
 };
 
 // ============================================================================
@@ -39,13 +42,20 @@ struct CompileOptions
   /// Output directory for generated files (overrides project config)
   std::optional<std::filesystem::path> output_dir;
 
-  /// Target environment (overrides project config)
+  /// Target environment (overrides project config), see is_valid_target()
   std::optional<std::string> target;
 
   /// Package paths (each path's folder name becomes the package name)
   /// e.g., --pkg /path/to/std registers "std" as a package.
   std::vector<std::filesystem::path> pkg_paths;
 
+  /// Optional codegen passes
+  CodegenOptions codegen;
+
+  /// Write one XML file per BehaviorTree plus an index (XML targets; ORed with
+  /// the project's `compiler.split_output`)
+  bool split_output = false;
+
   /// Automatically detect and register the standard library.
   /// When true, the compiler will search for stdlib in standard locations.
   bool auto_detect_stdlib = true;
@@ -66,9 +76,15 @@ struct CompileResult
   /// Collected diagnostics (errors, warnings, etc.)
   DiagnosticBag diagnostics;
 
-  /// Generated files (only populated for Build mode)
+  /// Files written by this build (only populated for Build mode)
   std::vector<std::filesystem::path> generated_files;
 
+  /// Outputs that already had the generated content and were not rewritten
+  std::vector<std::filesystem::path> unchanged_files;
+
+  /// Stale per-tree files removed from a split output directory
+  std::vector<std::filesystem::path> removed_files;
+
   /// Module graph (for introspection by LSP, etc.)
   std::unique_ptr<ModuleGraph> module_graph;
 };
@@ -125,16 +141,65 @@ private:
   static bool run_semantic_analysis(
     ModuleInfo & module, TypeContext & types, DiagnosticBag & diags);
 
+  /**
+   * Check for recursive tree calls across all modules of a graph.
+   *
+   * @param graph Module graph (all modules name-resolved)
+   * @param diags Diagnostic bag to collect errors
+   * @return true if no recursion was found
+   */
+  static bool check_tree_recursion(ModuleGraph & graph, DiagnosticBag & diags);
+
+  /**
+   * Generate and write the output files of an entry module for a target.
+   *
+   * Files are written in parallel through OutputWriter, so outputs whose
+   * content did not change keep their mtime.
+   *
+   * @param module Entry module
+   * @param output_dir Directory for the generated files
+   * @param stem File name without extension (also names the generated C++ functions)
+   * @param target Validated target name (see is_valid_target)
+   * @param codegen Optional codegen passes
+   * @param split Write `<stem>.xml` as an index of `<stem>/<TreeID>.xml` (XML targets)
+   * @param result Receives the written/unchanged/removed paths and diagnostics
+   * @return true if every file was generated and written
+   */
+  static bool generate_output(
+    const ModuleInfo & module, const std::filesystem::path & output_dir, const std::string & stem,
+    std::string_view target, const CodegenOptions & codegen, bool split, CompileResult & result);
+
   /**
    * Generate XML output for a module.
    *
    * @param module Module to generate XML for
-   * @param outputPath Output file path
+   * @param output_dir Output directory
+   * @param stem Name of the XML file (and of the per-tree directory when split)
+   * @param codegen Optional codegen passes
+   * @param split One file per BehaviorTree plus an index
+   * @param files Receives the files to write
    * @param diags Diagnostic bag to collect errors
    * @return true if generation succeeded
    */
   static bool generate_xml(
-    const ModuleInfo & module, const std::filesystem::path & output_path, DiagnosticBag & diags);
+    const ModuleInfo & module, const std::filesystem::path & output_dir, const std::string & stem,
+    const CodegenOptions & codegen, bool split, std::vector<OutputFile> & files,
+    DiagnosticBag & diags);
+
+  /**
+   * Generate C++ tree-construction source for a module.
+   *
+   * @param module Module to generate code for
+   * @param output_path Output file path
+   * @param name Suffix of the generated create_/validate_ functions
+   * @param codegen Optional codegen passes
+   * @param files Receives the file to write
+   * @param diags Diagnostic bag to collect errors
+   * @return true if generation succeeded
+   */
+  static bool generate_cpp(
+    const ModuleInfo & module, const std::filesystem::path & output_path, std::string_view name,
+    const CodegenOptions & codegen, std::vector<OutputFile> & files, DiagnosticBag & diags);
 };
 
 }  // namespace bt_dsl
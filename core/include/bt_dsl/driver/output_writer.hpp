@@ -0,0 +1,63 @@
+// bt_dsl/driver/output_writer.hpp - Write-if-changed output files
+//
+// Generated files are only touched when their content changes, so build
+// systems and file watchers downstream see stable mtimes.
+//
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace bt_dsl
+{
+
+/// A file to be written by OutputWriter.
+struct OutputFile
+{
+  std::filesystem::path path;
+  std::string content;
+};
+
+enum class WriteStatus : std::uint8_t {
+  Written,    ///< Created or replaced
+  Unchanged,  ///< Already had this content; not touched
+  Failed,     ///< See WriteResult::error
+};
+
+struct WriteResult
+{
+  std::filesystem::path path;
+  WriteStatus status = WriteStatus::Failed;
+  std::string error;
+};
+
+/**
+ * Atomic, write-if-changed file output.
+ *
+ * A file that already has the exact content is left alone, mtime included
+ * (sizes are compared before any byte is read). Otherwise the content goes
+ * to a temporary file in the same directory, which is then renamed over the
+ * target, so readers never see a partially written file.
+ */
+class OutputWriter
+{
+public:
+  OutputWriter() = default;
+
+  /// Write one file (parent directories are created).
+  [[nodiscard]] static WriteResult write_if_changed(const OutputFile & file);
+
+  /**
+   * Write several files in parallel.
+   *
+   * @param files Files to write; paths should be distinct
+   * @param jobs Maximum number of worker threads (0 = hardware concurrency, 1 = serial)
+   * @return One result per file, in the order of `files`
+   */
+  [[nodiscard]] static std::vector<WriteResult> write_all(
+    const std::vector<OutputFile> & files, unsigned jobs = 0);
+};
+
+}  // namespace bt_dsl
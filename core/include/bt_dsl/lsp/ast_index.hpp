@@ -0,0 +1,93 @@
+// bt_dsl/lsp/ast_index.hpp - Position index over a document's AST
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "bt_dsl/ast/ast.hpp"
+#include "bt_dsl/lsp/lsp.hpp"
+
+namespace bt_dsl::lsp
+{
+
+/// Innermost nodes of interest at a position; all null outside a tree.
+struct AstHit
+{
+  TreeDecl * tree = nullptr;
+  NodeStmt * node_stmt = nullptr;
+  InlineBlackboardDecl * inline_decl = nullptr;
+  VarRefExpr * var_ref = nullptr;
+};
+
+/// An occurrence of a name, as highlighted: `range` contains `name`.
+struct AstOccurrence
+{
+  SourceRange range;
+  std::string_view name;
+  HighlightKind kind = HighlightKind::Text;
+};
+
+/**
+ * Node ranges of a program's trees in flat, position-sorted arrays, one per
+ * node kind, each entry linked to its innermost enclosing entry. A point
+ * query is a binary search plus a walk up through the entries that end
+ * before the point, instead of a walk down from the tree roots.
+ *
+ * Also records, per value symbol and per node name, where the trees refer
+ * to it. Resolved symbols are read while building, so build after name
+ * resolution, and again after every re-parse.
+ */
+class AstIndex
+{
+public:
+  explicit AstIndex(Program & program);
+
+  [[nodiscard]] AstHit hit_at(uint32_t byte_offset) const;
+  [[nodiscard]] TreeDecl * tree_at(uint32_t byte_offset) const;
+
+  /**
+   * References to `sym` in `tree` (Read, or Write if the symbol is
+   * writable), assignments to it and inline declarations of its name (Write),
+   * in source order. Declaration initializers are not included.
+   */
+  [[nodiscard]] std::vector<AstOccurrence> symbol_occurrences(
+    const TreeDecl & tree, const Symbol * sym) const;
+
+  /// Calls of the node `name` in `tree`, in source order.
+  [[nodiscard]] std::vector<SourceRange> node_calls(
+    const TreeDecl & tree, std::string_view name) const;
+
+  /// Heap bytes held, approximately (map nodes are estimated).
+  [[nodiscard]] size_t memory_bytes() const;
+
+private:
+  static constexpr uint32_t k_no_parent = UINT32_MAX;
+
+  struct Entry
+  {
+    uint32_t begin = 0;
+    uint32_t end = 0;
+    uint32_t parent = k_no_parent;  ///< Innermost entry of the same kind containing this one
+    AstNode * node = nullptr;
+  };
+
+  class Builder;
+
+  static void link(std::vector<Entry> & entries);
+  [[nodiscard]] static AstNode * innermost(const std::vector<Entry> & entries, uint32_t off);
+
+  std::vector<Entry> trees_;
+  std::vector<Entry> node_stmts_;
+  std::vector<Entry> inline_decls_;
+  std::vector<Entry> var_refs_;
+
+  // Sorted by position
+  std::unordered_map<const Symbol *, std::vector<AstOccurrence>> symbol_occurrences_;
+  std::unordered_map<std::string_view, std::vector<AstOccurrence>> inline_decls_by_name_;
+  std::unordered_map<std::string_view, std::vector<SourceRange>> node_calls_;
+};
+
+}  // namespace bt_dsl::lsp
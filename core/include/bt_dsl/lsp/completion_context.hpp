@@ -1,9 +1,13 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <optional>
 #include <string>
 #include <string_view>
+#include <vector>
+
+#include "bt_dsl/syntax/token.hpp"
 
 namespace bt_dsl::lsp
 {
@@ -33,7 +37,47 @@ struct CompletionContext
   std::optional<std::string> callable_name;
 };
 
-// Classify completion context at a byte offset using Tree-sitter CST + Query.
+/**
+ * Completion context classifier over one document's token stream.
+ *
+ * Classification replays the tokens before the cursor (open braces and
+ * parens, the last identifier, ...). The replay state is saved every
+ * `k_checkpoint_interval` tokens when the index is built, so a query only
+ * replays the tokens after the nearest checkpoint. Build one per parse and
+ * reuse it for every completion request against that text.
+ */
+class CompletionContextIndex
+{
+public:
+  static constexpr size_t k_checkpoint_interval = 64;
+
+  CompletionContextIndex();
+  /// `tokens` as produced by Lexer::lex_all() for a text of `text_size` bytes.
+  CompletionContextIndex(std::vector<syntax::Token> tokens, size_t text_size);
+  ~CompletionContextIndex();
+
+  CompletionContextIndex(CompletionContextIndex &&) noexcept;
+  CompletionContextIndex & operator=(CompletionContextIndex &&) noexcept;
+  CompletionContextIndex(const CompletionContextIndex &) = delete;
+  CompletionContextIndex & operator=(const CompletionContextIndex &) = delete;
+
+  [[nodiscard]] std::optional<CompletionContext> classify(uint32_t byte_offset) const;
+
+  /// Heap bytes held (tokens and checkpoints), approximately.
+  [[nodiscard]] size_t memory_bytes() const;
+
+private:
+  struct ScanState;
+
+  static bool scan_token(ScanState & st, const syntax::Token & t, uint32_t byte_offset);
+
+  std::vector<syntax::Token> tokens_;
+  size_t text_size_ = 0;
+  // checkpoints_[i] is the state before tokens_[i * k_checkpoint_interval].
+  std::vector<ScanState> checkpoints_;
+};
+
+// Classify completion context at a byte offset, lexing `text` first.
 std::optional<CompletionContext> classify_completion_context(
   std::string_view text, uint32_t byte_offset);
 
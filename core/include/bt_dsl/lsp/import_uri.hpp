@@ -0,0 +1,30 @@
+// bt_dsl/lsp/import_uri.hpp - Import specs to document URIs
+//
+// Same policy as the compiler: `./` and `../` specs are relative to the
+// importing file, anything else names a package file.
+//
+#pragma once
+
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace bt_dsl::lsp
+{
+
+/// Whether `spec` is relative to the importing file.
+[[nodiscard]] bool is_relative_import_spec(std::string_view spec);
+
+/// `bt-dsl-pkg://<spec>`; the host maps package URIs to files.
+[[nodiscard]] std::string package_import_uri(std::string_view spec);
+
+/**
+ * Resolve a relative import against the `file://` URI of the importing
+ * document (dot segments removed).
+ *
+ * @return std::nullopt if `spec` is not relative or `from_uri` is not a file URI
+ */
+[[nodiscard]] std::optional<std::string> resolve_relative_import_uri(
+  std::string_view from_uri, std::string_view spec);
+
+}  // namespace bt_dsl::lsp
@@ -1,11 +1,15 @@
 // bt_dsl/lsp.hpp - LSP-like language service APIs (serverless)
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
+#include <optional>
 #include <string>
 #include <string_view>
 #include <vector>
 
+#include "bt_dsl/basic/diagnostic.hpp"
+
 namespace bt_dsl::lsp
 {
 
@@ -15,6 +19,150 @@ struct ByteRange
   uint32_t endByte = 0;
 };
 
+// ============================================================================
+// Query results
+// ============================================================================
+//
+// Ranges are UTF-8 byte offsets into the text of the document the query was
+// made on (Location::uri for definitions). Hosts that need line/column map
+// them with their own line table; the *_json methods do it for JS hosts.
+
+enum class DiagnosticSource : uint8_t { Import, Parser, Analyzer };
+
+struct DiagnosticItem
+{
+  DiagnosticSource source = DiagnosticSource::Parser;
+  Severity severity = Severity::Error;
+  std::string message;
+  std::string code;  ///< Empty if the diagnostic has no code
+  ByteRange range;
+};
+
+enum class CompletionItemKind : uint8_t { Keyword, Variable, Port, Node };
+
+struct CompletionItem
+{
+  std::string label;
+  CompletionItemKind kind = CompletionItemKind::Keyword;
+  std::string detail;  ///< Empty if none
+  std::string insert_text;
+  ByteRange replace_range;  ///< Text the insertion replaces
+};
+
+struct CompletionList
+{
+  bool is_incomplete = false;
+  std::vector<CompletionItem> items;
+};
+
+struct HoverInfo
+{
+  std::string contents;  ///< Markdown
+  ByteRange range;
+};
+
+struct Location
+{
+  std::string uri;
+  ByteRange range;
+};
+
+enum class DocumentSymbolKind : uint8_t { Declare, GlobalVar, GlobalConst, Tree };
+
+struct DocumentSymbol
+{
+  std::string name;
+  DocumentSymbolKind kind = DocumentSymbolKind::Declare;
+  ByteRange range;
+  ByteRange selection_range;
+};
+
+enum class HighlightKind : uint8_t { Text, Read, Write };
+
+struct DocumentHighlight
+{
+  ByteRange range;
+  HighlightKind kind = HighlightKind::Text;
+};
+
+enum class SemanticTokenType : uint8_t {
+  Class,
+  Function,
+  Keyword,
+  Decorator,
+  Property,
+  Parameter,
+  Variable,
+};
+
+/// Number of SemanticTokenType values (the size of the token legend).
+inline constexpr size_t k_semantic_token_type_count = 7;
+
+struct SemanticToken
+{
+  ByteRange range;
+  SemanticTokenType type = SemanticTokenType::Variable;
+  bool declaration = false;  ///< The `declaration` modifier
+};
+
+/// How LSP positions count characters within a line.
+enum class PositionEncoding : uint8_t { Utf8, Utf16 };
+
+/// One edit of a semantic tokens delta: replace `delete_count` integers at
+/// `start` with `data`.
+struct SemanticTokensEdit
+{
+  uint32_t start = 0;
+  uint32_t delete_count = 0;
+  std::vector<uint32_t> data;
+};
+
+/**
+ * Semantic tokens in the LSP integer encoding: five integers per token
+ * (deltaLine, deltaStartChar, length, type, modifier bits), each position
+ * relative to the previous token. Types index SemanticTokenType; modifier
+ * bit 0 is `declaration`.
+ */
+struct EncodedSemanticTokens
+{
+  std::string result_id;
+  std::vector<uint32_t> data;  ///< Full encoding; empty for a delta
+  /// Set for a delta against the requested previous result
+  std::optional<std::vector<SemanticTokensEdit>> edits;
+};
+
+struct DocumentMemoryUsage
+{
+  std::string uri;
+  bool pinned = false;
+  bool analyzed = false;
+  size_t text_bytes = 0;
+  size_t arena_bytes = 0;
+  size_t other_bytes = 0;
+};
+
+/**
+ * Memory held by a Workspace. Arena bytes (AST nodes, interned strings and
+ * composite types) are exact; other bytes (the source registry's copy of the
+ * text, token and position indexes, semantic token caches) are estimated
+ * from container capacities. Symbol tables and diagnostics are not counted.
+ */
+struct MemoryUsage
+{
+  size_t budget_bytes = 0;  ///< 0 if unlimited
+  size_t text_bytes = 0;
+  size_t arena_bytes = 0;
+  size_t other_bytes = 0;
+  uint64_t evictions = 0;  ///< Documents released to meet the budget, in total
+  std::vector<DocumentMemoryUsage> documents;  ///< Sorted by URI
+};
+
+/// Name used by the JSON API and LSP `source` (e.g. "parser").
+[[nodiscard]] std::string_view to_string(DiagnosticSource source);
+
+/// Name used by the JSON API and the LSP token legend (e.g. "keyword").
+[[nodiscard]] std::string_view to_string(SemanticTokenType type);
+
 /**
  * Serverless language service for BT-DSL.
  *
@@ -23,6 +171,10 @@ struct ByteRange
  * server.
  *
  * All positions are expressed in UTF-8 byte offsets.
+ *
+ * Queries come in two forms: typed methods returning the structs above, used
+ * by native hosts such as the stdio server, and *_json methods that serialize
+ * the same results (adding 1-based line/column) for the WASM/VS Code host.
  */
 class Workspace
 {
@@ -37,9 +189,95 @@ public:
   Workspace & operator=(Workspace && other) noexcept;
 
   void set_document(std::string uri, std::string text);
+
+  /**
+   * Replace `range` of a document's text with `replacement`.
+   *
+   * The analysis is invalidated as by set_document, but the text is edited in
+   * place and the changed range is kept (see edited_range()).
+   *
+   * @return false if the document is not loaded
+   */
+  bool apply_edit(std::string_view uri, ByteRange range, std::string_view replacement);
+
+  /// Range of the current text changed by apply_edit() since the document was
+  /// last parsed; nullopt if unchanged or replaced wholesale by set_document().
+  [[nodiscard]] std::optional<ByteRange> edited_range(std::string_view uri) const;
+
   void remove_document(std::string_view uri);
   [[nodiscard]] bool has_document(std::string_view uri) const;
 
+  /**
+   * Documents whose analysis depends on `uri`: those that imported it,
+   * directly or through other documents, when they were last analyzed.
+   *
+   * Changing or removing a document discards the analysis of exactly these
+   * documents; they are re-analyzed on their next query. Hosts can use this
+   * to refresh diagnostics of open importers.
+   */
+  [[nodiscard]] std::vector<std::string> dependents(std::string_view uri) const;
+
+  /// Text of a document; valid until it is next changed or removed.
+  [[nodiscard]] std::optional<std::string_view> document_text(std::string_view uri) const;
+
+  // Memory
+
+  /**
+   * Keep the parse and analysis state of all documents (arena and other
+   * bytes, see MemoryUsage) within about `bytes`; 0 means no limit, the
+   * default.
+   *
+   * After each query, state is released from the least recently used
+   * documents until the total fits. Texts are kept, so a released document
+   * is re-parsed and re-analyzed on its next query. Pinned documents are
+   * never released, nor are the imports of analyzed pinned documents, so
+   * the budget can be exceeded by what they hold.
+   */
+  void set_memory_budget(size_t bytes);
+
+  /// Pin documents open in the host. Pins are dropped by remove_document().
+  void set_pinned(std::string_view uri, bool pinned);
+
+  [[nodiscard]] MemoryUsage memory_usage() const;
+
+  // Typed queries
+  [[nodiscard]] std::vector<DiagnosticItem> diagnostics(
+    std::string_view uri, const std::vector<std::string> & imported_uris = {});
+  [[nodiscard]] std::vector<std::string> resolve_imports(
+    std::string_view uri, std::string_view stdlib_uri = {});
+  [[nodiscard]] CompletionList completion(
+    std::string_view uri, uint32_t byte_offset,
+    const std::vector<std::string> & imported_uris = {}, std::string_view trigger = {});
+  [[nodiscard]] std::optional<HoverInfo> hover(
+    std::string_view uri, uint32_t byte_offset,
+    const std::vector<std::string> & imported_uris = {});
+  [[nodiscard]] std::vector<Location> definition(
+    std::string_view uri, uint32_t byte_offset,
+    const std::vector<std::string> & imported_uris = {});
+  [[nodiscard]] std::vector<DocumentSymbol> document_symbols(std::string_view uri);
+  [[nodiscard]] std::vector<DocumentHighlight> document_highlights(
+    std::string_view uri, uint32_t byte_offset,
+    const std::vector<std::string> & imported_uris = {});
+  [[nodiscard]] std::vector<SemanticToken> semantic_tokens(
+    std::string_view uri, const std::vector<std::string> & imported_uris = {});
+
+  // Encoded semantic tokens. The result is cached per document until its
+  // analysis changes; the previous result is kept so that a delta can be
+  // sent instead.
+  [[nodiscard]] EncodedSemanticTokens semantic_tokens_full(
+    std::string_view uri, const std::vector<std::string> & imported_uris = {},
+    PositionEncoding encoding = PositionEncoding::Utf16);
+  /// Edits from `previous_result_id`, or the full encoding if that result is
+  /// no longer known.
+  [[nodiscard]] EncodedSemanticTokens semantic_tokens_delta(
+    std::string_view uri, std::string_view previous_result_id,
+    const std::vector<std::string> & imported_uris = {},
+    PositionEncoding encoding = PositionEncoding::Utf16);
+  /// Tokens overlapping `range`, encoded on their own (no result ID).
+  [[nodiscard]] std::vector<uint32_t> semantic_tokens_range(
+    std::string_view uri, ByteRange range, const std::vector<std::string> & imported_uris = {},
+    PositionEncoding encoding = PositionEncoding::Utf16);
+
   // Diagnostics (parse + semantic)
   std::string diagnostics_json(std::string_view uri);
   std::string diagnostics_json(
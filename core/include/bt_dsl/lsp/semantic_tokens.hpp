@@ -0,0 +1,37 @@
+// bt_dsl/lsp/semantic_tokens.hpp - LSP semantic token encoding
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "bt_dsl/lsp/lsp.hpp"
+
+namespace bt_dsl::lsp
+{
+
+/**
+ * Sort tokens by position and drop any that overlap an earlier one, as the
+ * LSP encoding requires.
+ */
+void normalize_semantic_tokens(std::vector<SemanticToken> & tokens);
+
+/**
+ * Encode tokens (sorted, non-overlapping, single-line) in the LSP relative
+ * integer form.
+ *
+ * @param text Document text the token ranges refer to
+ * @param line_offsets Line start offsets of `text` (see build_line_offsets())
+ */
+[[nodiscard]] std::vector<uint32_t> encode_semantic_tokens(
+  std::string_view text, const std::vector<uint32_t> & line_offsets,
+  const std::vector<SemanticToken> & tokens, PositionEncoding encoding);
+
+/**
+ * Edits turning `previous` into `next`: at most one, covering everything
+ * between their common prefix and common suffix (whole tokens only).
+ */
+[[nodiscard]] std::vector<SemanticTokensEdit> diff_semantic_tokens(
+  const std::vector<uint32_t> & previous, const std::vector<uint32_t> & next);
+
+}  // namespace bt_dsl::lsp
@@ -0,0 +1,155 @@
+// bt_dsl/lsp/symbol_index.hpp - Project-wide symbol and reference index
+//
+// Module-level declarations (trees, extern nodes, types, globals) and the
+// identifiers referring to them, per file. A file's entry is built from its
+// own syntax tree only, so entries can be refreshed one file at a time and
+// kept on disk between sessions. References are matched to declarations by
+// name through the importing file's imports when queried.
+//
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace bt_dsl::lsp
+{
+
+enum class IndexSymbolKind : uint8_t { Tree, Node, Type, Global };
+
+/// What a reference names; node calls name trees or extern nodes.
+enum class IndexRefKind : uint8_t { Node, Type, Value };
+
+/// Position of an identifier (identifiers are ASCII and never span lines).
+struct IndexRange
+{
+  uint32_t line = 0;          ///< 0-based
+  uint32_t column = 0;        ///< In bytes
+  uint32_t column_utf16 = 0;  ///< In UTF-16 code units
+  uint32_t length = 0;
+};
+
+struct IndexedSymbol
+{
+  std::string name;
+  IndexSymbolKind kind = IndexSymbolKind::Tree;
+  IndexRange range;  ///< The declared name
+};
+
+struct IndexedReference
+{
+  std::string name;
+  IndexRefKind kind = IndexRefKind::Node;
+  IndexRange range;
+};
+
+/// Index entry of one file.
+struct FileIndex
+{
+  std::string uri;
+  std::vector<std::string> imports;  ///< Import URIs, in declaration order
+  std::vector<IndexedSymbol> symbols;
+  std::vector<IndexedReference> references;
+
+  /// Stamp of the file the entry was built from (both 0 for unsaved text)
+  int64_t mtime = 0;
+  uint64_t size = 0;
+};
+
+/**
+ * Index `text` as the content of `uri`.
+ *
+ * Value references to a tree's own parameters and locals are left out, so
+ * they are never taken for globals of the same name.
+ */
+[[nodiscard]] FileIndex index_source(std::string_view uri, std::string_view text);
+
+/// Whether `name` lexes as a single identifier (not a keyword or literal).
+[[nodiscard]] bool is_valid_symbol_name(std::string_view name);
+
+// ============================================================================
+// Project scanning
+// ============================================================================
+
+/**
+ * Directories to index for a set of workspace folders: the directory of
+ * each btc.yaml in or below a folder (or the nearest one above it), plus the
+ * local path dependencies of those projects. Sorted and without duplicates.
+ */
+[[nodiscard]] std::vector<std::filesystem::path> find_index_roots(
+  const std::vector<std::filesystem::path> & folders);
+
+/// `.bt` files below `roots`, skipping hidden directories. Sorted and
+/// without duplicates.
+[[nodiscard]] std::vector<std::filesystem::path> list_index_sources(
+  const std::vector<std::filesystem::path> & roots);
+
+struct SymbolLocation
+{
+  std::string uri;
+  IndexedSymbol symbol;
+};
+
+struct ReferenceLocation
+{
+  std::string uri;
+  IndexRange range;
+};
+
+/**
+ * Symbol and reference index over many files.
+ *
+ * Not thread-safe; the host serializes access.
+ */
+class SymbolIndex
+{
+public:
+  /// Add or replace the entry of `file.uri`.
+  void update(FileIndex file);
+  void remove(std::string_view uri);
+
+  [[nodiscard]] const FileIndex * file(std::string_view uri) const;
+  [[nodiscard]] std::vector<std::string> uris() const;
+
+  /**
+   * Declarations whose name contains the characters of `query` in order
+   * (case-insensitive); prefix matches first, then substrings.
+   */
+  [[nodiscard]] std::vector<SymbolLocation> find_symbols(
+    std::string_view query, size_t limit) const;
+
+  /// Declaration at, or referred to at, a position (`column` in bytes).
+  [[nodiscard]] std::optional<SymbolLocation> symbol_at(
+    std::string_view uri, uint32_t line, uint32_t column) const;
+
+  /// References to a declaration from every file that sees it, sorted by
+  /// URI and position. The declaration itself is not included.
+  [[nodiscard]] std::vector<ReferenceLocation> references(const SymbolLocation & decl) const;
+
+  /// Write all entries to `path`, atomically. Returns false on failure.
+  [[nodiscard]] bool save(const std::filesystem::path & path) const;
+
+  /**
+   * Replace the contents with the entries written by save().
+   *
+   * @return false (leaving the index empty) if the file is missing,
+   *         malformed or from another format version
+   */
+  bool load(const std::filesystem::path & path);
+
+private:
+  [[nodiscard]] std::optional<SymbolLocation> resolve(
+    const FileIndex & from, std::string_view name, IndexRefKind kind) const;
+
+  std::unordered_map<std::string, FileIndex> files_;
+  // Name -> files with a reference to that name
+  std::unordered_map<std::string, std::unordered_set<std::string>> referencing_files_;
+};
+
+}  // namespace bt_dsl::lsp
@@ -0,0 +1,33 @@
+// bt_dsl/lsp/text_edit.hpp - In-place text edits with a line-offset table
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "bt_dsl/lsp/lsp.hpp"
+
+namespace bt_dsl::lsp
+{
+
+/// Byte offset of the start of each line (the first entry is always 0).
+[[nodiscard]] std::vector<uint32_t> build_line_offsets(std::string_view text);
+
+/// Length of UTF-8 `text` in UTF-16 code units.
+[[nodiscard]] uint32_t utf16_length(std::string_view text);
+
+/**
+ * Replace `range` of `text` with `replacement` and update `line_offsets` to
+ * match, without rescanning the unchanged text.
+ *
+ * Only the replacement is scanned for newlines; offsets of later lines are
+ * shifted. `range` is clamped to the text.
+ *
+ * @return The replaced range in the new text, i.e. where `replacement` now is
+ */
+ByteRange apply_text_edit(
+  std::string & text, std::vector<uint32_t> & line_offsets, ByteRange range,
+  std::string_view replacement);
+
+}  // namespace bt_dsl::lsp
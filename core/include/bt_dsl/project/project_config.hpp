@@ -8,6 +8,7 @@
 #include <filesystem>
 #include <optional>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace bt_dsl
@@ -40,8 +41,11 @@ struct CompilerConfig
   /// Output directory for generated files
   std::filesystem::path output_dir = "generated";
 
-  /// Target environment: "btcpp_v4" | "btcpp_v4_strict"
+  /// Target environment: "btcpp_v4" | "btcpp_v4_strict" | "btcpp_v4_cpp"
   std::string target = "btcpp_v4";
+
+  /// Write one XML file per BehaviorTree plus an index
+  bool split_output = false;
 };
 
 /**
@@ -127,6 +131,19 @@ struct ConfigLoadResult
 [[nodiscard]] std::optional<std::filesystem::path> find_project_config(
   const std::filesystem::path & start_dir);
 
+/**
+ * Check whether a compiler target name is supported.
+ *
+ * `btcpp_v4` and `btcpp_v4_strict` emit XML; `btcpp_v4_cpp` emits a C++
+ * translation unit building the same tree through the BT.CPP factory API.
+ */
+[[nodiscard]] bool is_valid_target(std::string_view target);
+
+/**
+ * Check whether a (valid) target emits C++ source instead of XML.
+ */
+[[nodiscard]] bool is_cpp_target(std::string_view target);
+
 /**
  * Default name of the project configuration file.
  */
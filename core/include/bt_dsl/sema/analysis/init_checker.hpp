@@ -7,7 +7,7 @@
 //
 #pragma once
 
-#include <unordered_map>
+#include <vector>
 
 #include "bt_dsl/ast/ast.hpp"
 #include "bt_dsl/basic/diagnostic.hpp"
@@ -35,8 +35,9 @@ enum class InitState : uint8_t {
 // Forward declarations
 // (BasicBlock and CFG are included via cfg.hpp at top level)
 
-/// Type for tracking variable initialization state by name
-using InitStateMap = std::unordered_map<std::string_view, InitState>;
+/// Type for tracking variable initialization state, indexed by symbol slot
+/// (see ResolvedBinding). Slots never written are Uninit.
+using InitStateMap = std::vector<InitState>;
 
 // ============================================================================
 // Initialization Checker
@@ -51,19 +52,22 @@ using InitStateMap = std::unordered_map<std::string_view, InitState>;
  *
  * ## Algorithm (§6.1.5)
  *
- * 1. Track initialization state of each variable by name
+ * 1. Track initialization state of each variable by its resolved slot
  * 2. For node calls, check arguments against port directions
  * 3. Apply DataPolicy rules when merging child results
  * 4. Apply FlowPolicy rules for sibling visibility
  * 5. Handle precondition skips (no out writes if skipped)
  *
+ * Requires NameResolver to have recorded bindings on the AST. Imported
+ * globals are always considered initialized.
+ *
  * ## Usage
  * ```cpp
  * InitializationChecker checker(values, nodes, &diags);
  * bool ok = checker.check(program);
  * ```
  */
-class InitializationChecker
+class InitializationChecker : private LazyErrorReporter<InitializationChecker>
 {
 public:
   /**
@@ -133,11 +137,13 @@ private:
   // Helper Methods
   // ===========================================================================
 
-  /// Get the variable name from an expression (VarRefExpr or IndexExpr)
-  static std::string_view get_var_name_from_expr(const Expr * expr);
+  /// Get the referenced variable from an expression (VarRefExpr or IndexExpr base)
+  static const VarRefExpr * get_var_ref_from_expr(const Expr * expr);
 
   /// Report an error
-  void report_error(SourceRange range, std::string_view message);
+  void report_error(SourceRange range, DiagnosticMessage message);
+  using LazyErrorReporter::report_error;
+  friend class LazyErrorReporter<InitializationChecker>;
 
   // ===========================================================================
   // Member Variables
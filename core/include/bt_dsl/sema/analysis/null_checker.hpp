@@ -7,7 +7,7 @@
 //
 #pragma once
 
-#include <unordered_set>
+#include <vector>
 
 #include "bt_dsl/ast/ast.hpp"
 #include "bt_dsl/basic/diagnostic.hpp"
@@ -26,8 +26,22 @@ namespace bt_dsl
  * Null Safety State.
  * Tracks variables that are *known to be non-null*.
  * Variables not in the set are considered nullable (if their type is nullable).
+ *
+ * Local symbols are indexed by their ResolvedBinding slot; the few symbols
+ * owned by imported modules are tracked by identity.
  */
-using NullStateSet = std::unordered_set<std::string_view>;
+struct NullStateSet
+{
+  std::vector<bool> local;               ///< NotNull flag per local slot
+  std::vector<const Symbol *> imported;  ///< NotNull imported symbols
+
+  void insert(ResolvedBinding binding, const Symbol * sym);
+  void erase(ResolvedBinding binding, const Symbol * sym);
+  [[nodiscard]] bool contains(ResolvedBinding binding, const Symbol * sym) const;
+
+  /// Intersect with another state; returns true if this state changed.
+  bool intersect(const NullStateSet & other);
+};
 
 /**
  * Null safety checker for BT-DSL.
@@ -38,7 +52,7 @@ using NullStateSet = std::unordered_set<std::string_view>;
  *
  * Implements flow-sensitive analysis (narrowing).
  */
-class NullChecker
+class NullChecker : private LazyErrorReporter<NullChecker>
 {
 public:
   NullChecker(
@@ -70,9 +84,11 @@ private:
   void check_stmt(const Stmt * stmt, NullStateSet & state, bool report_errors);
 
   // Helpers
-  static std::string_view get_var_name_from_expr(const Expr * expr);
+  static const VarRefExpr * get_var_ref_from_expr(const Expr * expr);
 
-  void report_error(SourceRange range, std::string_view message);
+  void report_error(SourceRange range, DiagnosticMessage message);
+  using LazyErrorReporter::report_error;
+  friend class LazyErrorReporter<NullChecker>;
 
   // ===========================================================================
   // Members
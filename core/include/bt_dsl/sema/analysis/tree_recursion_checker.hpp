@@ -12,6 +12,7 @@
 #include "bt_dsl/ast/ast.hpp"
 #include "bt_dsl/basic/diagnostic.hpp"
 #include "bt_dsl/sema/resolution/module_graph.hpp"
+#include "bt_dsl/sema/resolution/tree_call_graph.hpp"
 
 namespace bt_dsl
 {
@@ -19,10 +20,11 @@ namespace bt_dsl
 /**
  * Detect recursion (cycles) in the tree call graph.
  *
- * The checker builds a call graph between TreeDecl nodes by scanning NodeStmt
- * call sites and following those whose resolved node is a TreeDecl.
+ * Recursion is read off the strongly connected components of a
+ * TreeCallGraph: every recursive component yields one diagnostic per
+ * back-edge, naming the cycle (e.g. `A -> B -> A`).
  */
-class TreeRecursionChecker
+class TreeRecursionChecker : private LazyErrorReporter<TreeRecursionChecker>
 {
 public:
   explicit TreeRecursionChecker(DiagnosticBag * diags = nullptr) : diags_(diags) {}
@@ -34,16 +36,24 @@ public:
   /**
    * Check recursion within a single Program.
    *
-   * This detects recursion among trees declared in the same AST program.
+   * This detects recursion among trees declared in the same AST program,
+   * using a throwaway call graph.
    */
   bool check(const Program & program);
 
   /**
-   * Check recursion across a module graph, starting from an entry module.
+   * Check recursion across all modules of a graph.
    *
-   * The traversal roots are the trees defined in the entry module.
+   * Refreshes the persistent ModuleGraph::call_graph() from every module
+   * (only changed modules trigger component recomputation), then reports
+   * each recursive component once.
    */
-  bool check(const ModuleGraph & graph, const ModuleInfo & entry);
+  bool check(ModuleGraph & graph);
+
+  /**
+   * Report all recursive components of an up-to-date call graph.
+   */
+  bool check(const TreeCallGraph & calls);
 
   // ===========================================================================
   // Error State
@@ -53,9 +63,12 @@ public:
   [[nodiscard]] size_t error_count() const noexcept { return errorCount_; }
 
   // Internal (exposed for helper routines in the implementation unit).
-  void report_error(SourceRange range, std::string_view message);
+  void report_error(SourceRange range, DiagnosticMessage message);
+  using LazyErrorReporter::report_error;
 
 private:
+  friend class LazyErrorReporter<TreeRecursionChecker>;
+
   DiagnosticBag * diags_ = nullptr;
   bool hasErrors_ = false;
   size_t errorCount_ = 0;
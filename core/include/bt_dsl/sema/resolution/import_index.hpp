@@ -0,0 +1,101 @@
+// bt_dsl/sema/resolution/import_index.hpp - Merged visibility table of imported names
+//
+// Precomputes which public names a module sees through its direct imports,
+// so cross-module lookups are a single hash probe per namespace.
+//
+#pragma once
+
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "bt_dsl/sema/resolution/node_registry.hpp"
+#include "bt_dsl/sema/resolution/symbol_table.hpp"
+#include "bt_dsl/sema/types/type_table.hpp"
+
+namespace bt_dsl
+{
+
+struct ModuleInfo;
+
+// ============================================================================
+// Import Entry
+// ============================================================================
+
+/**
+ * A name visible through the imports of a module.
+ *
+ * When more than one direct import exports the same public name, the entry
+ * is marked ambiguous and `symbol` keeps the first candidate only.
+ */
+template <typename SymbolT>
+struct ImportEntry
+{
+  const SymbolT * symbol = nullptr;
+  bool ambiguous = false;
+};
+
+// ============================================================================
+// Import Index
+// ============================================================================
+
+/**
+ * Merged table of the public names exported by a module's direct imports.
+ *
+ * One map per namespace (Type, Node, Value). Names are filtered with
+ * ModuleInfo::is_public and ambiguity is recorded while building, so the
+ * NameResolver no longer walks every import for each reference.
+ *
+ * Builtin types are not indexed: every module registers them locally, and
+ * local declarations always shadow imports.
+ *
+ * The index is a snapshot; rebuild it whenever ModuleInfo::imports or an
+ * imported module's symbol tables change.
+ *
+ * Reference: docs/reference/semantics.md §4.2.2 (可視性)
+ */
+class ImportIndex
+{
+public:
+  ImportIndex() = default;
+
+  /**
+   * Rebuild the index from a list of direct imports.
+   *
+   * @param imports Direct imports of the owning module (null entries ignored)
+   */
+  void build(const std::vector<ModuleInfo *> & imports);
+
+  /// Drop all indexed names.
+  void clear();
+
+  // ===========================================================================
+  // Lookup
+  // ===========================================================================
+
+  /// Look up an imported type. Returns nullptr if no import exports it.
+  [[nodiscard]] const ImportEntry<TypeSymbol> * find_type(std::string_view name) const;
+
+  /// Look up an imported node. Returns nullptr if no import exports it.
+  [[nodiscard]] const ImportEntry<NodeSymbol> * find_node(std::string_view name) const;
+
+  /// Look up an imported global value. Returns nullptr if no import exports it.
+  [[nodiscard]] const ImportEntry<Symbol> * find_value(std::string_view name) const;
+
+  /// Total number of indexed names across all namespaces.
+  [[nodiscard]] size_t size() const noexcept
+  {
+    return types_.size() + nodes_.size() + values_.size();
+  }
+
+private:
+  template <typename SymbolT>
+  using EntryMap =
+    std::unordered_map<std::string_view, ImportEntry<SymbolT>, TypeTableHash, TypeTableEqual>;
+
+  EntryMap<TypeSymbol> types_;
+  EntryMap<NodeSymbol> nodes_;
+  EntryMap<Symbol> values_;
+};
+
+}  // namespace bt_dsl
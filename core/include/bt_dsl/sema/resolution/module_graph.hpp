@@ -7,14 +7,17 @@
 #include <filesystem>
 #include <memory>
 #include <optional>
+#include <utility>
 #include <vector>
 
 #include "bt_dsl/ast/ast.hpp"
 #include "bt_dsl/ast/ast_context.hpp"
 #include "bt_dsl/basic/diagnostic.hpp"
 #include "bt_dsl/basic/source_manager.hpp"
+#include "bt_dsl/sema/resolution/import_index.hpp"
 #include "bt_dsl/sema/resolution/node_registry.hpp"
 #include "bt_dsl/sema/resolution/symbol_table.hpp"
+#include "bt_dsl/sema/resolution/tree_call_graph.hpp"
 #include "bt_dsl/sema/types/type_table.hpp"
 
 namespace bt_dsl
@@ -52,6 +55,9 @@ struct ModuleInfo
   /// Direct imports (resolved ModuleInfo pointers)
   std::vector<ModuleInfo *> imports;
 
+  /// Public names visible through `imports` (rebuilt by NameResolver::resolve)
+  ImportIndex import_index;
+
   // ===========================================================================
   // Visibility Helpers
   // ===========================================================================
@@ -183,6 +189,45 @@ public:
     return result;
   }
 
+  /**
+   * Get all modules with imports ordered before their importers.
+   *
+   * Analysing modules in this order lets importers reuse declarations the
+   * owning module already resolved (e.g. memoized port types). Import cycles
+   * are broken at the first module reached again.
+   */
+  [[nodiscard]] std::vector<ModuleInfo *> get_modules_in_dependency_order() const
+  {
+    std::vector<ModuleInfo *> result;
+    result.reserve(modules_.size());
+    std::vector<bool> visited(modules_.size(), false);
+
+    // Iterative post-order DFS over imports: (module, next import index).
+    std::vector<std::pair<ModuleInfo *, size_t>> stack;
+    for (const auto & info : modules_) {
+      if (!info || visited[info->file_id.value]) continue;
+      visited[info->file_id.value] = true;
+      stack.emplace_back(info.get(), 0);
+
+      while (!stack.empty()) {
+        auto & [module, next] = stack.back();
+        if (next < module->imports.size()) {
+          ModuleInfo * imported = module->imports[next++];
+          if (
+            imported && imported->file_id.value < visited.size() &&
+            !visited[imported->file_id.value]) {
+            visited[imported->file_id.value] = true;
+            stack.emplace_back(imported, 0);
+          }
+          continue;
+        }
+        result.push_back(module);
+        stack.pop_back();
+      }
+    }
+    return result;
+  }
+
   /**
    * Get the number of modules in the graph.
    */
@@ -200,9 +245,23 @@ public:
    */
   [[nodiscard]] bool empty() const noexcept { return size() == 0; }
 
+  // ===========================================================================
+  // Whole-Program Analysis
+  // ===========================================================================
+
+  /**
+   * Tree call graph across all modules.
+   *
+   * Kept up to date by TreeRecursionChecker::check(ModuleGraph &); other
+   * consumers (e.g. call hierarchy) may query it afterwards.
+   */
+  [[nodiscard]] TreeCallGraph & call_graph() noexcept { return call_graph_; }
+  [[nodiscard]] const TreeCallGraph & call_graph() const noexcept { return call_graph_; }
+
 private:
   SourceRegistry sources_;
   std::vector<std::unique_ptr<ModuleInfo>> modules_;  // indexed by FileId::value
+  TreeCallGraph call_graph_;
 };
 
 }  // namespace bt_dsl
@@ -45,7 +45,7 @@ using PackageRegistry = std::unordered_map<std::string, std::filesystem::path>;
  *
  * Reference: docs/reference/semantics.md §4.1.3 (importの解決)
  */
-class ModuleResolver
+class ModuleResolver : private LazyErrorReporter<ModuleResolver>
 {
 public:
   /**
@@ -188,12 +188,14 @@ private:
   /**
    * Report an error.
    */
-  void report_error(SourceRange range, std::string_view message);
+  void report_error(SourceRange range, DiagnosticMessage message);
+  using LazyErrorReporter::report_error;
+  friend class LazyErrorReporter<ModuleResolver>;
 
   /**
    * Report an error with a file path.
    */
-  void report_error(const std::filesystem::path & file, std::string_view message);
+  void report_error(const std::filesystem::path & file, DiagnosticMessage message);
 
   // ===========================================================================
   // Member Variables
@@ -20,20 +20,23 @@ namespace bt_dsl
  * Name resolution pass for BT-DSL semantic analysis.
  *
  * This visitor walks the AST and resolves all identifier references:
- * - VarRefExpr -> Symbol (Value-space)
- * - AssignmentStmt.target -> Symbol (Value-space)
+ * - VarRefExpr -> Symbol + ResolvedBinding (Value-space)
+ * - AssignmentStmt.target -> Symbol + ResolvedBinding (Value-space)
  * - NodeStmt.nodeName -> NodeSymbol (Node-space)
  * - PrimaryType.name -> TypeSymbol (Type-space)
  *
  * Features:
  * - Import visibility: only public symbols (not starting with '_') are visible
  * - Ambiguity detection: error if multiple imports define the same public name
+ *   (precomputed in ModuleInfo::import_index at the start of resolve())
  * - Non-transitive imports: only direct imports are searched
  * - Shadowing detection: error if declaration hides a parent scope symbol
+ * - Lexical addresses: local declarations and references get a slot/depth
+ *   binding so later passes can index per-symbol state without name lookups
  *
  * Reference: docs/reference/semantics.md
  */
-class NameResolver : public AstVisitor<NameResolver>
+class NameResolver : public AstVisitor<NameResolver>, private LazyErrorReporter<NameResolver>
 {
 public:
   /**
@@ -167,11 +170,20 @@ private:
   /// Pop the current block scope
   void pop_block_scope();
 
+  /// Binding for a declaration site whose symbol lives in the current scope
+  [[nodiscard]] ResolvedBinding declaration_binding(
+    std::string_view name, const AstNode * decl) const;
+
+  /// Binding for a symbol owned by an imported module
+  [[nodiscard]] static ResolvedBinding imported_binding(const Symbol * sym);
+
   /// Check for shadowing and report error if found
   bool check_shadowing(std::string_view name, SourceRange range);
 
   /// Report an error
-  void report_error(SourceRange range, std::string_view message);
+  void report_error(SourceRange range, DiagnosticMessage message);
+  using LazyErrorReporter::report_error;
+  friend class LazyErrorReporter<NameResolver>;
 
   // ===========================================================================
   // Member Variables
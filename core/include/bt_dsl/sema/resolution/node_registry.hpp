@@ -114,6 +114,11 @@ public:
    */
   [[nodiscard]] size_t size() const noexcept { return symbols_.size(); }
 
+  /**
+   * Get all registered node symbols.
+   */
+  [[nodiscard]] const auto & get_symbols() const noexcept { return symbols_; }
+
 private:
   std::unordered_map<std::string_view, NodeSymbol, NodeRegistryHash, NodeRegistryEqual> symbols_;
 };
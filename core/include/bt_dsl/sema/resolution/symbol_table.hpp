@@ -50,6 +50,9 @@ struct Symbol
   /// Link back to AST node
   const AstNode * astNode = nullptr;
 
+  /// Dense index in the owning SymbolTable (assigned on first definition)
+  uint32_t slot = ResolvedBinding::kInvalidSlot;
+
   // ===========================================================================
   // Helper Methods
   // ===========================================================================
@@ -108,6 +111,9 @@ struct StringViewEqual
   bool operator()(std::string_view a, std::string_view b) const noexcept { return a == b; }
 };
 
+/// Slot-indexed registry of every symbol defined in a SymbolTable's scopes.
+using SymbolSlots = std::vector<const Symbol *>;
+
 // ============================================================================
 // Scope
 // ============================================================================
@@ -120,12 +126,18 @@ struct StringViewEqual
  *
  * Note: Symbol names (keys) must be interned string_views with lifetime
  * guaranteed by AstContext (arena allocation).
+ *
+ * Scopes owned by a SymbolTable share its SymbolSlots registry, so every
+ * newly defined symbol receives a dense slot index.
  */
 class Scope
 {
 public:
-  /// Create a scope with optional parent
-  explicit Scope(Scope * parent = nullptr) : parent_(parent) {}
+  /// Create a scope with optional parent and slot registry
+  explicit Scope(Scope * parent = nullptr, SymbolSlots * slots = nullptr)
+  : parent_(parent), slots_(slots)
+  {
+  }
 
   // ===========================================================================
   // Symbol Definition
@@ -140,15 +152,28 @@ public:
   bool define(Symbol symbol)
   {
     auto [it, inserted] = symbols_.emplace(symbol.name, symbol);
+    if (inserted) {
+      assign_slot(it->second);
+    }
     return inserted;
   }
 
   /**
    * Insert or overwrite a symbol in this scope.
    *
+   * An overwritten symbol keeps its slot.
+   *
    * @param symbol The symbol to insert/update (name must be interned)
    */
-  void upsert(Symbol symbol) { symbols_.insert_or_assign(symbol.name, symbol); }
+  void upsert(Symbol symbol)
+  {
+    if (auto it = symbols_.find(symbol.name); it != symbols_.end()) {
+      symbol.slot = it->second.slot;
+      it->second = symbol;
+      return;
+    }
+    (void)define(symbol);
+  }
 
   // ===========================================================================
   // Symbol Lookup
@@ -180,6 +205,25 @@ public:
     return parent_ ? parent_->lookup(name) : nullptr;
   }
 
+  /**
+   * Look up a symbol by name, also reporting how many parent hops it took.
+   *
+   * @param name The symbol name to look up
+   * @param depth Set to the scope depth of the match (0 = this scope)
+   * @return Pointer to symbol if found, nullptr otherwise
+   */
+  [[nodiscard]] const Symbol * lookup_with_depth(std::string_view name, uint16_t & depth) const
+  {
+    depth = 0;
+    for (const Scope * s = this; s != nullptr; s = s->parent_) {
+      if (const Symbol * sym = s->lookup_local(name)) {
+        return sym;
+      }
+      ++depth;
+    }
+    return nullptr;
+  }
+
   // ===========================================================================
   // Scope Properties
   // ===========================================================================
@@ -200,7 +244,16 @@ public:
   [[nodiscard]] bool empty() const noexcept { return symbols_.empty(); }
 
 private:
+  void assign_slot(Symbol & sym)
+  {
+    if (slots_ != nullptr) {
+      sym.slot = static_cast<uint32_t>(slots_->size());
+      slots_->push_back(&sym);
+    }
+  }
+
   Scope * parent_;
+  SymbolSlots * slots_;
   std::unordered_map<std::string_view, Symbol, StringViewHash, StringViewEqual> symbols_;
 };
 
@@ -221,7 +274,11 @@ private:
 class SymbolTable
 {
 public:
-  SymbolTable() : global_scope_(std::make_unique<Scope>()) {}
+  SymbolTable()
+  : slots_(std::make_unique<SymbolSlots>()),
+    global_scope_(std::make_unique<Scope>(nullptr, slots_.get()))
+  {
+  }
 
   // ===========================================================================
   // Building the Symbol Table
@@ -275,6 +332,43 @@ public:
     return fromScope ? fromScope->lookup(name) : global_scope_->lookup(name);
   }
 
+  /**
+   * Resolve a symbol name and compute its lexical address.
+   *
+   * @param name The symbol name to resolve
+   * @param fromScope The scope to start searching from (global if nullptr)
+   * @param binding Set to the symbol's slot and scope depth when found
+   * @return Pointer to symbol if found, nullptr otherwise
+   */
+  [[nodiscard]] const Symbol * resolve_binding(
+    std::string_view name, const Scope * fromScope, ResolvedBinding & binding) const
+  {
+    const Scope * start = fromScope ? fromScope : global_scope_.get();
+    uint16_t depth = 0;
+    const Symbol * sym = start->lookup_with_depth(name, depth);
+    binding = sym ? ResolvedBinding{sym->slot, depth} : ResolvedBinding{};
+    return sym;
+  }
+
+  // ===========================================================================
+  // Slot Access
+  // ===========================================================================
+
+  /// Number of slots handed out (size for slot-indexed per-symbol state)
+  [[nodiscard]] size_t symbol_count() const noexcept { return slots_->size(); }
+
+  /// Get the symbol for a slot (nullptr if out of range)
+  [[nodiscard]] const Symbol * symbol_at(uint32_t slot) const noexcept
+  {
+    return slot < slots_->size() ? (*slots_)[slot] : nullptr;
+  }
+
+  /// Get the symbol a binding refers to (nullptr for imported/invalid bindings)
+  [[nodiscard]] const Symbol * symbol_at(ResolvedBinding binding) const noexcept
+  {
+    return binding.is_local_slot() ? symbol_at(binding.slot) : nullptr;
+  }
+
   // =========================================================================
   // Block Scopes (children_block)
   // =========================================================================
@@ -287,7 +381,7 @@ public:
    */
   [[nodiscard]] Scope * create_block_scope(Scope * parent)
   {
-    auto scope = std::make_unique<Scope>(parent);
+    auto scope = std::make_unique<Scope>(parent, slots_.get());
     Scope * ptr = scope.get();
     block_scopes_.push_back(std::move(scope));
     return ptr;
@@ -331,6 +425,10 @@ private:
   /// Helper to build scope for a single tree
   void build_tree_scope(const TreeDecl & tree);
 
+  // Heap-allocated so scopes keep a stable registry pointer when the table moves.
+  // Declared before the scopes that point into it.
+  std::unique_ptr<SymbolSlots> slots_;
+
   std::unique_ptr<Scope> global_scope_;
   std::unordered_map<std::string_view, std::unique_ptr<Scope>, StringViewHash, StringViewEqual>
     tree_scopes_;
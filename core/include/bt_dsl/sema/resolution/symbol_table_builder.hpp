@@ -98,7 +98,7 @@ private:
   void report_shadowing(SourceRange range, SourceRange prev_range, std::string_view name);
 
   /// Report an error
-  void report_error(SourceRange range, std::string_view message);
+  void report_error(SourceRange range, DiagnosticMessage message);
 
   // ===========================================================================
   // Member Variables
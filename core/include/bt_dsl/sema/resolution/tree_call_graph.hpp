@@ -0,0 +1,158 @@
+// bt_dsl/sema/resolution/tree_call_graph.hpp - Whole-program tree call graph
+//
+// Persistent graph of tree -> subtree invocations across modules, with
+// strongly connected components maintained incrementally (Tarjan).
+//
+// Edges are collected from NodeStmt::resolvedNode, so a module must have been
+// through NameResolver before it is added.
+//
+#pragma once
+
+#include <cstdint>
+#include <gsl/span>
+#include <unordered_map>
+#include <vector>
+
+#include "bt_dsl/ast/ast.hpp"
+#include "bt_dsl/basic/source_manager.hpp"
+
+namespace bt_dsl
+{
+
+// ============================================================================
+// Tree Call
+// ============================================================================
+
+/**
+ * A single call site of a tree from the body of another tree.
+ */
+struct TreeCall
+{
+  const TreeDecl * caller = nullptr;
+  const TreeDecl * callee = nullptr;
+  SourceRange range;  ///< Range of the calling NodeStmt
+
+  [[nodiscard]] bool operator==(const TreeCall & other) const noexcept
+  {
+    return caller == other.caller && callee == other.callee && range == other.range;
+  }
+};
+
+// ============================================================================
+// Tree Call Graph
+// ============================================================================
+
+/**
+ * Cross-module call graph between TreeDecl nodes.
+ *
+ * Modules contribute their trees with update_module(); edges are diffed
+ * against the previous contribution and only changed callers are marked
+ * dirty. recompute() then re-runs Tarjan's SCC algorithm on the region
+ * forward-reachable from dirty trees, leaving every other component as is.
+ *
+ * Trees are visited in registration order so components and diagnostics
+ * are deterministic.
+ *
+ * ## Usage
+ * ```cpp
+ * TreeCallGraph & calls = graph.call_graph();
+ * calls.update_module(module.file_id, *module.program);
+ * calls.recompute();
+ * if (calls.is_recursive(tree)) { ... }
+ * ```
+ */
+class TreeCallGraph
+{
+public:
+  /// Strongly connected component of the call graph.
+  struct Component
+  {
+    std::vector<const TreeDecl *> members;  ///< In registration order
+    bool recursive = false;                 ///< Contains a cycle (incl. self-call)
+  };
+
+  TreeCallGraph() = default;
+
+  // ===========================================================================
+  // Updates
+  // ===========================================================================
+
+  /**
+   * Replace the trees and call edges contributed by a module.
+   *
+   * @param owner Module that declares the trees
+   * @param program Name-resolved program of that module
+   * @return true if the graph changed (components need recompute())
+   */
+  bool update_module(FileId owner, const Program & program);
+
+  /**
+   * Remove all trees of a module. Edges from other modules into them are
+   * dropped as well.
+   */
+  void remove_module(FileId owner);
+
+  /// Remove all trees, edges and components.
+  void clear();
+
+  /**
+   * Recompute components affected by updates since the last call.
+   *
+   * @return Number of trees whose component was recomputed
+   */
+  size_t recompute();
+
+  /// Check whether updates are pending a recompute().
+  [[nodiscard]] bool is_dirty() const noexcept { return !dirty_.empty(); }
+
+  // ===========================================================================
+  // Queries
+  // ===========================================================================
+
+  /// Check whether a tree is part of the graph.
+  [[nodiscard]] bool contains(const TreeDecl * tree) const;
+
+  /// Outgoing calls of a tree, in source order.
+  [[nodiscard]] gsl::span<const TreeCall> callees(const TreeDecl * tree) const;
+
+  /// Incoming calls of a tree, grouped by caller in registration order.
+  [[nodiscard]] std::vector<TreeCall> callers(const TreeDecl * tree) const;
+
+  /// Component containing a tree (nullptr if unknown or not recomputed).
+  [[nodiscard]] const Component * component_of(const TreeDecl * tree) const;
+
+  /// Check whether a tree is part of a call cycle.
+  [[nodiscard]] bool is_recursive(const TreeDecl * tree) const;
+
+  /// All recursive components, ordered by their first member.
+  [[nodiscard]] std::vector<const Component *> recursive_components() const;
+
+  /// Number of trees in the graph.
+  [[nodiscard]] size_t size() const noexcept { return trees_.size(); }
+
+private:
+  static constexpr uint32_t k_no_component = UINT32_MAX;
+
+  struct TreeNode
+  {
+    FileId owner = FileId::invalid();
+    uint64_t order = 0;
+    bool declared = false;  ///< false for callees whose module is not added yet
+    std::vector<TreeCall> calls;
+    std::vector<const TreeDecl *> callers;  ///< Unique callers
+    uint32_t component = k_no_component;
+  };
+
+  TreeNode & get_or_create(const TreeDecl * tree);
+  void set_calls(const TreeDecl * tree, TreeNode & node, std::vector<TreeCall> calls);
+  void erase_tree(const TreeDecl * tree);
+
+  std::unordered_map<const TreeDecl *, TreeNode> trees_;
+  std::unordered_map<uint16_t, std::vector<const TreeDecl *>> module_trees_;
+  std::unordered_map<uint32_t, Component> components_;
+  std::vector<const TreeDecl *> dirty_;
+  uint64_t next_order_ = 0;
+  uint32_t next_component_ = 0;
+};
+
+}  // namespace bt_dsl
@@ -49,7 +49,7 @@ class AstContext;
  * ConstValue val = eval.evaluate(expr);
  * ```
  */
-class ConstEvaluator
+class ConstEvaluator : private LazyErrorReporter<ConstEvaluator>
 {
 public:
   /**
@@ -99,6 +99,16 @@ public:
    */
   std::optional<uint64_t> evaluate_array_size(const Expr * expr, SourceRange range);
 
+  /**
+   * Keep constants evaluated on demand (by evaluate()) to this evaluator
+   * instead of publishing them to their declarations' `evaluatedValue`.
+   *
+   * For evaluators over an AST they do not own (e.g. codegen folding, which
+   * may run on several threads): published values would point into this
+   * evaluator's AstContext.
+   */
+  void keep_results_private() noexcept { publish_results_ = false; }
+
   // ===========================================================================
   // Error State
   // ===========================================================================
@@ -164,7 +174,9 @@ private:
   void evaluate_default_args(Program & program);
 
   /// Report an error
-  void report_error(SourceRange range, std::string_view message);
+  void report_error(SourceRange range, DiagnosticMessage message);
+  using LazyErrorReporter::report_error;
+  friend class LazyErrorReporter<ConstEvaluator>;
 
   /// Store a value in the AST arena and return a stable pointer.
   const ConstValue * store_in_arena(const ConstValue & v);
@@ -186,6 +198,7 @@ private:
 
   bool has_errors_ = false;
   size_t error_count_ = 0;
+  bool publish_results_ = true;
 };
 
 // ============================================================================
@@ -5,15 +5,20 @@
 //
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <deque>
 #include <memory_resource>
 #include <string_view>
+#include <unordered_map>
+
+#include "bt_dsl/basic/counting_resource.hpp"
 
 namespace bt_dsl
 {
 
 class AstNode;
+class TypeNode;
 
 // ============================================================================
 // Type Kind
@@ -242,6 +247,26 @@ public:
   /// Returns nullptr if not a built-in type
   [[nodiscard]] const Type * lookup_builtin(std::string_view name) const;
 
+  // ===========================================================================
+  // Resolved Type Annotations
+  // ===========================================================================
+
+  /// Type `node` was resolved to in this context (nullptr if not resolved here)
+  [[nodiscard]] const Type * resolved_type(const TypeNode * node) const
+  {
+    auto it = resolved_types_.find(node);
+    return it != resolved_types_.end() ? it->second : nullptr;
+  }
+
+  /// Memoize the type `node` resolved to (see TypeChecker::resolve_type)
+  void set_resolved_type(const TypeNode * node, const Type * type)
+  {
+    resolved_types_[node] = type;
+  }
+
+  /// Bytes the composite type arena has obtained from the heap
+  [[nodiscard]] size_t bytes_reserved() const noexcept { return upstream_.bytes_in_use(); }
+
 private:
   // Built-in type singletons
   Type int8_, int16_, int32_, int64_;
@@ -253,10 +278,16 @@ private:
   Type unknown_;
 
   // Arena for composite types
-  std::pmr::monotonic_buffer_resource arena_{4096};
+  CountingMemoryResource upstream_;
+  std::pmr::monotonic_buffer_resource arena_{4096, &upstream_};
   // NOTE: pointers to interned composite types are handed out widely.
   // We must use a container with stable element addresses.
   std::pmr::deque<Type> composite_types_{&arena_};
+
+  // Kept here rather than on the TypeNodes: an AST may be checked in several
+  // contexts (e.g. an import by each importer), and the types are interned
+  // per context, so the memo must not outlive or cross contexts.
+  std::unordered_map<const TypeNode *, const Type *> resolved_types_;
 };
 
 }  // namespace bt_dsl
@@ -44,7 +44,7 @@ namespace bt_dsl
  * // After this, all Expr::resolvedType fields are set
  * ```
  */
-class TypeChecker
+class TypeChecker : private LazyErrorReporter<TypeChecker>
 {
 public:
   /**
@@ -134,11 +134,14 @@ private:
   void check_global_var_decl(GlobalVarDecl * decl);
   void check_global_const_decl(GlobalConstDecl * decl);
 
+  /// Resolve declared port and parameter types once per module.
+  void resolve_signature_types(Program & program);
+
   // ===========================================================================
   // Helper Methods
   // ===========================================================================
 
-  /// Resolve a TypeNode AST to semantic Type
+  /// Resolve a TypeNode AST to semantic Type (memoized on the node)
   const Type * resolve_type(const TypeNode * node);
 
   /// Get type of a symbol from SymbolTable
@@ -166,7 +169,9 @@ private:
   const Type * apply_defaults(const Type * type);
 
   /// Report an error
-  void report_error(SourceRange range, std::string_view message);
+  void report_error(SourceRange range, DiagnosticMessage message);
+  using LazyErrorReporter::report_error;
+  friend class LazyErrorReporter<TypeChecker>;
 
   // ===========================================================================
   // Member Variables
@@ -194,11 +199,26 @@ private:
   // Deduplication for circular type alias diagnostics (report once per cycle anchor).
   std::unordered_set<const TypeAliasDecl *> reported_alias_cycles_;
 
-  // Current value scope (tree scope or children_block scope) during checking.
-  const Scope * current_scope_ = nullptr;
-
   bool has_errors_ = false;
   size_t error_count_ = 0;
 };
 
+// ============================================================================
+// Helper Functions
+// ============================================================================
+
+/**
+ * Get the semantic type TypeChecker memoized for a TypeNode in `types`.
+ *
+ * Declared types (ports, params, variables, aliases) are resolved once during
+ * type checking, so later stages (codegen, LSP) can reuse the result instead
+ * of walking the TypeNode again.
+ *
+ * @param node Type annotation to look up
+ * @param types TypeContext the annotation was checked in
+ * @return Resolved type (possibly the error type), or nullptr if not resolved
+ *         in this context
+ */
+const Type * get_resolved_type(const TypeNode * node, const TypeContext & types);
+
 }  // namespace bt_dsl
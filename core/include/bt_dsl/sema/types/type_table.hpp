@@ -168,6 +168,11 @@ public:
    */
   [[nodiscard]] size_t size() const noexcept { return symbols_.size(); }
 
+  /**
+   * Get all registered type symbols (excluding aliases).
+   */
+  [[nodiscard]] const auto & get_symbols() const noexcept { return symbols_; }
+
   /**
    * Get the canonical name for a type (resolves aliases).
    *
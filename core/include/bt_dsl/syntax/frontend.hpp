@@ -5,11 +5,13 @@
 #include <memory>
 #include <string>
 #include <string_view>
+#include <vector>
 
 #include "bt_dsl/ast/ast.hpp"
 #include "bt_dsl/ast/ast_context.hpp"
 #include "bt_dsl/basic/diagnostic.hpp"
 #include "bt_dsl/basic/source_manager.hpp"
+#include "bt_dsl/syntax/token.hpp"
 
 namespace bt_dsl
 {
@@ -18,6 +20,10 @@ struct ParseOutput
 {
   FileId file_id = FileId::invalid();
   Program * program = nullptr;
+
+  // Full token stream, comments included. Token text views point into the
+  // registered source content.
+  std::vector<syntax::Token> tokens;
 };
 
 // Parse pipeline:
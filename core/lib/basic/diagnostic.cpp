@@ -3,11 +3,58 @@
 
 #include <algorithm>
 #include <iterator>
+#include <ostream>
 #include <utility>
 
 namespace bt_dsl
 {
 
+// ============================================================================
+// DiagnosticMessage
+// ============================================================================
+
+std::string DiagnosticMessage::str() const
+{
+  if (is_owned_) {
+    return owned_;
+  }
+  if (args_.empty()) {
+    return std::string(pattern_);
+  }
+
+  std::string out;
+  size_t reserve = pattern_.size();
+  for (const auto & a : args_) reserve += a.size();
+  out.reserve(reserve);
+
+  size_t next_arg = 0;
+  for (size_t i = 0; i < pattern_.size(); ++i) {
+    if (pattern_[i] == '{' && i + 1 < pattern_.size() && pattern_[i + 1] == '}' &&
+        next_arg < args_.size()) {
+      out += args_[next_arg++];
+      ++i;
+      continue;
+    }
+    out += pattern_[i];
+  }
+  return out;
+}
+
+std::ostream & operator<<(std::ostream & os, const DiagnosticMessage & msg)
+{
+  if (msg.is_owned_) {
+    return os << msg.owned_;
+  }
+  if (msg.args_.empty()) {
+    return os << msg.pattern_;
+  }
+  return os << msg.str();
+}
+
+// ============================================================================
+// Diagnostic
+// ============================================================================
+
 const Label * Diagnostic::primary_label() const noexcept
 {
   for (const auto & l : labels) {
@@ -59,13 +106,14 @@ DiagnosticBuilder & DiagnosticBuilder::with_code(std::string code)
 }
 
 DiagnosticBuilder & DiagnosticBuilder::with_label(
-  SourceRange range, std::string msg, LabelStyle style)
+  SourceRange range, DiagnosticMessage msg, LabelStyle style)
 {
   diagnostic_.labels.push_back(Label{range, std::move(msg), style});
   return *this;
 }
 
-DiagnosticBuilder & DiagnosticBuilder::with_secondary_label(SourceRange range, std::string msg)
+DiagnosticBuilder & DiagnosticBuilder::with_secondary_label(
+  SourceRange range, DiagnosticMessage msg)
 {
   return with_label(range, std::move(msg), LabelStyle::Secondary);
 }
@@ -87,7 +135,7 @@ DiagnosticBuilder & DiagnosticBuilder::with_help(std::string help_msg)
 // ============================================================================
 
 DiagnosticBuilder DiagnosticBag::report_error(
-  SourceRange range, std::string message, std::string label_message)
+  SourceRange range, DiagnosticMessage message, DiagnosticMessage label_message)
 {
   Diagnostic d;
   d.severity = Severity::Error;
@@ -97,7 +145,7 @@ DiagnosticBuilder DiagnosticBag::report_error(
 }
 
 DiagnosticBuilder DiagnosticBag::report_warning(
-  SourceRange range, std::string message, std::string label_message)
+  SourceRange range, DiagnosticMessage message, DiagnosticMessage label_message)
 {
   Diagnostic d;
   d.severity = Severity::Warning;
@@ -107,7 +155,7 @@ DiagnosticBuilder DiagnosticBag::report_warning(
 }
 
 DiagnosticBuilder DiagnosticBag::report_info(
-  SourceRange range, std::string message, std::string label_message)
+  SourceRange range, DiagnosticMessage message, DiagnosticMessage label_message)
 {
   Diagnostic d;
   d.severity = Severity::Info;
@@ -117,7 +165,7 @@ DiagnosticBuilder DiagnosticBag::report_info(
 }
 
 DiagnosticBuilder DiagnosticBag::report_hint(
-  SourceRange range, std::string message, std::string label_message)
+  SourceRange range, DiagnosticMessage message, DiagnosticMessage label_message)
 {
   Diagnostic d;
   d.severity = Severity::Hint;
@@ -126,40 +174,16 @@ DiagnosticBuilder DiagnosticBag::report_hint(
   return {*this, std::move(d)};
 }
 
-void DiagnosticBag::add(Diagnostic && diag) { diagnostics_.push_back(std::move(diag)); }
-
-void DiagnosticBag::add(const Diagnostic & diag) { diagnostics_.push_back(diag); }
-
-std::vector<Diagnostic> DiagnosticBag::errors() const
-{
-  std::vector<Diagnostic> result;
-  std::copy_if(
-    diagnostics_.begin(), diagnostics_.end(), std::back_inserter(result),
-    [](const Diagnostic & d) { return d.severity == Severity::Error; });
-  return result;
-}
-
-std::vector<Diagnostic> DiagnosticBag::warnings() const
+void DiagnosticBag::add(Diagnostic && diag)
 {
-  std::vector<Diagnostic> result;
-  std::copy_if(
-    diagnostics_.begin(), diagnostics_.end(), std::back_inserter(result),
-    [](const Diagnostic & d) { return d.severity == Severity::Warning; });
-  return result;
+  ++counts_[static_cast<size_t>(diag.severity)];
+  diagnostics_.push_back(std::move(diag));
 }
 
-bool DiagnosticBag::has_errors() const
+void DiagnosticBag::add(const Diagnostic & diag)
 {
-  return std::any_of(diagnostics_.begin(), diagnostics_.end(), [](const Diagnostic & d) {
-    return d.severity == Severity::Error;
-  });
-}
-
-bool DiagnosticBag::has_warnings() const
-{
-  return std::any_of(diagnostics_.begin(), diagnostics_.end(), [](const Diagnostic & d) {
-    return d.severity == Severity::Warning;
-  });
+  ++counts_[static_cast<size_t>(diag.severity)];
+  diagnostics_.push_back(diag);
 }
 
 void DiagnosticBag::merge(DiagnosticBag && other)
@@ -167,12 +191,19 @@ void DiagnosticBag::merge(DiagnosticBag && other)
   diagnostics_.insert(
     diagnostics_.end(), std::make_move_iterator(other.diagnostics_.begin()),
     std::make_move_iterator(other.diagnostics_.end()));
+  for (size_t i = 0; i < k_severity_count; ++i) {
+    counts_[i] += other.counts_[i];
+  }
   other.diagnostics_.clear();
+  other.counts_ = {};
 }
 
 void DiagnosticBag::merge(const DiagnosticBag & other)
 {
   diagnostics_.insert(diagnostics_.end(), other.diagnostics_.begin(), other.diagnostics_.end());
+  for (size_t i = 0; i < k_severity_count; ++i) {
+    counts_[i] += other.counts_[i];
+  }
 }
 
 }  // namespace bt_dsl
@@ -78,18 +78,21 @@ void DiagnosticPrinter::print(const Diagnostic & diag, const SourceRegistry & so
 
 void DiagnosticPrinter::print_all(const DiagnosticBag & diags, const SourceRegistry & sources)
 {
-  std::vector<Diagnostic> sorted_diags;
+  // Sort pointers, not Diagnostic copies (bags can be large).
+  std::vector<const Diagnostic *> sorted_diags;
   sorted_diags.reserve(diags.size());
-  std::copy(diags.begin(), diags.end(), std::back_inserter(sorted_diags));
+  for (const auto & d : diags) {
+    sorted_diags.push_back(&d);
+  }
 
   // Sort by primary start location (stable)
   std::stable_sort(
-    sorted_diags.begin(), sorted_diags.end(), [](const Diagnostic & a, const Diagnostic & b) {
-      return a.primary_range().get_begin() < b.primary_range().get_begin();
+    sorted_diags.begin(), sorted_diags.end(), [](const Diagnostic * a, const Diagnostic * b) {
+      return a->primary_range().get_begin() < b->primary_range().get_begin();
     });
 
-  for (const auto & d : sorted_diags) {
-    print(d, sources);
+  for (const auto * d : sorted_diags) {
+    print(*d, sources);
   }
 }
 
@@ -136,9 +139,9 @@ void DiagnosticPrinter::print_severity_header(const Diagnostic & diag)
         break;
     }
     if (!diag.code.empty()) {
-      fmt::print(os_, "{}[{}]: {}\n", severity_str, diag.code, diag.message);
+      fmt::print(os_, "{}[{}]: {}\n", severity_str, diag.code, diag.message.str());
     } else {
-      fmt::print(os_, "{}: {}\n", severity_str, diag.message);
+      fmt::print(os_, "{}: {}\n", severity_str, diag.message.str());
     }
   }
 }
@@ -148,7 +151,7 @@ void DiagnosticPrinter::print_label_context(const Label & label, const SourceReg
   if (!label.range.is_valid()) {
     // No valid range - print as a note if message exists
     if (!label.message.empty()) {
-      print_note(label.message);
+      print_note(label.message.str());
     }
     return;
   }
@@ -173,7 +176,7 @@ void DiagnosticPrinter::print_label_context(const Label & label, const SourceReg
                              : (fr.start_column + 1);
 
   print_source_line(
-    *source, fr.start_line - 1, fr.start_column, end_col, label.style, label.message);
+    *source, fr.start_line - 1, fr.start_column, end_col, label.style, label.message.str());
 }
 
 void DiagnosticPrinter::print_source_line(
@@ -0,0 +1,445 @@
+// bt_dsl/codegen/blackboard_optimizer.cpp - Blackboard key coalescing pass
+//
+#include "bt_dsl/codegen/blackboard_optimizer.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <queue>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "bt_dsl/codegen/model_keys.hpp"
+
+namespace bt_dsl
+{
+
+namespace
+{
+
+using btcpp::AttrKind;
+using btcpp::classify_attribute;
+using btcpp::is_local_key;
+
+// ============================================================================
+// Key Tokens
+// ============================================================================
+
+/// Call `fn(offset, length)` for every codegen-local key (`name#N`) in a script.
+template <typename Fn>
+void for_each_key_in_script(std::string_view text, Fn && fn)
+{
+  btcpp::for_each_script_key(text, [&](size_t off, size_t len, std::string_view key, bool braced) {
+    if (!is_local_key(key)) {
+      return;
+    }
+    if (braced) {
+      fn(off + 1U, len - 2U);
+    } else {
+      fn(off, len);
+    }
+  });
+}
+
+[[nodiscard]] size_t skip_spaces(std::string_view text, size_t pos)
+{
+  while (pos < text.size() && text[pos] == ' ') {
+    ++pos;
+  }
+  return pos;
+}
+
+struct ScriptWrite
+{
+  size_t offset = 0;
+  size_t length = 0;
+  bool is_definition = false;  // `:=` (creates the entry) rather than `=`
+};
+
+/// Recognize the `k := e` / `k = e` statements emitted for declarations and assignments.
+[[nodiscard]] std::optional<ScriptWrite> match_script_write(std::string_view code)
+{
+  const size_t start = skip_spaces(code, 0);
+  const size_t len = btcpp::key_length(code, start);
+  if (!is_local_key(code.substr(start, len))) {
+    return std::nullopt;
+  }
+  const size_t op = skip_spaces(code, start + len);
+  if (code.substr(op, 2) == ":=") {
+    return ScriptWrite{start, len, true};
+  }
+  if (op < code.size() && code[op] == '=' && code.substr(op, 2) != "==") {
+    return ScriptWrite{start, len, false};
+  }
+  return std::nullopt;
+}
+
+// ============================================================================
+// Node Classification
+// ============================================================================
+
+/// Script without preconditions: it always runs once and succeeds.
+[[nodiscard]] bool is_plain_script(const btcpp::Node & node)
+{
+  return node.tag == "Script" && node.attributes.size() == 1U &&
+         node.attributes[0].key == "code";
+}
+
+/// Controls that tick their children in order, at most once per activation.
+[[nodiscard]] bool is_sequential_control(std::string_view tag)
+{
+  return tag == "Sequence" || tag == "Fallback" || tag == "ForceSuccess" ||
+         tag == "ForceFailure" || tag == "Inverter";
+}
+
+/// Codegen-local key of a whole `{name#N}` port value.
+[[nodiscard]] std::optional<std::string_view> port_key(std::string_view value)
+{
+  const auto key = btcpp::braced_key(value);
+  return key && is_local_key(*key) ? key : std::nullopt;
+}
+
+// ============================================================================
+// Analysis
+// ============================================================================
+
+struct KeyInfo
+{
+  uint32_t first = 0;
+  uint32_t last = 0;
+  size_t reads = 0;
+  bool defined_first = false;
+};
+
+struct Analysis
+{
+  std::unordered_map<std::string_view, KeyInfo> keys;
+  std::vector<std::pair<uint32_t, uint32_t>> barriers;
+  uint32_t next_pos = 0;
+
+  void note(std::string_view key, uint32_t pos, bool read, bool definition)
+  {
+    auto [it, inserted] = keys.try_emplace(key);
+    KeyInfo & info = it->second;
+    if (inserted) {
+      info.first = pos;
+      info.defined_first = definition;
+    }
+    info.last = pos;
+    if (read) {
+      ++info.reads;
+    }
+  }
+
+  void visit(const btcpp::Node & node)
+  {
+    const uint32_t pos = next_pos++;
+    const bool plain_script = is_plain_script(node);
+
+    for (const auto & a : node.attributes) {
+      switch (classify_attribute(node.tag, a.key)) {
+        case AttrKind::Script: {
+          const auto write = plain_script ? match_script_write(a.value) : std::nullopt;
+          for_each_key_in_script(a.value, [&](size_t off, size_t len) {
+            const bool is_target = write && write->offset == off;
+            note(a.value.substr(off, len), pos, !is_target, is_target && write->is_definition);
+          });
+          break;
+        }
+        case AttrKind::BareKey:
+          if (is_local_key(a.value)) {
+            note(a.value, pos, true, false);
+          }
+          break;
+        case AttrKind::Port:
+          if (const auto k = port_key(a.value)) {
+            note(*k, pos, true, false);
+          }
+          break;
+      }
+    }
+
+    for (const auto & ch : node.children) {
+      visit(ch);
+    }
+
+    if (!node.children.empty() && !is_sequential_control(node.tag)) {
+      barriers.emplace_back(pos, next_pos - 1U);
+    }
+  }
+
+  /// Widen lifetimes that touch a barrier subtree to the whole subtree.
+  void apply_barriers()
+  {
+    for (auto & [key, info] : keys) {
+      for (const auto & [start, end] : barriers) {
+        if (info.first <= end && start <= info.last) {
+          info.first = std::min(info.first, start);
+          info.last = std::max(info.last, end);
+        }
+      }
+    }
+  }
+};
+
+[[nodiscard]] Analysis analyze(const btcpp::Node & root)
+{
+  Analysis a;
+  a.visit(root);
+  return a;
+}
+
+// ============================================================================
+// Rewriting
+// ============================================================================
+
+class Rewriter
+{
+public:
+  Rewriter(
+    btcpp::ModelArena & arena, const std::unordered_set<std::string_view> & dead,
+    const std::unordered_map<std::string_view, std::string_view> & rename)
+  : arena_(arena), dead_(dead), rename_(rename)
+  {
+  }
+
+  [[nodiscard]] btcpp::Node rewrite_root(const btcpp::Node & root)
+  {
+    if (is_dead_script(root)) {
+      ++removed_;
+      return always_success();
+    }
+    return rewrite(root);
+  }
+
+  [[nodiscard]] size_t removed() const noexcept { return removed_; }
+
+private:
+  [[nodiscard]] bool is_dead_script(const btcpp::Node & node) const
+  {
+    if (dead_.empty() || !is_plain_script(node)) {
+      return false;
+    }
+    const std::string_view code = node.attributes[0].value;
+    const auto write = match_script_write(code);
+    return write && dead_.count(code.substr(write->offset, write->length)) > 0;
+  }
+
+  [[nodiscard]] btcpp::Node always_success()
+  {
+    return btcpp::NodeBuilder(arena_, "AlwaysSuccess").build();
+  }
+
+  [[nodiscard]] std::optional<std::string> renamed_value(AttrKind kind, std::string_view value)
+  {
+    if (rename_.empty()) {
+      return std::nullopt;
+    }
+    auto lookup = [&](std::string_view key) -> std::optional<std::string_view> {
+      auto it = rename_.find(key);
+      return it != rename_.end() ? std::optional<std::string_view>(it->second) : std::nullopt;
+    };
+
+    switch (kind) {
+      case AttrKind::Script: {
+        std::string out;
+        size_t copied = 0;
+        for_each_key_in_script(value, [&](size_t off, size_t len) {
+          if (const auto to = lookup(value.substr(off, len))) {
+            out.append(value.substr(copied, off - copied));
+            out.append(*to);
+            copied = off + len;
+          }
+        });
+        if (copied == 0) {
+          return std::nullopt;
+        }
+        out.append(value.substr(copied));
+        return out;
+      }
+      case AttrKind::BareKey:
+        if (const auto to = lookup(value)) {
+          return std::string(*to);
+        }
+        return std::nullopt;
+      case AttrKind::Port:
+        if (const auto k = port_key(value)) {
+          if (const auto to = lookup(*k)) {
+            return "{" + std::string(*to) + "}";
+          }
+        }
+        return std::nullopt;
+    }
+    return std::nullopt;
+  }
+
+  [[nodiscard]] btcpp::Node rewrite(const btcpp::Node & node)
+  {
+    bool changed = false;
+
+    std::vector<btcpp::Attribute> attrs(node.attributes.begin(), node.attributes.end());
+    for (auto & a : attrs) {
+      if (auto v = renamed_value(classify_attribute(node.tag, a.key), a.value)) {
+        a.value = arena_.store(*v);
+        changed = true;
+      }
+    }
+
+    // A plain Script always succeeds, so inside a Sequence it can simply be
+    // dropped; elsewhere it is replaced by a node with the same result.
+    const bool in_sequence = node.tag == "Sequence";
+    std::vector<btcpp::Node> children;
+    children.reserve(node.children.size());
+    for (const auto & ch : node.children) {
+      if (is_dead_script(ch)) {
+        ++removed_;
+        changed = true;
+        if (!in_sequence) {
+          children.push_back(always_success());
+        }
+        continue;
+      }
+      const btcpp::Node out = rewrite(ch);
+      changed = changed || out.children.data() != ch.children.data() ||
+                out.attributes.data() != ch.attributes.data();
+      children.push_back(out);
+    }
+    if (children.empty() && !node.children.empty()) {
+      children.push_back(always_success());
+    }
+
+    if (!changed) {
+      return node;
+    }
+    btcpp::Node out = node;
+    out.attributes = arena_.copy_array<btcpp::Attribute>(attrs);
+    out.children = arena_.copy_array<btcpp::Node>(children);
+    return out;
+  }
+
+  btcpp::ModelArena & arena_;
+  const std::unordered_set<std::string_view> & dead_;
+  const std::unordered_map<std::string_view, std::string_view> & rename_;
+  size_t removed_ = 0;
+};
+
+/**
+ * Assign names to keys by greedy interval coloring (optimal for interval graphs),
+ * separately for each entry type. Keys of unknown type keep their own name.
+ *
+ * @return old key -> representative key, for keys that change name
+ */
+[[nodiscard]] std::unordered_map<std::string_view, std::string_view> color_keys(
+  const Analysis & a, const std::unordered_map<std::string, std::string> & key_types)
+{
+  struct Candidate
+  {
+    std::string_view key;
+    std::string_view type;
+    const KeyInfo * info;
+  };
+  std::vector<Candidate> candidates;
+  for (const auto & [key, info] : a.keys) {
+    auto type = key_types.find(std::string(key));
+    if (info.defined_first && type != key_types.end()) {
+      candidates.push_back(Candidate{key, type->second, &info});
+    }
+  }
+  std::sort(candidates.begin(), candidates.end(), [](const auto & x, const auto & y) {
+    if (x.info->first != y.info->first) return x.info->first < y.info->first;
+    return x.key < y.key;
+  });
+
+  using Slot = std::pair<uint32_t, size_t>;  // (last occupied position, slot index)
+  struct Pool
+  {
+    std::priority_queue<Slot, std::vector<Slot>, std::greater<>> busy;
+    std::vector<std::string_view> representative;
+  };
+  std::unordered_map<std::string_view, Pool> pools;
+  std::unordered_map<std::string_view, std::string_view> rename;
+
+  for (const auto & c : candidates) {
+    Pool & pool = pools[c.type];
+    size_t slot = 0;
+    if (!pool.busy.empty() && pool.busy.top().first < c.info->first) {
+      slot = pool.busy.top().second;
+      pool.busy.pop();
+      rename.emplace(c.key, pool.representative[slot]);
+    } else {
+      slot = pool.representative.size();
+      pool.representative.push_back(c.key);
+    }
+    pool.busy.emplace(c.info->last, slot);
+  }
+
+  return rename;
+}
+
+}  // namespace
+
+// ============================================================================
+// BlackboardKeyOptimizer
+// ============================================================================
+
+BlackboardKeyStats BlackboardKeyOptimizer::run(btcpp::Document & doc)
+{
+  BlackboardKeyStats total;
+  for (auto & tree : doc.behavior_trees) {
+    total += run(tree);
+  }
+  return total;
+}
+
+BlackboardKeyStats BlackboardKeyOptimizer::run(btcpp::BehaviorTreeModel & tree)
+{
+  BlackboardKeyStats stats;
+  if (!tree.root.has_value() || !tree.arena) {
+    return stats;
+  }
+
+  const std::unordered_map<std::string_view, std::string_view> no_rename;
+  Analysis a = analyze(*tree.root);
+  stats.keys_before = a.keys.size();
+
+  // 1. Remove write-only keys until a fixpoint (removing a write may drop
+  //    the last read of another key).
+  for (;;) {
+    std::unordered_set<std::string_view> dead;
+    for (const auto & [key, info] : a.keys) {
+      if (info.reads == 0) dead.insert(key);
+    }
+    if (dead.empty()) {
+      break;
+    }
+    Rewriter rw(*tree.arena, dead, no_rename);
+    tree.root = rw.rewrite_root(*tree.root);
+    if (rw.removed() == 0) {
+      break;
+    }
+    stats.scripts_removed += rw.removed();
+    a = analyze(*tree.root);
+  }
+
+  // 2. Share keys with disjoint lifetimes.
+  a.apply_barriers();
+  const auto rename = color_keys(a, tree.key_types);
+  if (!rename.empty()) {
+    const std::unordered_set<std::string_view> no_dead;
+    Rewriter rw(*tree.arena, no_dead, rename);
+    tree.root = rw.rewrite_root(*tree.root);
+    for (const auto & [from, to] : rename) {
+      tree.key_types.erase(std::string(from));
+    }
+  }
+
+  stats.keys_after = a.keys.size() - rename.size();
+  return stats;
+}
+
+}  // namespace bt_dsl
@@ -0,0 +1,526 @@
+// bt_dsl/codegen/cpp_generator.cpp - BehaviorTree.CPP C++ source generator
+//
+#include "bt_dsl/codegen/cpp_generator.hpp"
+
+#include <cstddef>
+#include <cstdio>
+#include <gsl/span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "bt_dsl/codegen/model_optimizer.hpp"
+#include "bt_dsl/codegen/xml_generator.hpp"
+
+namespace bt_dsl
+{
+
+namespace
+{
+
+// Runtime support emitted into every generated translation unit. It mirrors
+// the node instantiation done by BT::XMLParser, using public BT.CPP v4 API.
+constexpr std::string_view k_builder_runtime = R"cpp(struct Attr
+{
+  const char * key;
+  const char * value;
+};
+
+class Builder;
+using BuildFn = BT::TreeNode * (*)(Builder &);
+
+bool apply_condition(BT::NodeConfig & config, const std::string & key, const char * value)
+{
+  static const std::pair<const char *, BT::PreCond> pre[] = {
+    {"_failureIf", BT::PreCond::FAILURE_IF},
+    {"_successIf", BT::PreCond::SUCCESS_IF},
+    {"_skipIf", BT::PreCond::SKIP_IF},
+    {"_while", BT::PreCond::WHILE_TRUE},
+  };
+  static const std::pair<const char *, BT::PostCond> post[] = {
+    {"_onHalted", BT::PostCond::ON_HALTED},
+    {"_onFailure", BT::PostCond::ON_FAILURE},
+    {"_onSuccess", BT::PostCond::ON_SUCCESS},
+    {"_post", BT::PostCond::ALWAYS},
+  };
+  for (const auto & [name, cond] : pre) {
+    if (key == name) {
+      config.pre_conditions[cond] = value;
+      return true;
+    }
+  }
+  for (const auto & [name, cond] : post) {
+    if (key == name) {
+      config.post_conditions[cond] = value;
+      return true;
+    }
+  }
+  return false;
+}
+
+class Builder
+{
+public:
+  Builder(const BT::BehaviorTreeFactory & factory, BT::Tree & tree) : factory_(factory), tree_(tree)
+  {
+  }
+
+  void root(const char * tree_id, BT::Blackboard::Ptr blackboard, BuildFn build)
+  {
+    auto subtree = std::make_shared<BT::Tree::Subtree>();
+    subtree->blackboard = std::move(blackboard);
+    subtree->tree_ID = tree_id;
+    enter(std::move(subtree), {}, build);
+  }
+
+  BT::TreeNode * node(
+    const char * id, std::initializer_list<Attr> attrs,
+    std::initializer_list<BT::TreeNode *> children)
+  {
+    const BT::TreeNodeManifest & manifest = manifest_for(id);
+    BT::NodeConfig config = make_config(manifest);
+    std::string name = id;
+
+    for (const auto & a : attrs) {
+      const std::string key = a.key;
+      if (key == "name") {
+        name = a.value;
+        continue;
+      }
+      if (apply_condition(config, key, a.value)) {
+        continue;
+      }
+      auto port = manifest.ports.find(key);
+      if (port == manifest.ports.end()) {
+        throw BT::RuntimeError("node '", id, "' has no port named '", key, "'");
+      }
+      if (port->second.direction() != BT::PortDirection::OUTPUT) {
+        config.input_ports[key] = a.value;
+      }
+      if (port->second.direction() != BT::PortDirection::INPUT) {
+        config.output_ports[key] = a.value;
+      }
+    }
+
+    for (const auto & [port_name, info] : manifest.ports) {
+      if (info.defaultValueString().empty()) {
+        continue;
+      }
+      if (info.direction() != BT::PortDirection::OUTPUT) {
+        config.input_ports.emplace(port_name, info.defaultValueString());
+      }
+      if (info.direction() != BT::PortDirection::INPUT) {
+        config.output_ports.emplace(port_name, info.defaultValueString());
+      }
+    }
+
+    config.path = scope().path + name;
+    BT::TreeNode::Ptr created = factory_.instantiateTreeNode(name, id, config);
+
+    if (auto * control = dynamic_cast<BT::ControlNode *>(created.get())) {
+      for (auto * child : children) {
+        control->addChild(child);
+      }
+    } else if (auto * decorator = dynamic_cast<BT::DecoratorNode *>(created.get())) {
+      if (children.size() != 1) {
+        throw BT::RuntimeError("decorator '", id, "' must have exactly one child");
+      }
+      decorator->setChild(*children.begin());
+    } else if (children.size() != 0) {
+      throw BT::RuntimeError("leaf node '", id, "' cannot have children");
+    }
+
+    return add(std::move(created));
+  }
+
+  BT::TreeNode * subtree(const char * tree_id, std::initializer_list<Attr> attrs, BuildFn build)
+  {
+    BT::NodeConfig config = make_config(manifest_for("SubTree"));
+    std::string name = tree_id;
+
+    auto subtree = std::make_shared<BT::Tree::Subtree>();
+    subtree->blackboard = BT::Blackboard::create(scope().subtree->blackboard);
+    subtree->tree_ID = tree_id;
+
+    for (const auto & a : attrs) {
+      const std::string key = a.key;
+      if (key == "name") {
+        name = a.value;
+        continue;
+      }
+      if (key == "_autoremap") {
+        subtree->blackboard->enableAutoRemapping(std::string(a.value) == "true");
+        continue;
+      }
+      if (apply_condition(config, key, a.value)) {
+        continue;
+      }
+      BT::StringView remapped;
+      if (BT::TreeNode::isBlackboardPointer(a.value, &remapped)) {
+        subtree->blackboard->addSubtreeRemapping(key, remapped);
+      } else {
+        subtree->blackboard->set(key, std::string(a.value));
+      }
+    }
+
+    config.path = scope().path + name;
+    subtree->instance_name = config.path;
+
+    BT::TreeNode::Ptr created = factory_.instantiateTreeNode(name, "SubTree", config);
+    auto * subtree_node = static_cast<BT::SubTreeNode *>(created.get());
+    subtree_node->setSubtreeID(tree_id);
+    subtree_node->setChild(enter(std::move(subtree), config.path + "/", build));
+
+    return add(std::move(created));
+  }
+
+private:
+  struct Scope
+  {
+    BT::Tree::Subtree::Ptr subtree;
+    std::string path;
+  };
+
+  BT::TreeNode * enter(BT::Tree::Subtree::Ptr subtree, std::string path, BuildFn build)
+  {
+    const std::string tree_id = subtree->tree_ID;
+    tree_.subtrees.push_back(subtree);
+    scopes_.push_back(Scope{std::move(subtree), std::move(path)});
+    BT::TreeNode * root = build(*this);
+    if (root == nullptr) {
+      throw BT::RuntimeError("tree '", tree_id, "' is empty");
+    }
+
+    // Children are created before their parents; BT::Tree expects the root
+    // to be the first node of each subtree.
+    auto & nodes = scopes_.back().subtree->nodes;
+    auto it = std::find_if(
+      nodes.begin(), nodes.end(), [root](const BT::TreeNode::Ptr & n) { return n.get() == root; });
+    std::rotate(nodes.begin(), it, it + 1);
+
+    scopes_.pop_back();
+    return root;
+  }
+
+  const Scope & scope() const { return scopes_.back(); }
+
+  const BT::TreeNodeManifest & manifest_for(const char * id) const
+  {
+    auto it = factory_.manifests().find(id);
+    if (it == factory_.manifests().end()) {
+      throw BT::RuntimeError("node '", id, "' is not registered");
+    }
+    return it->second;
+  }
+
+  BT::NodeConfig make_config(const BT::TreeNodeManifest & manifest)
+  {
+    BT::NodeConfig config;
+    config.blackboard = scope().subtree->blackboard;
+    config.manifest = &manifest;
+    config.uid = next_uid_++;
+    return config;
+  }
+
+  BT::TreeNode * add(BT::TreeNode::Ptr created)
+  {
+    BT::TreeNode * raw = created.get();
+    scopes_.back().subtree->nodes.push_back(std::move(created));
+    return raw;
+  }
+
+  const BT::BehaviorTreeFactory & factory_;
+  BT::Tree & tree_;
+  std::vector<Scope> scopes_;
+  std::uint16_t next_uid_ = 1;
+};
+)cpp";
+
+[[nodiscard]] std::string sanitize_identifier(std::string_view name)
+{
+  std::string out;
+  out.reserve(name.size() + 1U);
+  for (const char c : name) {
+    const bool alnum =
+      (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+    out.push_back(alnum ? c : '_');
+  }
+  if (out.empty() || (out.front() >= '0' && out.front() <= '9')) {
+    out.insert(out.begin(), '_');
+  }
+  return out;
+}
+
+[[nodiscard]] std::string cpp_string_literal(std::string_view s)
+{
+  std::string out;
+  out.reserve(s.size() + 2U);
+  out.push_back('"');
+  for (const char c : s) {
+    switch (c) {
+      case '"':
+        out += "\\\"";
+        break;
+      case '\\':
+        out += "\\\\";
+        break;
+      case '\n':
+        out += "\\n";
+        break;
+      case '\r':
+        out += "\\r";
+        break;
+      case '\t':
+        out += "\\t";
+        break;
+      default: {
+        const auto u = static_cast<unsigned char>(c);
+        if (u < 0x20U || u == 0x7FU) {
+          // Always three octal digits, so a following digit is not absorbed.
+          char buf[5];
+          std::snprintf(buf, sizeof(buf), "\\%03o", static_cast<unsigned>(u));
+          out += buf;
+        } else {
+          out.push_back(c);
+        }
+        break;
+      }
+    }
+  }
+  out.push_back('"');
+  return out;
+}
+
+[[nodiscard]] const char * port_direction_enum(btcpp::PortKind kind)
+{
+  switch (kind) {
+    case btcpp::PortKind::Input:
+      return "BT::PortDirection::INPUT";
+    case btcpp::PortKind::Output:
+      return "BT::PortDirection::OUTPUT";
+    case btcpp::PortKind::InOut:
+      return "BT::PortDirection::INOUT";
+  }
+  return "BT::PortDirection::INOUT";
+}
+
+class SourceWriter
+{
+public:
+  SourceWriter(const btcpp::Document & doc, std::string_view name)
+  : doc_(doc), name_(sanitize_identifier(name))
+  {
+    for (std::size_t i = 0; i < doc_.behavior_trees.size(); ++i) {
+      tree_index_.emplace(doc_.behavior_trees[i].id, i);
+    }
+  }
+
+  std::string write()
+  {
+    out_ += "// Generated by btc (target: btcpp_v4_cpp). Do not edit.\n";
+    out_ += "//\n";
+    out_ += "// Builds tree " + cpp_string_literal(doc_.main_tree_to_execute) +
+            " through the BehaviorTree.CPP v4 factory API.\n";
+    out_ += "//\n";
+    out_ += "#include <behaviortree_cpp/bt_factory.h>\n";
+    out_ += "#include <behaviortree_cpp/decorators/subtree_node.h>\n\n";
+    out_ += "#include <algorithm>\n#include <array>\n#include <cstdint>\n";
+    out_ += "#include <initializer_list>\n#include <memory>\n#include <string>\n";
+    out_ += "#include <utility>\n#include <vector>\n\n";
+    out_ += "namespace bt_dsl_generated\n{\n\nnamespace\n{\n\n";
+    out_ += k_builder_runtime;
+    out_ += "\n";
+
+    write_manifest_table();
+
+    for (std::size_t i = 0; i < doc_.behavior_trees.size(); ++i) {
+      out_ += "BT::TreeNode * " + build_fn(i) + "(Builder & b);  // " +
+              doc_.behavior_trees[i].id + "\n";
+    }
+    out_ += "\n";
+
+    for (std::size_t i = 0; i < doc_.behavior_trees.size(); ++i) {
+      write_tree(i);
+    }
+
+    out_ += "}  // namespace\n\n";
+    write_entry_points();
+    out_ += "}  // namespace bt_dsl_generated\n";
+    return std::move(out_);
+  }
+
+private:
+  [[nodiscard]] static std::string build_fn(std::size_t index)
+  {
+    return "build_tree_" + std::to_string(index);
+  }
+
+  void write_manifest_table()
+  {
+    std::size_t port_count = 0;
+    for (const auto & nm : doc_.node_models) {
+      port_count += nm.ports.size();
+    }
+
+    out_ += "struct DeclaredPort\n{\n  const char * node;\n  const char * port;\n";
+    out_ += "  BT::PortDirection direction;\n};\n\n";
+
+    out_ += "const std::array<const char *, " + std::to_string(doc_.node_models.size()) +
+            "> k_declared_nodes = {{\n";
+    for (const auto & nm : doc_.node_models) {
+      out_ += "  " + cpp_string_literal(nm.id) + ",\n";
+    }
+    out_ += "}};\n\n";
+
+    out_ += "const std::array<DeclaredPort, " + std::to_string(port_count) +
+            "> k_declared_ports = {{\n";
+    for (const auto & nm : doc_.node_models) {
+      for (const auto & p : nm.ports) {
+        out_ += "  {" + cpp_string_literal(nm.id) + ", " + cpp_string_literal(p.name) + ", " +
+                port_direction_enum(p.kind) + "},\n";
+      }
+    }
+    out_ += "}};\n\n";
+  }
+
+  void write_tree(std::size_t index)
+  {
+    const auto & tree = doc_.behavior_trees[index];
+    out_ += "// " + tree.id + "\n";
+    out_ += "BT::TreeNode * " + build_fn(index) + "(Builder & b)\n{\n";
+    if (tree.root.has_value()) {
+      out_ += "  return ";
+      write_node(*tree.root, 1);
+      out_ += ";\n";
+    } else {
+      out_ += "  (void)b;\n  return nullptr;\n";
+    }
+    out_ += "}\n\n";
+  }
+
+  void write_attrs(gsl::span<const btcpp::Attribute> attrs, std::string_view skip_key)
+  {
+    out_ += "{";
+    bool first = true;
+    for (const auto & a : attrs) {
+      if (a.key == skip_key) {
+        continue;
+      }
+      out_ += first ? "{" : ", {";
+      out_ += cpp_string_literal(a.key) + ", " + cpp_string_literal(a.value) + "}";
+      first = false;
+    }
+    out_ += "}";
+  }
+
+  void write_node(const btcpp::Node & node, int depth)
+  {
+    if (node.tag == "SubTree") {
+      std::string_view tree_id;
+      for (const auto & a : node.attributes) {
+        if (a.key == "ID") tree_id = a.value;
+      }
+      auto it = tree_index_.find(std::string(tree_id));
+      if (it == tree_index_.end()) {
+        throw std::runtime_error("SubTree references unknown tree '" + std::string(tree_id) + "'");
+      }
+      out_ += "b.subtree(" + cpp_string_literal(tree_id) + ", ";
+      write_attrs(node.attributes, "ID");
+      out_ += ", &" + build_fn(it->second) + ")";
+      return;
+    }
+
+    out_ += "b.node(" + cpp_string_literal(node.tag) + ", ";
+    write_attrs(node.attributes, {});
+    if (node.children.empty()) {
+      out_ += ", {})";
+      return;
+    }
+
+    const std::string indent(static_cast<std::size_t>(depth + 1) * 2U, ' ');
+    out_ += ", {\n";
+    for (const auto & child : node.children) {
+      out_ += indent;
+      write_node(child, depth + 1);
+      out_ += ",\n";
+    }
+    out_ += std::string(static_cast<std::size_t>(depth) * 2U, ' ') + "})";
+  }
+
+  void write_entry_points()
+  {
+    out_ += "void validate_" + name_ + "(const BT::BehaviorTreeFactory & factory)\n{\n";
+    out_ += "  const auto & manifests = factory.manifests();\n";
+    out_ += "  for (const char * id : k_declared_nodes) {\n";
+    out_ += "    if (manifests.count(id) == 0) {\n";
+    out_ += "      throw BT::RuntimeError(\"node '\", id, \"' is not registered\");\n";
+    out_ += "    }\n  }\n";
+    out_ += "  for (const auto & p : k_declared_ports) {\n";
+    out_ += "    const auto & ports = manifests.at(p.node).ports;\n";
+    out_ += "    auto it = ports.find(p.port);\n";
+    out_ += "    if (it == ports.end()) {\n";
+    out_ += "      throw BT::RuntimeError(\"node '\", p.node, \"' has no port named '\", p.port, "
+            "\"'\");\n";
+    out_ += "    }\n";
+    out_ += "    if (it->second.direction() != p.direction) {\n";
+    out_ += "      throw BT::RuntimeError(\"port '\", p.port, \"' of node '\", p.node, "
+            "\"' has a different direction\");\n";
+    out_ += "    }\n  }\n}\n\n";
+
+    std::size_t main_index = 0;
+    auto it = tree_index_.find(doc_.main_tree_to_execute);
+    if (it != tree_index_.end()) {
+      main_index = it->second;
+    }
+
+    out_ += "BT::Tree create_" + name_ + "(\n";
+    out_ += "  const BT::BehaviorTreeFactory & factory, BT::Blackboard::Ptr blackboard)\n{\n";
+    out_ += "  validate_" + name_ + "(factory);\n\n";
+    out_ += "  BT::Tree tree;\n";
+    if (!doc_.behavior_trees.empty()) {
+      out_ += "  Builder builder(factory, tree);\n";
+      out_ += "  builder.root(" + cpp_string_literal(doc_.behavior_trees[main_index].id) +
+              ", std::move(blackboard), &" + build_fn(main_index) + ");\n";
+    } else {
+      out_ += "  (void)blackboard;\n";
+    }
+    out_ += "  tree.manifests = factory.manifests();\n";
+    out_ += "  tree.initialize();\n";
+    out_ += "  return tree;\n}\n\n";
+
+    out_ += "BT::Tree create_" + name_ + "(const BT::BehaviorTreeFactory & factory)\n{\n";
+    out_ += "  return create_" + name_ + "(factory, BT::Blackboard::create());\n}\n\n";
+  }
+
+  const btcpp::Document & doc_;
+  std::string name_;
+  std::unordered_map<std::string, std::size_t> tree_index_;
+  std::string out_;
+};
+
+}  // namespace
+
+// ============================================================================
+// BtCppSourceSerializer
+// ============================================================================
+
+std::string BtCppSourceSerializer::serialize(const btcpp::Document & doc, std::string_view name)
+{
+  return SourceWriter(doc, name).write();
+}
+
+// ============================================================================
+// CppGenerator facade
+// ============================================================================
+
+std::string CppGenerator::generate_single_output(
+  const ModuleInfo & entry, std::string_view name, const CodegenOptions & options)
+{
+  auto model = AstToBtCppModelConverter::convert_single_output(entry, 0, options.types);
+  optimize_model(model, options);
+  return BtCppSourceSerializer::serialize(model, name);
+}
+
+}  // namespace bt_dsl
@@ -2,10 +2,19 @@
 //
 #include "bt_dsl/codegen/model_converter.hpp"
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <ostream>
 #include <sstream>
 #include <stdexcept>
-
-#include "tinyxml2.h"
+#include <thread>
+#include <unordered_map>
+#include <utility>
 
 namespace bt_dsl
 {
@@ -33,181 +42,531 @@ std::string sanitize_type_name(const std::string & type_name)
   return cleaned;
 }
 
-std::string get_string_attr(const tinyxml2::XMLElement * elem, const char * name)
+/// Category elements, in the order the converter emits them.
+constexpr std::array<std::string_view, 5> k_categories = {
+  "Action", "Condition", "Control", "Decorator", "SubTree"};
+
+[[nodiscard]] size_t category_rank(std::string_view category)
+{
+  for (size_t i = 0; i < k_categories.size(); ++i) {
+    if (k_categories[i] == category) return i;
+  }
+  return k_categories.size();
+}
+
+[[nodiscard]] bool is_space(char c) { return c == ' ' || c == '\t' || c == '\n' || c == '\r'; }
+
+[[nodiscard]] std::string_view trim(std::string_view s)
 {
-  const char * val = elem->Attribute(name);
-  return val ? std::string(val) : std::string();
+  const auto start = s.find_first_not_of(" \t\n\r");
+  if (start == std::string_view::npos) return {};
+  const auto end = s.find_last_not_of(" \t\n\r");
+  return s.substr(start, end - start + 1);
 }
 
-void parse_ports(
-  const tinyxml2::XMLElement * node_elem, const char * tag_name, ManifestPortDirection dir,
-  std::vector<ManifestPort> & out_ports)
+void append_utf8(std::string & out, std::uint32_t cp)
 {
-  for (const auto * child = node_elem->FirstChildElement(tag_name); child != nullptr;
-       child = child->NextSiblingElement(tag_name)) {
-    const std::string name = get_string_attr(child, "name");
-    if (name.empty()) {
-      continue;
+  if (cp < 0x80) {
+    out.push_back(static_cast<char>(cp));
+  } else if (cp < 0x800) {
+    out.push_back(static_cast<char>(0xC0 | (cp >> 6)));
+    out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+  } else if (cp < 0x10000) {
+    out.push_back(static_cast<char>(0xE0 | (cp >> 12)));
+    out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+    out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+  } else {
+    out.push_back(static_cast<char>(0xF0 | (cp >> 18)));
+    out.push_back(static_cast<char>(0x80 | ((cp >> 12) & 0x3F)));
+    out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+    out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+  }
+}
+
+/// Append `raw` with XML entity references decoded (unknown ones are kept).
+void append_decoded(std::string & out, std::string_view raw)
+{
+  while (!raw.empty()) {
+    const auto amp = raw.find('&');
+    out.append(raw.substr(0, amp));
+    if (amp == std::string_view::npos) return;
+    raw.remove_prefix(amp);
+
+    const auto semi = raw.find(';');
+    const std::string_view ent = raw.substr(1, semi == std::string_view::npos ? 0 : semi - 1);
+    bool decoded = true;
+    if (ent == "lt") {
+      out.push_back('<');
+    } else if (ent == "gt") {
+      out.push_back('>');
+    } else if (ent == "amp") {
+      out.push_back('&');
+    } else if (ent == "quot") {
+      out.push_back('"');
+    } else if (ent == "apos") {
+      out.push_back('\'');
+    } else if (ent.size() > 1 && ent[0] == '#') {
+      const bool hex = ent[1] == 'x' || ent[1] == 'X';
+      const std::string digits(ent.substr(hex ? 2 : 1));
+      char * parse_end = nullptr;
+      const unsigned long cp = std::strtoul(digits.c_str(), &parse_end, hex ? 16 : 10);
+      decoded = !digits.empty() && *parse_end == '\0' && cp > 0 && cp <= 0x10FFFF;
+      if (decoded) append_utf8(out, static_cast<std::uint32_t>(cp));
+    } else {
+      decoded = false;
+    }
+
+    if (decoded) {
+      raw.remove_prefix(semi + 1);
+    } else {
+      out.push_back('&');
+      raw.remove_prefix(1);
     }
+  }
+}
 
-    const std::string type = get_string_attr(child, "type");
-    const std::string attr_desc = get_string_attr(child, "description");
+[[nodiscard]] std::string sanitize_port_type(std::string_view type)
+{
+  return type.empty() ? std::string("any") : sanitize_type_name(std::string(type));
+}
 
-    std::string text_desc;
-    if (child->GetText() != nullptr) {
-      text_desc = child->GetText();
-      // Trim whitespace
-      auto start = text_desc.find_first_not_of(" \t\n\r");
-      auto end = text_desc.find_last_not_of(" \t\n\r");
-      if (start != std::string::npos && end != std::string::npos) {
-        text_desc = text_desc.substr(start, end - start + 1);
+/**
+ * Single-pass scanner for TreeNodesModel manifests.
+ *
+ * Walks the markup once, keeping only a stack of open element roles, and
+ * builds a ManifestNode as soon as its element closes. Accepts the same
+ * layouts as before: `<TreeNodesModel>` as the root, as the first matching
+ * child of the root, or node elements directly under the root.
+ */
+class ManifestScanner
+{
+public:
+  explicit ManifestScanner(std::string_view xml) : xml_(xml) {}
+
+  std::vector<ManifestNode> run()
+  {
+    while (pos_ < xml_.size()) {
+      const auto lt = xml_.find('<', pos_);
+      if (lt == std::string_view::npos) {
+        on_text(xml_.substr(pos_), false);
+        pos_ = xml_.size();
+        break;
+      }
+      on_text(xml_.substr(pos_, lt - pos_), false);
+      pos_ = lt;
+
+      if (starts_with("<!--")) {
+        skip_past("-->", "unterminated comment");
+      } else if (starts_with("<![CDATA[")) {
+        const auto begin = pos_ + 9;
+        skip_past("]]>", "unterminated CDATA section");
+        on_text(xml_.substr(begin, pos_ - 3 - begin), true);
+      } else if (starts_with("<?")) {
+        skip_past("?>", "unterminated processing instruction");
+      } else if (starts_with("<!")) {
+        skip_declaration();
+      } else if (starts_with("</")) {
+        close_tag();
       } else {
-        text_desc.clear();
+        open_tag();
       }
     }
 
-    const std::string description = (!text_desc.empty()) ? text_desc : attr_desc;
+    if (!stack_.empty()) {
+      fail("unexpected end of document inside <" + std::string(stack_.back().name) + ">");
+    }
+    if (!seen_root_) {
+      fail("document has no root element");
+    }
+    auto nodes = seen_model_ ? std::move(model_nodes_) : std::move(root_nodes_);
+    // Emit categories in a fixed order, ports grouped by direction.
+    std::stable_sort(nodes.begin(), nodes.end(), [](const auto & a, const auto & b) {
+      return category_rank(a.category) < category_rank(b.category);
+    });
+    for (auto & n : nodes) {
+      std::stable_sort(n.ports.begin(), n.ports.end(), [](const auto & a, const auto & b) {
+        return a.direction < b.direction;
+      });
+    }
+    return nodes;
+  }
+
+private:
+  enum class Role : std::uint8_t { Root, Container, Node, Port, Other };
 
-    out_ports.push_back(
-      {name, dir, (!type.empty() ? sanitize_type_name(type) : "any"), description});
+  struct Open
+  {
+    std::string_view name;
+    Role role;
+  };
+
+  [[noreturn]] void fail(const std::string & message) const
+  {
+    const std::string_view consumed = xml_.substr(0, pos_);
+    const auto line = 1 + std::count(consumed.begin(), consumed.end(), '\n');
+    throw std::runtime_error(
+      "Failed to parse XML: " + message + " (line " + std::to_string(line) + ")");
   }
-}
 
-}  // namespace
+  [[nodiscard]] bool starts_with(std::string_view prefix) const
+  {
+    return xml_.substr(pos_, prefix.size()) == prefix;
+  }
 
-std::vector<ManifestNode> ModelConverter::parse_xml(const std::string & xml_content)
-{
-  tinyxml2::XMLDocument doc;
-  const tinyxml2::XMLError err = doc.Parse(xml_content.c_str());
-  if (err != tinyxml2::XML_SUCCESS) {
-    throw std::runtime_error("Failed to parse XML: " + std::string(doc.ErrorStr()));
+  void skip_past(std::string_view terminator, const char * error)
+  {
+    const auto end = xml_.find(terminator, pos_);
+    if (end == std::string_view::npos) fail(error);
+    pos_ = end + terminator.size();
   }
 
-  std::vector<ManifestNode> result;
+  /// `<!DOCTYPE ...>`, including an internal subset in brackets.
+  void skip_declaration()
+  {
+    int brackets = 0;
+    for (size_t i = pos_ + 2; i < xml_.size(); ++i) {
+      if (xml_[i] == '[') {
+        ++brackets;
+      } else if (xml_[i] == ']') {
+        --brackets;
+      } else if (xml_[i] == '>' && brackets <= 0) {
+        pos_ = i + 1;
+        return;
+      }
+    }
+    fail("unterminated declaration");
+  }
 
-  // Helper to process a "root" or "TreeNodesModel" element that contains node
-  // definitions
-  auto process_container = [&](const tinyxml2::XMLElement * container) {
-    if (container == nullptr) {
-      return;
+  void skip_space()
+  {
+    while (pos_ < xml_.size() && is_space(xml_[pos_])) ++pos_;
+  }
+
+  std::string_view read_name()
+  {
+    const auto begin = pos_;
+    while (pos_ < xml_.size() && !is_space(xml_[pos_]) && xml_[pos_] != '/' &&
+           xml_[pos_] != '>' && xml_[pos_] != '=') {
+      ++pos_;
     }
+    if (pos_ == begin) fail("expected a name");
+    return xml_.substr(begin, pos_ - begin);
+  }
 
-    const char * categories[] = {"Action", "Condition", "Control", "Decorator", "SubTree"};
+  void open_tag()
+  {
+    ++pos_;  // '<'
+    const std::string_view name = read_name();
+    const Role role = role_for(name);
+
+    if (role == Role::Node) {
+      current_ = ManifestNode{};
+      current_.category = std::string(name);
+    } else if (role == Role::Port) {
+      port_ = ManifestPort{};
+      port_.direction = name == "input_port"    ? ManifestPortDirection::In
+                        : name == "output_port" ? ManifestPortDirection::Out
+                                                : ManifestPortDirection::InOut;
+      port_text_.clear();
+      port_type_.clear();
+    }
 
-    for (const char * cat : categories) {
-      for (const auto * node = container->FirstChildElement(cat); node != nullptr;
-           node = node->NextSiblingElement(cat)) {
-        const std::string id = get_string_attr(node, "ID");
-        if (id.empty()) {
-          continue;
-        }
+    for (;;) {
+      skip_space();
+      if (pos_ >= xml_.size()) fail("unterminated tag <" + std::string(name) + ">");
+      if (starts_with("/>")) {
+        pos_ += 2;
+        stack_.push_back({name, role});
+        close_element();
+        return;
+      }
+      if (xml_[pos_] == '>') {
+        ++pos_;
+        stack_.push_back({name, role});
+        return;
+      }
 
-        ManifestNode manifest_node;
-        manifest_node.category = cat;
-        manifest_node.name = id;
+      const std::string_view key = read_name();
+      skip_space();
+      if (pos_ >= xml_.size() || xml_[pos_] != '=') {
+        fail("expected '=' after attribute '" + std::string(key) + "'");
+      }
+      ++pos_;
+      skip_space();
+      if (pos_ >= xml_.size() || (xml_[pos_] != '"' && xml_[pos_] != '\'')) {
+        fail("expected a quoted value for attribute '" + std::string(key) + "'");
+      }
+      const char quote = xml_[pos_++];
+      const auto end = xml_.find(quote, pos_);
+      if (end == std::string_view::npos) fail("unterminated attribute value");
+      on_attribute(role, key, xml_.substr(pos_, end - pos_));
+      pos_ = end + 1;
+    }
+  }
 
-        parse_ports(node, "input_port", ManifestPortDirection::In, manifest_node.ports);
-        parse_ports(node, "output_port", ManifestPortDirection::Out, manifest_node.ports);
-        parse_ports(node, "inout_port", ManifestPortDirection::InOut, manifest_node.ports);
+  void close_tag()
+  {
+    pos_ += 2;  // "</"
+    const std::string_view name = read_name();
+    skip_space();
+    if (pos_ >= xml_.size() || xml_[pos_] != '>') fail("expected '>'");
+    ++pos_;
+    if (stack_.empty() || stack_.back().name != name) {
+      fail("mismatched closing tag </" + std::string(name) + ">");
+    }
+    close_element();
+  }
 
-        result.push_back(std::move(manifest_node));
+  [[nodiscard]] Role role_for(std::string_view name)
+  {
+    if (stack_.empty()) {
+      if (seen_root_) return Role::Other;
+      seen_root_ = true;
+      if (name == "TreeNodesModel") {
+        seen_model_ = true;
+        return Role::Container;
       }
+      return Role::Root;
     }
-  };
 
-  const auto * root = doc.RootElement();
-  if (root == nullptr) {
-    return result;  // Empty document
+    const Role parent = stack_.back().role;
+    if (parent == Role::Root && name == "TreeNodesModel" && !seen_model_) {
+      seen_model_ = true;
+      return Role::Container;
+    }
+    if ((parent == Role::Container || parent == Role::Root) &&
+        category_rank(name) < k_categories.size()) {
+      return Role::Node;
+    }
+    if (
+      parent == Role::Node &&
+      (name == "input_port" || name == "output_port" || name == "inout_port")) {
+      return Role::Port;
+    }
+    return Role::Other;
   }
 
-  // Check if root is TreeNodesModel/root or if it contains it
-  // Some XMLs have <root><TreeNodesModel>...</TreeNodesModel></root>
-  // Others might just be <TreeNodesModel>...</TreeNodesModel>
+  void on_attribute(Role role, std::string_view key, std::string_view raw)
+  {
+    if (role == Role::Node && key == "ID") {
+      append_decoded(current_.name, raw);
+    } else if (role == Role::Port) {
+      if (key == "name") {
+        append_decoded(port_.name, raw);
+      } else if (key == "type") {
+        append_decoded(port_type_, raw);
+      } else if (key == "description") {
+        append_decoded(port_.description, raw);
+      }
+    }
+  }
 
-  const std::string root_name = root->Name();
-  if (root_name == "TreeNodesModel") {
-    process_container(root);
-  } else {
-    // Look for TreeNodesModel child
-    const auto * model = root->FirstChildElement("TreeNodesModel");
-    if (model != nullptr) {
-      process_container(model);
+  void on_text(std::string_view raw, bool cdata)
+  {
+    if (stack_.empty() || stack_.back().role != Role::Port) return;
+    if (cdata) {
+      port_text_.append(raw);
     } else {
-      // If no TreeNodesModel, assume root might contain nodes directly
-      // (fallback) or maybe it is <root ...> with nodes inside
-      process_container(root);
+      append_decoded(port_text_, raw);
+    }
+  }
+
+  void close_element()
+  {
+    const Open open = stack_.back();
+    stack_.pop_back();
+
+    if (open.role == Role::Port) {
+      if (port_.name.empty()) return;
+      port_.type_name = sanitize_port_type(port_type_);
+      const std::string_view text = trim(port_text_);
+      if (!text.empty()) port_.description = std::string(text);
+      current_.ports.push_back(std::move(port_));
+    } else if (open.role == Role::Node) {
+      if (current_.name.empty()) return;
+      const bool in_model = !stack_.empty() && stack_.back().role == Role::Container;
+      (in_model ? model_nodes_ : root_nodes_).push_back(std::move(current_));
+    }
+  }
+
+  std::string_view xml_;
+  size_t pos_ = 0;
+  std::vector<Open> stack_;
+  bool seen_root_ = false;
+  bool seen_model_ = false;
+
+  ManifestNode current_;
+  ManifestPort port_;
+  std::string port_type_;
+  std::string port_text_;
+
+  /// Nodes inside <TreeNodesModel>, and nodes directly under another root.
+  std::vector<ManifestNode> model_nodes_;
+  std::vector<ManifestNode> root_nodes_;
+};
+
+[[nodiscard]] bool same_declaration(const ManifestNode & a, const ManifestNode & b)
+{
+  if (a.category != b.category || a.ports.size() != b.ports.size()) return false;
+  for (size_t i = 0; i < a.ports.size(); ++i) {
+    const auto & pa = a.ports[i];
+    const auto & pb = b.ports[i];
+    // Descriptions are documentation only.
+    if (pa.name != pb.name || pa.direction != pb.direction || pa.type_name != pb.type_name) {
+      return false;
+    }
+  }
+  return true;
+}
+
+[[nodiscard]] const char * direction_keyword(ManifestPortDirection dir)
+{
+  switch (dir) {
+    case ManifestPortDirection::Out:
+      return "out";
+    case ManifestPortDirection::InOut:
+      return "ref";
+    case ManifestPortDirection::In:
+      break;
+  }
+  return "in";
+}
+
+}  // namespace
+
+std::vector<ManifestNode> ModelConverter::parse_xml(std::string_view xml_content)
+{
+  return ManifestScanner(xml_content).run();
+}
+
+std::vector<ManifestFile> ModelConverter::parse_files(
+  const std::vector<std::string> & paths, unsigned jobs)
+{
+  std::vector<ManifestFile> files(paths.size());
+
+  auto parse_one = [&](size_t i) {
+    ManifestFile & file = files[i];
+    file.path = paths[i];
+
+    std::ifstream in(file.path, std::ios::binary);
+    if (!in.is_open()) {
+      file.error = "failed to open file: " + file.path;
+      return;
+    }
+    const std::string content{
+      std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+    try {
+      file.nodes = parse_xml(content);
+    } catch (const std::exception & e) {
+      file.error = file.path + ": " + e.what();
+    }
+  };
+
+  if (jobs == 0) {
+    jobs = std::max(1U, std::thread::hardware_concurrency());
+  }
+  const size_t threads = std::min<size_t>(jobs, paths.size());
+
+  std::atomic<size_t> next{0};
+  auto work = [&]() {
+    for (size_t i = next++; i < paths.size(); i = next++) {
+      parse_one(i);
     }
+  };
+
+  if (threads <= 1) {
+    work();
+    return files;
+  }
+
+  std::vector<std::thread> workers;
+  workers.reserve(threads - 1);
+  for (size_t t = 1; t < threads; ++t) {
+    workers.emplace_back(work);
+  }
+  work();
+  for (auto & w : workers) {
+    w.join();
   }
+  return files;
+}
 
+ModelMergeResult ModelConverter::merge(std::vector<ManifestFile> files)
+{
+  ModelMergeResult result;
+  // Node ID -> (index into result.nodes, file it came from)
+  std::unordered_map<std::string, std::pair<size_t, size_t>> seen;
+
+  for (size_t f = 0; f < files.size(); ++f) {
+    if (!files[f].error.empty()) continue;
+    for (auto & node : files[f].nodes) {
+      const auto it = seen.find(node.name);
+      if (it == seen.end()) {
+        seen.emplace(node.name, std::make_pair(result.nodes.size(), f));
+        result.nodes.push_back(std::move(node));
+        continue;
+      }
+      if (same_declaration(result.nodes[it->second.first], node)) {
+        ++result.duplicates_merged;
+      } else {
+        result.conflicts.push_back(
+          files[f].path + ": " + node.category + " '" + node.name +
+          "' differs from the declaration in " + files[it->second.second].path +
+          "; keeping that one");
+      }
+    }
+  }
   return result;
 }
 
 std::string ModelConverter::render_bt(const std::vector<ManifestNode> & nodes)
 {
-  std::stringstream ss;
-  ss << "//! Converted from TreeNodesModel XML\n";
-  ss << "//! This file contains only `extern node` declarations.\n\n";
+  std::ostringstream ss;
+  render_bt(nodes, ss);
+  return ss.str();
+}
+
+void ModelConverter::render_bt(const std::vector<ManifestNode> & nodes, std::ostream & out)
+{
+  out << "//! Converted from TreeNodesModel XML\n";
+  out << "//! This file contains only `extern node` declarations.\n\n";
 
   for (const auto & n : nodes) {
-    ss << "extern node " << n.category << " " << n.name << "(";
+    out << "extern node " << n.category << " " << n.name << "(";
 
-    bool multiline = (n.ports.size() > 2);
-    if (!multiline) {
-      for (const auto & p : n.ports) {
-        if (!p.description.empty()) {
-          multiline = true;
-          break;
-        }
-      }
-    }
+    const bool multiline =
+      n.ports.size() > 2 || std::any_of(n.ports.begin(), n.ports.end(), [](const auto & p) {
+        return !p.description.empty();
+      });
 
     if (!multiline) {
       for (size_t i = 0; i < n.ports.size(); ++i) {
         if (i > 0) {
-          ss << ", ";
+          out << ", ";
         }
-
         const auto & p = n.ports[i];
-        const char * dir_str = "in";
-        if (p.direction == ManifestPortDirection::Out) {
-          dir_str = "out";
-        } else if (p.direction == ManifestPortDirection::InOut) {
-          dir_str = "ref";
-        }
-
-        ss << dir_str << " " << p.name << ": " << p.type_name;
+        out << direction_keyword(p.direction) << " " << p.name << ": " << p.type_name;
       }
-      ss << ")\n";
+      out << ")\n";
     } else {
-      // Multiline
-      ss << "\n";
+      out << "\n";
       for (size_t i = 0; i < n.ports.size(); ++i) {
         const auto & p = n.ports[i];
         if (!p.description.empty()) {
-          ss << "    /// " << p.description << "\n";
-        }
-
-        const char * dir_str = "in";
-        if (p.direction == ManifestPortDirection::Out) {
-          dir_str = "out";
-        } else if (p.direction == ManifestPortDirection::InOut) {
-          dir_str = "ref";
+          out << "    /// " << p.description << "\n";
         }
-
-        ss << "    " << dir_str << " " << p.name << ": " << p.type_name;
+        out << "    " << direction_keyword(p.direction) << " " << p.name << ": " << p.type_name;
         if (i < n.ports.size() - 1) {
-          ss << ",";
+          out << ",";
         }
-        ss << "\n";
+        out << "\n";
       }
-      ss << ")\n";
+      out << ")\n";
     }
   }
-
-  return ss.str();
 }
 
-ModelConvertResult ModelConverter::convert(const std::string & xml_content)
+ModelConvertResult ModelConverter::convert(std::string_view xml_content)
 {
   auto nodes = parse_xml(xml_content);
   return {render_bt(nodes), static_cast<int>(nodes.size())};
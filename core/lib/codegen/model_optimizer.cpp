@@ -0,0 +1,30 @@
+// bt_dsl/codegen/model_optimizer.cpp - Optimization pipeline for generated models
+//
+#include "bt_dsl/codegen/model_optimizer.hpp"
+
+#include "bt_dsl/codegen/blackboard_optimizer.hpp"
+#include "bt_dsl/codegen/peephole_optimizer.hpp"
+#include "bt_dsl/codegen/subtree_optimizer.hpp"
+
+namespace bt_dsl
+{
+
+void optimize_model(btcpp::Document & doc, const CodegenOptions & options)
+{
+  const bool o2 = options.opt_level >= OptimizationLevel::O2;
+
+  if (options.inline_subtrees || o2) {
+    (void)SubtreeOptimizer::inline_calls(doc, options.inline_limits);
+  }
+  if (options.coalesce_blackboard_keys) {
+    (void)BlackboardKeyOptimizer::run(doc);
+  }
+  if (options.opt_level >= OptimizationLevel::O1) {
+    (void)PeepholeOptimizer::run(doc);
+  }
+  if (options.dedup_trees || o2) {
+    (void)SubtreeOptimizer::deduplicate(doc);
+  }
+}
+
+}  // namespace bt_dsl
@@ -0,0 +1,200 @@
+// bt_dsl/codegen/peephole_optimizer.cpp - Tree-structure peephole pass
+//
+#include "bt_dsl/codegen/peephole_optimizer.hpp"
+
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace bt_dsl
+{
+
+namespace
+{
+
+// ============================================================================
+// Node Classification
+// ============================================================================
+
+[[nodiscard]] bool is_splicable_control(std::string_view tag)
+{
+  return tag == "Sequence" || tag == "Fallback";
+}
+
+/// Control node that only groups its children (no name, preconditions or ports).
+[[nodiscard]] bool is_bare_control(const btcpp::Node & node)
+{
+  return is_splicable_control(node.tag) && node.attributes.empty() && !node.children.empty();
+}
+
+/// Script without preconditions: it always runs once and succeeds.
+[[nodiscard]] bool is_plain_script(const btcpp::Node & node)
+{
+  return node.tag == "Script" && node.attributes.size() == 1U &&
+         node.attributes[0].key == "code";
+}
+
+[[nodiscard]] bool is_plain_exists(const btcpp::Node & node)
+{
+  return node.tag == "BlackboardExists" && node.attributes.size() == 1U &&
+         node.attributes[0].key == "key";
+}
+
+/// Synchronous node that never removes a blackboard entry.
+[[nodiscard]] bool preserves_entries(const btcpp::Node & node)
+{
+  return is_plain_script(node) || is_plain_exists(node) ||
+         (node.tag == "AlwaysSuccess" && node.attributes.empty());
+}
+
+[[nodiscard]] std::string_view trim(std::string_view s)
+{
+  while (!s.empty() && s.front() == ' ') s.remove_prefix(1);
+  while (!s.empty() && s.back() == ' ') s.remove_suffix(1);
+  return s;
+}
+
+// ============================================================================
+// Rewriting
+// ============================================================================
+
+class Rewriter
+{
+public:
+  Rewriter(btcpp::ModelArena & arena, PeepholeStats & stats)
+  : arena_(arena), stats_(stats)
+  {
+  }
+
+  [[nodiscard]] btcpp::Node rewrite(const btcpp::Node & node)
+  {
+    bool changed = false;
+
+    std::vector<btcpp::Node> children;
+    children.reserve(node.children.size());
+    for (const auto & ch : node.children) {
+      const btcpp::Node out = rewrite(ch);
+      changed = changed || !same_node(out, ch);
+      // Children are already simplified, so one level of splicing is enough.
+      if (is_bare_control(out) && out.tag == node.tag) {
+        children.insert(children.end(), out.children.begin(), out.children.end());
+        ++stats_.controls_removed;
+        changed = true;
+        continue;
+      }
+      children.push_back(out);
+    }
+
+    if (node.tag == "Sequence") {
+      changed = simplify_sequence(children) || changed;
+    }
+
+    if (is_splicable_control(node.tag) && node.attributes.empty() && children.size() == 1U) {
+      ++stats_.controls_removed;
+      return children.front();
+    }
+
+    if (!changed) {
+      return node;
+    }
+    btcpp::Node out = node;
+    out.children = arena_.copy_array<btcpp::Node>(children);
+    return out;
+  }
+
+private:
+  [[nodiscard]] static bool same_node(const btcpp::Node & a, const btcpp::Node & b)
+  {
+    return a.tag.data() == b.tag.data() && a.attributes.data() == b.attributes.data() &&
+           a.children.data() == b.children.data();
+  }
+
+  /// Merge adjacent Scripts and drop repeated existence checks in place.
+  bool simplify_sequence(std::vector<btcpp::Node> & children)
+  {
+    const size_t original_size = children.size();
+    std::vector<btcpp::Node> out;
+    out.reserve(children.size());
+    std::unordered_set<std::string_view> known_keys;
+
+    for (const auto & ch : children) {
+      if (!preserves_entries(ch)) {
+        known_keys.clear();
+        out.push_back(ch);
+        continue;
+      }
+      if (is_plain_exists(ch) && !known_keys.insert(ch.attributes[0].value).second) {
+        ++stats_.exists_removed;
+        continue;
+      }
+      if (is_plain_script(ch) && !out.empty() && is_plain_script(out.back())) {
+        out.back() = merge_scripts(out.back(), ch);
+        ++stats_.scripts_merged;
+        continue;
+      }
+      out.push_back(ch);
+    }
+
+    children = std::move(out);
+    return children.size() != original_size;
+  }
+
+  [[nodiscard]] btcpp::Node merge_scripts(const btcpp::Node & first, const btcpp::Node & second)
+  {
+    const std::string_view a = trim(first.attributes[0].value);
+    const std::string_view b = trim(second.attributes[0].value);
+    std::string code;
+    code.reserve(a.size() + b.size() + 4U);
+    code += ' ';
+    code.append(a);
+    code += (!a.empty() && a.back() == ';') ? " " : "; ";
+    code.append(b);
+    code += ' ';
+    return btcpp::NodeBuilder(arena_, "Script").add_attribute("code", code).build();
+  }
+
+  btcpp::ModelArena & arena_;
+  PeepholeStats & stats_;
+};
+
+}  // namespace
+
+// ============================================================================
+// PeepholeOptimizer
+// ============================================================================
+
+PeepholeStats PeepholeOptimizer::run(btcpp::Document & doc)
+{
+  PeepholeStats total;
+  for (auto & tree : doc.behavior_trees) {
+    total += run(tree);
+  }
+  return total;
+}
+
+PeepholeStats PeepholeOptimizer::run(btcpp::BehaviorTreeModel & tree)
+{
+  PeepholeStats stats;
+  if (!tree.root.has_value() || !tree.arena) {
+    return stats;
+  }
+
+  stats.nodes_before = count_nodes(*tree.root);
+  Rewriter rw(*tree.arena, stats);
+  tree.root = rw.rewrite(*tree.root);
+  stats.nodes_after = count_nodes(*tree.root);
+  return stats;
+}
+
+size_t PeepholeOptimizer::count_nodes(const btcpp::Node & node)
+{
+  size_t n = 1;
+  for (const auto & ch : node.children) {
+    n += count_nodes(ch);
+  }
+  return n;
+}
+
+}  // namespace bt_dsl
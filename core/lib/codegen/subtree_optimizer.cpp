@@ -0,0 +1,634 @@
+// bt_dsl/codegen/subtree_optimizer.cpp - SubTree inlining and deduplication
+//
+#include "bt_dsl/codegen/subtree_optimizer.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "bt_dsl/codegen/model_keys.hpp"
+#include "bt_dsl/codegen/peephole_optimizer.hpp"
+
+namespace bt_dsl
+{
+
+namespace
+{
+
+using btcpp::as_local_key;
+using btcpp::AttrKind;
+using btcpp::braced_key;
+using btcpp::classify_attribute;
+using btcpp::for_each_script_key;
+using btcpp::is_global_ref;
+
+// ============================================================================
+// Node Queries
+// ============================================================================
+
+/// Prefix of the IDs of imported trees (`_SubTree_<module>_<name>`).
+constexpr std::string_view k_mangled_prefix = "_SubTree_";
+
+/**
+ * Check whether a tree may be dropped or renamed: an imported tree other than
+ * the main one. Trees of the entry module keep their IDs, since the
+ * application may load them by name.
+ */
+[[nodiscard]] bool is_private_tree(const btcpp::Document & doc, std::string_view id)
+{
+  return id.substr(0, k_mangled_prefix.size()) == k_mangled_prefix &&
+         id != doc.main_tree_to_execute;
+}
+
+[[nodiscard]] std::optional<std::string_view> attribute(
+  const btcpp::Node & node, std::string_view key)
+{
+  for (const auto & a : node.attributes) {
+    if (a.key == key) return a.value;
+  }
+  return std::nullopt;
+}
+
+[[nodiscard]] std::optional<std::string_view> subtree_call_id(const btcpp::Node & node)
+{
+  return node.tag == "SubTree" ? attribute(node, "ID") : std::nullopt;
+}
+
+/// Highest `#N` among the codegen-local keys of a subtree.
+[[nodiscard]] uint32_t max_local_number(const btcpp::Node & node)
+{
+  uint32_t max_n = 0;
+  auto note = [&](std::string_view key) {
+    if (const auto local = as_local_key(key)) max_n = std::max(max_n, local->number);
+  };
+  for (const auto & a : node.attributes) {
+    switch (classify_attribute(node.tag, a.key)) {
+      case AttrKind::Script:
+        for_each_script_key(a.value, [&](size_t, size_t, std::string_view k, bool) { note(k); });
+        break;
+      case AttrKind::BareKey:
+        note(a.value);
+        break;
+      case AttrKind::Port:
+        if (const auto k = braced_key(a.value)) note(*k);
+        break;
+    }
+  }
+  for (const auto & ch : node.children) {
+    max_n = std::max(max_n, max_local_number(ch));
+  }
+  return max_n;
+}
+
+template <typename Fn>
+void for_each_call(const btcpp::Node & node, Fn && fn)
+{
+  if (const auto id = subtree_call_id(node)) {
+    fn(*id);
+  }
+  for (const auto & ch : node.children) {
+    for_each_call(ch, fn);
+  }
+}
+
+// ============================================================================
+// Instantiation
+// ============================================================================
+
+/// How one callee parameter is spelled at a given call site.
+struct ParamBinding
+{
+  std::string script;  // inside script code
+  std::string port;    // as a whole port value
+  std::string bare;    // as a BlackboardExists key; empty if not expressible
+};
+
+/// Deep copy of a callee body into the caller's arena with keys rebound.
+class Instantiator
+{
+public:
+  Instantiator(
+    btcpp::ModelArena & arena, const std::unordered_map<std::string_view, ParamBinding> & params,
+    uint32_t local_offset)
+  : arena_(arena), params_(params), local_offset_(local_offset)
+  {
+  }
+
+  [[nodiscard]] std::optional<btcpp::Node> copy(const btcpp::Node & node)
+  {
+    btcpp::NodeBuilder b(arena_, node.tag);
+    for (const auto & a : node.attributes) {
+      const auto value = rebind(classify_attribute(node.tag, a.key), a.value);
+      if (!value) {
+        return std::nullopt;
+      }
+      b.add_attribute(a.key, *value);
+    }
+    for (const auto & ch : node.children) {
+      auto out = copy(ch);
+      if (!out) {
+        return std::nullopt;
+      }
+      b.add_child(*out);
+    }
+    if (node.text) {
+      b.set_text(*node.text);
+    }
+    return b.build();
+  }
+
+  /// Name of a callee-local key in the caller.
+  [[nodiscard]] std::optional<std::string> renumbered(std::string_view key) const
+  {
+    const auto local = as_local_key(key);
+    if (!local) {
+      return std::nullopt;
+    }
+    return std::string(local->name) + "#" + std::to_string(local->number + local_offset_);
+  }
+
+private:
+
+  [[nodiscard]] const ParamBinding * param(std::string_view key) const
+  {
+    auto it = params_.find(key);
+    return it != params_.end() ? &it->second : nullptr;
+  }
+
+  [[nodiscard]] std::optional<std::string> rebind(AttrKind kind, std::string_view value) const
+  {
+    switch (kind) {
+      case AttrKind::Script: {
+        std::string out;
+        size_t copied = 0;
+        for_each_script_key(value, [&](size_t off, size_t len, std::string_view key, bool braced) {
+          std::string replacement;
+          if (const auto * p = param(key)) {
+            replacement = braced ? p->port : p->script;
+          } else if (auto r = renumbered(key)) {
+            replacement = braced ? "{" + *r + "}" : *r;
+          } else {
+            return;
+          }
+          out.append(value.substr(copied, off - copied));
+          out.append(replacement);
+          copied = off + len;
+        });
+        out.append(value.substr(copied));
+        return out;
+      }
+      case AttrKind::BareKey:
+        if (const auto * p = param(value)) {
+          return p->bare.empty() ? std::nullopt : std::optional<std::string>(p->bare);
+        }
+        if (auto r = renumbered(value)) {
+          return r;
+        }
+        return std::string(value);
+      case AttrKind::Port:
+        if (const auto k = braced_key(value)) {
+          if (const auto * p = param(*k)) {
+            return p->port;
+          }
+          if (auto r = renumbered(*k)) {
+            return "{" + *r + "}";
+          }
+        }
+        return std::string(value);
+    }
+    return std::nullopt;
+  }
+
+  btcpp::ModelArena & arena_;
+  const std::unordered_map<std::string_view, ParamBinding> & params_;
+  uint32_t local_offset_;
+};
+
+// ============================================================================
+// Inlining
+// ============================================================================
+
+class Inliner
+{
+public:
+  Inliner(btcpp::Document & doc, const SubtreeInlineLimits & limits) : doc_(doc), limits_(limits)
+  {
+    for (size_t i = 0; i < doc_.behavior_trees.size(); ++i) {
+      tree_index_.emplace(doc_.behavior_trees[i].id, i);
+    }
+    for (const auto & st : doc_.subtree_models) {
+      models_.emplace(st.id, &st);
+    }
+    for (const auto & tree : doc_.behavior_trees) {
+      if (tree.root) {
+        for_each_call(*tree.root, [&](std::string_view id) { ++call_sites_[std::string(id)]; });
+      }
+    }
+  }
+
+  SubtreeStats run()
+  {
+    state_.assign(doc_.behavior_trees.size(), State::Pending);
+    for (size_t i = 0; i < doc_.behavior_trees.size(); ++i) {
+      process(i);
+    }
+    remove_unreferenced();
+    return stats_;
+  }
+
+private:
+  enum class State : std::uint8_t { Pending, Active, Done };
+
+  /// Inline into tree `i` after inlining into everything it calls.
+  void process(size_t i)
+  {
+    if (state_[i] != State::Pending) {
+      return;
+    }
+    state_[i] = State::Active;
+    btcpp::BehaviorTreeModel & tree = doc_.behavior_trees[i];
+    if (tree.root) {
+      for_each_call(*tree.root, [&](std::string_view id) {
+        auto it = tree_index_.find(std::string(id));
+        if (it == tree_index_.end()) return;
+        if (state_[it->second] == State::Active) {
+          recursive_.insert(it->second);
+        } else {
+          process(it->second);
+        }
+      });
+      next_local_ = max_local_number(*tree.root);
+      key_types_ = &tree.key_types;
+      tree.root = rewrite(*tree.root, *tree.arena);
+    }
+    state_[i] = State::Done;
+  }
+
+  [[nodiscard]] bool within_limits(size_t callee) const
+  {
+    const auto & tree = doc_.behavior_trees[callee];
+    const size_t nodes = PeepholeOptimizer::count_nodes(*tree.root);
+    if (nodes <= limits_.max_nodes) {
+      return true;
+    }
+    auto it = call_sites_.find(tree.id);
+    return it != call_sites_.end() && it->second == 1U && nodes <= limits_.single_use_max_nodes;
+  }
+
+  [[nodiscard]] btcpp::Node rewrite(const btcpp::Node & node, btcpp::ModelArena & arena)
+  {
+    if (const auto id = subtree_call_id(node)) {
+      if (auto inlined = try_inline(node, *id, arena)) {
+        ++stats_.calls_inlined;
+        return *inlined;
+      }
+      return node;
+    }
+
+    bool changed = false;
+    std::vector<btcpp::Node> children;
+    children.reserve(node.children.size());
+    for (const auto & ch : node.children) {
+      children.push_back(rewrite(ch, arena));
+      changed = changed || children.back().attributes.data() != ch.attributes.data() ||
+                children.back().children.data() != ch.children.data();
+    }
+    if (!changed) {
+      return node;
+    }
+    btcpp::Node out = node;
+    out.children = arena.copy_array<btcpp::Node>(children);
+    return out;
+  }
+
+  [[nodiscard]] std::optional<btcpp::Node> try_inline(
+    const btcpp::Node & call, std::string_view id, btcpp::ModelArena & arena)
+  {
+    auto it = tree_index_.find(std::string(id));
+    if (it == tree_index_.end() || recursive_.count(it->second) > 0) {
+      return std::nullopt;
+    }
+    const btcpp::BehaviorTreeModel & callee = doc_.behavior_trees[it->second];
+    if (!callee.root || !within_limits(it->second)) {
+      return std::nullopt;
+    }
+
+    std::unordered_set<std::string_view> param_names;
+    if (auto m = models_.find(callee.id); m != models_.end()) {
+      for (const auto & p : m->second->ports) {
+        param_names.insert(p.name);
+      }
+    }
+
+    // Bind the remapped ports; keep preconditions for the wrapper.
+    std::unordered_map<std::string_view, ParamBinding> params;
+    std::vector<btcpp::Attribute> preconditions;
+    for (const auto & a : call.attributes) {
+      if (a.key == "ID") continue;
+      if (a.key == "_autoremap") return std::nullopt;
+      if (!a.key.empty() && a.key.front() == '_') {
+        preconditions.push_back(a);
+        continue;
+      }
+      if (param_names.count(a.key) == 0) {
+        return std::nullopt;
+      }
+      if (const auto k = braced_key(a.value)) {
+        params.emplace(a.key, ParamBinding{std::string(*k), std::string(a.value), std::string(*k)});
+      } else if (is_global_ref(a.value)) {
+        params.emplace(a.key, ParamBinding{std::string(a.value), std::string(a.value), {}});
+      } else {
+        return std::nullopt;
+      }
+    }
+
+    // Parameters without a remap were private to the SubTree instance.
+    const uint32_t offset = next_local_;
+    uint32_t next = offset + max_local_number(*callee.root);
+    for (const auto & name : param_names) {
+      if (params.count(name) == 0) {
+        const std::string key = std::string(name) + "#" + std::to_string(++next);
+        params.emplace(name, ParamBinding{key, "{" + key + "}", key});
+      }
+    }
+
+    Instantiator inst(arena, params, offset);
+    auto body = inst.copy(*callee.root);
+    if (!body) {
+      return std::nullopt;
+    }
+    next_local_ = next;
+
+    // Renumbered locals keep their types; private parameters have none.
+    for (const auto & [key, type] : callee.key_types) {
+      if (auto local = inst.renumbered(key)) {
+        key_types_->emplace(std::move(*local), type);
+      }
+    }
+
+    if (preconditions.empty()) {
+      return body;
+    }
+    btcpp::NodeBuilder wrapper(arena, "Sequence");
+    for (const auto & a : preconditions) {
+      wrapper.add_attribute(a.key, a.value);
+    }
+    wrapper.add_child(*body);
+    return wrapper.build();
+  }
+
+  /// Drop imported trees that were called before but are no longer referenced.
+  void remove_unreferenced()
+  {
+    std::unordered_set<std::string> removed;
+    for (;;) {
+      std::unordered_set<std::string> referenced;
+      for (const auto & tree : doc_.behavior_trees) {
+        if (tree.root && removed.count(tree.id) == 0) {
+          for_each_call(*tree.root, [&](std::string_view id) { referenced.emplace(id); });
+        }
+      }
+      bool changed = false;
+      for (const auto & tree : doc_.behavior_trees) {
+        if (is_private_tree(doc_, tree.id) && call_sites_.count(tree.id) > 0 &&
+            referenced.count(tree.id) == 0 && removed.insert(tree.id).second) {
+          changed = true;
+        }
+      }
+      if (!changed) {
+        break;
+      }
+    }
+
+    stats_.trees_removed = removed.size();
+    auto is_removed = [&](const auto & x) { return removed.count(x.id) > 0; };
+    doc_.behavior_trees.erase(
+      std::remove_if(doc_.behavior_trees.begin(), doc_.behavior_trees.end(), is_removed),
+      doc_.behavior_trees.end());
+    doc_.subtree_models.erase(
+      std::remove_if(doc_.subtree_models.begin(), doc_.subtree_models.end(), is_removed),
+      doc_.subtree_models.end());
+  }
+
+  btcpp::Document & doc_;
+  const SubtreeInlineLimits & limits_;
+  std::unordered_map<std::string, size_t> tree_index_;
+  std::unordered_map<std::string, const btcpp::SubTreeModel *> models_;
+  std::unordered_map<std::string, size_t> call_sites_;
+  std::vector<State> state_;
+  std::unordered_set<size_t> recursive_;
+  uint32_t next_local_ = 0;
+  std::unordered_map<std::string, std::string> * key_types_ = nullptr;
+  SubtreeStats stats_;
+};
+
+// ============================================================================
+// Deduplication
+// ============================================================================
+
+void append_field(std::string & out, std::string_view s)
+{
+  out += std::to_string(s.size());
+  out += ':';
+  out.append(s);
+}
+
+void append_structure(std::string & out, const btcpp::Node & node)
+{
+  out += '(';
+  append_field(out, node.tag);
+  for (const auto & a : node.attributes) {
+    append_field(out, a.key);
+    append_field(out, a.value);
+  }
+  if (node.text) {
+    out += 'T';
+    append_field(out, *node.text);
+  }
+  for (const auto & ch : node.children) {
+    append_structure(out, ch);
+  }
+  out += ')';
+}
+
+/// Unambiguous encoding of a tree's body and SubTree model, without its ID.
+[[nodiscard]] std::string structural_key(
+  const btcpp::BehaviorTreeModel & tree, const btcpp::SubTreeModel * model)
+{
+  std::string key;
+  if (model) {
+    for (const auto & p : model->ports) {
+      key += static_cast<char>('0' + static_cast<int>(p.kind));
+      append_field(key, p.name);
+      append_field(key, p.type.value_or("-"));
+    }
+  }
+  key += '|';
+  if (tree.root) {
+    append_structure(key, *tree.root);
+  }
+  return key;
+}
+
+[[nodiscard]] btcpp::Node redirect_calls(
+  const btcpp::Node & node, btcpp::ModelArena & arena,
+  const std::unordered_map<std::string, std::string> & redirect)
+{
+  bool changed = false;
+  std::vector<btcpp::Attribute> attrs(node.attributes.begin(), node.attributes.end());
+  if (node.tag == "SubTree") {
+    for (auto & a : attrs) {
+      if (a.key != "ID") continue;
+      auto it = redirect.find(std::string(a.value));
+      if (it != redirect.end()) {
+        a.value = arena.store(it->second);
+        changed = true;
+      }
+    }
+  }
+
+  std::vector<btcpp::Node> children;
+  children.reserve(node.children.size());
+  for (const auto & ch : node.children) {
+    children.push_back(redirect_calls(ch, arena, redirect));
+    changed = changed || children.back().attributes.data() != ch.attributes.data() ||
+              children.back().children.data() != ch.children.data();
+  }
+
+  if (!changed) {
+    return node;
+  }
+  btcpp::Node out = node;
+  out.attributes = arena.copy_array<btcpp::Attribute>(attrs);
+  out.children = arena.copy_array<btcpp::Node>(children);
+  return out;
+}
+
+}  // namespace
+
+// ============================================================================
+// SubtreeOptimizer
+// ============================================================================
+
+SubtreeStats SubtreeOptimizer::inline_calls(
+  btcpp::Document & doc, const SubtreeInlineLimits & limits)
+{
+  return Inliner(doc, limits).run();
+}
+
+SubtreeStats SubtreeOptimizer::deduplicate(btcpp::Document & doc)
+{
+  SubtreeStats stats;
+
+  for (;;) {
+    std::unordered_map<std::string_view, const btcpp::SubTreeModel *> models;
+    for (const auto & st : doc.subtree_models) {
+      models.emplace(st.id, &st);
+    }
+    auto key_of = [&](const btcpp::BehaviorTreeModel & tree) {
+      auto it = models.find(tree.id);
+      return structural_key(tree, it != models.end() ? it->second : nullptr);
+    };
+
+    // Trees that keep their ID claim their structure first, the main tree
+    // before the rest of the entry module.
+    std::unordered_map<std::string, std::string> canonical;
+    for (const auto & tree : doc.behavior_trees) {
+      if (tree.id == doc.main_tree_to_execute) {
+        canonical.emplace(key_of(tree), tree.id);
+      }
+    }
+    for (const auto & tree : doc.behavior_trees) {
+      if (!is_private_tree(doc, tree.id)) {
+        canonical.try_emplace(key_of(tree), tree.id);
+      }
+    }
+    std::unordered_map<std::string, std::string> redirect;
+    for (const auto & tree : doc.behavior_trees) {
+      auto [it, inserted] = canonical.try_emplace(key_of(tree), tree.id);
+      if (!inserted && it->second != tree.id) {
+        redirect.emplace(tree.id, it->second);
+      }
+    }
+    if (redirect.empty()) {
+      break;
+    }
+
+    // Duplicates from the entry module stay; only their callers move.
+    auto is_duplicate = [&](const auto & x) {
+      return redirect.count(x.id) > 0 && is_private_tree(doc, x.id);
+    };
+    const size_t trees_before = doc.behavior_trees.size();
+    doc.behavior_trees.erase(
+      std::remove_if(doc.behavior_trees.begin(), doc.behavior_trees.end(), is_duplicate),
+      doc.behavior_trees.end());
+    doc.subtree_models.erase(
+      std::remove_if(doc.subtree_models.begin(), doc.subtree_models.end(), is_duplicate),
+      doc.subtree_models.end());
+    const size_t merged = trees_before - doc.behavior_trees.size();
+    stats.trees_merged += merged;
+
+    bool calls_changed = false;
+    for (auto & tree : doc.behavior_trees) {
+      if (tree.root) {
+        const btcpp::Node before = *tree.root;
+        tree.root = redirect_calls(before, *tree.arena, redirect);
+        calls_changed = calls_changed || tree.root->children.data() != before.children.data() ||
+                        tree.root->attributes.data() != before.attributes.data();
+      }
+    }
+    if (merged == 0 && !calls_changed) {
+      break;
+    }
+  }
+
+  return stats;
+}
+
+size_t SubtreeOptimizer::shorten_ids(btcpp::Document & doc)
+{
+  std::unordered_set<std::string> used;
+  for (const auto & tree : doc.behavior_trees) {
+    used.insert(tree.id);
+  }
+
+  std::unordered_map<std::string, std::string> rename;
+  size_t next = 1;
+  for (const auto & tree : doc.behavior_trees) {
+    if (!is_private_tree(doc, tree.id)) {
+      continue;
+    }
+    std::string id;
+    do {
+      id = "_" + std::to_string(next++);
+    } while (used.count(id) > 0);
+    used.insert(id);
+    rename.emplace(tree.id, std::move(id));
+  }
+  if (rename.empty()) {
+    return 0;
+  }
+
+  for (auto & tree : doc.behavior_trees) {
+    if (tree.root) {
+      tree.root = redirect_calls(*tree.root, *tree.arena, rename);
+    }
+    if (auto it = rename.find(tree.id); it != rename.end()) {
+      tree.id = it->second;
+    }
+  }
+  for (auto & st : doc.subtree_models) {
+    if (auto it = rename.find(st.id); it != rename.end()) {
+      st.id = it->second;
+    }
+  }
+  return rename.size();
+}
+
+}  // namespace bt_dsl
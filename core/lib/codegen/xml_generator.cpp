@@ -1,10 +1,12 @@
 #include "bt_dsl/codegen/xml_generator.hpp"
 
+#include <algorithm>
 #include <cassert>
 #include <cstddef>
 #include <cstdint>
 #include <functional>
 #include <gsl/span>
+#include <initializer_list>
 #include <memory>
 #include <optional>
 #include <sstream>
@@ -17,9 +19,16 @@
 #include <vector>
 
 #include "bt_dsl/ast/ast.hpp"
+#include "bt_dsl/ast/ast_context.hpp"
 #include "bt_dsl/ast/ast_enums.hpp"
+#include "bt_dsl/basic/parallel.hpp"
+#include "bt_dsl/codegen/model_optimizer.hpp"
+#include "bt_dsl/codegen/subtree_optimizer.hpp"
 #include "bt_dsl/sema/resolution/symbol_table.hpp"
+#include "bt_dsl/sema/types/const_evaluator.hpp"
 #include "bt_dsl/sema/types/const_value.hpp"
+#include "bt_dsl/sema/types/type_checker.hpp"
+#include "bt_dsl/sema/types/type_utils.hpp"
 #include "tinyxml2.h"
 
 namespace bt_dsl
@@ -154,7 +163,8 @@ enum class ExprMode : std::uint8_t {
 
 [[nodiscard]] std::string render_type_expr(const TypeExpr * type) { return render_type_node(type); }
 
-[[nodiscard]] std::string default_init_for_type(const TypeExpr * type)
+[[nodiscard]] std::string default_init_for_type(
+  const TypeExpr * type, const TypeContext * types)
 {
   // xml-mapping.md §6.3.2: initialize out var with a default value.
   // Best-effort: map common scalar types; fall back to 0.
@@ -162,6 +172,25 @@ enum class ExprMode : std::uint8_t {
     return "0";
   }
 
+  // Prefer the type memoized by TypeChecker (sees through aliases).
+  if (const Type * resolved = types ? get_resolved_type(type, *types) : nullptr) {
+    if (resolved->kind == TypeKind::Nullable && resolved->base_type) {
+      resolved = resolved->base_type;
+    }
+    if (resolved->is_string()) {
+      return "''";
+    }
+    if (resolved->kind == TypeKind::Float32 || resolved->kind == TypeKind::Float64) {
+      return "0.0";
+    }
+    if (resolved->kind == TypeKind::Bool) {
+      return "false";
+    }
+    if (resolved->is_integer()) {
+      return "0";
+    }
+  }
+
   const TypeNode * base = type->base;
   const auto * pt = (base && base->get_kind() == NodeKind::PrimaryType)
                       ? static_cast<const PrimaryType *>(base)
@@ -244,16 +273,67 @@ enum class ExprMode : std::uint8_t {
   return nullptr;
 }
 
+/// Whether a folded value can replace an expression of type `t` without changing its meaning.
+[[nodiscard]] bool folded_value_fits_type(const ConstValue & v, const Type * t)
+{
+  if (!t) {
+    return false;
+  }
+  if (t->is_nullable() && t->base_type) {
+    t = t->base_type;
+  }
+  if (v.is_integer()) {
+    return t->is_integer();
+  }
+  if (v.is_float()) {
+    return t->is_float();
+  }
+  if (v.is_bool()) {
+    return t->kind == TypeKind::Bool;
+  }
+  if (v.is_string()) {
+    return t->is_string();
+  }
+  // Arrays and null are not valid in scripts; keep the original text.
+  return false;
+}
+
+/// Evaluates runtime expressions whose operands are all compile-time constants.
+struct ConstFolder
+{
+  static constexpr size_t k_buffer_size = 1024;
+
+  explicit ConstFolder(const SymbolTable & values)
+  : ast(k_buffer_size), evaluator(ast, types, values, nullptr)
+  {
+    // The AST is shared by the trees folded in parallel and outlives `ast`.
+    evaluator.keep_results_private();
+  }
+
+  AstContext ast;
+  TypeContext types;
+  ConstEvaluator evaluator;
+};
+
 struct CodegenContext
 {
   const ModuleInfo & module;
 
+  // Storage for the nodes of the tree being converted
+  btcpp::ModelArena & arena;
+
   // Variable mangling for BT.CPP flat blackboard
   std::uint32_t next_id = 1;
 
   // Tree ID mapping for single-output mode (optional)
   std::function<std::string(const TreeDecl *)> subtree_id_resolver;
 
+  // Context the module was type-checked in (optional)
+  const TypeContext * types = nullptr;
+
+  // Created on first use; private to this context so trees can be folded in parallel.
+  std::unique_ptr<ConstFolder> folder;
+
   struct Frame
   {
     Frame * parent = nullptr;
@@ -263,7 +343,7 @@ struct CodegenContext
   std::vector<std::unique_ptr<Frame>> frames;
   Frame * current = nullptr;
 
-  explicit CodegenContext(const ModuleInfo & m) : module(m)
+  CodegenContext(const ModuleInfo & m, btcpp::ModelArena & a) : module(m), arena(a)
   {
     auto root = std::make_unique<Frame>();
     root->parent = nullptr;
@@ -288,13 +368,49 @@ struct CodegenContext
     }
   }
 
-  [[nodiscard]] std::string declare_var(std::string_view name)
+  // DSL types of the declared keys (see btcpp::BehaviorTreeModel::key_types)
+  std::unordered_map<std::string, std::string> key_types;
+
+  /// Declare a local key; `type` is its DSL type, empty if unknown.
+  [[nodiscard]] std::string declare_var(std::string_view name, std::string type = {})
   {
     const std::string key = std::string(name) + "#" + std::to_string(next_id++);
     current->var_keys.insert_or_assign(name, key);
+    if (!type.empty()) {
+      key_types.emplace(key, std::move(type));
+    }
     return key;
   }
 
+  /// Entry type for a value of `type`; empty unless it is fully inferred.
+  [[nodiscard]] static std::string entry_type(const Type * type)
+  {
+    if (type && type->kind == TypeKind::Nullable) {
+      type = type->base_type;
+    }
+    for (const Type * t = type; t; t = t->element_type ? t->element_type : t->base_type) {
+      if (t->is_placeholder() || t->is_error()) {
+        return {};
+      }
+    }
+    return type ? to_string(type) : std::string{};
+  }
+
+  [[nodiscard]] std::string entry_type(const TypeExpr * type) const
+  {
+    return entry_type(type && types ? get_resolved_type(type, *types) : nullptr);
+  }
+
+  /// Entry type of a `var`: its declared type, else its initializer's.
+  [[nodiscard]] std::string entry_type(const BlackboardDeclStmt & decl) const
+  {
+    std::string type = entry_type(decl.type);
+    if (type.empty() && decl.initialValue) {
+      type = entry_type(decl.initialValue->resolvedType);
+    }
+    return type;
+  }
+
   [[nodiscard]] std::optional<std::string_view> lookup_local_var_key(std::string_view name) const
   {
     for (const Frame * f = current; f; f = f->parent) {
@@ -345,8 +461,53 @@ struct CodegenContext
     }
     return tree ? std::string(tree->name) : std::string{};
   }
+
+  /**
+   * Evaluate an expression at compile time.
+   *
+   * @return The value, or nullopt if the expression depends on runtime state
+   *         or its value cannot be written back with the expression's type
+   */
+  [[nodiscard]] std::optional<ConstValue> fold_constant(const Expr * expr)
+  {
+    if (!expr) {
+      return std::nullopt;
+    }
+    if (!folder) {
+      folder = std::make_unique<ConstFolder>(module.values);
+    }
+    const ConstValue v = folder->evaluator.evaluate(expr);
+    if (v.is_error() || !folded_value_fits_type(v, expr->resolvedType)) {
+      return std::nullopt;
+    }
+    return v;
+  }
+
+  /// Value of a condition known at compile time (nullopt if it depends on runtime state).
+  [[nodiscard]] std::optional<bool> static_condition(const Expr * cond)
+  {
+    const auto v = fold_constant(cond);
+    if (v && v->is_bool()) {
+      return v->as_bool();
+    }
+    return std::nullopt;
+  }
 };
 
+/// Operators and casts whose constant operands are folded instead of re-evaluated every tick.
+[[nodiscard]] bool is_foldable_expr(const Expr * expr)
+{
+  switch (expr->get_kind()) {
+    case NodeKind::BinaryExpr:
+    case NodeKind::UnaryExpr:
+    case NodeKind::CastExpr:
+    case NodeKind::IndexExpr:
+      return true;
+    default:
+      return false;
+  }
+}
+
 [[nodiscard]] std::string serialize_expression(
   const Expr * expr, CodegenContext & ctx, ExprMode mode);
 
@@ -357,6 +518,12 @@ struct CodegenContext
     return {};
   }
 
+  if (is_foldable_expr(expr)) {
+    if (const auto folded = ctx.fold_constant(expr)) {
+      return format_const_value_for_mode(*folded, mode == ExprMode::AttributeValue);
+    }
+  }
+
   switch (expr->get_kind()) {
     case NodeKind::IntLiteral: {
       const auto * e = static_cast<const IntLiteralExpr *>(expr);
@@ -439,22 +606,28 @@ struct CodegenContext
   return {};
 }
 
-[[nodiscard]] btcpp::Node make_plain_script_node(std::string code)
+[[nodiscard]] btcpp::NodeBuilder make_plain_script_node(
+  btcpp::ModelArena & arena, std::string_view code)
 {
-  btcpp::Node script;
-  script.tag = "Script";
-  script.attributes.push_back(btcpp::Attribute{"code", " " + std::move(code) + " "});
+  std::string padded;
+  padded.reserve(code.size() + 2U);
+  padded += ' ';
+  padded.append(code);
+  padded += ' ';
+  btcpp::NodeBuilder script(arena, "Script");
+  script.add_attribute("code", padded);
   return script;
 }
 
-[[nodiscard]] btcpp::Node make_assignment_script_node(std::string_view lhs, std::string_view rhs)
+[[nodiscard]] btcpp::Node make_assignment_script_node(
+  btcpp::ModelArena & arena, std::string_view lhs, std::string_view rhs)
 {
   std::string code;
   code.reserve(lhs.size() + rhs.size() + 4U);
   code.append(lhs);
   code.append(" := ");
   code.append(rhs);
-  return make_plain_script_node(std::move(code));
+  return make_plain_script_node(arena, code).build();
 }
 
 struct NullableShortCircuit
@@ -547,7 +720,7 @@ struct NullableShortCircuit
   }
 
   // Helper variable lives in the current codegen scope.
-  const std::string helper_key = ctx.declare_var("_should_skip");
+  const std::string helper_key = ctx.declare_var("_should_skip", "bool");
 
   NullableShortCircuit out;
   out.var_name = var_name;
@@ -558,17 +731,70 @@ struct NullableShortCircuit
   return out;
 }
 
-[[nodiscard]] btcpp::Node make_blackboard_exists_node(std::string key)
+[[nodiscard]] btcpp::NodeBuilder make_blackboard_exists_node(
+  btcpp::ModelArena & arena, std::string_view key)
 {
-  btcpp::Node exists;
-  exists.tag = "BlackboardExists";
-  exists.attributes.push_back(btcpp::Attribute{"key", std::move(key)});
+  btcpp::NodeBuilder exists(arena, "BlackboardExists");
+  exists.add_attribute("key", key);
   return exists;
 }
 
+/// Build `<Sequence>` around already built children.
+[[nodiscard]] btcpp::Node make_sequence(
+  btcpp::ModelArena & arena, std::initializer_list<btcpp::Node> children)
+{
+  btcpp::NodeBuilder seq(arena, "Sequence");
+  seq.add_children(gsl::span<const btcpp::Node>(children.begin(), children.size()));
+  return seq.build();
+}
+
+/**
+ * Build the helper computation of a nullable short-circuit:
+ * `<ForceSuccess><Sequence><BlackboardExists/><Script/></Sequence></ForceSuccess>`.
+ */
+[[nodiscard]] btcpp::Node make_nullable_helper_compute(
+  const NullableShortCircuit & sc, CodegenContext & ctx)
+{
+  const btcpp::Node exists = make_blackboard_exists_node(ctx.arena, sc.var_key).build();
+  const std::string rhs = "(" + serialize_expression(sc.eval_expr, ctx, ExprMode::Script) + ")";
+  const btcpp::Node inner =
+    make_sequence(ctx.arena, {exists, make_assignment_script_node(ctx.arena, sc.helper_key, rhs)});
+
+  btcpp::NodeBuilder compute(ctx.arena, "ForceSuccess");
+  compute.add_child(inner);
+  return compute.build();
+}
+
+/// Whether a precondition whose condition is statically `value` never changes the outcome.
+[[nodiscard]] bool is_noop_precondition(PreconditionKind kind, bool value)
+{
+  switch (kind) {
+    case PreconditionKind::Guard:
+    case PreconditionKind::RunWhile:
+      return value;
+    case PreconditionKind::SuccessIf:
+    case PreconditionKind::FailureIf:
+    case PreconditionKind::SkipIf:
+      return !value;
+  }
+  return false;
+}
+
 [[nodiscard]] btcpp::Node apply_preconditions_and_guard(
-  btcpp::Node node, gsl::span<Precondition * const> preconditions, CodegenContext & ctx)
+  btcpp::NodeBuilder node, gsl::span<Precondition * const> preconditions, CodegenContext & ctx)
 {
+  // xml-mapping.md §5.2: a statically false @guard never lets the node run and the
+  // guard sequence always fails, so the node is replaced by <AlwaysFailure/>.
+  for (const auto * pc : preconditions) {
+    if (!pc || pc->kind != PreconditionKind::Guard) {
+      continue;
+    }
+    const auto value = ctx.static_condition(pc->condition);
+    if (value.has_value() && !*value) {
+      return btcpp::NodeBuilder(ctx.arena, "AlwaysFailure").build();
+    }
+  }
+
   std::vector<const Expr *> guard_conditions;
   guard_conditions.reserve(preconditions.size());
 
@@ -592,6 +818,10 @@ struct NullableShortCircuit
     if (!pc) {
       continue;
     }
+    const auto static_value = ctx.static_condition(pc->condition);
+    if (static_value.has_value() && is_noop_precondition(pc->kind, *static_value)) {
+      continue;
+    }
     if (pc->kind == PreconditionKind::Guard) {
       guard_conditions.push_back(pc->condition);
       continue;
@@ -623,16 +853,14 @@ struct NullableShortCircuit
         // and desugar into helper+BlackboardExists to avoid accessing missing keys.
         nullable_skip = try_build_skip_if_nullable_short_circuit(pc->condition, ctx);
         if (nullable_skip.has_value()) {
-          node.attributes.push_back(
-            btcpp::Attribute{std::move(attr_name), "{" + nullable_skip->helper_key + "}"});
+          node.add_attribute(attr_name, "{" + nullable_skip->helper_key + "}");
         } else {
-          node.attributes.push_back(btcpp::Attribute{
-            std::move(attr_name),
-            serialize_expression(pc->condition, ctx, ExprMode::Precondition)});
+          node.add_attribute(
+            attr_name, serialize_expression(pc->condition, ctx, ExprMode::Precondition));
         }
       } else {
-        node.attributes.push_back(btcpp::Attribute{
-          std::move(attr_name), serialize_expression(pc->condition, ctx, ExprMode::Precondition)});
+        node.add_attribute(
+          attr_name, serialize_expression(pc->condition, ctx, ExprMode::Precondition));
       }
     }
   }
@@ -668,97 +896,51 @@ struct NullableShortCircuit
   // If we created a nullable @skip_if desugaring, we need to run the helper logic
   // before the node executes.
   if (nullable_skip.has_value()) {
-    btcpp::Node init =
-      make_assignment_script_node(nullable_skip->helper_key, nullable_skip->helper_init);
-
-    btcpp::Node compute;
-    compute.tag = "ForceSuccess";
-
-    btcpp::Node inner;
-    inner.tag = "Sequence";
-    inner.children.push_back(make_blackboard_exists_node(nullable_skip->var_key));
-
-    const std::string rhs =
-      "(" + serialize_expression(nullable_skip->eval_expr, ctx, ExprMode::Script) + ")";
-    inner.children.push_back(make_assignment_script_node(nullable_skip->helper_key, rhs));
-
-    compute.children.push_back(std::move(inner));
-
-    btcpp::Node seq;
-    seq.tag = "Sequence";
-    seq.children.push_back(std::move(init));
-    seq.children.push_back(std::move(compute));
-    seq.children.push_back(std::move(node));
-
-    node = std::move(seq);
+    const btcpp::Node init =
+      make_assignment_script_node(ctx.arena, nullable_skip->helper_key, nullable_skip->helper_init);
+    const btcpp::Node compute = make_nullable_helper_compute(*nullable_skip, ctx);
+    node = btcpp::NodeBuilder(ctx.arena, make_sequence(ctx.arena, {init, compute, node.build()}));
   }
 
   // No guard -> done (after possible nullable skip_if wrapper).
   if (guard_conditions.empty()) {
-    return node;
+    return node.build();
   }
 
   // Special-case guard existence check.
   if (guard_exists.has_value()) {
-    btcpp::Node bb_exists = make_blackboard_exists_node(guard_exists->key);
+    btcpp::NodeBuilder bb_exists = make_blackboard_exists_node(ctx.arena, guard_exists->key);
     // xml-mapping.md §7.3: The existence check itself is evaluated while the guard is active.
-    bb_exists.attributes.push_back(btcpp::Attribute{"_while", "true"});
+    bb_exists.add_attribute("_while", "true");
 
-    btcpp::Node gate = std::move(bb_exists);
+    btcpp::Node gate = bb_exists.build();
     if (guard_exists->mode == GuardExistsMode::NotExists) {
-      btcpp::Node inv;
-      inv.tag = "Inverter";
-      inv.children.push_back(std::move(gate));
-      gate = std::move(inv);
+      btcpp::NodeBuilder inv(ctx.arena, "Inverter");
+      inv.add_child(gate);
+      gate = inv.build();
     }
 
-    node.attributes.push_back(btcpp::Attribute{"_while", "true"});
+    node.add_attribute("_while", "true");
 
-    btcpp::Node always;
-    always.tag = "AlwaysSuccess";
-    always.attributes.push_back(btcpp::Attribute{"_failureIf", "!(true)"});
+    btcpp::NodeBuilder always(ctx.arena, "AlwaysSuccess");
+    always.add_attribute("_failureIf", "!(true)");
 
-    btcpp::Node seq;
-    seq.tag = "Sequence";
-    seq.children.push_back(std::move(gate));
-    seq.children.push_back(std::move(node));
-    seq.children.push_back(std::move(always));
-    return seq;
+    return make_sequence(ctx.arena, {gate, node.build(), always.build()});
   }
 
   // Nullable @guard short-circuit desugaring (similar to @skip_if transformations).
   if (nullable_guard.has_value()) {
-    btcpp::Node init =
-      make_assignment_script_node(nullable_guard->helper_key, nullable_guard->helper_init);
-
-    btcpp::Node compute;
-    compute.tag = "ForceSuccess";
-
-    btcpp::Node inner;
-    inner.tag = "Sequence";
-    inner.children.push_back(make_blackboard_exists_node(nullable_guard->var_key));
-
-    const std::string rhs =
-      "(" + serialize_expression(nullable_guard->eval_expr, ctx, ExprMode::Script) + ")";
-    inner.children.push_back(make_assignment_script_node(nullable_guard->helper_key, rhs));
-
-    compute.children.push_back(std::move(inner));
-
-    btcpp::Node seq;
-    seq.tag = "Sequence";
-    seq.children.push_back(std::move(init));
-    seq.children.push_back(std::move(compute));
+    const btcpp::Node init = make_assignment_script_node(
+      ctx.arena, nullable_guard->helper_key, nullable_guard->helper_init);
+    const btcpp::Node compute = make_nullable_helper_compute(*nullable_guard, ctx);
 
     const std::string helper_ref = "{" + nullable_guard->helper_key + "}";
-    node.attributes.push_back(btcpp::Attribute{"_while", helper_ref});
+    node.add_attribute("_while", helper_ref);
 
-    btcpp::Node always;
-    always.tag = "AlwaysSuccess";
-    always.attributes.push_back(btcpp::Attribute{"_failureIf", "!(" + helper_ref + ")"});
+    btcpp::NodeBuilder always(ctx.arena, "AlwaysSuccess");
+    always.add_attribute("_failureIf", "!(" + helper_ref + ")");
 
-    seq.children.push_back(std::move(node));
-    seq.children.push_back(std::move(always));
-    return seq;
+    return make_sequence(ctx.arena, {init, compute, node.build(), always.build()});
   }
 
   // xml-mapping.md §5.1: @guard(expr) ->
@@ -785,17 +967,12 @@ struct NullableShortCircuit
     expr_str = std::move(out);
   }
 
-  node.attributes.push_back(btcpp::Attribute{"_while", expr_str});
+  node.add_attribute("_while", expr_str);
 
-  btcpp::Node always;
-  always.tag = "AlwaysSuccess";
-  always.attributes.push_back(btcpp::Attribute{"_failureIf", "!(" + expr_str + ")"});
+  btcpp::NodeBuilder always(ctx.arena, "AlwaysSuccess");
+  always.add_attribute("_failureIf", "!(" + expr_str + ")");
 
-  btcpp::Node seq;
-  seq.tag = "Sequence";
-  seq.children.push_back(std::move(node));
-  seq.children.push_back(std::move(always));
-  return seq;
+  return make_sequence(ctx.arena, {node.build(), always.build()});
 }
 
 [[nodiscard]] std::string serialize_assignment_stmt(
@@ -857,8 +1034,6 @@ struct NullableShortCircuit
   std::vector<btcpp::Node> pre_scripts;
   pre_scripts.reserve(4);
 
-  btcpp::Node element;
-
   const NodeSymbol * ns = node.resolvedNode;
   const ExternDecl * ext = as_extern_decl(ns);
   const TreeDecl * tree = as_tree_decl(ns);
@@ -866,15 +1041,13 @@ struct NullableShortCircuit
   const bool is_subtree_call =
     (tree != nullptr) || (ext && ext->category == ExternNodeCategory::Subtree);
 
+  btcpp::NodeBuilder element(ctx.arena, is_subtree_call ? "SubTree" : node.nodeName);
   if (is_subtree_call) {
-    element.tag = "SubTree";
     if (tree) {
-      element.attributes.push_back(btcpp::Attribute{"ID", ctx.subtree_xml_id(tree)});
+      element.add_attribute("ID", ctx.subtree_xml_id(tree));
     } else {
-      element.attributes.push_back(btcpp::Attribute{"ID", std::string(node.nodeName)});
+      element.add_attribute("ID", node.nodeName);
     }
-  } else {
-    element.tag = std::string(node.nodeName);
   }
 
   // ------------------------------------------------------------------------
@@ -926,9 +1099,11 @@ struct NullableShortCircuit
       // xml-mapping.md §6.3.2: out var x -> pre-Script declaration.
       const InlineBlackboardDecl * decl = arg->inlineDecl;
       const std::string_view var_name = decl ? decl->name : std::string_view{};
-      const std::string key = ctx.declare_var(var_name);
-      const std::string init = default_init_for_type(port_def ? port_def->type : nullptr);
-      pre_scripts.push_back(make_assignment_script_node(key, init));
+      const std::string key =
+        ctx.declare_var(var_name, ctx.entry_type(port_def ? port_def->type : nullptr));
+      const std::string init =
+        default_init_for_type(port_def ? port_def->type : nullptr, ctx.types);
+      pre_scripts.push_back(make_assignment_script_node(ctx.arena, key, init));
       attr_value = "{" + key + "}";
     } else {
       const Expr * expr = arg->valueExpr;
@@ -937,9 +1112,13 @@ struct NullableShortCircuit
       const bool is_in_port = (port_dir == PortDirection::In);
       if (is_in_port && !is_simple_value_expr_for_in_port(expr)) {
         const std::string_view tmp_base = "_expr";
-        const std::string key = ctx.declare_var(tmp_base);
+        std::string type = ctx.entry_type(port_def ? port_def->type : nullptr);
+        if (type.empty()) {
+          type = CodegenContext::entry_type(expr->resolvedType);
+        }
+        const std::string key = ctx.declare_var(tmp_base, std::move(type));
         const std::string rhs = serialize_expression(expr, ctx, ExprMode::Script);
-        pre_scripts.push_back(make_assignment_script_node(key, rhs));
+        pre_scripts.push_back(make_assignment_script_node(ctx.arena, key, rhs));
         attr_value = "{" + key + "}";
       } else {
         attr_value = serialize_expression(expr, ctx, ExprMode::AttributeValue);
@@ -967,16 +1146,16 @@ struct NullableShortCircuit
       }
 
       const std::string_view tmp_base = "_default";
-      const std::string key = ctx.declare_var(tmp_base);
+      const std::string key = ctx.declare_var(tmp_base, ctx.entry_type(p->type));
       const std::string rhs = serialize_expression(p->defaultValue, ctx, ExprMode::Script);
-      pre_scripts.push_back(make_assignment_script_node(key, rhs));
+      pre_scripts.push_back(make_assignment_script_node(ctx.arena, key, rhs));
 
       prepared.push_back(PreparedAttr{std::string(p->name), "{" + key + "}"});
     }
   }
 
-  for (auto & pa : prepared) {
-    element.attributes.push_back(btcpp::Attribute{std::move(pa.key), std::move(pa.value)});
+  for (const auto & pa : prepared) {
+    element.add_attribute(pa.key, pa.value);
   }
 
   // Children
@@ -1000,14 +1179,13 @@ struct NullableShortCircuit
         const auto * st = static_cast<const AssignmentStmt *>(child);
         if (st->op == AssignOp::Assign && st->indices.empty() && is_null_literal_expr(st->value)) {
           // xml-mapping.md §7.2: null assignment -> UnsetBlackboard.
-          btcpp::Node unset;
-          unset.tag = "UnsetBlackboard";
-          unset.attributes.push_back(
-            btcpp::Attribute{"key", ctx.var_ref(st->target, st->resolvedTarget, ExprMode::Script)});
+          btcpp::NodeBuilder unset(ctx.arena, "UnsetBlackboard");
+          unset.add_attribute("key", ctx.var_ref(st->target, st->resolvedTarget, ExprMode::Script));
           converted_children.push_back(
             apply_preconditions_and_guard(std::move(unset), st->preconditions, ctx));
         } else {
-          btcpp::Node script = make_plain_script_node(serialize_assignment_stmt(*st, ctx));
+          btcpp::NodeBuilder script =
+            make_plain_script_node(ctx.arena, serialize_assignment_stmt(*st, ctx));
           converted_children.push_back(
             apply_preconditions_and_guard(std::move(script), st->preconditions, ctx));
         }
@@ -1015,7 +1193,7 @@ struct NullableShortCircuit
       }
       case NodeKind::BlackboardDeclStmt: {
         const auto * st = static_cast<const BlackboardDeclStmt *>(child);
-        const std::string key = ctx.declare_var(st->name);
+        const std::string key = ctx.declare_var(st->name, ctx.entry_type(*st));
         if (st->initialValue) {
           // xml-mapping.md §7.1: nullable の null は「エントリ不在」で表現するため、
           // `var x: T? = null;` ではエントリを作成しない。
@@ -1023,7 +1201,7 @@ struct NullableShortCircuit
             break;
           }
           const std::string rhs = serialize_expression(st->initialValue, ctx, ExprMode::Script);
-          converted_children.push_back(make_assignment_script_node(key, rhs));
+          converted_children.push_back(make_assignment_script_node(ctx.arena, key, rhs));
         }
         break;
       }
@@ -1037,25 +1215,21 @@ struct NullableShortCircuit
 
   // Decorator nodes may be written with multiple children, which must be implicitly wrapped.
   if (ext && ext->category == ExternNodeCategory::Decorator && converted_children.size() > 1U) {
-    btcpp::Node seq;
-    seq.tag = "Sequence";
-    seq.children = std::move(converted_children);
-    element.children.push_back(std::move(seq));
+    btcpp::NodeBuilder seq(ctx.arena, "Sequence");
+    seq.add_children(converted_children);
+    element.add_child(seq.build());
   } else {
-    element.children = std::move(converted_children);
+    element.add_children(converted_children);
   }
 
-  btcpp::Node with_preconds =
+  const btcpp::Node with_preconds =
     apply_preconditions_and_guard(std::move(element), node.preconditions, ctx);
 
   if (!pre_scripts.empty()) {
-    btcpp::Node seq;
-    seq.tag = "Sequence";
-    for (auto & s : pre_scripts) {
-      seq.children.push_back(std::move(s));
-    }
-    seq.children.push_back(std::move(with_preconds));
-    return seq;
+    btcpp::NodeBuilder seq(ctx.arena, "Sequence");
+    seq.add_children(pre_scripts);
+    seq.add_child(with_preconds);
+    return seq.build();
   }
 
   return with_preconds;
@@ -1238,6 +1412,67 @@ void append_blackboard_exists_model(btcpp::Document & doc)
   return 99;
 }
 
+/// Convert the statements of a tree body into its root node (nullopt if empty).
+[[nodiscard]] std::optional<btcpp::Node> convert_tree_body(
+  const TreeDecl & tree, CodegenContext & ctx)
+{
+  std::vector<btcpp::Node> roots;
+  roots.reserve(tree.body.size());
+
+  for (const auto * st : tree.body) {
+    if (!st) {
+      continue;
+    }
+
+    switch (st->get_kind()) {
+      case NodeKind::NodeStmt:
+        roots.push_back(convert_node_stmt(*static_cast<const NodeStmt *>(st), ctx));
+        break;
+
+      case NodeKind::AssignmentStmt: {
+        const auto * as = static_cast<const AssignmentStmt *>(st);
+        if (as->op == AssignOp::Assign && as->indices.empty() && is_null_literal_expr(as->value)) {
+          btcpp::NodeBuilder unset(ctx.arena, "UnsetBlackboard");
+          unset.add_attribute("key", ctx.var_ref(as->target, as->resolvedTarget, ExprMode::Script));
+          roots.push_back(apply_preconditions_and_guard(std::move(unset), as->preconditions, ctx));
+        } else {
+          btcpp::NodeBuilder script =
+            make_plain_script_node(ctx.arena, serialize_assignment_stmt(*as, ctx));
+          roots.push_back(apply_preconditions_and_guard(std::move(script), as->preconditions, ctx));
+        }
+        break;
+      }
+
+      case NodeKind::BlackboardDeclStmt: {
+        const auto * vd = static_cast<const BlackboardDeclStmt *>(st);
+        const std::string key = ctx.declare_var(vd->name, ctx.entry_type(*vd));
+        if (vd->initialValue) {
+          const std::string rhs = serialize_expression(vd->initialValue, ctx, ExprMode::Script);
+          roots.push_back(make_assignment_script_node(ctx.arena, key, rhs));
+        }
+        break;
+      }
+
+      case NodeKind::ConstDeclStmt:
+      default:
+        break;
+    }
+  }
+
+  if (roots.size() == 1U) {
+    return roots.front();
+  }
+  if (roots.empty()) {
+    return std::nullopt;
+  }
+  btcpp::NodeBuilder seq(ctx.arena, "Sequence");
+  seq.add_children(roots);
+  return seq.build();
+}
+
+/// Trees below this count are converted on the calling thread.
+constexpr std::size_t k_min_trees_per_thread = 8;
+
 void sort_models_for_deterministic_output(btcpp::Document & doc)
 {
   for (auto & nm : doc.node_models) {
@@ -1276,7 +1511,8 @@ void sort_models_for_deterministic_output(btcpp::Document & doc)
 
 }  // namespace
 
-btcpp::Document AstToBtCppModelConverter::convert(const ModuleInfo & module)
+btcpp::Document AstToBtCppModelConverter::convert(
+  const ModuleInfo & module, const TypeContext * types)
 {
   btcpp::Document doc;
   if (!module.program) {
@@ -1356,63 +1592,10 @@ btcpp::Document AstToBtCppModelConverter::convert(const ModuleInfo & module)
     btcpp::BehaviorTreeModel tm;
     tm.id = std::string(tree->name);
 
-    CodegenContext ctx(module);
-
-    std::vector<btcpp::Node> roots;
-    roots.reserve(tree->body.size());
-
-    for (const auto * st : tree->body) {
-      if (!st) {
-        continue;
-      }
-
-      switch (st->get_kind()) {
-        case NodeKind::NodeStmt:
-          roots.push_back(convert_node_stmt(*static_cast<const NodeStmt *>(st), ctx));
-          break;
-
-        case NodeKind::AssignmentStmt: {
-          const auto * as = static_cast<const AssignmentStmt *>(st);
-          if (
-            as->op == AssignOp::Assign && as->indices.empty() && is_null_literal_expr(as->value)) {
-            btcpp::Node unset;
-            unset.tag = "UnsetBlackboard";
-            unset.attributes.push_back(btcpp::Attribute{
-              "key", ctx.var_ref(as->target, as->resolvedTarget, ExprMode::Script)});
-            roots.push_back(
-              apply_preconditions_and_guard(std::move(unset), as->preconditions, ctx));
-          } else {
-            btcpp::Node script = make_plain_script_node(serialize_assignment_stmt(*as, ctx));
-            roots.push_back(
-              apply_preconditions_and_guard(std::move(script), as->preconditions, ctx));
-          }
-          break;
-        }
-
-        case NodeKind::BlackboardDeclStmt: {
-          const auto * vd = static_cast<const BlackboardDeclStmt *>(st);
-          const std::string key = ctx.declare_var(vd->name);
-          if (vd->initialValue) {
-            const std::string rhs = serialize_expression(vd->initialValue, ctx, ExprMode::Script);
-            roots.push_back(make_assignment_script_node(key, rhs));
-          }
-          break;
-        }
-
-        case NodeKind::ConstDeclStmt:
-        default:
-          break;
-      }
-    }
-
-    if (roots.size() == 1U) {
-      tm.root = std::move(roots.front());
-    } else if (!roots.empty()) {
-      btcpp::Node seq;
-      seq.tag = "Sequence";
-      seq.children = std::move(roots);
-      tm.root = std::move(seq);
-    }
+    CodegenContext ctx(module, *tm.arena);
+    ctx.types = types;
+    tm.root = convert_tree_body(*tree, ctx);
+    tm.key_types = std::move(ctx.key_types);
 
     doc.behavior_trees.push_back(std::move(tm));
   }
@@ -1422,7 +1605,8 @@ btcpp::Document AstToBtCppModelConverter::convert(const ModuleInfo & module)
   return doc;
 }
 
-btcpp::Document AstToBtCppModelConverter::convert_single_output(const ModuleInfo & entry)
+btcpp::Document AstToBtCppModelConverter::convert_single_output(
+  const ModuleInfo & entry, unsigned jobs, const TypeContext * types)
 {
   btcpp::Document doc;
   if (!entry.program) {
@@ -1582,86 +1766,38 @@ btcpp::Document AstToBtCppModelConverter::convert_single_output(const ModuleInfo
   }
 
   // BehaviorTrees
-  for (const auto & k : ordered) {
-    btcpp::BehaviorTreeModel tm;
-    tm.id = tree_xml_ids.at(k);
-
-    CodegenContext ctx(*k.module);
-    ctx.subtree_id_resolver = [&](const TreeDecl * t) -> std::string {
-      if (!t) {
-        return {};
-      }
-      const ModuleInfo * owner = owner_module_for_tree_decl(tree_owner, t);
-      if (!owner) {
-        return std::string(t->name);
-      }
-
-      const TreeKey tk{owner, t};
-      auto it = tree_xml_ids.find(tk);
-      if (it != tree_xml_ids.end()) {
-        return it->second;
-      }
+  // XML IDs are fixed above and each tree gets its own CodegenContext, so
+  // trees convert independently; results land in discovery order.
+  const auto subtree_id_resolver = [&](const TreeDecl * t) -> std::string {
+    if (!t) {
+      return {};
+    }
+    const ModuleInfo * owner = owner_module_for_tree_decl(tree_owner, t);
+    if (!owner) {
       return std::string(t->name);
-    };
-
-    std::vector<btcpp::Node> roots;
-    roots.reserve(k.tree->body.size());
-
-    for (const auto * st : k.tree->body) {
-      if (!st) {
-        continue;
-      }
-
-      switch (st->get_kind()) {
-        case NodeKind::NodeStmt:
-          roots.push_back(convert_node_stmt(*static_cast<const NodeStmt *>(st), ctx));
-          break;
-
-        case NodeKind::AssignmentStmt: {
-          const auto * as = static_cast<const AssignmentStmt *>(st);
-          if (
-            as->op == AssignOp::Assign && as->indices.empty() && is_null_literal_expr(as->value)) {
-            btcpp::Node unset;
-            unset.tag = "UnsetBlackboard";
-            unset.attributes.push_back(btcpp::Attribute{
-              "key", ctx.var_ref(as->target, as->resolvedTarget, ExprMode::Script)});
-            roots.push_back(
-              apply_preconditions_and_guard(std::move(unset), as->preconditions, ctx));
-          } else {
-            btcpp::Node script = make_plain_script_node(serialize_assignment_stmt(*as, ctx));
-            roots.push_back(
-              apply_preconditions_and_guard(std::move(script), as->preconditions, ctx));
-          }
-          break;
-        }
-
-        case NodeKind::BlackboardDeclStmt: {
-          const auto * vd = static_cast<const BlackboardDeclStmt *>(st);
-          const std::string key = ctx.declare_var(vd->name);
-          if (vd->initialValue) {
-            const std::string rhs = serialize_expression(vd->initialValue, ctx, ExprMode::Script);
-            roots.push_back(make_assignment_script_node(key, rhs));
-          }
-          break;
-        }
-
-        case NodeKind::ConstDeclStmt:
-        default:
-          break;
-      }
     }
 
-    if (roots.size() == 1U) {
-      tm.root = std::move(roots.front());
-    } else if (!roots.empty()) {
-      btcpp::Node seq;
-      seq.tag = "Sequence";
-      seq.children = std::move(roots);
-      tm.root = std::move(seq);
+    const TreeKey tk{owner, t};
+    auto it = tree_xml_ids.find(tk);
+    if (it != tree_xml_ids.end()) {
+      return it->second;
     }
+    return std::string(t->name);
+  };
 
-    doc.behavior_trees.push_back(std::move(tm));
-  }
+  doc.behavior_trees.resize(ordered.size());
+  const auto convert = [&](std::size_t i) {
+    const TreeKey & k = ordered[i];
+    btcpp::BehaviorTreeModel & tm = doc.behavior_trees[i];
+    tm.id = tree_xml_ids.at(k);
+
+    CodegenContext ctx(*k.module, *tm.arena);
+    ctx.subtree_id_resolver = subtree_id_resolver;
+    ctx.types = types;
+    tm.root = convert_tree_body(*k.tree, ctx);
+    tm.key_types = std::move(ctx.key_types);
+  };
+  parallel_for_each_index(ordered.size(), jobs, convert, k_min_trees_per_thread);
 
   sort_models_for_deterministic_output(doc);
 
@@ -1678,14 +1814,15 @@ namespace
 tinyxml2::XMLElement * append_node_impl(
   tinyxml2::XMLDocument & doc, tinyxml2::XMLElement * parent, const btcpp::Node & node)
 {
-  auto * elem = doc.NewElement(node.tag.c_str());
+  // Arena strings are NUL-terminated (see btcpp::ModelArena).
+  auto * elem = doc.NewElement(node.tag.data());
 
   for (const auto & a : node.attributes) {
-    elem->SetAttribute(a.key.c_str(), a.value.c_str());
+    elem->SetAttribute(a.key.data(), a.value.data());
   }
 
   if (node.text.has_value()) {
-    elem->SetText(node.text->c_str());
+    elem->SetText(node.text->data());
   }
 
   for (const auto & ch : node.children) {
@@ -1696,109 +1833,180 @@ tinyxml2::XMLElement * append_node_impl(
   return elem;
 }
 
-}  // namespace
+[[nodiscard]] const char * port_model_tag(btcpp::PortKind kind)
+{
+  switch (kind) {
+    case btcpp::PortKind::Input:
+      return "input_port";
+    case btcpp::PortKind::Output:
+      return "output_port";
+    case btcpp::PortKind::InOut:
+      return "inout_port";
+  }
+  return "input_port";
+}
 
-std::string BtCppXmlSerializer::serialize(const btcpp::Document & doc_model)
+void append_port_models(
+  tinyxml2::XMLDocument & doc, tinyxml2::XMLElement * parent,
+  const std::vector<btcpp::PortModel> & ports)
 {
-  tinyxml2::XMLDocument doc;
-  doc.InsertFirstChild(doc.NewDeclaration(R"(xml version="1.0" encoding="UTF-8")"));
+  for (const auto & p : ports) {
+    auto * pe = doc.NewElement(port_model_tag(p.kind));
+    pe->SetAttribute("name", p.name.c_str());
+    if (p.type.has_value()) {
+      pe->SetAttribute("type", p.type->c_str());
+    }
+    parent->InsertEndChild(pe);
+  }
+}
+
+/// Append `<TreeNodesModel>` (the manifest) under `<root>`.
+void append_tree_nodes_model(
+  tinyxml2::XMLDocument & doc, tinyxml2::XMLElement * root, const btcpp::Document & doc_model)
+{
+  if (doc_model.node_models.empty() && doc_model.subtree_models.empty()) {
+    return;
+  }
+
+  auto * tnm = doc.NewElement("TreeNodesModel");
+  root->InsertEndChild(tnm);
+
+  for (const auto & nm : doc_model.node_models) {
+    const char * tag = nullptr;
+    switch (nm.kind) {
+      case btcpp::NodeModelKind::Action:
+        tag = "Action";
+        break;
+      case btcpp::NodeModelKind::Condition:
+        tag = "Condition";
+        break;
+      case btcpp::NodeModelKind::Control:
+        tag = "Control";
+        break;
+      case btcpp::NodeModelKind::Decorator:
+        tag = "Decorator";
+        break;
+    }
 
+    auto * ne = doc.NewElement(tag);
+    ne->SetAttribute("ID", nm.id.c_str());
+    tnm->InsertEndChild(ne);
+    append_port_models(doc, ne, nm.ports);
+  }
+
+  for (const auto & st : doc_model.subtree_models) {
+    auto * sub = doc.NewElement("SubTree");
+    sub->SetAttribute("ID", st.id.c_str());
+    tnm->InsertEndChild(sub);
+    append_port_models(doc, sub, st.ports);
+  }
+}
+
+/// Create `<?xml ...?><root BTCPP_format="4">` and return the root element.
+/// The declaration is optional and left out of compact output.
+tinyxml2::XMLElement * begin_root(tinyxml2::XMLDocument & doc, XmlFormat format)
+{
+  if (format == XmlFormat::Pretty) {
+    doc.InsertFirstChild(doc.NewDeclaration(R"(xml version="1.0" encoding="UTF-8")"));
+  }
   auto * root = doc.NewElement("root");
   root->SetAttribute("BTCPP_format", "4");
-  root->SetAttribute("main_tree_to_execute", doc_model.main_tree_to_execute.c_str());
   doc.InsertEndChild(root);
+  return root;
+}
+
+void append_behavior_tree(
+  tinyxml2::XMLDocument & doc, tinyxml2::XMLElement * root, const btcpp::BehaviorTreeModel & tree)
+{
+  auto * bt = doc.NewElement("BehaviorTree");
+  bt->SetAttribute("ID", tree.id.c_str());
+  root->InsertEndChild(bt);
+
+  if (tree.root.has_value()) {
+    append_node_impl(doc, bt, *tree.root);
+  }
+}
+
+[[nodiscard]] std::string print_document(const tinyxml2::XMLDocument & doc, XmlFormat format)
+{
+  tinyxml2::XMLPrinter printer(nullptr, format == XmlFormat::Compact);
+  doc.Print(&printer);
+  return {printer.CStr()};
+}
+
+/// XML-only rewrites requested by CodegenOptions (after optimize_model()).
+void apply_xml_options(btcpp::Document & doc, const CodegenOptions & options)
+{
+  if (options.xml_compact) {
+    (void)SubtreeOptimizer::shorten_ids(doc);
+  }
+  if (!options.xml_compact && options.known_node_models.empty()) {
+    return;
+  }
+
+  // Each imported module declares the externs it uses, so the same model
+  // can appear several times; compact output keeps the first one.
+  std::unordered_set<std::string> seen;
+  auto & models = doc.node_models;
+  models.erase(
+    std::remove_if(
+      models.begin(), models.end(),
+      [&](const btcpp::NodeModel & nm) {
+        return options.known_node_models.count(nm.id) > 0 ||
+               (options.xml_compact && !seen.insert(nm.id).second);
+      }),
+    models.end());
+}
+
+[[nodiscard]] XmlFormat xml_format_for(const CodegenOptions & options)
+{
+  return options.xml_compact ? XmlFormat::Compact : XmlFormat::Pretty;
+}
+
+}  // namespace
+
+std::string BtCppXmlSerializer::serialize(const btcpp::Document & doc_model, XmlFormat format)
+{
+  tinyxml2::XMLDocument doc;
+  auto * root = begin_root(doc, format);
+  root->SetAttribute("main_tree_to_execute", doc_model.main_tree_to_execute.c_str());
 
   for (const auto & tree : doc_model.behavior_trees) {
-    auto * bt = doc.NewElement("BehaviorTree");
-    bt->SetAttribute("ID", tree.id.c_str());
-    root->InsertEndChild(bt);
-
-    if (tree.root.has_value()) {
-      append_node_impl(doc, bt, *tree.root);
-    }
-  }
-
-  // TreeNodesModel (manifest) should appear under <root>.
-  if (!doc_model.node_models.empty() || !doc_model.subtree_models.empty()) {
-    auto * tnm = doc.NewElement("TreeNodesModel");
-    root->InsertEndChild(tnm);
-
-    for (const auto & nm : doc_model.node_models) {
-      const char * tag = nullptr;
-      switch (nm.kind) {
-        case btcpp::NodeModelKind::Action:
-          tag = "Action";
-          break;
-        case btcpp::NodeModelKind::Condition:
-          tag = "Condition";
-          break;
-        case btcpp::NodeModelKind::Control:
-          tag = "Control";
-          break;
-        case btcpp::NodeModelKind::Decorator:
-          tag = "Decorator";
-          break;
-      }
+    append_behavior_tree(doc, root, tree);
+  }
+  append_tree_nodes_model(doc, root, doc_model);
 
-      auto * ne = doc.NewElement(tag);
-      ne->SetAttribute("ID", nm.id.c_str());
-      tnm->InsertEndChild(ne);
+  return print_document(doc, format);
+}
 
-      for (const auto & p : nm.ports) {
-        const char * port_tag = nullptr;
-        switch (p.kind) {
-          case btcpp::PortKind::Input:
-            port_tag = "input_port";
-            break;
-          case btcpp::PortKind::Output:
-            port_tag = "output_port";
-            break;
-          case btcpp::PortKind::InOut:
-            port_tag = "inout_port";
-            break;
-        }
+std::vector<XmlFile> BtCppXmlSerializer::serialize_split(
+  const btcpp::Document & doc_model, std::string_view tree_dir, XmlFormat format)
+{
+  std::vector<XmlFile> files;
+  files.reserve(doc_model.behavior_trees.size() + 1U);
 
-        auto * pe = doc.NewElement(port_tag);
-        pe->SetAttribute("name", p.name.c_str());
-        if (p.type.has_value()) {
-          pe->SetAttribute("type", p.type->c_str());
-        }
-        ne->InsertEndChild(pe);
-      }
-    }
+  // Index: includes every tree (paths are relative to the index file) and
+  // carries the manifest, so it loads like the single-file output.
+  tinyxml2::XMLDocument index;
+  auto * index_root = begin_root(index, format);
+  index_root->SetAttribute("main_tree_to_execute", doc_model.main_tree_to_execute.c_str());
+  files.push_back(XmlFile{});
 
-    for (const auto & st : doc_model.subtree_models) {
-      auto * sub = doc.NewElement("SubTree");
-      sub->SetAttribute("ID", st.id.c_str());
-      tnm->InsertEndChild(sub);
+  for (const auto & tree : doc_model.behavior_trees) {
+    std::string path = std::string(tree_dir) + "/" + tree.id + ".xml";
 
-      for (const auto & p : st.ports) {
-        const char * port_tag = nullptr;
-        switch (p.kind) {
-          case btcpp::PortKind::Input:
-            port_tag = "input_port";
-            break;
-          case btcpp::PortKind::Output:
-            port_tag = "output_port";
-            break;
-          case btcpp::PortKind::InOut:
-            port_tag = "inout_port";
-            break;
-        }
+    auto * include = index.NewElement("include");
+    include->SetAttribute("path", path.c_str());
+    index_root->InsertEndChild(include);
 
-        auto * pe = doc.NewElement(port_tag);
-        pe->SetAttribute("name", p.name.c_str());
-        if (p.type.has_value()) {
-          pe->SetAttribute("type", p.type->c_str());
-        }
-        sub->InsertEndChild(pe);
-      }
-    }
+    tinyxml2::XMLDocument doc;
+    append_behavior_tree(doc, begin_root(doc, format), tree);
+    files.push_back(XmlFile{std::move(path), print_document(doc, format)});
   }
+  append_tree_nodes_model(index, index_root, doc_model);
 
-  tinyxml2::XMLPrinter printer;
-  doc.Print(&printer);
-  return {printer.CStr()};
+  files.front().content = print_document(index, format);
+  return files;
 }
 
 // ============================================================================
@@ -1811,10 +2019,22 @@ std::string XmlGenerator::generate(const ModuleInfo & module)
   return BtCppXmlSerializer::serialize(model);
 }
 
-std::string XmlGenerator::generate_single_output(const ModuleInfo & entry)
+std::string XmlGenerator::generate_single_output(
+  const ModuleInfo & entry, const CodegenOptions & options)
 {
-  const auto model = AstToBtCppModelConverter::convert_single_output(entry);
-  return BtCppXmlSerializer::serialize(model);
+  auto model = AstToBtCppModelConverter::convert_single_output(entry, 0, options.types);
+  optimize_model(model, options);
+  apply_xml_options(model, options);
+  return BtCppXmlSerializer::serialize(model, xml_format_for(options));
+}
+
+std::vector<XmlFile> XmlGenerator::generate_split_output(
+  const ModuleInfo & entry, std::string_view tree_dir, const CodegenOptions & options)
+{
+  auto model = AstToBtCppModelConverter::convert_single_output(entry, 0, options.types);
+  optimize_model(model, options);
+  apply_xml_options(model, options);
+  return BtCppXmlSerializer::serialize_split(model, tree_dir, xml_format_for(options));
 }
 
 }  // namespace bt_dsl
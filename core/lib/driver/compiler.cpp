@@ -2,8 +2,12 @@
 //
 #include "bt_dsl/driver/compiler.hpp"
 
-#include <fstream>
+#include <system_error>
+#include <unordered_set>
+#include <utility>
+#include <vector>
 
+#include "bt_dsl/codegen/cpp_generator.hpp"
 #include "bt_dsl/codegen/xml_generator.hpp"
 #include "bt_dsl/driver/stdlib_finder.hpp"
 #include "bt_dsl/sema/analysis/init_checker.hpp"
@@ -30,6 +34,12 @@ CompileResult Compiler::compile_single_file(
 
   namespace fs = std::filesystem;
 
+  const std::string target = options.target.value_or("btcpp_v4");
+  if (!is_valid_target(target)) {
+    result.diagnostics.report_error(SourceRange{}, "unknown target: '" + target + "'");
+    return result;
+  }
+
   // Ensure file exists
   if (!fs::exists(file)) {
     result.diagnostics.report_error(SourceRange{}, "file not found: " + file.string());
@@ -66,8 +76,8 @@ CompileResult Compiler::compile_single_file(
     return result;
   }
 
-  // Run semantic analysis on all modules
-  for (auto * module : result.module_graph->get_all_modules()) {
+  // Run semantic analysis on all modules (imports first)
+  for (auto * module : result.module_graph->get_modules_in_dependency_order()) {
     // Merge parse diagnostics - REMOVED: Managed by ModuleResolver
     // if (module->parsedUnit) {
     //   merge_diagnostics(result.diagnostics, module->parsedUnit->diags);
@@ -77,27 +87,28 @@ CompileResult Compiler::compile_single_file(
       // Continue to collect more errors from other modules
     }
   }
+  (void)check_tree_recursion(*result.module_graph, result.diagnostics);
 
   // Check for errors before codegen
   if (result.diagnostics.has_errors()) {
     return result;
   }
 
-  // Generate XML if in Build mode
+  // Generate output if in Build mode
   if (options.mode == CompileMode::Build) {
-    fs::path output_path;
+    fs::path output_dir = file.parent_path();
     if (options.output_dir) {
       fs::create_directories(*options.output_dir);
-      output_path = *options.output_dir / (file.stem().string() + ".xml");
-    } else {
-      output_path = file.parent_path() / (file.stem().string() + ".xml");
+      output_dir = *options.output_dir;
     }
 
-    if (!generate_xml(*entry, output_path, result.diagnostics)) {
+    CodegenOptions codegen = options.codegen;
+    codegen.types = &types;
+    if (!generate_output(
+          *entry, output_dir, file.stem().string(), target, codegen, options.split_output,
+          result)) {
       return result;
     }
-
-    result.generated_files.push_back(output_path);
   }
 
   result.success = !result.diagnostics.has_errors();
@@ -119,6 +130,12 @@ CompileResult Compiler::compile_project(
     return result;
   }
 
+  const std::string target = options.target.value_or(config.compiler.target);
+  if (!is_valid_target(target)) {
+    result.diagnostics.report_error(SourceRange{}, "unknown target: '" + target + "'");
+    return result;
+  }
+
   // Determine output directory
   const fs::path output_dir =
     options.output_dir.value_or(config.project_root / config.compiler.output_dir);
@@ -129,6 +146,7 @@ CompileResult Compiler::compile_project(
   // Process each entry point
   // Shared type context for this compile invocation.
   TypeContext types;
+  std::vector<std::pair<ModuleInfo *, std::string>> entries;
   for (const auto & entry_rel : config.compiler.entry_points) {
     const fs::path entry_path = config.project_root / entry_rel;
 
@@ -166,19 +184,27 @@ CompileResult Compiler::compile_project(
       continue;
     }
 
-    // Run semantic analysis on all modules
-    for (auto * module : result.module_graph->get_all_modules()) {
+    // Run semantic analysis on all modules (imports first)
+    for (auto * module : result.module_graph->get_modules_in_dependency_order()) {
       if (!run_semantic_analysis(*module, types, result.diagnostics)) {
         // Continue to collect more errors from other modules
       }
     }
+    entries.emplace_back(entry, entry_path.stem().string());
+  }
 
-    // Generate XML if no errors and in Build mode
-    if (!result.diagnostics.has_errors() && options.mode == CompileMode::Build) {
-      const fs::path output_path = output_dir / (entry_path.stem().string() + ".xml");
-      if (generate_xml(*entry, output_path, result.diagnostics)) {
-        result.generated_files.push_back(output_path);
-      }
+  // Once for the whole graph, so a cycle in a module shared by several entry
+  // points is reported once.
+  (void)check_tree_recursion(*result.module_graph, result.diagnostics);
+
+  // Generate output if no errors and in Build mode
+  if (!result.diagnostics.has_errors() && options.mode == CompileMode::Build) {
+    CodegenOptions codegen = options.codegen;
+    codegen.types = &types;
+    for (const auto & [entry, stem] : entries) {
+      (void)generate_output(
+        *entry, output_dir, stem, target, codegen,
+        options.split_output || config.compiler.split_output, result);
     }
   }
 
@@ -241,28 +267,87 @@ bool Compiler::run_semantic_analysis(
     success = false;
   }
 
-  // 7. Tree recursion checking
+  // Tree recursion is checked once per graph (see check_tree_recursion) so
+  // cycles spanning several modules are found too.
+
+  return success;
+}
+
+bool Compiler::check_tree_recursion(ModuleGraph & graph, DiagnosticBag & diags)
+{
   TreeRecursionChecker recursion_checker(&diags);
-  if (!recursion_checker.check(*module.program)) {
-    success = false;
+  return recursion_checker.check(graph);
+}
+
+bool Compiler::generate_output(
+  const ModuleInfo & module, const std::filesystem::path & output_dir, const std::string & stem,
+  std::string_view target, const CodegenOptions & codegen, bool split, CompileResult & result)
+{
+  namespace fs = std::filesystem;
+
+  std::vector<OutputFile> files;
+  const bool generated =
+    is_cpp_target(target)
+      ? generate_cpp(module, output_dir / (stem + ".cpp"), stem, codegen, files, result.diagnostics)
+      : generate_xml(module, output_dir, stem, codegen, split, files, result.diagnostics);
+  if (!generated) {
+    return false;
   }
 
-  return success;
+  bool ok = true;
+  for (auto & w : OutputWriter::write_all(files)) {
+    switch (w.status) {
+      case WriteStatus::Written:
+        result.generated_files.push_back(std::move(w.path));
+        break;
+      case WriteStatus::Unchanged:
+        result.unchanged_files.push_back(std::move(w.path));
+        break;
+      case WriteStatus::Failed:
+        result.diagnostics.report_error(SourceRange{}, w.error);
+        ok = false;
+        break;
+    }
+  }
+
+  // Trees that no longer exist must not linger next to the index.
+  const fs::path tree_dir = output_dir / stem;
+  if (ok && split && !is_cpp_target(target) && fs::is_directory(tree_dir)) {
+    std::unordered_set<std::string> current;
+    for (const auto & f : files) {
+      current.insert(f.path.lexically_normal().string());
+    }
+    std::error_code ec;
+    for (const auto & entry : fs::directory_iterator(tree_dir, ec)) {
+      const fs::path & p = entry.path();
+      if (entry.is_regular_file() && p.extension() == ".xml" &&
+          current.count(p.lexically_normal().string()) == 0 && fs::remove(p, ec)) {
+        result.removed_files.push_back(p);
+      }
+    }
+  }
+
+  return ok;
 }
 
 bool Compiler::generate_xml(
-  const ModuleInfo & module, const std::filesystem::path & output_path, DiagnosticBag & diags)
+  const ModuleInfo & module, const std::filesystem::path & output_dir, const std::string & stem,
+  const CodegenOptions & codegen, bool split, std::vector<OutputFile> & files,
+  DiagnosticBag & diags)
 {
   try {
-    const std::string xml = XmlGenerator::generate_single_output(module);
-
-    std::ofstream out(output_path);
-    if (!out.is_open()) {
-      diags.report_error(SourceRange{}, "failed to open output file: " + output_path.string());
-      return false;
+    const std::filesystem::path index_path = output_dir / (stem + ".xml");
+    if (!split) {
+      files.push_back(
+        OutputFile{index_path, XmlGenerator::generate_single_output(module, codegen)});
+      return true;
     }
 
-    out << xml;
+    for (auto & f : XmlGenerator::generate_split_output(module, stem, codegen)) {
+      const std::filesystem::path path =
+        f.relative_path.empty() ? index_path : output_dir / f.relative_path;
+      files.push_back(OutputFile{path, std::move(f.content)});
+    }
     return true;
   } catch (const std::exception & e) {
     diags.report_error(SourceRange{}, "XML generation failed: " + std::string(e.what()));
@@ -270,4 +355,18 @@ bool Compiler::generate_xml(
   }
 }
 
+bool Compiler::generate_cpp(
+  const ModuleInfo & module, const std::filesystem::path & output_path, std::string_view name,
+  const CodegenOptions & codegen, std::vector<OutputFile> & files, DiagnosticBag & diags)
+{
+  try {
+    files.push_back(
+      OutputFile{output_path, CppGenerator::generate_single_output(module, name, codegen)});
+    return true;
+  } catch (const std::exception & e) {
+    diags.report_error(SourceRange{}, "C++ generation failed: " + std::string(e.what()));
+    return false;
+  }
+}
+
 }  // namespace bt_dsl
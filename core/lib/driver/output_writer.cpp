@@ -0,0 +1,125 @@
+// bt_dsl/driver/output_writer.cpp - Write-if-changed output files
+//
+#include "bt_dsl/driver/output_writer.hpp"
+
+#include <atomic>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <set>
+#include <system_error>
+#include <thread>
+
+#include "bt_dsl/basic/parallel.hpp"
+
+namespace bt_dsl
+{
+
+namespace
+{
+
+namespace fs = std::filesystem;
+
+/// Whether `path` exists with exactly `content`.
+[[nodiscard]] bool has_content(const fs::path & path, std::string_view content)
+{
+  std::error_code ec;
+  const auto size = fs::file_size(path, ec);
+  if (ec || size != content.size()) {
+    return false;
+  }
+
+  std::ifstream in(path, std::ios::binary);
+  if (!in.is_open()) {
+    return false;
+  }
+  const std::string existing{std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+  return existing == content;
+}
+
+/// Unique name for a temporary file next to `path`.
+[[nodiscard]] fs::path temp_path_for(const fs::path & path)
+{
+  static std::atomic<std::uint64_t> counter{0};
+  const auto thread_tag = std::hash<std::thread::id>{}(std::this_thread::get_id());
+  fs::path tmp = path;
+  tmp += ".tmp" + std::to_string(thread_tag % 100000U) + "_" + std::to_string(counter++);
+  return tmp;
+}
+
+}  // namespace
+
+WriteResult OutputWriter::write_if_changed(const OutputFile & file)
+{
+  WriteResult result;
+  result.path = file.path;
+
+  if (has_content(file.path, file.content)) {
+    result.status = WriteStatus::Unchanged;
+    return result;
+  }
+
+  std::error_code ec;
+  if (file.path.has_parent_path()) {
+    fs::create_directories(file.path.parent_path(), ec);
+    if (ec) {
+      result.error = "failed to create directory: " + file.path.parent_path().string();
+      return result;
+    }
+  }
+
+  const fs::path tmp = temp_path_for(file.path);
+  {
+    std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) {
+      result.error = "failed to open output file: " + file.path.string();
+      return result;
+    }
+    out.write(file.content.data(), static_cast<std::streamsize>(file.content.size()));
+    out.flush();
+    if (!out) {
+      out.close();
+      fs::remove(tmp, ec);
+      result.error = "failed to write output file: " + file.path.string();
+      return result;
+    }
+  }
+
+  // Keep the mode of the file being replaced (e.g. an executable script).
+  const fs::file_status old_status = fs::status(file.path, ec);
+  if (!ec && fs::exists(old_status)) {
+    fs::permissions(tmp, old_status.permissions(), ec);
+  }
+
+  fs::rename(tmp, file.path, ec);
+  if (ec) {
+    fs::remove(tmp, ec);
+    result.error = "failed to replace output file: " + file.path.string();
+    return result;
+  }
+
+  result.status = WriteStatus::Written;
+  return result;
+}
+
+std::vector<WriteResult> OutputWriter::write_all(
+  const std::vector<OutputFile> & files, unsigned jobs)
+{
+  std::vector<WriteResult> results(files.size());
+
+  // Create directories up front rather than racing on them from every worker.
+  std::set<fs::path> dirs;
+  for (const auto & f : files) {
+    if (f.path.has_parent_path()) dirs.insert(f.path.parent_path());
+  }
+  for (const auto & d : dirs) {
+    std::error_code ec;
+    fs::create_directories(d, ec);
+  }
+
+  parallel_for_each_index(
+    files.size(), jobs, [&](size_t i) { results[i] = write_if_changed(files[i]); });
+  return results;
+}
+
+}  // namespace bt_dsl
@@ -0,0 +1,308 @@
+#include "bt_dsl/lsp/ast_index.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "bt_dsl/basic/casting.hpp"
+#include "bt_dsl/sema/resolution/symbol_table.hpp"
+
+namespace bt_dsl::lsp
+{
+namespace
+{
+
+bool by_position(const AstOccurrence & a, const AstOccurrence & b)
+{
+  return a.range.get_begin().get_offset() < b.range.get_begin().get_offset();
+}
+
+/// The part of sorted `items` that starts within `tree`.
+template <typename T, typename Begin>
+std::vector<T> within_tree(const std::vector<T> & items, const TreeDecl & tree, Begin begin_of)
+{
+  const uint32_t s = tree.get_range().get_begin().get_offset();
+  const uint32_t e = tree.get_range().get_end().get_offset();
+  auto first = std::partition_point(
+    items.begin(), items.end(), [&](const T & item) { return begin_of(item) < s; });
+  auto last = std::partition_point(
+    first, items.end(), [&](const T & item) { return begin_of(item) < e; });
+  return {first, last};
+}
+
+uint32_t occurrence_begin(const AstOccurrence & o) { return o.range.get_begin().get_offset(); }
+
+uint32_t range_begin(const SourceRange & r) { return r.get_begin().get_offset(); }
+
+/// Buckets, plus per node the entry, a next pointer and the vector's elements.
+template <typename Map>
+size_t map_bytes(const Map & map)
+{
+  using Value = typename Map::value_type;
+  using Item = typename Map::mapped_type::value_type;
+  size_t bytes = map.bucket_count() * sizeof(void *);
+  for (const auto & [key, items] : map) {
+    bytes += sizeof(Value) + sizeof(void *) + items.capacity() * sizeof(Item);
+  }
+  return bytes;
+}
+
+}  // namespace
+
+/// Collects entries and occurrences in one walk over the tree bodies.
+class AstIndex::Builder
+{
+public:
+  explicit Builder(AstIndex & index) : index_(index) {}
+
+  void tree(TreeDecl * t)
+  {
+    add(index_.trees_, t);
+    for (auto * stmt : t->body) {
+      this->stmt(stmt);
+    }
+  }
+
+private:
+  static void add(std::vector<Entry> & entries, AstNode * node)
+  {
+    const SourceRange r = node->get_range();
+    if (r.is_valid()) {
+      entries.push_back(Entry{r.get_begin().get_offset(), r.get_end().get_offset(), 0, node});
+    }
+  }
+
+  // `highlight`: whether references here are listed by symbol_occurrences().
+  void expr(Expr * e, bool highlight)
+  {
+    if (e == nullptr) return;
+
+    if (auto * vr = dyn_cast<VarRefExpr>(e)) {
+      add(index_.var_refs_, vr);
+      if (highlight && vr->resolvedSymbol != nullptr) {
+        const auto kind =
+          vr->resolvedSymbol->is_writable() ? HighlightKind::Write : HighlightKind::Read;
+        index_.symbol_occurrences_[vr->resolvedSymbol].push_back(
+          AstOccurrence{vr->get_range(), vr->name, kind});
+      }
+      return;
+    }
+
+    if (auto * b = dyn_cast<BinaryExpr>(e)) {
+      expr(b->lhs, highlight);
+      expr(b->rhs, highlight);
+      return;
+    }
+
+    if (auto * u = dyn_cast<UnaryExpr>(e)) {
+      expr(u->operand, highlight);
+      return;
+    }
+
+    if (auto * c = dyn_cast<CastExpr>(e)) {
+      expr(c->expr, highlight);
+      return;
+    }
+
+    if (auto * idx = dyn_cast<IndexExpr>(e)) {
+      expr(idx->base, highlight);
+      expr(idx->index, highlight);
+      return;
+    }
+
+    if (auto * arr = dyn_cast<ArrayLiteralExpr>(e)) {
+      for (auto * el : arr->elements) {
+        expr(el, highlight);
+      }
+      return;
+    }
+
+    if (auto * rep = dyn_cast<ArrayRepeatExpr>(e)) {
+      expr(rep->value, highlight);
+      expr(rep->count, highlight);
+      return;
+    }
+
+    if (auto * vm = dyn_cast<VecMacroExpr>(e)) {
+      // VecMacroExpr wraps either an ArrayLiteralExpr or ArrayRepeatExpr.
+      expr(vm->inner, highlight);
+      return;
+    }
+  }
+
+  void stmt(Stmt * s)
+  {
+    if (s == nullptr) return;
+
+    if (auto * ns = dyn_cast<NodeStmt>(s)) {
+      add(index_.node_stmts_, ns);
+      index_.node_calls_[ns->nodeName].push_back(ns->get_range());
+      for (auto * pc : ns->preconditions) {
+        if (pc) expr(pc->condition, true);
+      }
+      for (auto * arg : ns->args) {
+        if (arg == nullptr) continue;
+        if (auto * decl = arg->inlineDecl) {
+          add(index_.inline_decls_, decl);
+          index_.inline_decls_by_name_[decl->name].push_back(
+            AstOccurrence{decl->get_range(), decl->name, HighlightKind::Write});
+        }
+        expr(arg->valueExpr, true);
+      }
+      for (auto * child : ns->children) {
+        stmt(child);
+      }
+      return;
+    }
+
+    if (auto * as = dyn_cast<AssignmentStmt>(s)) {
+      if (as->resolvedTarget != nullptr) {
+        index_.symbol_occurrences_[as->resolvedTarget].push_back(
+          AstOccurrence{as->get_range(), as->target, HighlightKind::Write});
+      }
+      for (auto * pc : as->preconditions) {
+        if (pc) expr(pc->condition, false);
+      }
+      for (auto * idx : as->indices) {
+        expr(idx, true);
+      }
+      expr(as->value, true);
+      return;
+    }
+
+    if (auto * vd = dyn_cast<BlackboardDeclStmt>(s)) {
+      expr(vd->initialValue, false);
+      return;
+    }
+
+    if (auto * cd = dyn_cast<ConstDeclStmt>(s)) {
+      expr(cd->value, false);
+      return;
+    }
+  }
+
+  AstIndex & index_;
+};
+
+AstIndex::AstIndex(Program & program)
+{
+  Builder builder(*this);
+  for (auto * t : program.trees()) {
+    if (t) builder.tree(t);
+  }
+
+  link(trees_);
+  link(node_stmts_);
+  link(inline_decls_);
+  link(var_refs_);
+
+  for (auto & [sym, occurrences] : symbol_occurrences_) {
+    std::stable_sort(occurrences.begin(), occurrences.end(), by_position);
+  }
+  for (auto & [name, occurrences] : inline_decls_by_name_) {
+    std::stable_sort(occurrences.begin(), occurrences.end(), by_position);
+  }
+  for (auto & [name, ranges] : node_calls_) {
+    std::stable_sort(
+      ranges.begin(), ranges.end(),
+      [](const SourceRange & a, const SourceRange & b) { return range_begin(a) < range_begin(b); });
+  }
+}
+
+void AstIndex::link(std::vector<Entry> & entries)
+{
+  // Outer entries first among those starting together.
+  std::stable_sort(entries.begin(), entries.end(), [](const Entry & a, const Entry & b) {
+    return a.begin != b.begin ? a.begin < b.begin : a.end > b.end;
+  });
+
+  std::vector<uint32_t> open;
+  for (size_t i = 0; i < entries.size(); ++i) {
+    while (!open.empty() && entries[open.back()].end <= entries[i].begin) {
+      open.pop_back();
+    }
+    entries[i].parent = open.empty() ? k_no_parent : open.back();
+    open.push_back(static_cast<uint32_t>(i));
+  }
+}
+
+AstNode * AstIndex::innermost(const std::vector<Entry> & entries, uint32_t off)
+{
+  // The last entry starting at or before `off`; if it ends before `off`, any
+  // entry containing `off` also contains it, so look among its ancestors.
+  auto it = std::upper_bound(
+    entries.begin(), entries.end(), off, [](uint32_t o, const Entry & e) { return o < e.begin; });
+  if (it == entries.begin()) {
+    return nullptr;
+  }
+
+  auto i = static_cast<uint32_t>((it - entries.begin()) - 1);
+  while (off >= entries[i].end) {
+    i = entries[i].parent;
+    if (i == k_no_parent) {
+      return nullptr;
+    }
+  }
+  return entries[i].node;
+}
+
+AstHit AstIndex::hit_at(uint32_t byte_offset) const
+{
+  AstHit hit;
+  hit.tree = tree_at(byte_offset);
+  if (hit.tree == nullptr) {
+    return hit;
+  }
+
+  hit.node_stmt = cast_or_null<NodeStmt>(innermost(node_stmts_, byte_offset));
+  hit.inline_decl = cast_or_null<InlineBlackboardDecl>(innermost(inline_decls_, byte_offset));
+  hit.var_ref = cast_or_null<VarRefExpr>(innermost(var_refs_, byte_offset));
+  return hit;
+}
+
+TreeDecl * AstIndex::tree_at(uint32_t byte_offset) const
+{
+  return cast_or_null<TreeDecl>(innermost(trees_, byte_offset));
+}
+
+std::vector<AstOccurrence> AstIndex::symbol_occurrences(
+  const TreeDecl & tree, const Symbol * sym) const
+{
+  std::vector<AstOccurrence> out;
+  if (sym == nullptr) {
+    return out;
+  }
+
+  if (auto it = symbol_occurrences_.find(sym); it != symbol_occurrences_.end()) {
+    out = within_tree(it->second, tree, occurrence_begin);
+  }
+  if (auto it = inline_decls_by_name_.find(sym->name); it != inline_decls_by_name_.end()) {
+    const auto decls = within_tree(it->second, tree, occurrence_begin);
+    const auto middle = static_cast<std::ptrdiff_t>(out.size());
+    out.insert(out.end(), decls.begin(), decls.end());
+    std::inplace_merge(out.begin(), out.begin() + middle, out.end(), by_position);
+  }
+  return out;
+}
+
+size_t AstIndex::memory_bytes() const
+{
+  return (trees_.capacity() + node_stmts_.capacity() + inline_decls_.capacity() +
+          var_refs_.capacity()) *
+           sizeof(Entry) +
+         map_bytes(symbol_occurrences_) + map_bytes(inline_decls_by_name_) +
+         map_bytes(node_calls_);
+}
+
+std::vector<SourceRange> AstIndex::node_calls(const TreeDecl & tree, std::string_view name) const
+{
+  auto it = node_calls_.find(name);
+  if (it == node_calls_.end()) {
+    return {};
+  }
+  return within_tree(it->second, tree, range_begin);
+}
+
+}  // namespace bt_dsl::lsp
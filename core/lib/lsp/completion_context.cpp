@@ -6,6 +6,7 @@
 #include <optional>
 #include <string>
 #include <string_view>
+#include <utility>
 #include <vector>
 
 #include "bt_dsl/syntax/lexer.hpp"
@@ -42,115 +43,173 @@ struct OpenBrace
 
 }  // namespace
 
-std::optional<CompletionContext> classify_completion_context(
-  std::string_view text, uint32_t byte_offset)
+struct CompletionContextIndex::ScanState
 {
-  CompletionContext ctx;
-  ctx.kind = CompletionContextKind::TopLevelKeywords;
-
-  if (text.empty()) {
-    return ctx;
-  }
-
-  byte_offset = clamp_byte_offset(byte_offset, text.size());
-
-  // Completion context classification is purely offset-based.
-  // Use a dummy-but-valid FileId so SourceRange is considered valid.
-  bt_dsl::syntax::Lexer lex(bt_dsl::FileId{0}, text);
-  const std::vector<bt_dsl::syntax::Token> toks = lex.lex_all();
-
   std::vector<OpenBrace> brace_stack;
   bool pending_tree = false;
   std::optional<std::string_view> last_ident;
   int paren_depth = 0;
   bool saw_import_kw = false;
+  bool saw_at = false;                              // An '@' ending before the cursor
   std::optional<std::string> paren_callable_name;  // Node name for which paren is open
+};
 
-  for (const auto & t : toks) {
-    if (t.begin() > byte_offset) {
-      break;
+/**
+ * Advance `st` over `t`, a token starting at or before `byte_offset`.
+ *
+ * @return true if `t` is the import path string the cursor is in
+ */
+bool CompletionContextIndex::scan_token(
+  ScanState & st, const bt_dsl::syntax::Token & t, uint32_t byte_offset)
+{
+  if (t.kind == bt_dsl::syntax::TokenKind::StringLiteral) {
+    if (st.saw_import_kw && contains_half_open(t.range, byte_offset)) {
+      return true;
     }
+    st.saw_import_kw = false;
+  }
 
-    if (t.kind == bt_dsl::syntax::TokenKind::StringLiteral) {
-      if (saw_import_kw && contains_half_open(t.range, byte_offset)) {
-        ctx.kind = CompletionContextKind::ImportPath;
-        return ctx;
-      }
-      saw_import_kw = false;
+  if (t.kind == bt_dsl::syntax::TokenKind::Identifier) {
+    st.last_ident = t.text;
+    if (t.text == "import") {
+      st.saw_import_kw = true;
+    } else if (t.text == "tree") {
+      st.pending_tree = true;
     }
+    return false;
+  }
 
-    if (t.kind == bt_dsl::syntax::TokenKind::Identifier) {
-      last_ident = t.text;
-      if (t.text == "import") {
-        saw_import_kw = true;
-      } else if (t.text == "tree") {
-        pending_tree = true;
-      }
-      continue;
+  if (t.kind == bt_dsl::syntax::TokenKind::At) {
+    if (t.end() <= byte_offset) {
+      st.saw_at = true;
     }
+    return false;
+  }
 
-    if (t.kind == bt_dsl::syntax::TokenKind::At) {
-      if (t.end() <= byte_offset) {
-        ctx.kind = CompletionContextKind::PreconditionKind;
-      }
-      continue;
+  if (t.kind == bt_dsl::syntax::TokenKind::LParen) {
+    ++st.paren_depth;
+    // Record the callable name when entering the first paren (e.g., NodeName(...))
+    if (st.paren_depth == 1 && st.last_ident) {
+      st.paren_callable_name = std::string(*st.last_ident);
     }
+    return false;
+  }
+  if (t.kind == bt_dsl::syntax::TokenKind::RParen) {
+    st.paren_depth = std::max(0, st.paren_depth - 1);
+    if (st.paren_depth == 0) {
+      st.paren_callable_name.reset();
+    }
+    return false;
+  }
+
+  if (t.kind == bt_dsl::syntax::TokenKind::LBrace) {
+    OpenBrace ob;
+    ob.openByte = t.begin();
 
-    if (t.kind == bt_dsl::syntax::TokenKind::LParen) {
-      ++paren_depth;
-      // Record the callable name when entering the first paren (e.g., NodeName(...))
-      if (paren_depth == 1 && last_ident) {
-        paren_callable_name = std::string(*last_ident);
+    if (st.pending_tree) {
+      ob.after_tree = true;
+      if (st.last_ident && *st.last_ident != "tree") {
+        ob.tree_name = std::string(*st.last_ident);
       }
-      continue;
+    } else if (st.last_ident) {
+      ob.after_node = true;
+      ob.node_name = std::string(*st.last_ident);
     }
-    if (t.kind == bt_dsl::syntax::TokenKind::RParen) {
-      paren_depth = std::max(0, paren_depth - 1);
-      if (paren_depth == 0) {
-        paren_callable_name.reset();
-      }
-      continue;
+
+    st.brace_stack.push_back(std::move(ob));
+    st.pending_tree = false;
+    return false;
+  }
+
+  if (t.kind == bt_dsl::syntax::TokenKind::RBrace) {
+    if (!st.brace_stack.empty()) {
+      st.brace_stack.pop_back();
     }
+    st.pending_tree = false;
+    return false;
+  }
 
-    if (t.kind == bt_dsl::syntax::TokenKind::LBrace) {
-      OpenBrace ob;
-      ob.openByte = t.begin();
+  if (
+    t.kind != bt_dsl::syntax::TokenKind::DocLine &&
+    t.kind != bt_dsl::syntax::TokenKind::DocModule) {
+    st.pending_tree = false;
+  }
+  return false;
+}
 
-      if (pending_tree) {
-        ob.after_tree = true;
-        if (last_ident && *last_ident != "tree") {
-          ob.tree_name = std::string(*last_ident);
-        }
-      } else if (last_ident) {
-        ob.after_node = true;
-        ob.node_name = std::string(*last_ident);
-      }
+CompletionContextIndex::CompletionContextIndex() = default;
+CompletionContextIndex::~CompletionContextIndex() = default;
+CompletionContextIndex::CompletionContextIndex(CompletionContextIndex &&) noexcept = default;
+CompletionContextIndex & CompletionContextIndex::operator=(CompletionContextIndex &&) noexcept =
+  default;
 
-      brace_stack.push_back(std::move(ob));
-      pending_tree = false;
-      continue;
-    }
+CompletionContextIndex::CompletionContextIndex(
+  std::vector<bt_dsl::syntax::Token> tokens, size_t text_size)
+: tokens_(std::move(tokens)), text_size_(text_size)
+{
+  // With no cursor limit the scan never stops early, and counts every '@'.
+  constexpr uint32_t k_no_limit = UINT32_MAX;
 
-    if (t.kind == bt_dsl::syntax::TokenKind::RBrace) {
-      if (!brace_stack.empty()) {
-        brace_stack.pop_back();
-      }
-      pending_tree = false;
-      continue;
+  checkpoints_.reserve(tokens_.size() / k_checkpoint_interval + 1);
+  ScanState st;
+  for (size_t i = 0; i < tokens_.size(); ++i) {
+    if (i % k_checkpoint_interval == 0) {
+      checkpoints_.push_back(st);
     }
+    (void)scan_token(st, tokens_[i], k_no_limit);
+  }
+  if (checkpoints_.empty()) {
+    checkpoints_.emplace_back();
+  }
+}
+
+size_t CompletionContextIndex::memory_bytes() const
+{
+  size_t bytes = tokens_.capacity() * sizeof(bt_dsl::syntax::Token) +
+                 checkpoints_.capacity() * sizeof(ScanState);
+  for (const auto & st : checkpoints_) {
+    bytes += st.brace_stack.capacity() * sizeof(OpenBrace);
+  }
+  return bytes;
+}
+
+std::optional<CompletionContext> CompletionContextIndex::classify(uint32_t byte_offset) const
+{
+  CompletionContext ctx;
+  ctx.kind = CompletionContextKind::TopLevelKeywords;
+
+  if (text_size_ == 0) {
+    return ctx;
+  }
+
+  byte_offset = clamp_byte_offset(byte_offset, text_size_);
+
+  // Tokens that end at or before the cursor scan the same whatever the
+  // cursor, so resume from the last checkpoint among them.
+  const auto done = std::partition_point(
+    tokens_.begin(), tokens_.end(),
+    [&](const bt_dsl::syntax::Token & t) { return t.end() <= byte_offset; });
+  const auto ended = static_cast<size_t>(done - tokens_.begin());
+  const size_t checkpoint = ended / k_checkpoint_interval;
 
-    if (
-      t.kind != bt_dsl::syntax::TokenKind::DocLine &&
-      t.kind != bt_dsl::syntax::TokenKind::DocModule) {
-      pending_tree = false;
+  ScanState st = checkpoints_[checkpoint];
+  for (size_t i = checkpoint * k_checkpoint_interval; i < tokens_.size(); ++i) {
+    const auto & t = tokens_[i];
+    if (t.begin() > byte_offset) {
+      break;
+    }
+    if (scan_token(st, t, byte_offset)) {
+      ctx.kind = CompletionContextKind::ImportPath;
+      return ctx;
     }
   }
 
   // If we observed an '@' before the cursor, prefer completing precondition kinds
   // even when nested inside a tree body.
-  if (ctx.kind == CompletionContextKind::PreconditionKind) {
-    if (!brace_stack.empty()) {
-      const OpenBrace & innermost = brace_stack.back();
+  if (st.saw_at) {
+    ctx.kind = CompletionContextKind::PreconditionKind;
+    if (!st.brace_stack.empty()) {
+      const OpenBrace & innermost = st.brace_stack.back();
       if (innermost.tree_name) {
         ctx.tree_name = innermost.tree_name.value();
       }
@@ -158,15 +217,10 @@ std::optional<CompletionContext> classify_completion_context(
     return ctx;
   }
 
-  if (paren_depth > 0) {
-    bt_dsl::syntax::TokenKind prev = bt_dsl::syntax::TokenKind::Unknown;
-    for (const auto & t : toks) {
-      if (t.end() <= byte_offset) {
-        prev = t.kind;
-      } else {
-        break;
-      }
-    }
+  if (st.paren_depth > 0) {
+    // Last token ending at or before the cursor
+    const bt_dsl::syntax::TokenKind prev =
+      ended > 0 ? tokens_[ended - 1].kind : bt_dsl::syntax::TokenKind::Unknown;
 
     if (prev == bt_dsl::syntax::TokenKind::LParen || prev == bt_dsl::syntax::TokenKind::Comma) {
       ctx.kind = CompletionContextKind::ArgStart;
@@ -177,25 +231,25 @@ std::optional<CompletionContext> classify_completion_context(
     }
 
     // Search brace stack from innermost to outermost for tree_name
-    for (auto it = brace_stack.rbegin(); it != brace_stack.rend(); ++it) {
+    for (auto it = st.brace_stack.rbegin(); it != st.brace_stack.rend(); ++it) {
       if (it->tree_name) {
         ctx.tree_name = it->tree_name.value_or(std::string{});
         break;
       }
     }
     // Set callable_name so port suggestions work
-    if (paren_callable_name) {
-      ctx.callable_name = *paren_callable_name;
+    if (st.paren_callable_name) {
+      ctx.callable_name = *st.paren_callable_name;
     }
     return ctx;
   }
 
-  if (!brace_stack.empty()) {
-    const OpenBrace & innermost = brace_stack.back();
+  if (!st.brace_stack.empty()) {
+    const OpenBrace & innermost = st.brace_stack.back();
     if (innermost.after_tree || innermost.after_node) {
       ctx.kind = CompletionContextKind::TreeBody;
       // Search brace stack for tree_name
-      for (auto it = brace_stack.rbegin(); it != brace_stack.rend(); ++it) {
+      for (auto it = st.brace_stack.rbegin(); it != st.brace_stack.rend(); ++it) {
         if (it->tree_name) {
           ctx.tree_name = it->tree_name.value_or(std::string{});
           break;
@@ -211,4 +265,17 @@ std::optional<CompletionContext> classify_completion_context(
   return ctx;
 }
 
+std::optional<CompletionContext> classify_completion_context(
+  std::string_view text, uint32_t byte_offset)
+{
+  if (text.empty()) {
+    return CompletionContext{CompletionContextKind::TopLevelKeywords, std::nullopt, std::nullopt};
+  }
+
+  // Completion context classification is purely offset-based.
+  // Use a dummy-but-valid FileId so SourceRange is considered valid.
+  bt_dsl::syntax::Lexer lex(bt_dsl::FileId{0}, text);
+  return CompletionContextIndex(lex.lex_all(), text.size()).classify(byte_offset);
+}
+
 }  // namespace bt_dsl::lsp
@@ -0,0 +1,105 @@
+#include "bt_dsl/lsp/import_uri.hpp"
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace bt_dsl::lsp
+{
+namespace
+{
+
+bool starts_with(std::string_view s, std::string_view prefix)
+{
+  return s.size() >= prefix.size() && s.substr(0, prefix.size()) == prefix;
+}
+
+std::string remove_dot_segments(std::string_view path)
+{
+  std::vector<std::string_view> segs;
+  segs.reserve(32);
+
+  size_t i = 0;
+  while (i <= path.size()) {
+    const size_t j = path.find('/', i);
+    const size_t end = (j == std::string_view::npos) ? path.size() : j;
+    const std::string_view seg = path.substr(i, end - i);
+
+    if (seg == "..") {
+      if (!segs.empty()) {
+        segs.pop_back();
+      }
+    } else if (!seg.empty() && seg != ".") {
+      segs.push_back(seg);
+    }
+
+    if (j == std::string_view::npos) {
+      break;
+    }
+    i = j + 1;
+  }
+
+  std::string out;
+  if (starts_with(path, "/")) {
+    out.push_back('/');
+  }
+  for (size_t k = 0; k < segs.size(); ++k) {
+    if (k > 0) {
+      out.push_back('/');
+    }
+    out.append(segs[k].data(), segs[k].size());
+  }
+  return out;
+}
+
+}  // namespace
+
+bool is_relative_import_spec(std::string_view spec)
+{
+  return starts_with(spec, "./") || starts_with(spec, "../");
+}
+
+std::string package_import_uri(std::string_view spec)
+{
+  std::string out = "bt-dsl-pkg://";
+  out.append(spec.data(), spec.size());
+  return out;
+}
+
+std::optional<std::string> resolve_relative_import_uri(
+  std::string_view from_uri, std::string_view spec)
+{
+  if (!is_relative_import_spec(spec)) {
+    return std::nullopt;
+  }
+
+  constexpr std::string_view file_prefix = "file://";
+  if (!starts_with(from_uri, file_prefix)) {
+    return std::nullopt;
+  }
+
+  const size_t last_slash = from_uri.find_last_of('/');
+  if (last_slash == std::string_view::npos || last_slash + 1 <= file_prefix.size()) {
+    return std::nullopt;
+  }
+
+  const std::string_view dir_uri = from_uri.substr(0, last_slash + 1);
+  std::string combined = std::string(dir_uri);
+  combined += std::string(spec);
+
+  const std::string_view combined_sv = combined;
+  const std::string_view path_part = combined_sv.substr(file_prefix.size());
+  if (path_part.empty() || path_part[0] != '/') {
+    return std::nullopt;
+  }
+
+  const std::string normalized_path = remove_dot_segments(path_part);
+  std::string out;
+  out.reserve(file_prefix.size() + normalized_path.size());
+  out.append(file_prefix.data(), file_prefix.size());
+  out += normalized_path;
+  return out;
+}
+
+}  // namespace bt_dsl::lsp
@@ -0,0 +1,111 @@
+#include "bt_dsl/lsp/semantic_tokens.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "bt_dsl/lsp/text_edit.hpp"
+
+namespace bt_dsl::lsp
+{
+namespace
+{
+
+constexpr size_t k_ints_per_token = 5;
+
+/// Length of UTF-8 `s` in the units of `encoding`.
+uint32_t encoded_length(std::string_view s, PositionEncoding encoding)
+{
+  return encoding == PositionEncoding::Utf8 ? static_cast<uint32_t>(s.size()) : utf16_length(s);
+}
+
+}  // namespace
+
+void normalize_semantic_tokens(std::vector<SemanticToken> & tokens)
+{
+  std::stable_sort(tokens.begin(), tokens.end(), [](const auto & a, const auto & b) {
+    return a.range.startByte < b.range.startByte;
+  });
+
+  size_t kept = 0;
+  uint32_t covered_to = 0;
+  for (auto & t : tokens) {
+    if (t.range.endByte <= t.range.startByte) {
+      continue;
+    }
+    if (kept > 0 && t.range.startByte < covered_to) {
+      continue;
+    }
+    covered_to = t.range.endByte;
+    tokens[kept++] = t;
+  }
+  tokens.resize(kept);
+}
+
+std::vector<uint32_t> encode_semantic_tokens(
+  std::string_view text, const std::vector<uint32_t> & line_offsets,
+  const std::vector<SemanticToken> & tokens, PositionEncoding encoding)
+{
+  std::vector<uint32_t> data;
+  data.reserve(tokens.size() * k_ints_per_token);
+
+  const auto size = static_cast<uint32_t>(text.size());
+  uint32_t prev_line = 0;
+  uint32_t prev_char = 0;
+  for (const auto & t : tokens) {
+    const uint32_t start = std::min(t.range.startByte, size);
+    const uint32_t end = std::clamp(t.range.endByte, start, size);
+
+    const auto it = std::upper_bound(line_offsets.begin(), line_offsets.end(), start);
+    const auto line =
+      it == line_offsets.begin() ? 0U : static_cast<uint32_t>(it - line_offsets.begin() - 1);
+    const uint32_t line_start = line_offsets.empty() ? 0U : line_offsets[line];
+
+    const uint32_t ch = encoded_length(text.substr(line_start, start - line_start), encoding);
+    const uint32_t length = encoded_length(text.substr(start, end - start), encoding);
+
+    data.push_back(line - prev_line);
+    data.push_back(line == prev_line ? ch - prev_char : ch);
+    data.push_back(length);
+    data.push_back(static_cast<uint32_t>(t.type));
+    data.push_back(t.declaration ? 1U : 0U);
+
+    prev_line = line;
+    prev_char = ch;
+  }
+  return data;
+}
+
+std::vector<SemanticTokensEdit> diff_semantic_tokens(
+  const std::vector<uint32_t> & previous, const std::vector<uint32_t> & next)
+{
+  const size_t limit = std::min(previous.size(), next.size());
+
+  size_t prefix = 0;
+  while (prefix < limit && previous[prefix] == next[prefix]) {
+    ++prefix;
+  }
+  prefix -= prefix % k_ints_per_token;
+  if (prefix == previous.size() && prefix == next.size()) {
+    return {};
+  }
+
+  size_t suffix = 0;
+  while (suffix < limit - prefix &&
+         previous[previous.size() - 1 - suffix] == next[next.size() - 1 - suffix]) {
+    ++suffix;
+  }
+  suffix -= suffix % k_ints_per_token;
+
+  SemanticTokensEdit edit;
+  edit.start = static_cast<uint32_t>(prefix);
+  edit.delete_count = static_cast<uint32_t>(previous.size() - prefix - suffix);
+  edit.data.assign(
+    next.begin() + static_cast<std::ptrdiff_t>(prefix),
+    next.end() - static_cast<std::ptrdiff_t>(suffix));
+  return {std::move(edit)};
+}
+
+}  // namespace bt_dsl::lsp
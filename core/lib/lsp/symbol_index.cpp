@@ -0,0 +1,670 @@
+#include "bt_dsl/lsp/symbol_index.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstddef>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <set>
+#include <system_error>
+#include <nlohmann/json.hpp>
+#include <tuple>
+#include <utility>
+
+#include "bt_dsl/ast/ast.hpp"
+#include "bt_dsl/ast/ast_context.hpp"
+#include "bt_dsl/basic/casting.hpp"
+#include "bt_dsl/basic/diagnostic.hpp"
+#include "bt_dsl/basic/source_manager.hpp"
+#include "bt_dsl/driver/output_writer.hpp"
+#include "bt_dsl/lsp/import_uri.hpp"
+#include "bt_dsl/lsp/text_edit.hpp"
+#include "bt_dsl/project/project_config.hpp"
+#include "bt_dsl/sema/resolution/module_graph.hpp"
+#include "bt_dsl/syntax/frontend.hpp"
+#include "bt_dsl/syntax/keywords.hpp"
+#include "bt_dsl/syntax/lexer.hpp"
+
+namespace bt_dsl::lsp
+{
+namespace
+{
+
+namespace fs = std::filesystem;
+using json = nlohmann::json;
+
+// Bump when the on-disk layout or the indexing rules change.
+constexpr int k_index_format = 1;
+
+bool is_ident_char(char c)
+{
+  return (std::isalnum(static_cast<unsigned char>(c)) != 0) || c == '_';
+}
+
+/// Namespace a reference of `kind` looks a declaration up in.
+bool can_refer_to(IndexRefKind ref, IndexSymbolKind sym)
+{
+  switch (ref) {
+    case IndexRefKind::Node:
+      return sym == IndexSymbolKind::Tree || sym == IndexSymbolKind::Node;
+    case IndexRefKind::Type:
+      return sym == IndexSymbolKind::Type;
+    case IndexRefKind::Value:
+      return sym == IndexSymbolKind::Global;
+  }
+  return false;
+}
+
+bool contains(const IndexRange & r, uint32_t line, uint32_t column)
+{
+  return r.line == line && column >= r.column && column <= r.column + r.length;
+}
+
+bool same_position(const IndexRange & a, const IndexRange & b)
+{
+  return a.line == b.line && a.column == b.column;
+}
+
+std::string to_lower(std::string_view s)
+{
+  std::string out(s);
+  std::transform(out.begin(), out.end(), out.begin(), [](char c) {
+    return static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+  });
+  return out;
+}
+
+/// 0 = prefix, 1 = substring, 2 = subsequence; nullopt if no match.
+std::optional<int> match_rank(std::string_view name, std::string_view lowered_query)
+{
+  const std::string lowered = to_lower(name);
+  const size_t pos = lowered.find(lowered_query);
+  if (pos == 0) return 0;
+  if (pos != std::string::npos) return 1;
+
+  size_t q = 0;
+  for (const char c : lowered) {
+    if (q < lowered_query.size() && c == lowered_query[q]) ++q;
+  }
+  return q == lowered_query.size() ? std::optional<int>(2) : std::nullopt;
+}
+
+/// Builds the entry of one parsed file.
+class FileIndexer
+{
+public:
+  FileIndexer(std::string_view text, FileIndex & out)
+  : text_(text), line_offsets_(build_line_offsets(text)), out_(out)
+  {
+  }
+
+  void index(const Program & p)
+  {
+    for (auto * imp : p.imports()) {
+      if (imp == nullptr) continue;
+      if (is_relative_import_spec(imp->path)) {
+        if (auto resolved = resolve_relative_import_uri(out_.uri, imp->path)) {
+          out_.imports.push_back(std::move(*resolved));
+        }
+      } else {
+        out_.imports.push_back(package_import_uri(imp->path));
+      }
+    }
+
+    for (auto * t : p.extern_types()) {
+      if (t) declare(t->get_range(), t->name, IndexSymbolKind::Type);
+    }
+    for (auto * a : p.type_aliases()) {
+      if (a == nullptr) continue;
+      declare(a->get_range(), a->name, IndexSymbolKind::Type);
+      visit_type(a->aliasedType);
+    }
+    for (auto * e : p.externs()) {
+      if (e == nullptr) continue;
+      declare(e->get_range(), e->name, IndexSymbolKind::Node);
+      for (auto * port : e->ports) {
+        if (port == nullptr) continue;
+        visit_type(port->type);
+        visit_expr(port->defaultValue);
+      }
+    }
+    for (auto * gv : p.global_vars()) {
+      if (gv == nullptr) continue;
+      declare(gv->get_range(), gv->name, IndexSymbolKind::Global);
+      visit_type(gv->type);
+      visit_expr(gv->initialValue);
+    }
+    for (auto * gc : p.global_consts()) {
+      if (gc == nullptr) continue;
+      declare(gc->get_range(), gc->name, IndexSymbolKind::Global);
+      visit_type(gc->type);
+      visit_expr(gc->value);
+    }
+    for (auto * t : p.trees()) {
+      if (t == nullptr) continue;
+      declare(t->get_range(), t->name, IndexSymbolKind::Tree);
+      index_tree(*t);
+    }
+
+    const auto by_position = [](const auto & a, const auto & b) {
+      return std::tie(a.range.line, a.range.column) < std::tie(b.range.line, b.range.column);
+    };
+    std::sort(out_.symbols.begin(), out_.symbols.end(), by_position);
+    std::sort(out_.references.begin(), out_.references.end(), by_position);
+  }
+
+private:
+  void index_tree(const TreeDecl & t)
+  {
+    // Block scoping is not modelled: a local anywhere in the tree hides a
+    // global of the same name in the whole tree.
+    locals_.clear();
+    for (auto * param : t.params) {
+      if (param) locals_.insert(param->name);
+    }
+    for (auto * s : t.body) {
+      collect_locals(s);
+    }
+
+    for (auto * param : t.params) {
+      if (param == nullptr) continue;
+      visit_type(param->type);
+      visit_expr(param->defaultValue);
+    }
+    for (auto * s : t.body) {
+      visit_stmt(s);
+    }
+    locals_.clear();
+  }
+
+  void collect_locals(const Stmt * s)
+  {
+    if (auto * ns = dyn_cast<NodeStmt>(s)) {
+      for (auto * arg : ns->args) {
+        if (arg && arg->inlineDecl) locals_.insert(arg->inlineDecl->name);
+      }
+      for (auto * ch : ns->children) {
+        collect_locals(ch);
+      }
+    } else if (auto * vd = dyn_cast<BlackboardDeclStmt>(s)) {
+      locals_.insert(vd->name);
+    } else if (auto * cd = dyn_cast<ConstDeclStmt>(s)) {
+      locals_.insert(cd->name);
+    }
+  }
+
+  void visit_stmt(const Stmt * s)
+  {
+    if (auto * ns = dyn_cast<NodeStmt>(s)) {
+      refer(ns->get_range(), ns->nodeName, IndexRefKind::Node);
+      for (auto * pc : ns->preconditions) {
+        if (pc) visit_expr(pc->condition);
+      }
+      for (auto * arg : ns->args) {
+        if (arg) visit_expr(arg->valueExpr);
+      }
+      for (auto * ch : ns->children) {
+        visit_stmt(ch);
+      }
+    } else if (auto * as = dyn_cast<AssignmentStmt>(s)) {
+      for (auto * pc : as->preconditions) {
+        if (pc) visit_expr(pc->condition);
+      }
+      refer_value(as->get_range(), as->target);
+      for (auto * idx : as->indices) {
+        visit_expr(idx);
+      }
+      visit_expr(as->value);
+    } else if (auto * vd = dyn_cast<BlackboardDeclStmt>(s)) {
+      visit_type(vd->type);
+      visit_expr(vd->initialValue);
+    } else if (auto * cd = dyn_cast<ConstDeclStmt>(s)) {
+      visit_type(cd->type);
+      visit_expr(cd->value);
+    }
+  }
+
+  void visit_expr(const Expr * e)
+  {
+    if (e == nullptr) return;
+
+    if (auto * vr = dyn_cast<VarRefExpr>(e)) {
+      refer_value(vr->get_range(), vr->name);
+    } else if (auto * b = dyn_cast<BinaryExpr>(e)) {
+      visit_expr(b->lhs);
+      visit_expr(b->rhs);
+    } else if (auto * u = dyn_cast<UnaryExpr>(e)) {
+      visit_expr(u->operand);
+    } else if (auto * c = dyn_cast<CastExpr>(e)) {
+      visit_expr(c->expr);
+      visit_type(c->targetType);
+    } else if (auto * idx = dyn_cast<IndexExpr>(e)) {
+      visit_expr(idx->base);
+      visit_expr(idx->index);
+    } else if (auto * arr = dyn_cast<ArrayLiteralExpr>(e)) {
+      for (auto * el : arr->elements) {
+        visit_expr(el);
+      }
+    } else if (auto * rep = dyn_cast<ArrayRepeatExpr>(e)) {
+      visit_expr(rep->value);
+      visit_expr(rep->count);
+    } else if (auto * vm = dyn_cast<VecMacroExpr>(e)) {
+      visit_expr(vm->inner);
+    }
+  }
+
+  void visit_type(const TypeNode * t)
+  {
+    if (t == nullptr) return;
+
+    if (auto * te = dyn_cast<TypeExpr>(t)) {
+      visit_type(te->base);
+    } else if (auto * pt = dyn_cast<PrimaryType>(t)) {
+      refer(pt->get_range(), pt->name, IndexRefKind::Type);
+    } else if (auto * sa = dyn_cast<StaticArrayType>(t)) {
+      visit_type(sa->elementType);
+    } else if (auto * da = dyn_cast<DynamicArrayType>(t)) {
+      visit_type(da->elementType);
+    }
+  }
+
+  void declare(SourceRange r, std::string_view name, IndexSymbolKind kind)
+  {
+    if (auto range = locate(r, name)) {
+      out_.symbols.push_back(IndexedSymbol{std::string(name), kind, *range});
+    }
+  }
+
+  void refer(SourceRange r, std::string_view name, IndexRefKind kind)
+  {
+    if (auto range = locate(r, name)) {
+      out_.references.push_back(IndexedReference{std::string(name), kind, *range});
+    }
+  }
+
+  void refer_value(SourceRange r, std::string_view name)
+  {
+    if (locals_.count(name) == 0) {
+      refer(r, name, IndexRefKind::Value);
+    }
+  }
+
+  /// First whole-word occurrence of `name` within `r`.
+  std::optional<IndexRange> locate(SourceRange r, std::string_view name) const
+  {
+    const auto size = static_cast<uint32_t>(text_.size());
+    const uint32_t begin = std::min(r.get_begin().get_offset(), size);
+    const uint32_t end = std::clamp(r.get_end().get_offset(), begin, size);
+    if (name.empty()) return std::nullopt;
+
+    const std::string_view slice = text_.substr(begin, end - begin);
+    for (size_t pos = slice.find(name); pos != std::string_view::npos;
+         pos = slice.find(name, pos + 1)) {
+      const size_t after = pos + name.size();
+      const bool starts_word = pos == 0 || !is_ident_char(slice[pos - 1]);
+      const bool ends_word = after == slice.size() || !is_ident_char(slice[after]);
+      if (starts_word && ends_word) {
+        return range_at(begin + static_cast<uint32_t>(pos), static_cast<uint32_t>(name.size()));
+      }
+    }
+    return std::nullopt;
+  }
+
+  IndexRange range_at(uint32_t offset, uint32_t length) const
+  {
+    const auto it = std::upper_bound(line_offsets_.begin(), line_offsets_.end(), offset);
+    const auto line = static_cast<uint32_t>(it - line_offsets_.begin() - 1);
+    const uint32_t line_start = line_offsets_[line];
+    const std::string_view prefix = text_.substr(line_start, offset - line_start);
+    return IndexRange{line, offset - line_start, utf16_length(prefix), length};
+  }
+
+  std::string_view text_;
+  std::vector<uint32_t> line_offsets_;
+  FileIndex & out_;
+  std::unordered_set<std::string_view> locals_;
+};
+
+bool is_hidden(const fs::path & p)
+{
+  const std::string name = p.filename().string();
+  return name.size() > 1 && name[0] == '.';
+}
+
+/// Regular files below `dir` for which `keep` holds, not entering hidden
+/// directories. Unreadable directories are skipped.
+template <typename Keep>
+void walk_files(const fs::path & dir, Keep keep, std::set<fs::path> & out)
+{
+  std::error_code ec;
+  fs::recursive_directory_iterator it(dir, fs::directory_options::skip_permission_denied, ec);
+  for (; !ec && it != fs::recursive_directory_iterator(); it.increment(ec)) {
+    const fs::directory_entry & entry = *it;
+    std::error_code type_ec;
+    if (entry.is_directory(type_ec)) {
+      if (is_hidden(entry.path())) it.disable_recursion_pending();
+      continue;
+    }
+    if (entry.is_regular_file(type_ec) && keep(entry.path())) {
+      out.insert(fs::weakly_canonical(entry.path(), type_ec));
+    }
+  }
+}
+
+json range_to_json(const IndexRange & r)
+{
+  return json::array({r.line, r.column, r.column_utf16, r.length});
+}
+
+IndexRange range_from_json(const json & j)
+{
+  return IndexRange{
+    j.at(0).get<uint32_t>(), j.at(1).get<uint32_t>(), j.at(2).get<uint32_t>(),
+    j.at(3).get<uint32_t>()};
+}
+
+}  // namespace
+
+FileIndex index_source(std::string_view uri, std::string_view text)
+{
+  FileIndex out;
+  out.uri = std::string(uri);
+
+  SourceRegistry sources;
+  AstContext ast;
+  DiagnosticBag diags;
+  const ParseOutput parsed =
+    parse_source(sources, std::filesystem::path(out.uri), std::string(text), ast, diags);
+  if (parsed.program != nullptr) {
+    FileIndexer(text, out).index(*parsed.program);
+  }
+  return out;
+}
+
+bool is_valid_symbol_name(std::string_view name)
+{
+  // Keywords are contextual, so they lex as identifiers.
+  constexpr std::array<std::string_view, 5> k_reserved = {"true", "false", "null", "as", "_"};
+  const auto is_one_of = [&](const auto & words) {
+    return std::find(words.begin(), words.end(), name) != words.end();
+  };
+  if (
+    is_one_of(syntax::k_top_level_keywords) || is_one_of(syntax::k_port_directions) ||
+    is_one_of(k_reserved)) {
+    return false;
+  }
+
+  using syntax::TokenKind;
+  const auto tokens = syntax::Lexer(FileId{}, name).lex_all();
+  return tokens.size() == 2 && tokens[0].kind == TokenKind::Identifier &&
+         tokens[0].text == name && tokens[1].kind == TokenKind::Eof;
+}
+
+std::vector<fs::path> find_index_roots(const std::vector<fs::path> & folders)
+{
+  std::set<fs::path> configs;
+  for (const auto & folder : folders) {
+    if (auto above = find_project_config(folder)) {
+      configs.insert(*above);
+    }
+    walk_files(
+      folder, [](const fs::path & p) { return p.filename() == k_project_config_file_name; },
+      configs);
+  }
+
+  std::set<fs::path> roots;
+  for (const auto & config_path : configs) {
+    std::error_code ec;
+    const fs::path root = fs::weakly_canonical(config_path.parent_path(), ec);
+    roots.insert(root);
+
+    const auto loaded = load_project_config(config_path);
+    if (!loaded.success) continue;
+    for (const auto & dep : loaded.config.dependencies) {
+      if (dep.path) {
+        roots.insert(fs::weakly_canonical(root / *dep.path, ec));
+      }
+    }
+  }
+  return {roots.begin(), roots.end()};
+}
+
+std::vector<fs::path> list_index_sources(const std::vector<fs::path> & roots)
+{
+  std::set<fs::path> files;
+  for (const auto & root : roots) {
+    walk_files(root, [](const fs::path & p) { return p.extension() == ".bt"; }, files);
+  }
+  return {files.begin(), files.end()};
+}
+
+// ---- SymbolIndex ----
+
+void SymbolIndex::update(FileIndex file)
+{
+  remove(file.uri);
+  for (const auto & ref : file.references) {
+    referencing_files_[ref.name].insert(file.uri);
+  }
+  std::string uri = file.uri;
+  files_.emplace(std::move(uri), std::move(file));
+}
+
+void SymbolIndex::remove(std::string_view uri)
+{
+  auto it = files_.find(std::string(uri));
+  if (it == files_.end()) {
+    return;
+  }
+  for (const auto & ref : it->second.references) {
+    auto r = referencing_files_.find(ref.name);
+    if (r == referencing_files_.end()) continue;
+    r->second.erase(it->first);
+    if (r->second.empty()) {
+      referencing_files_.erase(r);
+    }
+  }
+  files_.erase(it);
+}
+
+const FileIndex * SymbolIndex::file(std::string_view uri) const
+{
+  auto it = files_.find(std::string(uri));
+  return it == files_.end() ? nullptr : &it->second;
+}
+
+std::vector<std::string> SymbolIndex::uris() const
+{
+  std::vector<std::string> out;
+  out.reserve(files_.size());
+  for (const auto & [uri, f] : files_) {
+    out.push_back(uri);
+  }
+  std::sort(out.begin(), out.end());
+  return out;
+}
+
+std::vector<SymbolLocation> SymbolIndex::find_symbols(std::string_view query, size_t limit) const
+{
+  const std::string lowered_query = to_lower(query);
+
+  struct Match
+  {
+    int rank;
+    const std::string * uri;
+    const IndexedSymbol * symbol;
+  };
+  std::vector<Match> matches;
+  for (const auto & [uri, f] : files_) {
+    for (const auto & sym : f.symbols) {
+      if (const auto rank = match_rank(sym.name, lowered_query)) {
+        matches.push_back(Match{*rank, &uri, &sym});
+      }
+    }
+  }
+
+  const auto n = std::min(limit, matches.size());
+  std::partial_sort(
+    matches.begin(), matches.begin() + static_cast<std::ptrdiff_t>(n), matches.end(),
+    [](const Match & a, const Match & b) {
+      return std::tie(a.rank, a.symbol->name, *a.uri, a.symbol->range.line) <
+             std::tie(b.rank, b.symbol->name, *b.uri, b.symbol->range.line);
+    });
+
+  std::vector<SymbolLocation> out;
+  out.reserve(n);
+  for (size_t i = 0; i < n; ++i) {
+    out.push_back(SymbolLocation{*matches[i].uri, *matches[i].symbol});
+  }
+  return out;
+}
+
+std::optional<SymbolLocation> SymbolIndex::symbol_at(
+  std::string_view uri, uint32_t line, uint32_t column) const
+{
+  const FileIndex * f = file(uri);
+  if (f == nullptr) {
+    return std::nullopt;
+  }
+  for (const auto & sym : f->symbols) {
+    if (contains(sym.range, line, column)) {
+      return SymbolLocation{f->uri, sym};
+    }
+  }
+  for (const auto & ref : f->references) {
+    if (contains(ref.range, line, column)) {
+      return resolve(*f, ref.name, ref.kind);
+    }
+  }
+  return std::nullopt;
+}
+
+std::vector<ReferenceLocation> SymbolIndex::references(const SymbolLocation & decl) const
+{
+  std::vector<ReferenceLocation> out;
+
+  auto files = referencing_files_.find(decl.symbol.name);
+  if (files == referencing_files_.end()) {
+    return out;
+  }
+
+  for (const auto & uri : files->second) {
+    const FileIndex * f = file(uri);
+    if (f == nullptr) continue;
+    for (const auto & ref : f->references) {
+      if (ref.name != decl.symbol.name || !can_refer_to(ref.kind, decl.symbol.kind)) continue;
+      const auto target = resolve(*f, ref.name, ref.kind);
+      if (
+        target && target->uri == decl.uri &&
+        same_position(target->symbol.range, decl.symbol.range)) {
+        out.push_back(ReferenceLocation{uri, ref.range});
+      }
+    }
+  }
+
+  std::sort(out.begin(), out.end(), [](const auto & a, const auto & b) {
+    return std::tie(a.uri, a.range.line, a.range.column) <
+           std::tie(b.uri, b.range.line, b.range.column);
+  });
+  return out;
+}
+
+std::optional<SymbolLocation> SymbolIndex::resolve(
+  const FileIndex & from, std::string_view name, IndexRefKind kind) const
+{
+  for (const auto & sym : from.symbols) {
+    if (sym.name == name && can_refer_to(kind, sym.kind)) {
+      return SymbolLocation{from.uri, sym};
+    }
+  }
+  if (!ModuleInfo::is_public(name)) {
+    return std::nullopt;
+  }
+  for (const auto & imp_uri : from.imports) {
+    const FileIndex * imp = file(imp_uri);
+    if (imp == nullptr) continue;
+    for (const auto & sym : imp->symbols) {
+      if (sym.name == name && can_refer_to(kind, sym.kind)) {
+        return SymbolLocation{imp->uri, sym};
+      }
+    }
+  }
+  return std::nullopt;
+}
+
+// ---- Persistence ----
+
+bool SymbolIndex::save(const std::filesystem::path & path) const
+{
+  json files = json::array();
+  for (const auto & uri : uris()) {
+    const FileIndex & f = files_.at(uri);
+    json symbols = json::array();
+    for (const auto & s : f.symbols) {
+      symbols.push_back(json::array({s.name, static_cast<int>(s.kind), range_to_json(s.range)}));
+    }
+    json refs = json::array();
+    for (const auto & r : f.references) {
+      refs.push_back(json::array({r.name, static_cast<int>(r.kind), range_to_json(r.range)}));
+    }
+    files.push_back(json{
+      {"uri", f.uri},
+      {"mtime", f.mtime},
+      {"size", f.size},
+      {"imports", f.imports},
+      {"symbols", std::move(symbols)},
+      {"references", std::move(refs)},
+    });
+  }
+
+  const json doc{{"format", k_index_format}, {"files", std::move(files)}};
+  const auto result = OutputWriter::write_if_changed(OutputFile{path, doc.dump()});
+  return result.status != WriteStatus::Failed;
+}
+
+bool SymbolIndex::load(const std::filesystem::path & path)
+{
+  files_.clear();
+  referencing_files_.clear();
+
+  std::ifstream in(path, std::ios::binary);
+  if (!in.is_open()) {
+    return false;
+  }
+  const std::string text{std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+
+  const json doc = json::parse(text, nullptr, /*allow_exceptions=*/false);
+  if (!doc.is_object() || doc.value("format", 0) != k_index_format) {
+    return false;
+  }
+
+  try {
+    for (const auto & jf : doc.at("files")) {
+      FileIndex f;
+      f.uri = jf.at("uri").get<std::string>();
+      f.mtime = jf.at("mtime").get<int64_t>();
+      f.size = jf.at("size").get<uint64_t>();
+      f.imports = jf.at("imports").get<std::vector<std::string>>();
+      for (const auto & js : jf.at("symbols")) {
+        f.symbols.push_back(IndexedSymbol{
+          js.at(0).get<std::string>(), static_cast<IndexSymbolKind>(js.at(1).get<int>()),
+          range_from_json(js.at(2))});
+      }
+      for (const auto & jr : jf.at("references")) {
+        f.references.push_back(IndexedReference{
+          jr.at(0).get<std::string>(), static_cast<IndexRefKind>(jr.at(1).get<int>()),
+          range_from_json(jr.at(2))});
+      }
+      update(std::move(f));
+    }
+  } catch (const json::exception &) {
+    files_.clear();
+    referencing_files_.clear();
+    return false;
+  }
+  return true;
+}
+
+}  // namespace bt_dsl::lsp
@@ -0,0 +1,76 @@
+#include "bt_dsl/lsp/text_edit.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace bt_dsl::lsp
+{
+
+std::vector<uint32_t> build_line_offsets(std::string_view text)
+{
+  std::vector<uint32_t> offsets;
+  offsets.push_back(0);
+  for (size_t i = 0; i < text.size(); ++i) {
+    if (text[i] == '\n') {
+      offsets.push_back(static_cast<uint32_t>(i + 1));
+    }
+  }
+  return offsets;
+}
+
+uint32_t utf16_length(std::string_view text)
+{
+  uint32_t units = 0;
+  for (const char ch : text) {
+    const auto c = static_cast<unsigned char>(ch);
+    if ((c & 0xC0U) == 0x80U) {
+      continue;  // continuation byte
+    }
+    units += (c >= 0xF0U) ? 2U : 1U;  // 4-byte sequences need a surrogate pair
+  }
+  return units;
+}
+
+ByteRange apply_text_edit(
+  std::string & text, std::vector<uint32_t> & line_offsets, ByteRange range,
+  std::string_view replacement)
+{
+  const auto size = static_cast<uint32_t>(text.size());
+  const uint32_t start = std::min(range.startByte, size);
+  const uint32_t end = std::clamp(range.endByte, start, size);
+  const auto inserted = static_cast<uint32_t>(replacement.size());
+
+  text.replace(start, end - start, replacement);
+
+  if (line_offsets.empty()) {
+    line_offsets.push_back(0);
+  }
+
+  // Lines starting inside (start, end] began after a removed newline.
+  const auto first = std::upper_bound(line_offsets.begin(), line_offsets.end(), start);
+  const auto last = std::upper_bound(first, line_offsets.end(), end);
+
+  std::vector<uint32_t> added;
+  for (uint32_t i = 0; i < inserted; ++i) {
+    if (replacement[i] == '\n') {
+      added.push_back(start + i + 1);
+    }
+  }
+
+  // Shift the tail first; unsigned wrap-around gives the right result for
+  // shrinking edits because every shifted offset is >= end.
+  const uint32_t delta = inserted - (end - start);
+  for (auto it = last; it != line_offsets.end(); ++it) {
+    *it += delta;
+  }
+
+  const auto pos = line_offsets.erase(first, last);
+  line_offsets.insert(pos, added.begin(), added.end());
+
+  return ByteRange{start, start + inserted};
+}
+
+}  // namespace bt_dsl::lsp
@@ -1,9 +1,9 @@
 #include <algorithm>
 #include <cctype>
+#include <cstddef>
 #include <cstdint>
 #include <filesystem>
 #include <functional>
-#include <limits>
 #include <memory>
 #include <nlohmann/json.hpp>
 #include <optional>
@@ -17,14 +17,18 @@
 #include "bt_dsl/ast/ast.hpp"
 #include "bt_dsl/ast/ast_enums.hpp"
 #include "bt_dsl/basic/casting.hpp"
+#include "bt_dsl/lsp/ast_index.hpp"
 #include "bt_dsl/lsp/completion_context.hpp"
+#include "bt_dsl/lsp/import_uri.hpp"
 #include "bt_dsl/lsp/lsp.hpp"
+#include "bt_dsl/lsp/semantic_tokens.hpp"
 #include "bt_dsl/sema/analysis/init_checker.hpp"
 #include "bt_dsl/sema/analysis/null_checker.hpp"
 #include "bt_dsl/sema/analysis/tree_recursion_checker.hpp"
 #include "bt_dsl/sema/resolution/module_graph.hpp"
 #include "bt_dsl/sema/resolution/name_resolver.hpp"
 #include "bt_dsl/sema/resolution/symbol_table_builder.hpp"
+#include "bt_dsl/sema/resolution/tree_call_graph.hpp"
 #include "bt_dsl/sema/types/type_checker.hpp"
 #include "bt_dsl/sema/types/type_utils.hpp"
 #include "bt_dsl/syntax/frontend.hpp"
@@ -63,12 +67,6 @@ struct WordRange
   uint32_t endByte = 0;
 };
 
-struct ByteRange
-{
-  uint32_t startByte = 0;
-  uint32_t endByte = 0;
-};
-
 WordRange word_range_at(std::string_view text, uint32_t byte_offset)
 {
   WordRange r;
@@ -151,6 +149,11 @@ json byte_range_to_json(const ByteRange & r)
   return json{{"startByte", r.startByte}, {"endByte", r.endByte}};
 }
 
+ByteRange to_byte_range(bt_dsl::SourceRange r)
+{
+  return ByteRange{r.get_begin().get_offset(), r.get_end().get_offset()};
+}
+
 bt_dsl::SourceRange narrow_to_identifier(
   std::string_view text, bt_dsl::SourceRange decl_range, std::string_view ident)
 {
@@ -183,11 +186,6 @@ bool starts_with(std::string_view s, std::string_view prefix)
   return s.size() >= prefix.size() && s.substr(0, prefix.size()) == prefix;
 }
 
-bool is_relative_import_spec(std::string_view spec)
-{
-  return starts_with(spec, "./") || starts_with(spec, "../");
-}
-
 bool has_required_extension(std::string_view spec)
 {
   const size_t last_slash = spec.find_last_of('/');
@@ -200,86 +198,6 @@ bool has_required_extension(std::string_view spec)
   return true;
 }
 
-std::string package_import_uri(std::string_view spec)
-{
-  std::string out = "bt-dsl-pkg://";
-  out.append(spec.data(), spec.size());
-  return out;
-}
-
-std::string remove_dot_segments(std::string_view path)
-{
-  std::vector<std::string_view> segs;
-  segs.reserve(32);
-
-  size_t i = 0;
-  while (i <= path.size()) {
-    const size_t j = path.find('/', i);
-    const size_t end = (j == std::string_view::npos) ? path.size() : j;
-    const std::string_view seg = path.substr(i, end - i);
-
-    if (seg == "..") {
-      if (!segs.empty()) {
-        segs.pop_back();
-      }
-    } else if (!seg.empty() && seg != ".") {
-      segs.push_back(seg);
-    }
-
-    if (j == std::string_view::npos) {
-      break;
-    }
-    i = j + 1;
-  }
-
-  std::string out;
-  if (starts_with(path, "/")) {
-    out.push_back('/');
-  }
-  for (size_t k = 0; k < segs.size(); ++k) {
-    if (k > 0) {
-      out.push_back('/');
-    }
-    out.append(segs[k].data(), segs[k].size());
-  }
-  return out;
-}
-
-std::optional<std::string> resolve_relative_import_uri(
-  std::string_view from_uri, std::string_view spec)
-{
-  if (!is_relative_import_spec(spec)) {
-    return std::nullopt;
-  }
-
-  constexpr std::string_view file_prefix = "file://";
-  if (!starts_with(from_uri, file_prefix)) {
-    return std::nullopt;
-  }
-
-  const size_t last_slash = from_uri.find_last_of('/');
-  if (last_slash == std::string_view::npos || last_slash + 1 <= file_prefix.size()) {
-    return std::nullopt;
-  }
-
-  const std::string_view dir_uri = from_uri.substr(0, last_slash + 1);
-  std::string combined = std::string(dir_uri);
-  combined += std::string(spec);
-
-  const std::string_view combined_sv = combined;
-  const std::string_view path_part = combined_sv.substr(file_prefix.size());
-  if (path_part.empty() || path_part[0] != '/') {
-    return std::nullopt;
-  }
-
-  const std::string normalized_path = remove_dot_segments(path_part);
-  std::string out;
-  out.reserve(file_prefix.size() + normalized_path.size());
-  out.append(file_prefix.data(), file_prefix.size());
-  out += normalized_path;
-  return out;
-}
-
 std::optional<fs::path> file_uri_to_path(std::string_view uri)
 {
   if (!starts_with(uri, "file://")) {
@@ -359,6 +277,31 @@ std::string type_to_string(const bt_dsl::Type * t)
   return "?";
 }
 
+// Type memoized in `types` for the declaration of a value symbol (nullptr if none).
+const bt_dsl::Type * declared_symbol_type(
+  const bt_dsl::Symbol * sym, const bt_dsl::TypeContext & types)
+{
+  if (sym == nullptr || sym->astNode == nullptr) {
+    return nullptr;
+  }
+
+  const bt_dsl::TypeNode * type = nullptr;
+  if (const auto * p = bt_dsl::dyn_cast<bt_dsl::ParamDecl>(sym->astNode)) {
+    type = p->type;
+  } else if (const auto * v = bt_dsl::dyn_cast<bt_dsl::GlobalVarDecl>(sym->astNode)) {
+    type = v->type;
+  } else if (const auto * b = bt_dsl::dyn_cast<bt_dsl::BlackboardDeclStmt>(sym->astNode)) {
+    type = b->type;
+  } else if (const auto * gc = bt_dsl::dyn_cast<bt_dsl::GlobalConstDecl>(sym->astNode)) {
+    type = gc->type;
+  } else if (const auto * c = bt_dsl::dyn_cast<bt_dsl::ConstDeclStmt>(sym->astNode)) {
+    type = c->type;
+  }
+
+  const bt_dsl::Type * resolved = bt_dsl::get_resolved_type(type, types);
+  return (resolved != nullptr && !resolved->is_error()) ? resolved : nullptr;
+}
+
 std::string severity_to_string(bt_dsl::Severity s)
 {
   switch (s) {
@@ -374,230 +317,47 @@ std::string severity_to_string(bt_dsl::Severity s)
   return "Error";
 }
 
-// -----------------------------
-// AST hit testing (minimal subset)
-// -----------------------------
-
-struct AstHit
-{
-  bt_dsl::TreeDecl * tree = nullptr;
-  bt_dsl::NodeStmt * node_stmt = nullptr;
-  bt_dsl::InlineBlackboardDecl * inline_decl = nullptr;
-  bt_dsl::VarRefExpr * var_ref = nullptr;
-};
-
-bt_dsl::TreeDecl * find_tree_at(bt_dsl::Program & p, uint32_t off)
-{
-  bt_dsl::TreeDecl * best = nullptr;
-  uint32_t best_len = std::numeric_limits<uint32_t>::max();
-
-  for (auto * t : p.trees()) {
-    if (t == nullptr) continue;
-    if (!contains_byte(t->get_range(), off)) {
-      continue;
-    }
-
-    const auto s = t->get_range().get_begin().get_offset();
-    const auto e = t->get_range().get_end().get_offset();
-    const uint32_t len = (e > s) ? (e - s) : 0;
-
-    if (best == nullptr || len < best_len) {
-      best = t;
-      best_len = len;
-    }
-  }
-
-  return best;
-}
-
-void consider_best_varref(bt_dsl::VarRefExpr * vr, uint32_t off, AstHit & hit)
-{
-  if (vr == nullptr) return;
-  if (!contains_byte(vr->get_range(), off)) return;
-
-  const auto s = vr->get_range().get_begin().get_offset();
-  const auto e = vr->get_range().get_end().get_offset();
-  const uint32_t new_len = (e > s) ? (e - s) : 0;
-
-  if (hit.var_ref == nullptr) {
-    hit.var_ref = vr;
-    return;
-  }
-
-  const auto cs = hit.var_ref->get_range().get_begin().get_offset();
-  const auto ce = hit.var_ref->get_range().get_end().get_offset();
-  const uint32_t cur_len = (ce > cs) ? (ce - cs) : 0;
-  if (new_len < cur_len) {
-    hit.var_ref = vr;
-  }
-}
-
-void consider_best_inline_decl(bt_dsl::InlineBlackboardDecl * d, uint32_t off, AstHit & hit)
-{
-  if (d == nullptr) return;
-  if (!contains_byte(d->get_range(), off)) return;
-
-  const auto s = d->get_range().get_begin().get_offset();
-  const auto e = d->get_range().get_end().get_offset();
-  const uint32_t new_len = (e > s) ? (e - s) : 0;
-
-  if (hit.inline_decl == nullptr) {
-    hit.inline_decl = d;
-    return;
-  }
-
-  const auto cs = hit.inline_decl->get_range().get_begin().get_offset();
-  const auto ce = hit.inline_decl->get_range().get_end().get_offset();
-  const uint32_t cur_len = (ce > cs) ? (ce - cs) : 0;
-  if (new_len < cur_len) {
-    hit.inline_decl = d;
-  }
-}
-
-void consider_best_node_stmt(bt_dsl::NodeStmt * n, uint32_t off, AstHit & hit)
+std::string_view to_string(CompletionItemKind k)
 {
-  if (n == nullptr) return;
-  if (!contains_byte(n->get_range(), off)) return;
-
-  const auto s = n->get_range().get_begin().get_offset();
-  const auto e = n->get_range().get_end().get_offset();
-  const uint32_t new_len = (e > s) ? (e - s) : 0;
-
-  if (hit.node_stmt == nullptr) {
-    hit.node_stmt = n;
-    return;
-  }
-
-  const auto cs = hit.node_stmt->get_range().get_begin().get_offset();
-  const auto ce = hit.node_stmt->get_range().get_end().get_offset();
-  const uint32_t cur_len = (ce > cs) ? (ce - cs) : 0;
-  if (new_len < cur_len) {
-    hit.node_stmt = n;
-  }
-}
-
-void visit_expr_for_hit(bt_dsl::Expr * e, uint32_t off, AstHit & hit);
-void visit_stmt_for_hit(bt_dsl::Stmt * s, uint32_t off, AstHit & hit);
-
-void visit_expr_for_hit(bt_dsl::Expr * e, uint32_t off, AstHit & hit)
-{
-  if (e == nullptr) return;
-  if (!contains_byte(e->get_range(), off)) return;
-
-  if (auto * vr = bt_dsl::dyn_cast<bt_dsl::VarRefExpr>(e)) {
-    consider_best_varref(vr, off, hit);
-    return;
-  }
-
-  if (auto * b = bt_dsl::dyn_cast<bt_dsl::BinaryExpr>(e)) {
-    visit_expr_for_hit(b->lhs, off, hit);
-    visit_expr_for_hit(b->rhs, off, hit);
-    return;
-  }
-
-  if (auto * u = bt_dsl::dyn_cast<bt_dsl::UnaryExpr>(e)) {
-    visit_expr_for_hit(u->operand, off, hit);
-    return;
-  }
-
-  if (auto * c = bt_dsl::dyn_cast<bt_dsl::CastExpr>(e)) {
-    visit_expr_for_hit(c->expr, off, hit);
-    return;
-  }
-
-  if (auto * idx = bt_dsl::dyn_cast<bt_dsl::IndexExpr>(e)) {
-    visit_expr_for_hit(idx->base, off, hit);
-    visit_expr_for_hit(idx->index, off, hit);
-    return;
-  }
-
-  if (auto * arr = bt_dsl::dyn_cast<bt_dsl::ArrayLiteralExpr>(e)) {
-    for (auto * el : arr->elements) {
-      visit_expr_for_hit(el, off, hit);
-    }
-    return;
-  }
-
-  if (auto * rep = bt_dsl::dyn_cast<bt_dsl::ArrayRepeatExpr>(e)) {
-    visit_expr_for_hit(rep->value, off, hit);
-    visit_expr_for_hit(rep->count, off, hit);
-    return;
-  }
-
-  if (auto * vm = bt_dsl::dyn_cast<bt_dsl::VecMacroExpr>(e)) {
-    // VecMacroExpr wraps either an ArrayLiteralExpr or ArrayRepeatExpr.
-    visit_expr_for_hit(vm->inner, off, hit);
-    return;
-  }
+  switch (k) {
+    case CompletionItemKind::Keyword:
+      return "Keyword";
+    case CompletionItemKind::Variable:
+      return "Variable";
+    case CompletionItemKind::Port:
+      return "Port";
+    case CompletionItemKind::Node:
+      return "Node";
+  }
+  return "Keyword";
 }
 
-void visit_stmt_for_hit(bt_dsl::Stmt * s, uint32_t off, AstHit & hit)
+std::string_view to_string(DocumentSymbolKind k)
 {
-  if (s == nullptr) return;
-  if (!contains_byte(s->get_range(), off)) return;
-
-  if (auto * ns = bt_dsl::dyn_cast<bt_dsl::NodeStmt>(s)) {
-    consider_best_node_stmt(ns, off, hit);
-    for (auto * pc : ns->preconditions) {
-      if (pc && contains_byte(pc->get_range(), off)) {
-        visit_expr_for_hit(pc->condition, off, hit);
-      }
-    }
-    for (auto * arg : ns->args) {
-      if (arg == nullptr) continue;
-      if (!contains_byte(arg->get_range(), off)) continue;
-      if (arg->inlineDecl) {
-        consider_best_inline_decl(arg->inlineDecl, off, hit);
-      }
-      if (arg->valueExpr) {
-        visit_expr_for_hit(arg->valueExpr, off, hit);
-      }
-    }
-    for (auto * child : ns->children) {
-      visit_stmt_for_hit(child, off, hit);
-    }
-    return;
-  }
-
-  if (auto * as = bt_dsl::dyn_cast<bt_dsl::AssignmentStmt>(s)) {
-    for (auto * pc : as->preconditions) {
-      if (pc && contains_byte(pc->get_range(), off)) {
-        visit_expr_for_hit(pc->condition, off, hit);
-      }
-    }
-    for (auto * idx : as->indices) {
-      visit_expr_for_hit(idx, off, hit);
-    }
-    visit_expr_for_hit(as->value, off, hit);
-    return;
-  }
-
-  if (auto * vd = bt_dsl::dyn_cast<bt_dsl::BlackboardDeclStmt>(s)) {
-    if (vd->initialValue) {
-      visit_expr_for_hit(vd->initialValue, off, hit);
-    }
-    return;
-  }
-
-  if (auto * cd = bt_dsl::dyn_cast<bt_dsl::ConstDeclStmt>(s)) {
-    visit_expr_for_hit(cd->value, off, hit);
-    return;
-  }
+  switch (k) {
+    case DocumentSymbolKind::Declare:
+      return "Declare";
+    case DocumentSymbolKind::GlobalVar:
+      return "GlobalVar";
+    case DocumentSymbolKind::GlobalConst:
+      return "GlobalConst";
+    case DocumentSymbolKind::Tree:
+      return "Tree";
+  }
+  return "Declare";
 }
 
-AstHit find_ast_hit(bt_dsl::Program & p, uint32_t off)
+std::string_view to_string(HighlightKind k)
 {
-  AstHit hit;
-  hit.tree = find_tree_at(p, off);
-  if (hit.tree == nullptr) {
-    return hit;
-  }
-
-  for (auto * stmt : hit.tree->body) {
-    visit_stmt_for_hit(stmt, off, hit);
-  }
-
-  return hit;
+  switch (k) {
+    case HighlightKind::Text:
+      return "Text";
+    case HighlightKind::Read:
+      return "Read";
+    case HighlightKind::Write:
+      return "Write";
+  }
+  return "Text";
 }
 
 // -----------------------------
@@ -639,28 +399,28 @@ std::optional<ExternNodeCategory> extern_category_from_decl(const bt_dsl::AstNod
   return std::nullopt;
 }
 
-std::string token_type_for_node_category(std::optional<ExternNodeCategory> c, bool is_tree)
+SemanticTokenType token_type_for_node_category(std::optional<ExternNodeCategory> c, bool is_tree)
 {
   if (is_tree) {
-    return "class";
+    return SemanticTokenType::Class;
   }
   if (!c) {
-    return "function";
+    return SemanticTokenType::Function;
   }
 
   switch (*c) {
     case ExternNodeCategory::Control:
-      return "keyword";
+      return SemanticTokenType::Keyword;
     case ExternNodeCategory::Subtree:
-      return "class";
+      return SemanticTokenType::Class;
     case ExternNodeCategory::Decorator:
-      return "decorator";
+      return SemanticTokenType::Decorator;
     case ExternNodeCategory::Action:
     case ExternNodeCategory::Condition:
-      return "function";
+      return SemanticTokenType::Function;
   }
 
-  return "function";
+  return SemanticTokenType::Function;
 }
 
 }  // namespace
@@ -678,19 +438,66 @@ struct Workspace::Impl
 
     bt_dsl::ModuleInfo module{};
 
+    // Token stream of the last parse, for completion context.
+    CompletionContextIndex completion_context;
+    // Position index of the analyzed AST; built on first use.
+    std::unique_ptr<AstIndex> ast_index;
+
     std::unique_ptr<bt_dsl::TypeContext> type_ctx;
 
+    // Content version, bumped (workspace-wide counter) on every text change.
+    uint64_t version = 0;
+
+    // Open in the host; never evicted.
+    bool pinned = false;
+    // `use_clock` at the last query that parsed or used the parse.
+    uint64_t last_used = 0;
+
     bool indexed = false;
     bool analyzed = false;
-    uint64_t analyzed_import_hash = 0;
+    // Imports (URI, content version) the current analysis was made against.
+    std::vector<std::pair<std::string, uint64_t>> analyzed_deps;
+
+    // Text changed by apply_edit() since the last parse (current coordinates).
+    std::optional<ByteRange> edited;
 
     bt_dsl::DiagnosticBag sema_diags;
+
+    // Last encoded semantic tokens. `fresh` is cleared with the analysis; the
+    // data itself is kept as the base of the next delta.
+    struct SemanticTokensCache
+    {
+      bool fresh = false;
+      PositionEncoding encoding = PositionEncoding::Utf16;
+      std::vector<SemanticToken> tokens;  // Sorted, for range requests
+      std::string result_id;
+      std::vector<uint32_t> data;
+      std::string previous_result_id;
+      std::vector<uint32_t> previous_data;
+    } semantic;
   };
 
   bt_dsl::SourceRegistry sources;
 
   std::unordered_map<std::string, Document> docs;
 
+  uint64_t last_version = 0;
+  uint64_t last_semantic_result = 0;
+
+  // Bytes of parse/analysis state to keep; 0 for no limit.
+  size_t memory_budget = 0;
+  uint64_t use_clock = 0;
+  uint64_t evictions = 0;
+
+  // Reverse import graph: URI -> documents whose last analysis imported it
+  // (whether or not it was loaded at the time).
+  std::unordered_map<std::string, std::unordered_set<std::string>> importers;
+
+  // Tree call graph of the analyzed documents, kept across edits: analysis
+  // re-registers one document and recomputes the components it can reach.
+  // A document leaves it when invalidated, with everything importing it.
+  bt_dsl::TreeCallGraph calls;
+
   Document * get_doc(std::string_view uri)
   {
     auto it = docs.find(std::string(uri));
@@ -709,21 +516,276 @@ struct Workspace::Impl
     return &it->second;
   }
 
+  /// Drop everything derived from the text.
+  void invalidate(Document & d)
+  {
+    calls.remove_module(d.module.file_id);
+    d.module = bt_dsl::ModuleInfo{};
+    d.type_ctx = std::make_unique<bt_dsl::TypeContext>();
+    d.indexed = false;
+    d.analyzed = false;
+    d.sema_diags = bt_dsl::DiagnosticBag{};
+    d.ast_index.reset();
+    d.semantic.fresh = false;
+  }
+
+  /// Drop the analysis of `d` and of everything that imports it.
+  void reparse_with_dependents(Document & d)
+  {
+    invalidate(d);
+    for (const auto & dep : dependents_of(d.uri)) {
+      // Resolved AST pointers may point into the old import, and the
+      // resolver does not clear them; start over from a fresh parse.
+      if (auto * dd = get_doc(dep)) {
+        invalidate(*dd);
+      }
+    }
+  }
+
+  /// Record a new text for `d`.
+  void text_changed(Document & d)
+  {
+    d.version = ++last_version;
+    reparse_with_dependents(d);
+  }
+
+  /// Documents that import `uri`, directly or transitively, as of their last
+  /// analysis.
+  [[nodiscard]] std::vector<std::string> dependents_of(const std::string & uri) const
+  {
+    std::vector<std::string> out;
+    std::unordered_set<std::string> seen{uri};
+    std::vector<std::string> stack{uri};
+    while (!stack.empty()) {
+      const std::string cur = std::move(stack.back());
+      stack.pop_back();
+      auto it = importers.find(cur);
+      if (it == importers.end()) {
+        continue;
+      }
+      for (const auto & importer : it->second) {
+        if (seen.insert(importer).second) {
+          out.push_back(importer);
+          stack.push_back(importer);
+        }
+      }
+    }
+    return out;
+  }
+
+  /// Replace the import edges of `d` in the reverse graph.
+  void set_analyzed_deps(Document & d, std::vector<std::pair<std::string, uint64_t>> deps)
+  {
+    for (const auto & [dep, version] : d.analyzed_deps) {
+      auto it = importers.find(dep);
+      if (it != importers.end()) {
+        it->second.erase(d.uri);
+        if (it->second.empty()) {
+          importers.erase(it);
+        }
+      }
+    }
+    d.analyzed_deps = std::move(deps);
+    for (const auto & [dep, version] : d.analyzed_deps) {
+      importers[dep].insert(d.uri);
+    }
+  }
+
+  [[nodiscard]] bool deps_current(
+    const Document & d, const std::vector<std::string> & imported_uris) const
+  {
+    if (d.analyzed_deps.size() != imported_uris.size()) {
+      return false;
+    }
+    for (size_t i = 0; i < imported_uris.size(); ++i) {
+      const auto * imp = get_doc(imported_uris[i]);
+      const uint64_t version = imp != nullptr ? imp->version : 0;
+      if (d.analyzed_deps[i].first != imported_uris[i] || d.analyzed_deps[i].second != version) {
+        return false;
+      }
+    }
+    return true;
+  }
+
   void ensure_parsed(Document & d)
   {
+    d.last_used = ++use_clock;
     if (d.module.program != nullptr && d.module.ast) {
       return;
     }
 
-    // Re-parse into a fresh AST context.
-    d.module.ast = std::make_unique<bt_dsl::AstContext>();
+    // Re-parse into a fresh AST context. Most documents are small, so start
+    // the arena near the text's size rather than at the 64KB default; it grows
+    // geometrically from there.
+    constexpr size_t k_min_ast_buffer = size_t{4} * size_t{1024};
+    const size_t ast_buffer = std::clamp(
+      d.text.size() * 2, k_min_ast_buffer, bt_dsl::AstContext::k_default_buffer_size);
+    d.module.ast = std::make_unique<bt_dsl::AstContext>(ast_buffer);
     d.module.parse_diags = bt_dsl::DiagnosticBag{};
 
     const fs::path path = file_uri_to_path(d.uri).value_or(fs::path{d.uri});
-    const bt_dsl::ParseOutput out =
+    bt_dsl::ParseOutput out =
       bt_dsl::parse_source(sources, path, d.text, *d.module.ast, d.module.parse_diags);
     d.module.file_id = out.file_id;
     d.module.program = out.program;
+    d.completion_context = CompletionContextIndex(std::move(out.tokens), d.text.size());
+    d.edited.reset();
+  }
+
+  /// Line start offsets of `d`, which must be parsed (kept by the source registry).
+  const std::vector<uint32_t> & line_offsets(const Document & d) const
+  {
+    return sources.get_file(d.module.file_id)->line_offsets();
+  }
+
+  /// Position index of `d`, which must be analyzed.
+  const AstIndex & ensure_ast_index(Document & d)
+  {
+    if (!d.ast_index) {
+      d.ast_index = std::make_unique<AstIndex>(*d.module.program);
+    }
+    return *d.ast_index;
+  }
+
+  // ---------------------------------------------------------------------------
+  // Memory budget
+  // ---------------------------------------------------------------------------
+
+  struct StateBytes
+  {
+    size_t arena = 0;  // Exact
+    size_t other = 0;  // Estimated
+
+    [[nodiscard]] size_t total() const { return arena + other; }
+  };
+
+  /// Memory held by the parse and analysis state of `d` (not its text).
+  [[nodiscard]] StateBytes state_bytes(const Document & d) const
+  {
+    StateBytes b;
+    if (d.module.ast) {
+      b.arena += d.module.ast->bytes_reserved();
+    }
+    if (d.type_ctx) {
+      b.arena += d.type_ctx->bytes_reserved();
+    }
+    if (const auto * file = sources.get_file(d.module.file_id)) {
+      b.other += file->size() + file->line_count() * sizeof(uint32_t);
+    }
+    b.other += d.completion_context.memory_bytes();
+    if (d.ast_index) {
+      b.other += d.ast_index->memory_bytes();
+    }
+    const auto & sem = d.semantic;
+    b.other += sem.tokens.capacity() * sizeof(SemanticToken) +
+               (sem.data.capacity() + sem.previous_data.capacity()) * sizeof(uint32_t);
+    return b;
+  }
+
+  /// Drop all state derived from the text of `d`; the next query re-parses.
+  void release(Document & d)
+  {
+    const bt_dsl::FileId file_id = d.module.file_id;
+    invalidate(d);
+    d.type_ctx.reset();
+    d.completion_context = CompletionContextIndex{};
+    d.semantic = Document::SemanticTokensCache{};
+    // The AST was the last user of the registry's copy of the text.
+    sources.update_content(file_id, {});
+    ++evictions;
+  }
+
+  /**
+   * Release `d` and every analyzed document that imports it, as their
+   * resolved pointers point into it.
+   *
+   * @return The bytes freed
+   */
+  size_t evict(Document & d)
+  {
+    size_t freed = state_bytes(d).total();
+    release(d);
+    for (const auto & dep : dependents_of(d.uri)) {
+      auto * dd = get_doc(dep);
+      if (dd != nullptr && dd->analyzed) {
+        freed += state_bytes(*dd).total();
+        release(*dd);
+      }
+    }
+    return freed;
+  }
+
+  /// Evict least recently used documents until the budget is met. Pinned
+  /// documents and the imports of analyzed pinned documents stay.
+  void enforce_memory_budget()
+  {
+    if (memory_budget == 0) {
+      return;
+    }
+
+    size_t total = 0;
+    std::vector<Document *> candidates;
+    for (auto & [uri, d] : docs) {
+      const size_t bytes = state_bytes(d).total();
+      total += bytes;
+      if (!d.pinned && bytes > 0) {
+        candidates.push_back(&d);
+      }
+    }
+    if (total <= memory_budget) {
+      return;
+    }
+
+    std::sort(candidates.begin(), candidates.end(), [](const Document * a, const Document * b) {
+      return a->last_used < b->last_used;
+    });
+    for (auto * d : candidates) {
+      if (total <= memory_budget) {
+        break;
+      }
+      // Skip documents already released along with one of their imports.
+      if (state_bytes(*d).total() == 0 || imported_by_pinned(*d)) {
+        continue;
+      }
+      total -= std::min(total, evict(*d));
+    }
+  }
+
+  [[nodiscard]] bool imported_by_pinned(const Document & d) const
+  {
+    for (const auto & dep : dependents_of(d.uri)) {
+      const auto * dd = get_doc(dep);
+      if (dd != nullptr && dd->pinned && dd->analyzed) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  [[nodiscard]] MemoryUsage memory_usage() const
+  {
+    MemoryUsage out;
+    out.budget_bytes = memory_budget;
+    out.evictions = evictions;
+    out.documents.reserve(docs.size());
+    for (const auto & [uri, d] : docs) {
+      const StateBytes b = state_bytes(d);
+      DocumentMemoryUsage du;
+      du.uri = uri;
+      du.pinned = d.pinned;
+      du.analyzed = d.analyzed;
+      du.text_bytes = d.text.capacity();
+      du.arena_bytes = b.arena;
+      du.other_bytes = b.other;
+      out.text_bytes += du.text_bytes;
+      out.arena_bytes += du.arena_bytes;
+      out.other_bytes += du.other_bytes;
+      out.documents.push_back(std::move(du));
+    }
+    std::sort(
+      out.documents.begin(), out.documents.end(),
+      [](const DocumentMemoryUsage & a, const DocumentMemoryUsage & b) { return a.uri < b.uri; });
+    return out;
   }
 
   void ensure_indexed(Document & d)
@@ -775,21 +837,6 @@ struct Workspace::Impl
     d.indexed = true;
   }
 
-  static uint64_t hash_imports(const std::vector<std::string> & imported_uris)
-  {
-    uint64_t h = 1469598103934665603ULL;
-    for (const auto & s : imported_uris) {
-      for (const char ch : s) {
-        const auto c = static_cast<unsigned char>(ch);
-        h ^= static_cast<uint64_t>(c);
-        h *= 1099511628211ULL;
-      }
-      h ^= 0xFF;
-      h *= 1099511628211ULL;
-    }
-    return h;
-  }
-
   void ensure_analyzed(Document & d, const std::vector<std::string> & imported_uris)
   {
     ensure_indexed(d);
@@ -798,17 +845,25 @@ struct Workspace::Impl
       d.type_ctx = std::make_unique<bt_dsl::TypeContext>();
     }
 
-    const uint64_t h = hash_imports(imported_uris);
-    if (d.analyzed && d.analyzed_import_hash == h) {
-      return;
+    if (d.analyzed) {
+      if (deps_current(d, imported_uris)) {
+        return;
+      }
+      // Analyzed against other imports (the host changed the list); the
+      // resolver does not clear stale results, so re-parse first.
+      reparse_with_dependents(d);
+      ensure_indexed(d);
     }
 
     // Ensure imported modules are indexed.
     std::vector<bt_dsl::ModuleInfo *> imports;
     imports.reserve(imported_uris.size());
+    std::vector<std::pair<std::string, uint64_t>> deps;
+    deps.reserve(imported_uris.size());
 
     for (const auto & u : imported_uris) {
       auto * imp = get_doc(u);
+      deps.emplace_back(u, imp != nullptr ? imp->version : 0);
       if (imp == nullptr) {
         continue;
       }
@@ -832,12 +887,21 @@ struct Workspace::Impl
     bt_dsl::NullChecker null_checker(d.module.values, d.module.nodes, &diags);
     (void)null_checker.check(*d.module.program);
 
-    bt_dsl::TreeRecursionChecker recursion_checker(&diags);
-    (void)recursion_checker.check(*d.module.program);
+    // Cycles may run through other analyzed documents; keep the back-edges
+    // (call sites) that lie in this one.
+    (void)calls.update_module(d.module.file_id, *d.module.program);
+    (void)calls.recompute();
+    bt_dsl::DiagnosticBag recursion;
+    (void)bt_dsl::TreeRecursionChecker(&recursion).check(calls);
+    for (const auto & diag : recursion) {
+      if (diag.primary_range().file_id() == d.module.file_id) {
+        diags.add(diag);
+      }
+    }
 
     d.sema_diags = std::move(diags);
     d.analyzed = true;
-    d.analyzed_import_hash = h;
+    set_analyzed_deps(d, std::move(deps));
   }
 
   std::vector<std::string> direct_import_uris(Document & d, std::string_view stdlib_uri)
@@ -885,11 +949,10 @@ struct Workspace::Impl
     return out;
   }
 
-  json diagnostics_json_impl(std::string_view uri, const std::vector<std::string> & imported_uris)
+  std::vector<DiagnosticItem> diagnostics_impl(
+    std::string_view uri, const std::vector<std::string> & imported_uris)
   {
-    json out;
-    out["uri"] = std::string(uri);
-    out["items"] = json::array();
+    std::vector<DiagnosticItem> out;
 
     auto * doc = get_doc(uri);
     if (doc == nullptr) {
@@ -906,13 +969,9 @@ struct Workspace::Impl
         const std::string_view spec = imp->path;
 
         auto push_item = [&](std::string msg) {
-          json item;
-          item["source"] = "import";
-          item["message"] = std::move(msg);
-          item["severity"] = "Error";
-          const auto fr = sources.get_full_range(imp->get_range());
-          item["range"] = range_to_json(fr);
-          out["items"].push_back(std::move(item));
+          out.push_back(DiagnosticItem{
+            DiagnosticSource::Import, bt_dsl::Severity::Error, std::move(msg), {},
+            to_byte_range(imp->get_range())});
         };
 
         if (starts_with(spec, "/")) {
@@ -976,16 +1035,9 @@ struct Workspace::Impl
 
     // Parse/build diagnostics
     for (const auto & d0 : doc->module.parse_diags.all()) {
-      json item;
-      item["source"] = "parser";
-      item["message"] = d0.message;
-      item["severity"] = severity_to_string(d0.severity);
-      if (!d0.code.empty()) {
-        item["code"] = d0.code;
-      }
-      const auto fr = sources.get_full_range(d0.primary_range());
-      item["range"] = range_to_json(fr);
-      out["items"].push_back(std::move(item));
+      out.push_back(DiagnosticItem{
+        DiagnosticSource::Parser, d0.severity, d0.message.str(), d0.code,
+        to_byte_range(d0.primary_range())});
     }
 
     const bool has_parse_error = std::any_of(
@@ -995,52 +1047,31 @@ struct Workspace::Impl
     if (!has_parse_error) {
       ensure_analyzed(*doc, imported_uris);
       for (const auto & d0 : doc->sema_diags.all()) {
-        json item;
-        item["source"] = "analyzer";
-        item["message"] = d0.message;
-        item["severity"] = severity_to_string(d0.severity);
-        if (!d0.code.empty()) {
-          item["code"] = d0.code;
-        }
-        const auto fr = sources.get_full_range(d0.primary_range());
-        item["range"] = range_to_json(fr);
-        out["items"].push_back(std::move(item));
+        out.push_back(DiagnosticItem{
+          DiagnosticSource::Analyzer, d0.severity, d0.message.str(), d0.code,
+          to_byte_range(d0.primary_range())});
       }
     }
 
     return out;
   }
 
-  json resolve_imports_json_impl(std::string_view uri, std::string_view stdlib_uri)
+  std::vector<std::string> resolve_imports_impl(std::string_view uri, std::string_view stdlib_uri)
   {
-    json out;
-    out["uri"] = std::string(uri);
-    out["stdlibUri"] = std::string(stdlib_uri);
-    out["uris"] = json::array();
-
     auto * doc = get_doc(uri);
     if (doc == nullptr) {
-      return out;
-    }
-
-    const auto uris = direct_import_uris(*doc, stdlib_uri);
-    for (const auto & u : uris) {
-      out["uris"].push_back(u);
+      return {};
     }
-
-    return out;
+    return direct_import_uris(*doc, stdlib_uri);
   }
 
-  json completion_json_impl(
+  CompletionList completion_impl(
     std::string_view uri, uint32_t byte_offset, const std::vector<std::string> & imported_uris,
     std::string_view trigger)
   {
     (void)trigger;
 
-    json out;
-    out["uri"] = std::string(uri);
-    out["isIncomplete"] = false;
-    out["items"] = json::array();
+    CompletionList out;
 
     auto * doc = get_doc(uri);
     if (doc == nullptr) {
@@ -1054,28 +1085,22 @@ struct Workspace::Impl
 
     const auto replace_range = completion_replace_range_at(doc->text, byte_offset);
 
-    const auto ctx_opt = classify_completion_context(doc->text, byte_offset);
+    const auto ctx_opt = doc->completion_context.classify(byte_offset);
     if (!ctx_opt) {
       return out;
     }
     const auto & ctx = *ctx_opt;
 
     auto push_item =
-      [&](std::string label, std::string kind, std::string detail, std::string insert) {
-        json item;
-        item["label"] = std::move(label);
-        item["kind"] = std::move(kind);
-        if (!detail.empty()) {
-          item["detail"] = std::move(detail);
-        }
-        item["insertText"] = std::move(insert);
-        item["replaceRange"] = byte_range_to_json(replace_range);
-        out["items"].push_back(std::move(item));
+      [&](std::string label, CompletionItemKind kind, std::string detail, std::string insert) {
+        out.items.push_back(CompletionItem{
+          std::move(label), kind, std::move(detail), std::move(insert), replace_range});
       };
 
     auto push_directions = [&]() {
       for (const auto & ddir : bt_dsl::syntax::k_port_directions) {
-        push_item(std::string(ddir), "Keyword", "direction", std::string(ddir) + " ");
+        push_item(
+          std::string(ddir), CompletionItemKind::Keyword, "direction", std::string(ddir) + " ");
       }
     };
 
@@ -1098,7 +1123,8 @@ struct Workspace::Impl
           if (sym.typeName) {
             detail = std::string(*sym.typeName);
           }
-          push_item(std::string(sym.name), "Variable", detail, std::string(sym.name));
+          push_item(
+            std::string(sym.name), CompletionItemKind::Variable, detail, std::string(sym.name));
         }
       }
     };
@@ -1175,7 +1201,7 @@ struct Workspace::Impl
         const std::string type = p.type.empty() ? "" : p.type;
         const std::string detail =
           (dir.empty() && type.empty()) ? "" : format_port(dir, p.name, type);
-        push_item(p.name, "Port", detail, insert);
+        push_item(p.name, CompletionItemKind::Port, detail, insert);
       }
     };
 
@@ -1185,14 +1211,15 @@ struct Workspace::Impl
 
     if (ctx.kind == CompletionContextKind::TopLevelKeywords) {
       for (const auto & kw : bt_dsl::syntax::k_top_level_keywords) {
-        push_item(std::string(kw), "Keyword", "keyword", std::string(kw) + " ");
+        push_item(std::string(kw), CompletionItemKind::Keyword, "keyword", std::string(kw) + " ");
       }
       return out;
     }
 
     if (ctx.kind == CompletionContextKind::PreconditionKind) {
       for (const auto & k : bt_dsl::syntax::k_precondition_kinds) {
-        push_item(std::string(k), "Keyword", "precondition", std::string(k) + "(");
+        push_item(
+          std::string(k), CompletionItemKind::Keyword, "precondition", std::string(k) + "(");
       }
       return out;
     }
@@ -1270,30 +1297,25 @@ struct Workspace::Impl
           detail = "subtree";
         }
       }
-      push_item(n, "Node", detail, n);
+      push_item(n, CompletionItemKind::Node, detail, n);
     }
 
     return out;
   }
 
-  json hover_json_impl(
+  std::optional<HoverInfo> hover_impl(
     std::string_view uri, uint32_t byte_offset, const std::vector<std::string> & imported_uris)
   {
-    json out;
-    out["uri"] = std::string(uri);
-    out["contents"] = nullptr;
-    out["range"] = nullptr;
-
     auto * doc = get_doc(uri);
     if (doc == nullptr) {
-      return out;
+      return std::nullopt;
     }
 
     ensure_parsed(*doc);
     byte_offset = clamp_byte_offset(byte_offset, doc->text.size());
     ensure_analyzed(*doc, imported_uris);
 
-    auto hit = find_ast_hit(*doc->module.program, byte_offset);
+    auto hit = ensure_ast_index(*doc).hit_at(byte_offset);
 
     if (hit.tree != nullptr && (hit.var_ref != nullptr || hit.inline_decl != nullptr)) {
       const std::string name =
@@ -1315,6 +1337,8 @@ struct Workspace::Impl
       std::optional<std::string> type_str;
       if (sym && sym->typeName) {
         type_str = std::string(*sym->typeName);
+      } else if (const bt_dsl::Type * declared = declared_symbol_type(sym, *doc->type_ctx)) {
+        type_str = type_to_string(declared);
       } else if (hit.var_ref && hit.var_ref->resolvedType) {
         type_str = type_to_string(hit.var_ref->resolvedType);
       }
@@ -1323,9 +1347,7 @@ struct Workspace::Impl
         md += "\n\nType: `" + *type_str + "`";
       }
 
-      out["contents"] = md;
-      out["range"] = range_to_json(sources.get_full_range(r));
-      return out;
+      return HoverInfo{std::move(md), to_byte_range(r)};
     }
 
     if (auto w = word_at(doc->text, byte_offset)) {
@@ -1378,17 +1400,14 @@ struct Workspace::Impl
           }
         }
 
-        out["contents"] = md;
         const auto wr = word_range_at(doc->text, byte_offset);
-        out["range"] = range_to_json(sources.get_full_range(
-          bt_dsl::SourceRange(doc->module.file_id, wr.startByte, wr.endByte)));
-        return out;
+        return HoverInfo{std::move(md), ByteRange{wr.startByte, wr.endByte}};
       }
 
       // Value symbol (variable / const / param) hover fallback.
       const bt_dsl::TreeDecl * tree = hit.tree;
       if (tree == nullptr && doc->module.program != nullptr) {
-        tree = find_tree_at(*doc->module.program, byte_offset);
+        tree = ensure_ast_index(*doc).tree_at(byte_offset);
       }
 
       const bt_dsl::Scope * scope = nullptr;
@@ -1406,23 +1425,18 @@ struct Workspace::Impl
           md += "\n\nType: `" + std::string(*vsym->typeName) + "`";
         }
 
-        out["contents"] = md;
         const auto wr = word_range_at(doc->text, byte_offset);
-        out["range"] = range_to_json(sources.get_full_range(
-          bt_dsl::SourceRange(doc->module.file_id, wr.startByte, wr.endByte)));
-        return out;
+        return HoverInfo{std::move(md), ByteRange{wr.startByte, wr.endByte}};
       }
     }
 
-    return out;
+    return std::nullopt;
   }
 
-  json definition_json_impl(
+  std::vector<Location> definition_impl(
     std::string_view uri, uint32_t byte_offset, const std::vector<std::string> & imported_uris)
   {
-    json out;
-    out["uri"] = std::string(uri);
-    out["locations"] = json::array();
+    std::vector<Location> out;
 
     auto * doc = get_doc(uri);
     if (doc == nullptr) {
@@ -1447,10 +1461,7 @@ struct Workspace::Impl
         continue;
       }
       if (auto resolved = resolve_relative_import_uri(doc->uri, imp->path)) {
-        json loc;
-        loc["uri"] = *resolved;
-        loc["range"] = range_to_json(bt_dsl::FullSourceRange::from_byte_range(0, 0));
-        out["locations"].push_back(std::move(loc));
+        out.push_back(Location{*resolved, ByteRange{0, 0}});
         return out;
       }
     }
@@ -1458,20 +1469,8 @@ struct Workspace::Impl
     auto push_loc = [&](
                       const std::string & target_uri, std::string_view target_text,
                       bt_dsl::SourceRange r, std::string_view ident) {
-      json loc;
-      loc["uri"] = target_uri;
-      const auto narrowed = narrow_to_identifier(target_text, r, ident);
-      bt_dsl::FullSourceRange fr = bt_dsl::FullSourceRange::from_byte_range(
-        narrowed.get_begin().get_offset(), narrowed.get_end().get_offset());
-
-      // If the target doc is in-memory, compute line/col.
-      if (auto * tdoc = get_doc(target_uri)) {
-        ensure_parsed(*tdoc);
-        fr = sources.get_full_range(narrowed);
-      }
-
-      loc["range"] = range_to_json(fr);
-      out["locations"].push_back(std::move(loc));
+      out.push_back(
+        Location{target_uri, to_byte_range(narrow_to_identifier(target_text, r, ident))});
     };
 
     // Node / subtree definition
@@ -1517,7 +1516,7 @@ struct Workspace::Impl
     }
 
     // VarRef / inline decl
-    const auto hit = find_ast_hit(*p, byte_offset);
+    const auto hit = ensure_ast_index(*doc).hit_at(byte_offset);
     if (hit.var_ref && hit.var_ref->resolvedSymbol) {
       push_loc(
         doc->uri, doc->text, hit.var_ref->resolvedSymbol->definitionRange, hit.var_ref->name);
@@ -1540,11 +1539,9 @@ struct Workspace::Impl
     return out;
   }
 
-  json document_symbols_json_impl(std::string_view uri)
+  std::vector<DocumentSymbol> document_symbols_impl(std::string_view uri)
   {
-    json out;
-    out["uri"] = std::string(uri);
-    out["symbols"] = json::array();
+    std::vector<DocumentSymbol> out;
 
     auto * doc = get_doc(uri);
     if (doc == nullptr) {
@@ -1553,13 +1550,9 @@ struct Workspace::Impl
 
     ensure_parsed(*doc);
 
-    auto push_sym = [&](std::string name, std::string kind, bt_dsl::SourceRange range) {
-      json s;
-      s["name"] = std::move(name);
-      s["kind"] = std::move(kind);
-      s["range"] = range_to_json(sources.get_full_range(range));
-      s["selectionRange"] = range_to_json(sources.get_full_range(range));
-      out["symbols"].push_back(std::move(s));
+    auto push_sym = [&](std::string name, DocumentSymbolKind kind, bt_dsl::SourceRange range) {
+      out.push_back(
+        DocumentSymbol{std::move(name), kind, to_byte_range(range), to_byte_range(range)});
     };
 
     bt_dsl::Program * p = doc->module.program;
@@ -1568,30 +1561,28 @@ struct Workspace::Impl
     }
 
     for (auto * d0 : p->externs()) {
-      if (d0) push_sym(std::string(d0->name), "Declare", d0->get_range());
+      if (d0) push_sym(std::string(d0->name), DocumentSymbolKind::Declare, d0->get_range());
     }
 
     for (auto * g : p->global_vars()) {
-      if (g) push_sym(std::string(g->name), "GlobalVar", g->get_range());
+      if (g) push_sym(std::string(g->name), DocumentSymbolKind::GlobalVar, g->get_range());
     }
 
     for (auto * c : p->global_consts()) {
-      if (c) push_sym(std::string(c->name), "GlobalConst", c->get_range());
+      if (c) push_sym(std::string(c->name), DocumentSymbolKind::GlobalConst, c->get_range());
     }
 
     for (auto * t : p->trees()) {
-      if (t) push_sym(std::string(t->name), "Tree", t->get_range());
+      if (t) push_sym(std::string(t->name), DocumentSymbolKind::Tree, t->get_range());
     }
 
     return out;
   }
 
-  json document_highlights_json_impl(
+  std::vector<DocumentHighlight> document_highlights_impl(
     std::string_view uri, uint32_t byte_offset, const std::vector<std::string> & imported_uris)
   {
-    json out;
-    out["uri"] = std::string(uri);
-    out["items"] = json::array();
+    std::vector<DocumentHighlight> out;
 
     auto * doc = get_doc(uri);
     if (doc == nullptr) {
@@ -1607,20 +1598,15 @@ struct Workspace::Impl
       return out;
     }
 
-    const auto hit = find_ast_hit(*p, byte_offset);
+    const AstIndex & index = ensure_ast_index(*doc);
+    const auto hit = index.hit_at(byte_offset);
     if (hit.tree == nullptr) {
       return out;
     }
 
-    auto push_item = [&](bt_dsl::SourceRange r, std::string kind) {
-      json item;
-      item["range"] = range_to_json(sources.get_full_range(r));
-      item["kind"] = std::move(kind);
-      out["items"].push_back(std::move(item));
-    };
-
-    auto push_item_narrowed = [&](bt_dsl::SourceRange r, std::string_view ident, std::string kind) {
-      push_item(narrow_to_identifier(doc->text, r, ident), std::move(kind));
+    auto push_item_narrowed = [&](bt_dsl::SourceRange r, std::string_view ident, HighlightKind k) {
+      out.push_back(
+        DocumentHighlight{to_byte_range(narrow_to_identifier(doc->text, r, ident)), k});
     };
 
     // Highlight node name occurrences (node call)
@@ -1631,38 +1617,19 @@ struct Workspace::Impl
       if (w == hit.node_stmt->nodeName) {
         const std::string_view node_name = hit.node_stmt->nodeName;
 
-        std::function<void(bt_dsl::Stmt *)> visit_stmt;
-        std::function<void(bt_dsl::NodeStmt *)> visit_node;
-
-        visit_node = [&](bt_dsl::NodeStmt * n) {
-          if (n == nullptr) return;
-          if (n->nodeName == node_name) {
-            push_item_narrowed(n->get_range(), node_name, "Text");
-          }
-          for (auto * ch : n->children) {
-            visit_stmt(ch);
-          }
-        };
-
-        visit_stmt = [&](bt_dsl::Stmt * s) {
-          if (auto * n = bt_dsl::dyn_cast<bt_dsl::NodeStmt>(s)) {
-            visit_node(n);
-          }
-        };
-
-        for (auto * stmt : hit.tree->body) {
-          visit_stmt(stmt);
+        for (const auto & r : index.node_calls(*hit.tree, node_name)) {
+          push_item_narrowed(r, node_name, HighlightKind::Text);
         }
 
         // Also highlight same-document decl name.
         for (auto * e : p->externs()) {
           if (e && e->name == node_name) {
-            push_item_narrowed(e->get_range(), node_name, "Text");
+            push_item_narrowed(e->get_range(), node_name, HighlightKind::Text);
           }
         }
         for (auto * t : p->trees()) {
           if (t && t->name == node_name) {
-            push_item_narrowed(t->get_range(), node_name, "Text");
+            push_item_narrowed(t->get_range(), node_name, HighlightKind::Text);
           }
         }
 
@@ -1680,118 +1647,21 @@ struct Workspace::Impl
       return out;
     }
 
-    auto kind_from_symbol = [&](const bt_dsl::Symbol * sym) {
-      if (sym == nullptr) {
-        return std::string("Read");
-      }
-      return sym->is_writable() ? std::string("Write") : std::string("Read");
-    };
-
     if (target_sym->definitionRange.get_end().get_offset() <= doc->text.size()) {
-      push_item_narrowed(target_sym->definitionRange, target_sym->name, "Write");
+      push_item_narrowed(target_sym->definitionRange, target_sym->name, HighlightKind::Write);
     }
 
-    std::function<void(bt_dsl::Expr *, std::optional<bt_dsl::PortDirection>)> visit_expr;
-    std::function<void(bt_dsl::Stmt *)> visit_stmt;
-
-    visit_expr = [&](bt_dsl::Expr * e, std::optional<bt_dsl::PortDirection> dir) {
-      if (e == nullptr) return;
-
-      if (auto * vr = bt_dsl::dyn_cast<bt_dsl::VarRefExpr>(e)) {
-        if (vr->resolvedSymbol == target_sym) {
-          const std::string kind = kind_from_symbol(target_sym);
-          push_item_narrowed(vr->get_range(), vr->name, kind);
-        }
-        return;
-      }
-
-      if (auto * b = bt_dsl::dyn_cast<bt_dsl::BinaryExpr>(e)) {
-        visit_expr(b->lhs, dir);
-        visit_expr(b->rhs, dir);
-        return;
-      }
-
-      if (auto * u = bt_dsl::dyn_cast<bt_dsl::UnaryExpr>(e)) {
-        visit_expr(u->operand, dir);
-        return;
-      }
-
-      if (auto * c = bt_dsl::dyn_cast<bt_dsl::CastExpr>(e)) {
-        visit_expr(c->expr, dir);
-        return;
-      }
-
-      if (auto * idx = bt_dsl::dyn_cast<bt_dsl::IndexExpr>(e)) {
-        visit_expr(idx->base, dir);
-        visit_expr(idx->index, dir);
-        return;
-      }
-
-      if (auto * arr = bt_dsl::dyn_cast<bt_dsl::ArrayLiteralExpr>(e)) {
-        for (auto * el : arr->elements) {
-          visit_expr(el, dir);
-        }
-        return;
-      }
-
-      if (auto * rep = bt_dsl::dyn_cast<bt_dsl::ArrayRepeatExpr>(e)) {
-        visit_expr(rep->value, dir);
-        visit_expr(rep->count, dir);
-        return;
-      }
-
-      if (auto * vm = bt_dsl::dyn_cast<bt_dsl::VecMacroExpr>(e)) {
-        visit_expr(vm->inner, dir);
-        return;
-      }
-    };
-
-    visit_stmt = [&](bt_dsl::Stmt * s) {
-      if (s == nullptr) return;
-
-      if (auto * as = bt_dsl::dyn_cast<bt_dsl::AssignmentStmt>(s)) {
-        if (as->resolvedTarget == target_sym) {
-          push_item_narrowed(as->get_range(), as->target, "Write");
-        }
-        for (auto * idx : as->indices) {
-          visit_expr(idx, std::nullopt);
-        }
-        visit_expr(as->value, std::nullopt);
-        return;
-      }
-
-      if (auto * ns = bt_dsl::dyn_cast<bt_dsl::NodeStmt>(s)) {
-        for (auto * pc : ns->preconditions) {
-          if (pc) visit_expr(pc->condition, std::nullopt);
-        }
-        for (auto * arg : ns->args) {
-          if (arg == nullptr) continue;
-          if (arg->inlineDecl && arg->inlineDecl->name == target_sym->name) {
-            push_item_narrowed(arg->inlineDecl->get_range(), arg->inlineDecl->name, "Write");
-          }
-          if (arg->valueExpr) {
-            visit_expr(arg->valueExpr, arg->direction);
-          }
-        }
-        for (auto * ch : ns->children) {
-          visit_stmt(ch);
-        }
-      }
-    };
-
-    for (auto * stmt : hit.tree->body) {
-      visit_stmt(stmt);
+    for (const auto & occ : index.symbol_occurrences(*hit.tree, target_sym)) {
+      push_item_narrowed(occ.range, occ.name, occ.kind);
     }
 
     return out;
   }
 
-  json semantic_tokens_json_impl(
+  std::vector<SemanticToken> semantic_tokens_impl(
     std::string_view uri, const std::vector<std::string> & imported_uris)
   {
-    json out;
-    out["uri"] = std::string(uri);
-    out["tokens"] = json::array();
+    std::vector<SemanticToken> out;
 
     auto * doc = get_doc(uri);
     if (doc == nullptr) {
@@ -1806,54 +1676,45 @@ struct Workspace::Impl
       return out;
     }
 
-    auto push_tok =
-      [&](bt_dsl::SourceRange r, std::string type, const std::vector<std::string> & mods) {
-        if (r.get_end().get_offset() <= r.get_begin().get_offset()) {
+    auto tok_ident =
+      [&](bt_dsl::SourceRange r, std::string_view ident, SemanticTokenType type, bool decl) {
+        const auto narrowed = narrow_to_identifier(doc->text, r, ident);
+        if (narrowed.get_end().get_offset() <= narrowed.get_begin().get_offset()) {
           return;
         }
-        json t;
-        t["type"] = std::move(type);
-        t["modifiers"] = mods;
-        t["range"] = range_to_json(sources.get_full_range(r));
-        out["tokens"].push_back(std::move(t));
+        out.push_back(SemanticToken{to_byte_range(narrowed), type, decl});
       };
 
-    auto tok_ident = [&](
-                       bt_dsl::SourceRange r, std::string_view ident, std::string type,
-                       const std::vector<std::string> & mods) {
-      push_tok(narrow_to_identifier(doc->text, r, ident), std::move(type), mods);
-    };
-
-    const std::vector<std::string> no_mods;
-    const std::vector<std::string> decl_mods{"declaration"};
+    constexpr bool k_ref = false;
+    constexpr bool k_decl = true;
 
     // Declarations
     for (auto * e : p->externs()) {
       if (e == nullptr) continue;
       tok_ident(
-        e->get_range(), e->name, token_type_for_node_category(e->category, false), decl_mods);
+        e->get_range(), e->name, token_type_for_node_category(e->category, false), k_decl);
       for (auto * port : e->ports) {
         if (port == nullptr) continue;
-        tok_ident(port->get_range(), port->name, "property", decl_mods);
+        tok_ident(port->get_range(), port->name, SemanticTokenType::Property, k_decl);
       }
     }
 
     for (auto * t : p->trees()) {
       if (t == nullptr) continue;
-      tok_ident(t->get_range(), t->name, "function", decl_mods);
+      tok_ident(t->get_range(), t->name, SemanticTokenType::Function, k_decl);
       for (auto * param : t->params) {
         if (param == nullptr) continue;
-        tok_ident(param->get_range(), param->name, "parameter", decl_mods);
+        tok_ident(param->get_range(), param->name, SemanticTokenType::Parameter, k_decl);
       }
     }
 
     for (auto * gv : p->global_vars()) {
       if (gv == nullptr) continue;
-      tok_ident(gv->get_range(), gv->name, "variable", decl_mods);
+      tok_ident(gv->get_range(), gv->name, SemanticTokenType::Variable, k_decl);
     }
     for (auto * gc : p->global_consts()) {
       if (gc == nullptr) continue;
-      tok_ident(gc->get_range(), gc->name, "variable", decl_mods);
+      tok_ident(gc->get_range(), gc->name, SemanticTokenType::Variable, k_decl);
     }
 
     // Tree bodies: node calls + var refs
@@ -1864,7 +1725,7 @@ struct Workspace::Impl
       if (e == nullptr) return;
 
       if (auto * vr = bt_dsl::dyn_cast<bt_dsl::VarRefExpr>(e)) {
-        tok_ident(vr->get_range(), vr->name, "variable", no_mods);
+        tok_ident(vr->get_range(), vr->name, SemanticTokenType::Variable, k_ref);
         return;
       }
       if (auto * b = bt_dsl::dyn_cast<bt_dsl::BinaryExpr>(e)) {
@@ -1909,7 +1770,7 @@ struct Workspace::Impl
         const auto cat =
           ns->resolvedNode ? extern_category_from_decl(ns->resolvedNode->decl) : std::nullopt;
         tok_ident(
-          ns->get_range(), ns->nodeName, token_type_for_node_category(cat, is_tree), no_mods);
+          ns->get_range(), ns->nodeName, token_type_for_node_category(cat, is_tree), k_ref);
 
         for (auto * pc : ns->preconditions) {
           if (pc) visit_expr(pc->condition);
@@ -1917,10 +1778,12 @@ struct Workspace::Impl
         for (auto * arg : ns->args) {
           if (arg == nullptr) continue;
           if (!arg->name.empty()) {
-            tok_ident(arg->get_range(), arg->name, "property", no_mods);
+            tok_ident(arg->get_range(), arg->name, SemanticTokenType::Property, k_ref);
           }
           if (arg->inlineDecl) {
-            tok_ident(arg->inlineDecl->get_range(), arg->inlineDecl->name, "variable", decl_mods);
+            tok_ident(
+              arg->inlineDecl->get_range(), arg->inlineDecl->name, SemanticTokenType::Variable,
+              k_decl);
           }
           if (arg->valueExpr) {
             visit_expr(arg->valueExpr);
@@ -1933,7 +1796,7 @@ struct Workspace::Impl
       }
 
       if (auto * as = bt_dsl::dyn_cast<bt_dsl::AssignmentStmt>(s)) {
-        tok_ident(as->get_range(), as->target, "variable", no_mods);
+        tok_ident(as->get_range(), as->target, SemanticTokenType::Variable, k_ref);
         for (auto * idx : as->indices) {
           visit_expr(idx);
         }
@@ -1942,7 +1805,7 @@ struct Workspace::Impl
       }
 
       if (auto * vd = bt_dsl::dyn_cast<bt_dsl::BlackboardDeclStmt>(s)) {
-        tok_ident(vd->get_range(), vd->name, "variable", decl_mods);
+        tok_ident(vd->get_range(), vd->name, SemanticTokenType::Variable, k_decl);
         if (vd->initialValue) {
           visit_expr(vd->initialValue);
         }
@@ -1950,7 +1813,7 @@ struct Workspace::Impl
       }
 
       if (auto * cd = bt_dsl::dyn_cast<bt_dsl::ConstDeclStmt>(s)) {
-        tok_ident(cd->get_range(), cd->name, "variable", decl_mods);
+        tok_ident(cd->get_range(), cd->name, SemanticTokenType::Variable, k_decl);
         visit_expr(cd->value);
         return;
       }
@@ -1965,6 +1828,51 @@ struct Workspace::Impl
 
     return out;
   }
+
+  /// Up-to-date semantic tokens of `uri` (nullptr if it is not loaded).
+  Document::SemanticTokensCache * ensure_semantic_tokens(
+    std::string_view uri, const std::vector<std::string> & imported_uris,
+    PositionEncoding encoding)
+  {
+    auto * doc = get_doc(uri);
+    if (doc == nullptr) {
+      return nullptr;
+    }
+    ensure_parsed(*doc);
+    ensure_analyzed(*doc, imported_uris);
+
+    auto & c = doc->semantic;
+    if (c.fresh && c.encoding == encoding) {
+      return &c;
+    }
+
+    c.tokens = semantic_tokens_impl(uri, imported_uris);
+    normalize_semantic_tokens(c.tokens);
+    c.previous_result_id = std::move(c.result_id);
+    c.previous_data = std::move(c.data);
+    if (c.encoding != encoding) {
+      c.previous_result_id.clear();  // Positions are not comparable
+      c.previous_data.clear();
+    }
+    c.data = encode_semantic_tokens(doc->text, line_offsets(*doc), c.tokens, encoding);
+    c.result_id = std::to_string(++last_semantic_result);
+    c.encoding = encoding;
+    c.fresh = true;
+    return &c;
+  }
+
+  /// JSON range (bytes plus 1-based line/column) of `r` in document `uri`.
+  /// Only bytes are known for documents that are not loaded.
+  json range_json(std::string_view uri, ByteRange r)
+  {
+    auto * doc = get_doc(uri);
+    if (doc == nullptr) {
+      return range_to_json(bt_dsl::FullSourceRange::from_byte_range(r.startByte, r.endByte));
+    }
+    ensure_parsed(*doc);
+    return range_to_json(
+      sources.get_full_range(bt_dsl::SourceRange(doc->module.file_id, r.startByte, r.endByte)));
+  }
 };
 
 // =============================================================================
@@ -1995,34 +1903,283 @@ void Workspace::set_document(std::string uri, std::string text)
   auto & d = impl_->docs[uri];
   d.uri = std::move(uri);
   d.text = std::move(text);
-  d.module = bt_dsl::ModuleInfo{};
-  d.type_ctx = std::make_unique<bt_dsl::TypeContext>();
-  d.indexed = false;
-  d.analyzed = false;
-  d.analyzed_import_hash = 0;
-  d.sema_diags = bt_dsl::DiagnosticBag{};
+  d.edited.reset();
+  impl_->text_changed(d);
+}
+
+bool Workspace::apply_edit(std::string_view uri, ByteRange range, std::string_view replacement)
+{
+  auto * d = impl_->get_doc(uri);
+  if (d == nullptr) {
+    return false;
+  }
+
+  const auto size = static_cast<uint32_t>(d->text.size());
+  const uint32_t start = std::min(range.startByte, size);
+  const uint32_t end = std::clamp(range.endByte, start, size);
+  const auto inserted = static_cast<uint32_t>(replacement.size());
+  d->text.replace(start, end - start, replacement);
+
+  // Merge with earlier edits, mapping their end into the new text.
+  ByteRange edited{start, start + inserted};
+  if (d->edited) {
+    const uint32_t prev_end = d->edited->endByte;
+    uint32_t mapped_end = start + inserted;
+    if (prev_end <= start) {
+      mapped_end = prev_end;
+    } else if (prev_end >= end) {
+      mapped_end = prev_end - end + start + inserted;
+    }
+    edited.startByte = std::min(edited.startByte, d->edited->startByte);
+    edited.endByte = std::max(edited.endByte, mapped_end);
+  }
+  d->edited = edited;
+
+  impl_->text_changed(*d);
+  return true;
+}
+
+std::optional<ByteRange> Workspace::edited_range(std::string_view uri) const
+{
+  const auto * d = impl_->get_doc(uri);
+  return d != nullptr ? d->edited : std::nullopt;
+}
+
+void Workspace::remove_document(std::string_view uri)
+{
+  auto * d = impl_->get_doc(uri);
+  if (d == nullptr) {
+    return;
+  }
+  // Importers keep their edge to `uri`, so they are invalidated again if it
+  // is reloaded.
+  impl_->text_changed(*d);
+  impl_->set_analyzed_deps(*d, {});
+  impl_->docs.erase(std::string(uri));
 }
 
-void Workspace::remove_document(std::string_view uri) { impl_->docs.erase(std::string(uri)); }
+std::vector<std::string> Workspace::dependents(std::string_view uri) const
+{
+  return impl_->dependents_of(std::string(uri));
+}
 
 bool Workspace::has_document(std::string_view uri) const
 {
   return impl_->docs.find(std::string(uri)) != impl_->docs.end();
 }
 
+std::optional<std::string_view> Workspace::document_text(std::string_view uri) const
+{
+  const auto * d = impl_->get_doc(uri);
+  if (d == nullptr) {
+    return std::nullopt;
+  }
+  return std::string_view(d->text);
+}
+
+void Workspace::set_memory_budget(size_t bytes)
+{
+  impl_->memory_budget = bytes;
+  impl_->enforce_memory_budget();
+}
+
+void Workspace::set_pinned(std::string_view uri, bool pinned)
+{
+  if (auto * d = impl_->get_doc(uri)) {
+    d->pinned = pinned;
+  }
+}
+
+MemoryUsage Workspace::memory_usage() const { return impl_->memory_usage(); }
+
+std::string_view to_string(DiagnosticSource source)
+{
+  switch (source) {
+    case DiagnosticSource::Import:
+      return "import";
+    case DiagnosticSource::Parser:
+      return "parser";
+    case DiagnosticSource::Analyzer:
+      return "analyzer";
+  }
+  return "parser";
+}
+
+std::string_view to_string(SemanticTokenType type)
+{
+  switch (type) {
+    case SemanticTokenType::Class:
+      return "class";
+    case SemanticTokenType::Function:
+      return "function";
+    case SemanticTokenType::Keyword:
+      return "keyword";
+    case SemanticTokenType::Decorator:
+      return "decorator";
+    case SemanticTokenType::Property:
+      return "property";
+    case SemanticTokenType::Parameter:
+      return "parameter";
+    case SemanticTokenType::Variable:
+      return "variable";
+  }
+  return "variable";
+}
+
+// ---- Typed queries ----
+
+std::vector<DiagnosticItem> Workspace::diagnostics(
+  std::string_view uri, const std::vector<std::string> & imported_uris)
+{
+  auto out = impl_->diagnostics_impl(uri, imported_uris);
+  impl_->enforce_memory_budget();
+  return out;
+}
+
+std::vector<std::string> Workspace::resolve_imports(
+  std::string_view uri, std::string_view stdlib_uri)
+{
+  auto out = impl_->resolve_imports_impl(uri, stdlib_uri);
+  impl_->enforce_memory_budget();
+  return out;
+}
+
+CompletionList Workspace::completion(
+  std::string_view uri, uint32_t byte_offset, const std::vector<std::string> & imported_uris,
+  std::string_view trigger)
+{
+  auto out = impl_->completion_impl(uri, byte_offset, imported_uris, trigger);
+  impl_->enforce_memory_budget();
+  return out;
+}
+
+std::optional<HoverInfo> Workspace::hover(
+  std::string_view uri, uint32_t byte_offset, const std::vector<std::string> & imported_uris)
+{
+  auto out = impl_->hover_impl(uri, byte_offset, imported_uris);
+  impl_->enforce_memory_budget();
+  return out;
+}
+
+std::vector<Location> Workspace::definition(
+  std::string_view uri, uint32_t byte_offset, const std::vector<std::string> & imported_uris)
+{
+  auto out = impl_->definition_impl(uri, byte_offset, imported_uris);
+  impl_->enforce_memory_budget();
+  return out;
+}
+
+std::vector<DocumentSymbol> Workspace::document_symbols(std::string_view uri)
+{
+  auto out = impl_->document_symbols_impl(uri);
+  impl_->enforce_memory_budget();
+  return out;
+}
+
+std::vector<DocumentHighlight> Workspace::document_highlights(
+  std::string_view uri, uint32_t byte_offset, const std::vector<std::string> & imported_uris)
+{
+  auto out = impl_->document_highlights_impl(uri, byte_offset, imported_uris);
+  impl_->enforce_memory_budget();
+  return out;
+}
+
+std::vector<SemanticToken> Workspace::semantic_tokens(
+  std::string_view uri, const std::vector<std::string> & imported_uris)
+{
+  auto out = impl_->semantic_tokens_impl(uri, imported_uris);
+  impl_->enforce_memory_budget();
+  return out;
+}
+
+EncodedSemanticTokens Workspace::semantic_tokens_full(
+  std::string_view uri, const std::vector<std::string> & imported_uris, PositionEncoding encoding)
+{
+  EncodedSemanticTokens out;
+  if (const auto * c = impl_->ensure_semantic_tokens(uri, imported_uris, encoding)) {
+    out.result_id = c->result_id;
+    out.data = c->data;
+  }
+  impl_->enforce_memory_budget();
+  return out;
+}
+
+EncodedSemanticTokens Workspace::semantic_tokens_delta(
+  std::string_view uri, std::string_view previous_result_id,
+  const std::vector<std::string> & imported_uris, PositionEncoding encoding)
+{
+  EncodedSemanticTokens out;
+  const auto * c = impl_->ensure_semantic_tokens(uri, imported_uris, encoding);
+  if (c == nullptr) {
+    return out;
+  }
+  out.result_id = c->result_id;
+  if (!previous_result_id.empty() && previous_result_id == c->result_id) {
+    out.edits.emplace();
+  } else if (!previous_result_id.empty() && previous_result_id == c->previous_result_id) {
+    out.edits = diff_semantic_tokens(c->previous_data, c->data);
+  } else {
+    out.data = c->data;
+  }
+  impl_->enforce_memory_budget();
+  return out;
+}
+
+std::vector<uint32_t> Workspace::semantic_tokens_range(
+  std::string_view uri, ByteRange range, const std::vector<std::string> & imported_uris,
+  PositionEncoding encoding)
+{
+  const auto * c = impl_->ensure_semantic_tokens(uri, imported_uris, encoding);
+  const auto * doc = impl_->get_doc(uri);
+  if (c == nullptr || doc == nullptr) {
+    return {};
+  }
+
+  // Tokens are sorted and disjoint, so the overlapping ones are contiguous.
+  const auto first = std::lower_bound(
+    c->tokens.begin(), c->tokens.end(), range.startByte,
+    [](const SemanticToken & t, uint32_t pos) { return t.range.endByte <= pos; });
+  auto last = first;
+  while (last != c->tokens.end() && last->range.startByte < range.endByte) {
+    ++last;
+  }
+  const std::vector<SemanticToken> in_range(first, last);
+  auto out = encode_semantic_tokens(doc->text, impl_->line_offsets(*doc), in_range, encoding);
+  impl_->enforce_memory_budget();
+  return out;
+}
+
+// ---- JSON adapters (WASM / VS Code host) ----
+
 std::string Workspace::diagnostics_json(std::string_view uri) { return diagnostics_json(uri, {}); }
 
 std::string Workspace::diagnostics_json(
   std::string_view uri, const std::vector<std::string> & imported_uris)
 {
-  const json j = impl_->diagnostics_json_impl(uri, imported_uris);
-  return j.dump();
+  json out;
+  out["uri"] = std::string(uri);
+  out["items"] = json::array();
+  for (const auto & d : diagnostics(uri, imported_uris)) {
+    json item;
+    item["source"] = to_string(d.source);
+    item["message"] = d.message;
+    item["severity"] = severity_to_string(d.severity);
+    if (!d.code.empty()) {
+      item["code"] = d.code;
+    }
+    item["range"] = impl_->range_json(uri, d.range);
+    out["items"].push_back(std::move(item));
+  }
+  return out.dump();
 }
 
 std::string Workspace::resolve_imports_json(std::string_view uri, std::string_view stdlib_uri)
 {
-  const json j = impl_->resolve_imports_json_impl(uri, stdlib_uri);
-  return j.dump();
+  json out;
+  out["uri"] = std::string(uri);
+  out["stdlibUri"] = std::string(stdlib_uri);
+  out["uris"] = resolve_imports(uri, stdlib_uri);
+  return out.dump();
 }
 
 std::string Workspace::completion_json(std::string_view uri, uint32_t byte_offset)
@@ -2034,8 +2191,23 @@ std::string Workspace::completion_json(
   std::string_view uri, uint32_t byte_offset, const std::vector<std::string> & imported_uris,
   std::string_view trigger)
 {
-  const json j = impl_->completion_json_impl(uri, byte_offset, imported_uris, trigger);
-  return j.dump();
+  const CompletionList list = completion(uri, byte_offset, imported_uris, trigger);
+  json out;
+  out["uri"] = std::string(uri);
+  out["isIncomplete"] = list.is_incomplete;
+  out["items"] = json::array();
+  for (const auto & c : list.items) {
+    json item;
+    item["label"] = c.label;
+    item["kind"] = to_string(c.kind);
+    if (!c.detail.empty()) {
+      item["detail"] = c.detail;
+    }
+    item["insertText"] = c.insert_text;
+    item["replaceRange"] = byte_range_to_json(c.replace_range);
+    out["items"].push_back(std::move(item));
+  }
+  return out.dump();
 }
 
 std::string Workspace::hover_json(std::string_view uri, uint32_t byte_offset)
@@ -2046,8 +2218,15 @@ std::string Workspace::hover_json(std::string_view uri, uint32_t byte_offset)
 std::string Workspace::hover_json(
   std::string_view uri, uint32_t byte_offset, const std::vector<std::string> & imported_uris)
 {
-  const json j = impl_->hover_json_impl(uri, byte_offset, imported_uris);
-  return j.dump();
+  json out;
+  out["uri"] = std::string(uri);
+  out["contents"] = nullptr;
+  out["range"] = nullptr;
+  if (auto h = hover(uri, byte_offset, imported_uris)) {
+    out["contents"] = h->contents;
+    out["range"] = impl_->range_json(uri, h->range);
+  }
+  return out.dump();
 }
 
 std::string Workspace::definition_json(std::string_view uri, uint32_t byte_offset)
@@ -2058,14 +2237,29 @@ std::string Workspace::definition_json(std::string_view uri, uint32_t byte_offse
 std::string Workspace::definition_json(
   std::string_view uri, uint32_t byte_offset, const std::vector<std::string> & imported_uris)
 {
-  const json j = impl_->definition_json_impl(uri, byte_offset, imported_uris);
-  return j.dump();
+  json out;
+  out["uri"] = std::string(uri);
+  out["locations"] = json::array();
+  for (const auto & l : definition(uri, byte_offset, imported_uris)) {
+    out["locations"].push_back(json{{"uri", l.uri}, {"range", impl_->range_json(l.uri, l.range)}});
+  }
+  return out.dump();
 }
 
 std::string Workspace::document_symbols_json(std::string_view uri)
 {
-  const json j = impl_->document_symbols_json_impl(uri);
-  return j.dump();
+  json out;
+  out["uri"] = std::string(uri);
+  out["symbols"] = json::array();
+  for (const auto & sym : document_symbols(uri)) {
+    json s;
+    s["name"] = sym.name;
+    s["kind"] = to_string(sym.kind);
+    s["range"] = impl_->range_json(uri, sym.range);
+    s["selectionRange"] = impl_->range_json(uri, sym.selection_range);
+    out["symbols"].push_back(std::move(s));
+  }
+  return out.dump();
 }
 
 std::string Workspace::document_highlights_json(std::string_view uri, uint32_t byte_offset)
@@ -2076,8 +2270,14 @@ std::string Workspace::document_highlights_json(std::string_view uri, uint32_t b
 std::string Workspace::document_highlights_json(
   std::string_view uri, uint32_t byte_offset, const std::vector<std::string> & imported_uris)
 {
-  const json j = impl_->document_highlights_json_impl(uri, byte_offset, imported_uris);
-  return j.dump();
+  json out;
+  out["uri"] = std::string(uri);
+  out["items"] = json::array();
+  for (const auto & h : document_highlights(uri, byte_offset, imported_uris)) {
+    out["items"].push_back(
+      json{{"range", impl_->range_json(uri, h.range)}, {"kind", to_string(h.kind)}});
+  }
+  return out.dump();
 }
 
 std::string Workspace::semantic_tokens_json(std::string_view uri)
@@ -2088,8 +2288,17 @@ std::string Workspace::semantic_tokens_json(std::string_view uri)
 std::string Workspace::semantic_tokens_json(
   std::string_view uri, const std::vector<std::string> & imported_uris)
 {
-  const json j = impl_->semantic_tokens_json_impl(uri, imported_uris);
-  return j.dump();
+  json out;
+  out["uri"] = std::string(uri);
+  out["tokens"] = json::array();
+  for (const auto & t : semantic_tokens(uri, imported_uris)) {
+    json tok;
+    tok["type"] = to_string(t.type);
+    tok["modifiers"] = t.declaration ? json::array({"declaration"}) : json::array();
+    tok["range"] = impl_->range_json(uri, t.range);
+    out["tokens"].push_back(std::move(tok));
+  }
+  return out.dump();
 }
 
 }  // namespace bt_dsl::lsp
@@ -38,6 +38,13 @@ std::optional<DependencyConfig> parse_dependency(const YAML::Node & node, std::s
 
 }  // namespace
 
+bool is_valid_target(std::string_view target)
+{
+  return target == "btcpp_v4" || target == "btcpp_v4_strict" || target == "btcpp_v4_cpp";
+}
+
+bool is_cpp_target(std::string_view target) { return target == "btcpp_v4_cpp"; }
+
 ConfigLoadResult load_project_config(const std::filesystem::path & config_path)
 {
   namespace fs = std::filesystem;
@@ -89,12 +96,16 @@ ConfigLoadResult load_project_config(const std::filesystem::path & config_path)
     if (comp["target"]) {
       config.compiler.target = comp["target"].as<std::string>();
       // Validate target
-      if (config.compiler.target != "btcpp_v4" && config.compiler.target != "btcpp_v4_strict") {
+      if (!is_valid_target(config.compiler.target)) {
         return ConfigLoadResult::fail(
           "invalid compiler.target: '" + config.compiler.target +
-          "' (must be 'btcpp_v4' or 'btcpp_v4_strict')");
+          "' (must be 'btcpp_v4', 'btcpp_v4_strict' or 'btcpp_v4_cpp')");
       }
     }
+
+    if (comp["split_output"]) {
+      config.compiler.split_output = comp["split_output"].as<bool>();
+    }
   }
 
   // Parse 'dependencies' section
@@ -11,6 +11,29 @@
 namespace bt_dsl
 {
 
+namespace
+{
+
+// Only symbols owned by this module's SymbolTable are tracked. Imported
+// symbols are globals (always Init); unresolved references were already
+// reported by NameResolver.
+void set_init_state(InitStateMap & state, ResolvedBinding binding, InitState value)
+{
+  if (binding.is_local_slot() && binding.slot < state.size()) {
+    state[binding.slot] = value;
+  }
+}
+
+bool is_initialized(const InitStateMap & state, ResolvedBinding binding)
+{
+  if (!binding.is_local_slot()) {
+    return true;
+  }
+  return binding.slot < state.size() && state[binding.slot] == InitState::Init;
+}
+
+}  // namespace
+
 // ============================================================================
 // Constructor
 // ============================================================================
@@ -52,17 +75,17 @@ void InitializationChecker::check(const TreeDecl * tree, const CFG & cfg)
   if (tree == nullptr) return;
 
   // Initialize entry state: parameters with in/ref/mut are Init, out are Uninit
-  InitStateMap entry_state;
+  InitStateMap entry_state(values_.symbol_count(), InitState::Uninit);
 
   // Register parameters
   for (const auto * param : tree->params) {
     const PortDirection dir = param->direction.value_or(PortDirection::In);
     if (dir == PortDirection::Out) {
       // out parameters start as Uninit
-      entry_state[param->name] = InitState::Uninit;
+      set_init_state(entry_state, param->binding, InitState::Uninit);
     } else {
       // in/ref/mut parameters start as Init
-      entry_state[param->name] = InitState::Init;
+      set_init_state(entry_state, param->binding, InitState::Init);
     }
   }
 
@@ -70,8 +93,8 @@ void InitializationChecker::check(const TreeDecl * tree, const CFG & cfg)
   const Scope * global_scope = values_.get_global_scope();
   if (global_scope != nullptr) {
     for (const auto & [name, sym] : global_scope->get_symbols()) {
-      if (sym.is_variable() || sym.is_const()) {
-        entry_state[name] = InitState::Init;
+      if ((sym.is_variable() || sym.is_const()) && sym.slot < entry_state.size()) {
+        entry_state[sym.slot] = InitState::Init;
       }
     }
   }
@@ -88,25 +111,12 @@ static bool merge_init_states(InitStateMap & target, const InitStateMap & source
 {
   bool changed = false;
 
-  for (auto it = target.begin(); it != target.end();) {
-    const auto & name = it->first;
-    const InitState target_state = it->second;
-
-    auto src_it = source.find(name);
-    const InitState source_state = (src_it != source.end()) ? src_it->second : InitState::Uninit;
+  for (size_t slot = 0; slot < target.size(); ++slot) {
+    const InitState source_state = slot < source.size() ? source[slot] : InitState::Uninit;
 
     // Merge rule: Init + Init = Init, otherwise Uninit
-    if (target_state == InitState::Init && source_state != InitState::Init) {
-      it->second = InitState::Uninit;
-      changed = true;
-    }
-
-    ++it;
-  }
-
-  for (const auto & [name, state] : source) {
-    if (target.find(name) == target.end()) {
-      target[name] = InitState::Uninit;
+    if (target[slot] == InitState::Init && source_state != InitState::Init) {
+      target[slot] = InitState::Uninit;
       changed = true;
     }
   }
@@ -116,14 +126,12 @@ static bool merge_init_states(InitStateMap & target, const InitStateMap & source
 
 static void union_init_states(InitStateMap & target, const InitStateMap & source)
 {
-  for (const auto & [name, st] : source) {
-    if (st == InitState::Init) {
-      target[name] = InitState::Init;
-    } else {
-      // Ensure key exists so later merges remain stable.
-      if (target.find(name) == target.end()) {
-        target[name] = InitState::Uninit;
-      }
+  if (target.size() < source.size()) {
+    target.resize(source.size(), InitState::Uninit);
+  }
+  for (size_t slot = 0; slot < source.size(); ++slot) {
+    if (source[slot] == InitState::Init) {
+      target[slot] = InitState::Init;
     }
   }
 }
@@ -132,7 +140,8 @@ void InitializationChecker::analyze_data_flow(const CFG & cfg, InitStateMap & in
 {
   if (cfg.blocks.empty()) return;
 
-  std::vector<InitStateMap> block_in_states(cfg.blocks.size());
+  std::vector<InitStateMap> block_in_states(
+    cfg.blocks.size(), InitStateMap(initial_state.size(), InitState::Uninit));
 
   if (cfg.entry) {
     block_in_states[cfg.entry->id] = initial_state;
@@ -306,12 +315,11 @@ void InitializationChecker::transfer_edge(
     if (const auto * node = dyn_cast<NodeStmt>(last_stmt)) {
       for (const auto * arg : node->args) {
         if (arg->direction == PortDirection::Out) {
-          const std::string_view name = get_var_name_from_expr(arg->valueExpr);
-          if (!name.empty()) {
-            state[name] = InitState::Init;
+          if (const VarRefExpr * var_ref = get_var_ref_from_expr(arg->valueExpr)) {
+            set_init_state(state, var_ref->binding, InitState::Init);
           }
           if (arg->inlineDecl != nullptr) {
-            state[arg->inlineDecl->name] = InitState::Init;
+            set_init_state(state, arg->inlineDecl->binding, InitState::Init);
           }
         }
       }
@@ -322,9 +330,9 @@ void InitializationChecker::transfer_edge(
 void InitializationChecker::check_node_args(const NodeStmt * node, const InitStateMap & state)
 {
   for (const auto * arg : node->args) {
-    // Get variable name
-    const std::string_view var_name = get_var_name_from_expr(arg->valueExpr);
-    if (var_name.empty()) continue;
+    // Get referenced variable
+    const VarRefExpr * var_ref = get_var_ref_from_expr(arg->valueExpr);
+    if (var_ref == nullptr) continue;
 
     const PortDirection dir = arg->direction.value_or(PortDirection::In);
 
@@ -333,15 +341,12 @@ void InitializationChecker::check_node_args(const NodeStmt * node, const InitSta
       check_expr(arg->valueExpr, state);
     } else if (dir == PortDirection::Ref || dir == PortDirection::Mut) {
       // Ref/Mut must also be Init at call site
-      const std::string_view name = get_var_name_from_expr(arg->valueExpr);
-      if (!name.empty()) {
-        auto it = state.find(name);
-        if (it == state.end() || it->second == InitState::Uninit) {
-          report_error(
-            arg->get_range(), std::string("Variable '") + std::string(name) +
-                                "' may be uninitialized when passed to '" +
-                                std::string(to_string(dir)) + "' port");
-        }
+      if (!is_initialized(state, var_ref->binding)) {
+        report_error(arg->get_range(), [&] {
+          return DiagnosticMessage::format(
+            "Variable '{}' may be uninitialized when passed to '{}' port", var_ref->name,
+            to_string(dir));
+        });
       }
     }
   }
@@ -359,12 +364,11 @@ void InitializationChecker::check_expr(
       if (!var_ref->resolvedSymbol) {
         break;
       }
-      auto it = state.find(var_ref->name);
-      if (it == state.end() || it->second == InitState::Uninit) {
+      if (!is_initialized(state, var_ref->binding)) {
         if (report_errors) {
-          report_error(
-            var_ref->get_range(),
-            std::string("Variable '") + std::string(var_ref->name) + "' may be uninitialized");
+          report_error(var_ref->get_range(), [&] {
+            return DiagnosticMessage::format("Variable '{}' may be uninitialized", var_ref->name);
+          });
         }
       }
       break;
@@ -422,14 +426,8 @@ void InitializationChecker::check_stmt(const Stmt * stmt, InitStateMap & state,
     case NodeKind::NodeStmt: {
       const auto * node = cast<NodeStmt>(stmt);
       for (const auto * arg : node->args) {
-        if (arg->direction == PortDirection::Out) {
-          const std::string_view var_name = get_var_name_from_expr(arg->valueExpr);
-          if (!var_name.empty()) {
-          }
-        }
-
         if (arg->inlineDecl != nullptr) {
-          state[arg->inlineDecl->name] = InitState::Uninit;
+          set_init_state(state, arg->inlineDecl->binding, InitState::Uninit);
         }
       }
       break;
@@ -443,9 +441,7 @@ void InitializationChecker::check_stmt(const Stmt * stmt, InitStateMap & state,
       for (const auto * idx : assign->indices) {
         if (idx) check_expr(idx, state, report_errors);
       }
-      if (!assign->target.empty()) {
-        state[assign->target] = InitState::Init;
-      }
+      set_init_state(state, assign->targetBinding, InitState::Init);
       break;
     }
 
@@ -453,9 +449,9 @@ void InitializationChecker::check_stmt(const Stmt * stmt, InitStateMap & state,
       const auto * decl = cast<BlackboardDeclStmt>(stmt);
       if (decl->initialValue) {
         check_expr(decl->initialValue, state, report_errors);
-        state[decl->name] = InitState::Init;
+        set_init_state(state, decl->binding, InitState::Init);
       } else {
-        state[decl->name] = InitState::Uninit;
+        set_init_state(state, decl->binding, InitState::Uninit);
       }
       break;
     }
@@ -465,7 +461,7 @@ void InitializationChecker::check_stmt(const Stmt * stmt, InitStateMap & state,
       if (decl->value) {
         check_expr(decl->value, state, report_errors);
       }
-      state[decl->name] = InitState::Init;
+      set_init_state(state, decl->binding, InitState::Init);
       break;
     }
 
@@ -474,24 +470,24 @@ void InitializationChecker::check_stmt(const Stmt * stmt, InitStateMap & state,
   }
 }
 
-std::string_view InitializationChecker::get_var_name_from_expr(const Expr * expr)
+const VarRefExpr * InitializationChecker::get_var_ref_from_expr(const Expr * expr)
 {
-  if (expr == nullptr) return {};
+  if (expr == nullptr) return nullptr;
   if (const auto * var_ref = dyn_cast<VarRefExpr>(expr)) {
-    return var_ref->name;
+    return var_ref;
   }
   if (const auto * index_expr = dyn_cast<IndexExpr>(expr)) {
-    return get_var_name_from_expr(index_expr->base);
+    return get_var_ref_from_expr(index_expr->base);
   }
-  return {};
+  return nullptr;
 }
 
-void InitializationChecker::report_error(SourceRange range, std::string_view message)
+void InitializationChecker::report_error(SourceRange range, DiagnosticMessage message)
 {
   hasErrors_ = true;
   errorCount_++;
   if (diags_) {
-    diags_->report_error(range, std::string(message));
+    diags_->report_error(range, std::move(message));
   }
 }
 
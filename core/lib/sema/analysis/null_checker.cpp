@@ -2,6 +2,7 @@
 //
 #include "bt_dsl/sema/analysis/null_checker.hpp"
 
+#include <algorithm>
 #include <deque>
 #include <optional>
 
@@ -67,13 +68,13 @@ std::optional<PortContract> get_port_contract(const NodeStmt * node, const Argum
 //
 // Intentionally conservative:
 // - For (a && b) == false, we do not infer facts (since !a || !b).
-std::string_view get_var_name_from_expr_local(const Expr * expr)
+const VarRefExpr * get_var_ref_from_expr_local(const Expr * expr)
 {
-  if (expr == nullptr) return {};
-  if (const auto * var = dyn_cast<VarRefExpr>(expr)) return var->name;
+  if (expr == nullptr) return nullptr;
+  if (const auto * var = dyn_cast<VarRefExpr>(expr)) return var;
   if (const auto * index_expr = dyn_cast<IndexExpr>(expr))
-    return get_var_name_from_expr_local(index_expr->base);
-  return {};
+    return get_var_ref_from_expr_local(index_expr->base);
+  return nullptr;
 }
 
 void apply_null_facts_from_condition(const Expr * expr, bool branch_truth, NullStateSet & state)
@@ -107,8 +108,8 @@ void apply_null_facts_from_condition(const Expr * expr, bool branch_truth, NullS
 
       if (var_expr == nullptr) return;
 
-      const std::string_view var_name = get_var_name_from_expr_local(var_expr);
-      if (var_name.empty()) return;
+      const VarRefExpr * var = get_var_ref_from_expr_local(var_expr);
+      if (var == nullptr) return;
 
       // Decide whether this branch implies var is NotNull.
       //
@@ -122,9 +123,9 @@ void apply_null_facts_from_condition(const Expr * expr, bool branch_truth, NullS
       const bool is_not_null_path = is_eq ? !implies_eq_holds : implies_eq_holds;
 
       if (is_not_null_path) {
-        state.insert(var_name);
+        state.insert(var->binding, var->resolvedSymbol);
       } else {
-        state.erase(var_name);
+        state.erase(var->binding, var->resolvedSymbol);
       }
       return;
     }
@@ -158,9 +159,8 @@ void erase_vars_referenced_by_null_condition(const Expr * expr, NullStateSet & s
 
       if (var_expr == nullptr) return;
 
-      const std::string_view var_name = get_var_name_from_expr_local(var_expr);
-      if (!var_name.empty()) {
-        state.erase(var_name);
+      if (const VarRefExpr * var = get_var_ref_from_expr_local(var_expr)) {
+        state.erase(var->binding, var->resolvedSymbol);
       }
       return;
     }
@@ -169,6 +169,66 @@ void erase_vars_referenced_by_null_condition(const Expr * expr, NullStateSet & s
 
 }  // namespace
 
+// ============================================================================
+// NullStateSet
+// ============================================================================
+
+void NullStateSet::insert(ResolvedBinding binding, const Symbol * sym)
+{
+  if (binding.is_local_slot()) {
+    if (local.size() <= binding.slot) {
+      local.resize(static_cast<size_t>(binding.slot) + 1, false);
+    }
+    local[binding.slot] = true;
+  } else if (binding.is_imported() && sym != nullptr) {
+    if (std::find(imported.begin(), imported.end(), sym) == imported.end()) {
+      imported.push_back(sym);
+    }
+  }
+}
+
+void NullStateSet::erase(ResolvedBinding binding, const Symbol * sym)
+{
+  if (binding.is_local_slot()) {
+    if (binding.slot < local.size()) {
+      local[binding.slot] = false;
+    }
+  } else if (binding.is_imported()) {
+    imported.erase(std::remove(imported.begin(), imported.end(), sym), imported.end());
+  }
+}
+
+bool NullStateSet::contains(ResolvedBinding binding, const Symbol * sym) const
+{
+  if (binding.is_local_slot()) {
+    return binding.slot < local.size() && local[binding.slot];
+  }
+  if (binding.is_imported()) {
+    return std::find(imported.begin(), imported.end(), sym) != imported.end();
+  }
+  return false;
+}
+
+bool NullStateSet::intersect(const NullStateSet & other)
+{
+  bool changed = false;
+  for (size_t slot = 0; slot < local.size(); ++slot) {
+    if (local[slot] && (slot >= other.local.size() || !other.local[slot])) {
+      local[slot] = false;
+      changed = true;
+    }
+  }
+  for (auto it = imported.begin(); it != imported.end();) {
+    if (std::find(other.imported.begin(), other.imported.end(), *it) == other.imported.end()) {
+      it = imported.erase(it);
+      changed = true;
+    } else {
+      ++it;
+    }
+  }
+  return changed;
+}
+
 // ============================================================================
 // Constructor
 // ============================================================================
@@ -209,12 +269,13 @@ void NullChecker::check(const TreeDecl * tree, const CFG & cfg)
 
   // Initialize entry state: Non-nullable parameters/globals are "NotNull"
   NullStateSet entry_state;
+  entry_state.local.assign(values_.symbol_count(), false);
 
   // Parameters
   for (const auto * param : tree->params) {
     const bool is_nullable = (param && param->type) ? param->type->nullable : false;
     if (!is_nullable) {
-      entry_state.insert(param->name);
+      entry_state.insert(param->binding, nullptr);
     }
   }
 
@@ -236,7 +297,7 @@ void NullChecker::check(const TreeDecl * tree, const CFG & cfg)
         }
 
         if (!is_nullable) {
-          entry_state.insert(name);
+          entry_state.insert(ResolvedBinding{sym.slot, 0}, &sym);
         }
       }
     }
@@ -252,16 +313,7 @@ void NullChecker::check(const TreeDecl * tree, const CFG & cfg)
 // Merge function: Intersection (Must be NotNull on all paths)
 static bool merge_null_states(NullStateSet & target, const NullStateSet & source)
 {
-  bool changed = false;
-  for (auto it = target.begin(); it != target.end();) {
-    if (source.find(*it) == source.end()) {
-      it = target.erase(it);
-      changed = true;
-    } else {
-      ++it;
-    }
-  }
-  return changed;
+  return target.intersect(source);
 }
 
 void NullChecker::analyze_data_flow(const CFG & cfg, NullStateSet & initial_state)
@@ -380,21 +432,23 @@ void NullChecker::transfer_edge(
             continue;
           }
 
-          std::string_view name;
+          ResolvedBinding binding;
+          const Symbol * sym = nullptr;
           if (arg->inlineDecl != nullptr) {
-            name = arg->inlineDecl->name;
-          } else {
-            name = get_var_name_from_expr(arg->valueExpr);
+            binding = arg->inlineDecl->binding;
+          } else if (const VarRefExpr * var = get_var_ref_from_expr(arg->valueExpr)) {
+            binding = var->binding;
+            sym = var->resolvedSymbol;
           }
 
-          if (name.empty()) continue;
+          if (!binding.is_valid()) continue;
 
           if (contract->isNullable) {
             // out T? may write null even on Success; forget NotNull knowledge.
-            state.erase(name);
+            state.erase(binding, sym);
           } else {
             // out T guarantees non-null on Success.
-            state.insert(name);
+            state.insert(binding, sym);
           }
         }
       }
@@ -454,10 +508,10 @@ void NullChecker::check_stmt(const Stmt * stmt, NullStateSet & state, bool repor
         // Also, assigning null to any target invalidates NotNull knowledge.
         const bool assigned_null = isa<NullLiteralExpr>(assign->value);
         if (assigned_null || target_is_declared_nullable) {
-          state.erase(assign->target);
+          state.erase(assign->targetBinding, assign->resolvedTarget);
         } else {
           // Non-nullable targets remain NotNull.
-          state.insert(assign->target);
+          state.insert(assign->targetBinding, assign->resolvedTarget);
         }
       }
       break;
@@ -469,15 +523,15 @@ void NullChecker::check_stmt(const Stmt * stmt, NullStateSet & state, bool repor
       // See AssignmentStmt notes above: nullable declarations are not treated as NotNull
       // even if initialized with a non-null value.
       if (is_declared_nullable) {
-        state.erase(decl->name);
+        state.erase(decl->binding, nullptr);
         break;
       }
 
       // Non-nullable locals: treat as NotNull when initialized with a non-null literal.
       if (decl->initialValue && !isa<NullLiteralExpr>(decl->initialValue)) {
-        state.insert(decl->name);
+        state.insert(decl->binding, nullptr);
       } else {
-        state.erase(decl->name);
+        state.erase(decl->binding, nullptr);
       }
       break;
     }
@@ -485,9 +539,9 @@ void NullChecker::check_stmt(const Stmt * stmt, NullStateSet & state, bool repor
       const auto * decl = cast<ConstDeclStmt>(stmt);
       const bool is_declared_nullable = (decl->type != nullptr) ? decl->type->nullable : false;
       if (!is_declared_nullable && !isa<NullLiteralExpr>(decl->value)) {
-        state.insert(decl->name);
+        state.insert(decl->binding, nullptr);
       } else {
-        state.erase(decl->name);
+        state.erase(decl->binding, nullptr);
       }
       break;
     }
@@ -517,8 +571,7 @@ void NullChecker::check_node_args(const NodeStmt * node, const NullStateSet & st
       continue;
     }
 
-    const std::string_view name = get_var_name_from_expr(arg->valueExpr);
-    if (!name.empty()) {
+    if (const VarRefExpr * var = get_var_ref_from_expr(arg->valueExpr)) {
       // Check if the expression's resolved type is nullable.
       // We rely on TypeChecker to have already resolved types (including inference).
       // If the type is known and non-nullable, we can skip the check.
@@ -528,32 +581,33 @@ void NullChecker::check_node_args(const NodeStmt * node, const NullStateSet & st
       }
 
       if (should_check) {
-        if (state.find(name) == state.end()) {
-          report_error(
-            arg->get_range(), std::string("Variable '") + std::string(name) + "' may be null");
+        if (!state.contains(var->binding, var->resolvedSymbol)) {
+          report_error(arg->get_range(), [&] {
+            return DiagnosticMessage::format("Variable '{}' may be null", var->name);
+          });
         }
       }
     }
   }
 }
 
-std::string_view NullChecker::get_var_name_from_expr(const Expr * expr)
+const VarRefExpr * NullChecker::get_var_ref_from_expr(const Expr * expr)
 {
-  if (expr == nullptr) return {};
+  if (expr == nullptr) return nullptr;
   if (const auto * var = dyn_cast<VarRefExpr>(expr)) {
-    if (var->resolvedSymbol == nullptr) return {};
-    return var->name;
+    if (var->resolvedSymbol == nullptr) return nullptr;
+    return var;
   }
   if (const auto * index_expr = dyn_cast<IndexExpr>(expr))
-    return get_var_name_from_expr(index_expr->base);
-  return {};
+    return get_var_ref_from_expr(index_expr->base);
+  return nullptr;
 }
 
-void NullChecker::report_error(SourceRange range, std::string_view message)
+void NullChecker::report_error(SourceRange range, DiagnosticMessage message)
 {
   has_errors_ = true;
   error_count_++;
-  if (diags_) diags_->report_error(range, std::string(message));
+  if (diags_) diags_->report_error(range, std::move(message));
 }
 
 }  // namespace bt_dsl
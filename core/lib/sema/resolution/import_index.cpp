@@ -0,0 +1,93 @@
+// bt_dsl/sema/import_index.cpp - Merged import visibility table implementation
+//
+#include "bt_dsl/sema/resolution/import_index.hpp"
+
+#include "bt_dsl/sema/resolution/module_graph.hpp"
+
+namespace bt_dsl
+{
+
+namespace
+{
+
+template <typename Map, typename SymbolT>
+void add_candidate(Map & map, std::string_view name, const SymbolT * sym)
+{
+  if (!ModuleInfo::is_public(name)) {
+    return;
+  }
+
+  auto [it, inserted] = map.try_emplace(name);
+  if (inserted) {
+    it->second.symbol = sym;
+  } else if (it->second.symbol != sym) {
+    // A second import exporting the same name is ambiguous, but the same
+    // module listed twice still yields a single declaration.
+    it->second.ambiguous = true;
+  }
+}
+
+template <typename Map>
+auto find_entry(const Map & map, std::string_view name) -> const typename Map::mapped_type *
+{
+  auto it = map.find(name);
+  return it != map.end() ? &it->second : nullptr;
+}
+
+}  // namespace
+
+// ============================================================================
+// Construction
+// ============================================================================
+
+void ImportIndex::build(const std::vector<ModuleInfo *> & imports)
+{
+  clear();
+
+  for (const auto * imported : imports) {
+    if (!imported) continue;
+
+    for (const auto & [name, sym] : imported->types.get_symbols()) {
+      if (sym.is_builtin) continue;
+      add_candidate(types_, name, &sym);
+    }
+
+    for (const auto & [name, sym] : imported->nodes.get_symbols()) {
+      add_candidate(nodes_, name, &sym);
+    }
+
+    if (const Scope * global_scope = imported->values.get_global_scope()) {
+      for (const auto & [name, sym] : global_scope->get_symbols()) {
+        add_candidate(values_, name, &sym);
+      }
+    }
+  }
+}
+
+void ImportIndex::clear()
+{
+  types_.clear();
+  nodes_.clear();
+  values_.clear();
+}
+
+// ============================================================================
+// Lookup
+// ============================================================================
+
+const ImportEntry<TypeSymbol> * ImportIndex::find_type(std::string_view name) const
+{
+  return find_entry(types_, name);
+}
+
+const ImportEntry<NodeSymbol> * ImportIndex::find_node(std::string_view name) const
+{
+  return find_entry(nodes_, name);
+}
+
+const ImportEntry<Symbol> * ImportIndex::find_value(std::string_view name) const
+{
+  return find_entry(values_, name);
+}
+
+}  // namespace bt_dsl
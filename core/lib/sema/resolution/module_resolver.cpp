@@ -256,7 +256,7 @@ ModuleInfo * ModuleResolver::parse_file(const std::filesystem::path & path)
     }
     if (module->parse_diags.has_errors()) {
       has_errors_ = true;
-      error_count_ += module->parse_diags.errors().size();
+      error_count_ += module->parse_diags.error_count();
     }
   }
 
@@ -298,23 +298,23 @@ bool ModuleResolver::register_declarations(ModuleInfo & module)
 // Error Reporting
 // ============================================================================
 
-void ModuleResolver::report_error(SourceRange range, std::string_view message)
+void ModuleResolver::report_error(SourceRange range, DiagnosticMessage message)
 {
   has_errors_ = true;
   error_count_++;
 
   if (diags_) {
-    diags_->report_error(range, std::string(message));
+    diags_->report_error(range, std::move(message));
   }
 }
 
-void ModuleResolver::report_error(const std::filesystem::path & file, std::string_view message)
+void ModuleResolver::report_error(const std::filesystem::path & file, DiagnosticMessage message)
 {
   has_errors_ = true;
   error_count_++;
 
   if (diags_) {
-    diags_->report_error(SourceRange{}, std::string(message))
+    diags_->report_error(SourceRange{}, std::move(message))
       .with_secondary_label(SourceRange{}, file.string());
   }
 }
@@ -22,6 +22,10 @@ bool NameResolver::resolve()
 
   const Program & program = *module_.program;
 
+  // Merge the public names of all direct imports once, so each imported
+  // lookup below is a single probe.
+  module_.import_index.build(module_.imports);
+
   // Start from global scope
   current_scope_ = module_.values.get_global_scope();
 
@@ -78,27 +82,18 @@ const TypeSymbol * NameResolver::lookup_type(std::string_view name, SourceRange
     return sym;
   }
 
-  // 2. Collect from imports (public only)
-  std::vector<const TypeSymbol *> candidates;
-  for (auto * imported : module_.imports) {
-    if (const TypeSymbol * sym = imported->types.lookup(name)) {
-      if (ModuleInfo::is_public(name)) {
-        candidates.push_back(sym);
-      }
-    }
-  }
-
-  // 3. Check ambiguity
-  if (candidates.size() > 1) {
-    report_error(range, "ambiguous reference to type '" + std::string(name) + "'");
+  // 2. Imported public names (ambiguity precomputed)
+  const auto * entry = module_.import_index.find_type(name);
+  if (!entry) {
     return nullptr;
   }
-
-  if (!candidates.empty()) {
-    return candidates[0];
+  if (entry->ambiguous) {
+    report_error(range, [&] {
+      return DiagnosticMessage::format("ambiguous reference to type '{}'", name);
+    });
+    return nullptr;
   }
-
-  return nullptr;
+  return entry->symbol;
 }
 
 const NodeSymbol * NameResolver::lookup_node(std::string_view name, SourceRange range)
@@ -108,27 +103,18 @@ const NodeSymbol * NameResolver::lookup_node(std::string_view name, SourceRange
     return sym;
   }
 
-  // 2. Collect from imports (public only)
-  std::vector<const NodeSymbol *> candidates;
-  for (auto * imported : module_.imports) {
-    if (const NodeSymbol * sym = imported->nodes.lookup(name)) {
-      if (ModuleInfo::is_public(name)) {
-        candidates.push_back(sym);
-      }
-    }
-  }
-
-  // 3. Check ambiguity
-  if (candidates.size() > 1) {
-    report_error(range, "ambiguous reference to node '" + std::string(name) + "'");
+  // 2. Imported public names (ambiguity precomputed)
+  const auto * entry = module_.import_index.find_node(name);
+  if (!entry) {
     return nullptr;
   }
-
-  if (!candidates.empty()) {
-    return candidates[0];
+  if (entry->ambiguous) {
+    report_error(range, [&] {
+      return DiagnosticMessage::format("ambiguous reference to node '{}'", name);
+    });
+    return nullptr;
   }
-
-  return nullptr;
+  return entry->symbol;
 }
 
 const Symbol * NameResolver::lookup_value(std::string_view name, Scope * scope, SourceRange range)
@@ -138,30 +124,18 @@ const Symbol * NameResolver::lookup_value(std::string_view name, Scope * scope,
     return sym;
   }
 
-  // 2. Collect from imports (public only, global scope)
-  std::vector<const Symbol *> candidates;
-  for (auto * imported : module_.imports) {
-    Scope * global_scope = imported->values.get_global_scope();
-    if (global_scope) {
-      if (const Symbol * sym = global_scope->lookup_local(name)) {
-        if (ModuleInfo::is_public(name)) {
-          candidates.push_back(sym);
-        }
-      }
-    }
-  }
-
-  // 3. Check ambiguity
-  if (candidates.size() > 1) {
-    report_error(range, "ambiguous reference to '" + std::string(name) + "'");
+  // 2. Imported public globals (ambiguity precomputed)
+  const auto * entry = module_.import_index.find_value(name);
+  if (!entry) {
     return nullptr;
   }
-
-  if (!candidates.empty()) {
-    return candidates[0];
+  if (entry->ambiguous) {
+    report_error(range, [&] {
+      return DiagnosticMessage::format("ambiguous reference to '{}'", name);
+    });
+    return nullptr;
   }
-
-  return nullptr;
+  return entry->symbol;
 }
 
 namespace
@@ -206,7 +180,8 @@ void NameResolver::visit_var_ref_expr(VarRefExpr * node)
 {
   // First resolve within the current module. If it resolves to a local/global
   // symbol, we can enforce declaration-before-use (§4.2.4) using byte offsets.
-  if (const Symbol * sym = module_.values.resolve(node->name, current_scope_)) {
+  if (const Symbol * sym =
+        module_.values.resolve_binding(node->name, current_scope_, node->binding)) {
     if (violates_value_forward_reference(*sym, node->get_range())) {
       report_error(node->get_range(), "use of identifier before declaration");
     }
@@ -217,12 +192,13 @@ void NameResolver::visit_var_ref_expr(VarRefExpr * node)
   // Otherwise, try imported modules (no forward-reference rule across modules).
   const Symbol * sym = lookup_value(node->name, current_scope_, node->get_range());
   if (!sym) {
-    report_error(
-      node->get_range(),
-      std::string("use of undeclared identifier '") + std::string(node->name) + "'");
+    report_error(node->get_range(), [&] {
+      return DiagnosticMessage::format("use of undeclared identifier '{}'", node->name);
+    });
     return;
   }
   node->resolvedSymbol = sym;
+  node->binding = imported_binding(sym);
 }
 
 void NameResolver::visit_binary_expr(BinaryExpr * node)
@@ -274,8 +250,9 @@ void NameResolver::visit_primary_type(PrimaryType * node)
 {
   const TypeSymbol * sym = lookup_type(node->name, node->get_range());
   if (!sym) {
-    report_error(
-      node->get_range(), std::string("use of undeclared type '") + std::string(node->name) + "'");
+    report_error(node->get_range(), [&] {
+      return DiagnosticMessage::format("use of undeclared type '{}'", node->name);
+    });
     return;
   }
   node->resolvedType = sym;
@@ -305,9 +282,9 @@ void NameResolver::visit_node_stmt(NodeStmt * node)
   // Resolve node name
   const NodeSymbol * sym = lookup_node(node->nodeName, node->get_range());
   if (!sym) {
-    report_error(
-      node->get_range(),
-      std::string("use of undeclared node '") + std::string(node->nodeName) + "'");
+    report_error(node->get_range(), [&] {
+      return DiagnosticMessage::format("use of undeclared node '{}'", node->nodeName);
+    });
   } else {
     node->resolvedNode = sym;
   }
@@ -339,7 +316,8 @@ void NameResolver::visit_node_stmt(NodeStmt * node)
 void NameResolver::visit_assignment_stmt(AssignmentStmt * node)
 {
   // Resolve target
-  if (const Symbol * sym = module_.values.resolve(node->target, current_scope_)) {
+  if (const Symbol * sym =
+        module_.values.resolve_binding(node->target, current_scope_, node->targetBinding)) {
     if (violates_value_forward_reference(*sym, node->get_range())) {
       report_error(node->get_range(), "use of identifier before declaration");
     }
@@ -347,11 +325,12 @@ void NameResolver::visit_assignment_stmt(AssignmentStmt * node)
   } else {
     const Symbol * imported = lookup_value(node->target, current_scope_, node->get_range());
     if (!imported) {
-      report_error(
-        node->get_range(),
-        std::string("use of undeclared identifier '") + std::string(node->target) + "'");
+      report_error(node->get_range(), [&] {
+        return DiagnosticMessage::format("use of undeclared identifier '{}'", node->target);
+      });
     } else {
       node->resolvedTarget = imported;
+      node->targetBinding = imported_binding(imported);
     }
   }
 
@@ -372,7 +351,8 @@ void NameResolver::visit_assignment_stmt(AssignmentStmt * node)
 void NameResolver::visit_blackboard_decl_stmt(BlackboardDeclStmt * node)
 {
   // Symbol already registered by SymbolTableBuilder
-  // Just resolve type and initializer expressions
+  // Record its binding, then resolve type and initializer expressions
+  node->binding = declaration_binding(node->name, node);
   if (node->type) visit(node->type);
   if (node->initialValue) visit(node->initialValue);
 }
@@ -380,7 +360,8 @@ void NameResolver::visit_blackboard_decl_stmt(BlackboardDeclStmt * node)
 void NameResolver::visit_const_decl_stmt(ConstDeclStmt * node)
 {
   // Symbol already registered by SymbolTableBuilder
-  // Just resolve type and value expressions
+  // Record its binding, then resolve type and value expressions
+  node->binding = declaration_binding(node->name, node);
   if (node->type) visit(node->type);
   if (node->value) visit(node->value);
 }
@@ -419,7 +400,12 @@ void NameResolver::visit_tree_decl(TreeDecl * node)
 
 void NameResolver::visit_argument(Argument * node)
 {
-  // Resolve value expression (inline decl symbol registered by SymbolTableBuilder)
+  // Inline decl symbol registered by SymbolTableBuilder
+  if (node->inlineDecl) {
+    node->inlineDecl->binding = declaration_binding(node->inlineDecl->name, node->inlineDecl);
+  }
+
+  // Resolve value expression
   if (node->valueExpr) {
     visit(node->valueExpr);
   }
@@ -434,6 +420,8 @@ void NameResolver::visit_precondition(Precondition * node)
 
 void NameResolver::visit_param_decl(ParamDecl * node)
 {
+  node->binding = declaration_binding(node->name, node);
+
   // Resolve type
   if (node->type) visit(node->type);
 
@@ -477,6 +465,23 @@ void NameResolver::pop_block_scope()
   }
 }
 
+ResolvedBinding NameResolver::declaration_binding(
+  std::string_view name, const AstNode * decl) const
+{
+  // Redefinitions are not registered; only the declaration owning the symbol gets a slot.
+  if (current_scope_) {
+    if (const Symbol * sym = current_scope_->lookup_local(name); sym && sym->astNode == decl) {
+      return ResolvedBinding{sym->slot, 0};
+    }
+  }
+  return {};
+}
+
+ResolvedBinding NameResolver::imported_binding(const Symbol * sym)
+{
+  return ResolvedBinding{sym->slot, ResolvedBinding::kImportedDepth};
+}
+
 bool NameResolver::check_shadowing(std::string_view name, SourceRange range)
 {
   // Check if name exists in any parent scope
@@ -493,13 +498,13 @@ bool NameResolver::check_shadowing(std::string_view name, SourceRange range)
   return false;
 }
 
-void NameResolver::report_error(SourceRange range, std::string_view message)
+void NameResolver::report_error(SourceRange range, DiagnosticMessage message)
 {
   has_errors_ = true;
   error_count_++;
 
   if (diags_) {
-    diags_->report_error(range, std::string(message));
+    diags_->report_error(range, std::move(message));
   }
 }
 
@@ -29,9 +29,11 @@ std::vector<std::string> SymbolTable::get_tree_names() const
 
 void SymbolTable::build_from_program(const Program & program)
 {
-  // Clear existing data
-  global_scope_ = std::make_unique<Scope>();
+  // Clear existing data (block scopes parent into the scopes being replaced)
+  block_scopes_.clear();
   tree_scopes_.clear();
+  slots_->clear();
+  global_scope_ = std::make_unique<Scope>(nullptr, slots_.get());
 
   // Register global variables
   for (const auto * var : program.global_vars()) {
@@ -66,7 +68,7 @@ void SymbolTable::build_from_program(const Program & program)
 
 void SymbolTable::build_tree_scope(const TreeDecl & tree)
 {
-  auto scope = std::make_unique<Scope>(global_scope_.get());
+  auto scope = std::make_unique<Scope>(global_scope_.get(), slots_.get());
 
   // Add parameters
   for (const auto * param : tree.params) {
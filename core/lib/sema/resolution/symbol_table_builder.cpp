@@ -301,13 +301,13 @@ bool SymbolTableBuilder::check_shadowing(std::string_view name, SourceRange rang
   return false;
 }
 
-void SymbolTableBuilder::report_error(SourceRange range, std::string_view message)
+void SymbolTableBuilder::report_error(SourceRange range, DiagnosticMessage message)
 {
   has_errors_ = true;
   ++error_count_;
 
   if (diags_ != nullptr) {
-    diags_->report_error(range, std::string(message));
+    diags_->report_error(range, std::move(message));
   }
 }
 
@@ -319,8 +319,7 @@ void SymbolTableBuilder::report_redefinition(
 
   if (diags_ != nullptr) {
     diags_
-      ->report_error(
-        range, std::string("redefinition of ") + std::string(kind) + " '" + std::string(name) + "'")
+      ->report_error(range, DiagnosticMessage::format("redefinition of {} '{}'", kind, name))
       .with_secondary_label(prev_range, "previous definition is here");
   }
 }
@@ -334,8 +333,7 @@ void SymbolTableBuilder::report_shadowing(
   if (diags_ != nullptr) {
     diags_
       ->report_error(
-        range,
-        std::string("declaration of '") + std::string(name) + "' shadows previous declaration")
+        range, DiagnosticMessage::format("declaration of '{}' shadows previous declaration", name))
       .with_secondary_label(prev_range, "previous declaration is here");
   }
 }
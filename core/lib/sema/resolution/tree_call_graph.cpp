@@ -0,0 +1,398 @@
+// bt_dsl/sema/tree_call_graph.cpp - Whole-program tree call graph implementation
+//
+#include "bt_dsl/sema/resolution/tree_call_graph.hpp"
+
+#include <algorithm>
+#include <unordered_set>
+
+#include "bt_dsl/basic/casting.hpp"
+#include "bt_dsl/sema/resolution/node_registry.hpp"
+
+namespace bt_dsl
+{
+
+namespace
+{
+
+void collect_calls_from_stmt(
+  const TreeDecl * caller, const Stmt * stmt, std::vector<TreeCall> & out)
+{
+  if (!stmt) return;
+
+  if (const auto * node = dyn_cast<NodeStmt>(stmt)) {
+    if (node->resolvedNode && node->resolvedNode->is_tree()) {
+      if (const auto * callee = cast<TreeDecl>(node->resolvedNode->decl)) {
+        out.push_back(TreeCall{caller, callee, node->get_range()});
+      }
+    }
+
+    for (const auto * child : node->children) {
+      collect_calls_from_stmt(caller, child, out);
+    }
+  }
+
+  // Other statements have no nested statements.
+}
+
+void erase_value(std::vector<const TreeDecl *> & v, const TreeDecl * value)
+{
+  v.erase(std::remove(v.begin(), v.end(), value), v.end());
+}
+
+}  // namespace
+
+// ============================================================================
+// Updates
+// ============================================================================
+
+bool TreeCallGraph::update_module(FileId owner, const Program & program)
+{
+  std::vector<const TreeDecl *> current;
+  current.reserve(program.trees().size());
+  for (const auto * t : program.trees()) {
+    if (t) current.push_back(t);
+  }
+
+  bool changed = false;
+  auto & registered = module_trees_[owner.value];
+
+  // Trees that disappeared from the module.
+  const std::unordered_set<const TreeDecl *> now(current.begin(), current.end());
+  for (const auto * old : registered) {
+    if (now.count(old) == 0) {
+      erase_tree(old);
+      changed = true;
+    }
+  }
+
+  for (const auto * t : current) {
+    TreeNode & node = get_or_create(t);
+    if (!node.declared || node.owner != owner) {
+      node.declared = true;
+      node.owner = owner;
+      dirty_.push_back(t);
+      changed = true;
+    }
+
+    std::vector<TreeCall> calls;
+    for (const auto * s : t->body) {
+      collect_calls_from_stmt(t, s, calls);
+    }
+    if (calls != node.calls) {
+      set_calls(t, node, std::move(calls));
+      changed = true;
+    }
+  }
+
+  registered = std::move(current);
+  return changed;
+}
+
+void TreeCallGraph::remove_module(FileId owner)
+{
+  auto it = module_trees_.find(owner.value);
+  if (it == module_trees_.end()) {
+    return;
+  }
+  for (const auto * t : it->second) {
+    erase_tree(t);
+  }
+  module_trees_.erase(it);
+}
+
+void TreeCallGraph::clear()
+{
+  trees_.clear();
+  module_trees_.clear();
+  components_.clear();
+  dirty_.clear();
+  next_order_ = 0;
+  next_component_ = 0;
+}
+
+TreeCallGraph::TreeNode & TreeCallGraph::get_or_create(const TreeDecl * tree)
+{
+  auto [it, inserted] = trees_.try_emplace(tree);
+  if (inserted) {
+    it->second.order = next_order_++;
+    dirty_.push_back(tree);
+  }
+  return it->second;
+}
+
+void TreeCallGraph::set_calls(const TreeDecl * tree, TreeNode & node, std::vector<TreeCall> calls)
+{
+  for (const auto & c : node.calls) {
+    auto it = trees_.find(c.callee);
+    if (it != trees_.end()) {
+      erase_value(it->second.callers, tree);
+    }
+  }
+
+  node.calls = std::move(calls);
+
+  for (const auto & c : node.calls) {
+    auto & callers = get_or_create(c.callee).callers;
+    if (std::find(callers.begin(), callers.end(), tree) == callers.end()) {
+      callers.push_back(tree);
+    }
+  }
+
+  dirty_.push_back(tree);
+}
+
+void TreeCallGraph::erase_tree(const TreeDecl * tree)
+{
+  auto it = trees_.find(tree);
+  if (it == trees_.end()) {
+    return;
+  }
+  TreeNode & node = it->second;
+
+  // Detach outgoing edges. Callees only known through them (their module was
+  // never added) go as well, so dropped ASTs leave no stale keys behind.
+  for (const auto & c : node.calls) {
+    auto callee_it = trees_.find(c.callee);
+    if (callee_it == trees_.end() || callee_it == it) {
+      continue;
+    }
+    TreeNode & callee = callee_it->second;
+    erase_value(callee.callers, tree);
+    if (!callee.declared && callee.callers.empty()) {
+      components_.erase(callee.component);
+      trees_.erase(callee_it);
+    }
+  }
+
+  // Drop incoming edges; those callers must be recomputed.
+  for (const auto * caller : node.callers) {
+    auto caller_it = trees_.find(caller);
+    if (caller == tree || caller_it == trees_.end()) continue;
+    auto & calls = caller_it->second.calls;
+    calls.erase(
+      std::remove_if(
+        calls.begin(), calls.end(), [tree](const TreeCall & c) { return c.callee == tree; }),
+      calls.end());
+    dirty_.push_back(caller);
+  }
+
+  // The rest of its component may split.
+  auto comp_it = components_.find(node.component);
+  if (comp_it != components_.end()) {
+    for (const auto * m : comp_it->second.members) {
+      if (m != tree) dirty_.push_back(m);
+    }
+    components_.erase(comp_it);
+  }
+
+  trees_.erase(it);
+}
+
+// ============================================================================
+// Strongly Connected Components
+// ============================================================================
+
+size_t TreeCallGraph::recompute()
+{
+  if (dirty_.empty()) {
+    return 0;
+  }
+
+  // Affected region: dirty trees, the rest of their old components, and
+  // everything forward-reachable from them. A new cycle through a changed
+  // edge only involves trees reachable from that edge, and components
+  // outside the region keep all of their edges, so they stay valid.
+  std::unordered_set<const TreeDecl *> region;
+  std::vector<const TreeDecl *> work;
+  auto seed = [&](const TreeDecl * t) {
+    if (trees_.count(t) > 0 && region.insert(t).second) {
+      work.push_back(t);
+    }
+  };
+
+  for (const auto * t : dirty_) {
+    seed(t);
+    auto it = trees_.find(t);
+    if (it == trees_.end()) continue;
+    auto comp_it = components_.find(it->second.component);
+    if (comp_it != components_.end()) {
+      for (const auto * m : comp_it->second.members) {
+        seed(m);
+      }
+    }
+  }
+  dirty_.clear();
+
+  while (!work.empty()) {
+    const TreeDecl * t = work.back();
+    work.pop_back();
+    for (const auto & c : trees_.at(t).calls) {
+      seed(c.callee);
+    }
+  }
+
+  for (const auto * t : region) {
+    TreeNode & node = trees_.at(t);
+    components_.erase(node.component);
+    node.component = k_no_component;
+  }
+
+  std::vector<const TreeDecl *> roots(region.begin(), region.end());
+  std::sort(roots.begin(), roots.end(), [this](const TreeDecl * a, const TreeDecl * b) {
+    return trees_.at(a).order < trees_.at(b).order;
+  });
+
+  // Iterative Tarjan over the region (forward-closed, so every callee is in it).
+  struct VisitState
+  {
+    uint32_t index = 0;
+    uint32_t lowlink = 0;
+    bool on_stack = false;
+  };
+  struct Frame
+  {
+    const TreeDecl * tree;
+    const TreeNode * node;
+    size_t next_call;
+  };
+
+  std::unordered_map<const TreeDecl *, VisitState> state;
+  state.reserve(region.size());
+  std::vector<const TreeDecl *> stack;
+  std::vector<Frame> frames;
+  uint32_t next_index = 0;
+
+  auto visit = [&](const TreeDecl * t) {
+    VisitState & s = state[t];
+    s.index = s.lowlink = next_index++;
+    s.on_stack = true;
+    stack.push_back(t);
+    frames.push_back(Frame{t, &trees_.at(t), 0});
+  };
+
+  for (const auto * root : roots) {
+    if (state.count(root) > 0) continue;
+    visit(root);
+
+    while (!frames.empty()) {
+      Frame & f = frames.back();
+      if (f.next_call < f.node->calls.size()) {
+        const TreeDecl * w = f.node->calls[f.next_call++].callee;
+        auto w_it = state.find(w);
+        if (w_it == state.end()) {
+          visit(w);
+        } else if (w_it->second.on_stack) {
+          VisitState & s = state[f.tree];
+          s.lowlink = std::min(s.lowlink, w_it->second.index);
+        }
+        continue;
+      }
+
+      const TreeDecl * done = f.tree;
+      const VisitState done_state = state[done];
+      frames.pop_back();
+
+      if (done_state.lowlink == done_state.index) {
+        Component comp;
+        const TreeDecl * m = nullptr;
+        do {
+          m = stack.back();
+          stack.pop_back();
+          state[m].on_stack = false;
+          comp.members.push_back(m);
+        } while (m != done);
+
+        std::sort(
+          comp.members.begin(), comp.members.end(), [this](const TreeDecl * a, const TreeDecl * b) {
+            return trees_.at(a).order < trees_.at(b).order;
+          });
+
+        const TreeNode & first = trees_.at(comp.members.front());
+        comp.recursive =
+          comp.members.size() > 1 ||
+          std::any_of(first.calls.begin(), first.calls.end(), [&](const TreeCall & c) {
+            return c.callee == comp.members.front();
+          });
+
+        const uint32_t id = next_component_++;
+        for (const auto * member : comp.members) {
+          trees_.at(member).component = id;
+        }
+        components_.emplace(id, std::move(comp));
+      }
+
+      if (!frames.empty()) {
+        VisitState & parent = state[frames.back().tree];
+        parent.lowlink = std::min(parent.lowlink, done_state.lowlink);
+      }
+    }
+  }
+
+  return region.size();
+}
+
+// ============================================================================
+// Queries
+// ============================================================================
+
+bool TreeCallGraph::contains(const TreeDecl * tree) const { return trees_.count(tree) > 0; }
+
+gsl::span<const TreeCall> TreeCallGraph::callees(const TreeDecl * tree) const
+{
+  auto it = trees_.find(tree);
+  if (it == trees_.end()) {
+    return {};
+  }
+  return {it->second.calls.data(), it->second.calls.size()};
+}
+
+std::vector<TreeCall> TreeCallGraph::callers(const TreeDecl * tree) const
+{
+  std::vector<TreeCall> out;
+  auto it = trees_.find(tree);
+  if (it == trees_.end()) {
+    return out;
+  }
+
+  std::vector<const TreeDecl *> callers = it->second.callers;
+  std::sort(callers.begin(), callers.end(), [this](const TreeDecl * a, const TreeDecl * b) {
+    return trees_.at(a).order < trees_.at(b).order;
+  });
+
+  for (const auto * caller : callers) {
+    for (const auto & c : trees_.at(caller).calls) {
+      if (c.callee == tree) out.push_back(c);
+    }
+  }
+  return out;
+}
+
+const TreeCallGraph::Component * TreeCallGraph::component_of(const TreeDecl * tree) const
+{
+  auto it = trees_.find(tree);
+  if (it == trees_.end()) {
+    return nullptr;
+  }
+  auto comp_it = components_.find(it->second.component);
+  return comp_it != components_.end() ? &comp_it->second : nullptr;
+}
+
+bool TreeCallGraph::is_recursive(const TreeDecl * tree) const
+{
+  const Component * comp = component_of(tree);
+  return comp && comp->recursive;
+}
+
+std::vector<const TreeCallGraph::Component *> TreeCallGraph::recursive_components() const
+{
+  std::vector<const Component *> out;
+  for (const auto & [id, comp] : components_) {
+    if (comp.recursive) out.push_back(&comp);
+  }
+  std::sort(out.begin(), out.end(), [this](const Component * a, const Component * b) {
+    return trees_.at(a->members.front()).order < trees_.at(b->members.front()).order;
+  });
+  return out;
+}
+
+}  // namespace bt_dsl
@@ -83,9 +83,11 @@ ConstCastTarget analyze_const_cast_target(TypeContext & type_ctx, const TypeNode
   return out;
 }
 
+/// `report_error(range, message)` receives either a literal or a message builder.
+template <typename ReportError>
 ConstValue convert_const_value_to_target(
   TypeContext & type_ctx, const ConstValue & val, const ConstCastTarget & target, SourceRange range,
-  const std::function<void(SourceRange, std::string_view)> & report_error)
+  const ReportError & report_error)
 {
   if (target.is_extern) {
     report_error(range, "cannot cast to extern type in constant expression");
@@ -125,8 +127,9 @@ ConstValue convert_const_value_to_target(
   if (dst->is_integer()) {
     auto i = val.to_integer();
     if (!i.has_value()) {
-      report_error(
-        range, "cannot cast value of type '" + to_string(val.type) + "' to integer type");
+      report_error(range, [&] {
+        return "cannot cast value of type '" + to_string(val.type) + "' to integer type";
+      });
       return ConstValue::make_error();
     }
     auto out = ConstValue::make_integer(*i);
@@ -137,7 +140,9 @@ ConstValue convert_const_value_to_target(
   if (dst->is_float()) {
     auto f = val.to_float();
     if (!f.has_value()) {
-      report_error(range, "cannot cast value of type '" + to_string(val.type) + "' to float type");
+      report_error(range, [&] {
+        return "cannot cast value of type '" + to_string(val.type) + "' to float type";
+      });
       return ConstValue::make_error();
     }
     auto out = ConstValue::make_float(*f);
@@ -148,7 +153,9 @@ ConstValue convert_const_value_to_target(
   // Bool casts (keep strict for now)
   if (dst->kind == TypeKind::Bool) {
     if (!val.is_bool()) {
-      report_error(range, "cannot cast value of type '" + to_string(val.type) + "' to bool");
+      report_error(range, [&] {
+        return "cannot cast value of type '" + to_string(val.type) + "' to bool";
+      });
       return ConstValue::make_error();
     }
     auto out = ConstValue::make_bool(val.as_bool());
@@ -159,7 +166,9 @@ ConstValue convert_const_value_to_target(
   // String casts (including bounded string)
   if (dst->is_string()) {
     if (!val.is_string()) {
-      report_error(range, "cannot cast value of type '" + to_string(val.type) + "' to string");
+      report_error(range, [&] {
+        return "cannot cast value of type '" + to_string(val.type) + "' to string";
+      });
       return ConstValue::make_error();
     }
     auto out = ConstValue::make_string(val.as_string());
@@ -167,8 +176,9 @@ ConstValue convert_const_value_to_target(
     return out;
   }
 
-  report_error(
-    range, "unsupported cast target type '" + to_string(target.type) + "' in constant expression");
+  report_error(range, [&] {
+    return "unsupported cast target type '" + to_string(target.type) + "' in constant expression";
+  });
   return ConstValue::make_error();
 }
 
@@ -402,8 +412,9 @@ ConstValue ConstEvaluator::eval_var_ref(const VarRefExpr * node)
   // Check for circular reference
   const Symbol * sym = node->resolvedSymbol;
   if (sym && evaluating_.count(sym)) {
-    report_error(
-      node->get_range(), "circular reference involving constant '" + std::string(sym->name) + "'");
+    report_error(node->get_range(), [&] {
+      return "circular reference involving constant '" + std::string(sym->name) + "'";
+    });
     return ConstValue::make_error();
   }
 
@@ -415,15 +426,17 @@ ConstValue ConstEvaluator::eval_var_ref(const VarRefExpr * node)
 
   // Get resolved symbol
   if (!sym) {
-    report_error(node->get_range(), "unresolved identifier '" + std::string(node->name) + "'");
+    report_error(node->get_range(), [&] {
+      return "unresolved identifier '" + std::string(node->name) + "'";
+    });
     return ConstValue::make_error();
   }
 
   // Must be a const
   if (!sym->is_const()) {
-    report_error(
-      node->get_range(),
-      "non-constant value '" + std::string(sym->name) + "' in constant expression");
+    report_error(node->get_range(), [&] {
+      return "non-constant value '" + std::string(sym->name) + "' in constant expression";
+    });
     return ConstValue::make_error();
   }
 
@@ -437,14 +450,18 @@ ConstValue ConstEvaluator::eval_var_ref(const VarRefExpr * node)
       const_cache_[sym] = gc->evaluatedValue;
       return *gc->evaluatedValue;
     }
-    gc_mut = const_cast<GlobalConstDecl *>(gc);
+    if (publish_results_) {
+      gc_mut = const_cast<GlobalConstDecl *>(gc);
+    }
     init_expr = gc->value;
   } else if (const auto * cs = dyn_cast<ConstDeclStmt>(sym->astNode)) {
     if (cs->evaluatedValue) {
       const_cache_[sym] = cs->evaluatedValue;
       return *cs->evaluatedValue;
     }
-    cs_mut = const_cast<ConstDeclStmt *>(cs);
+    if (publish_results_) {
+      cs_mut = const_cast<ConstDeclStmt *>(cs);
+    }
     init_expr = cs->value;
   }
 
@@ -461,8 +478,8 @@ ConstValue ConstEvaluator::eval_var_ref(const VarRefExpr * node)
   if (!val.is_error()) {
     const ConstValue * stored = store_in_arena(val);
     const_cache_[sym] = stored;
-    // Also publish to the declaration node so later phases (e.g., codegen)
-    // can use the evaluated value.
+    // Also publish to the declaration node (unless results are kept private)
+    // so later phases (e.g., codegen) can use the evaluated value.
     if (gc_mut) {
       gc_mut->evaluatedValue = stored;
     }
@@ -560,7 +577,9 @@ ConstValue ConstEvaluator::eval_cast_expr(const CastExpr * node)
 
   const ConstCastTarget target = analyze_const_cast_target(type_ctx_, node->targetType);
 
-  auto reporter = [&](SourceRange r, std::string_view msg) { report_error(r, msg); };
+  auto reporter = [&](SourceRange r, auto && message) {
+    report_error(r, std::forward<decltype(message)>(message));
+  };
   return convert_const_value_to_target(type_ctx_, val, target, node->get_range(), reporter);
 }
 
@@ -969,8 +988,9 @@ std::vector<const AstNode *> ConstEvaluator::build_evaluation_order(
     if (in_stack.count(name)) {
       // Cycle detected
       if (auto * gc = const_map[name]) {
-        report_error(
-          gc->get_range(), "circular dependency in constant '" + std::string(name) + "'");
+        report_error(gc->get_range(), [&] {
+          return "circular dependency in constant '" + std::string(name) + "'";
+        });
       }
       return false;
     }
@@ -1008,13 +1028,13 @@ const ConstValue * ConstEvaluator::get_const_for_symbol(const Symbol * sym)
   return get_const_value(sym);
 }
 
-void ConstEvaluator::report_error(SourceRange range, std::string_view message)
+void ConstEvaluator::report_error(SourceRange range, DiagnosticMessage message)
 {
   has_errors_ = true;
   error_count_++;
 
   if (diags_) {
-    diags_->report_error(range, std::string(message));
+    diags_->report_error(range, std::move(message));
   }
 }
 
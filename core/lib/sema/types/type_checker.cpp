@@ -362,6 +362,10 @@ bool TypeChecker::check(Program & program)
     (void)resolve_type(alias->aliasedType);
   }
 
+  // Declared signatures are resolved up front so call sites and later
+  // stages only read the memoized types.
+  resolve_signature_types(program);
+
   // Check global variable declarations
   for (auto * decl : program.global_vars()) {
     check_global_var_decl(decl);
@@ -380,6 +384,23 @@ bool TypeChecker::check(Program & program)
   return !has_errors_;
 }
 
+void TypeChecker::resolve_signature_types(Program & program)
+{
+  for (const auto * ext : program.externs()) {
+    if (!ext) continue;
+    for (const auto * port : ext->ports) {
+      if (port && port->type) (void)resolve_type(port->type);
+    }
+  }
+
+  for (const auto * tree : program.trees()) {
+    if (!tree) continue;
+    for (const auto * param : tree->params) {
+      if (param && param->type) (void)resolve_type(param->type);
+    }
+  }
+}
+
 const Type * TypeChecker::check_expr(Expr * expr)
 {
   return check_expr_with_expected(expr, nullptr);
@@ -670,9 +691,10 @@ const Type * TypeChecker::infer_binary_expr(BinaryExpr * node, const Type * /*ex
       }
       const Type * common = common_numeric_type(types_, lhs_type, rhs_type);
       if (!common) {
-        report_error(
-          node->get_range(), std::string("incompatible operand types for arithmetic operation: '") +
-                               to_string(lhs_type) + "' and '" + to_string(rhs_type) + "'");
+        report_error(node->get_range(), [&] {
+          return std::string("incompatible operand types for arithmetic operation: '") +
+                 to_string(lhs_type) + "' and '" + to_string(rhs_type) + "'";
+        });
         return types_.error_type();
       }
       return common;
@@ -969,9 +991,10 @@ void TypeChecker::check_node_stmt(NodeStmt * node)
 
     // If we have a signature but the port name is unknown, report it.
     if (node->resolvedNode && node->resolvedNode->decl && !has_signature) {
-      report_error(
-        arg->get_range(), std::string("Unknown port '") + std::string(arg->name) + "' for node '" +
-                            std::string(node->nodeName) + "'");
+      report_error(arg->get_range(), [&] {
+        return DiagnosticMessage::format(
+          "Unknown port '{}' for node '{}'", arg->name, node->nodeName);
+      });
       // Still type-check the expression for better error recovery.
       if (arg->valueExpr) check_expr(arg->valueExpr);
       continue;
@@ -983,10 +1006,10 @@ void TypeChecker::check_node_stmt(NodeStmt * node)
     if (arg->is_inline_decl()) {
       // Keep behavior close to reference: inline decl is only for out ports.
       if (has_signature && port_dir != PortDirection::Out) {
-        report_error(
-          arg->inlineDecl->get_range(),
-          std::string("Inline declaration is only allowed for 'out' ports (port '") +
-            std::string(arg->name) + "' is not out)");
+        report_error(arg->inlineDecl->get_range(), [&] {
+          return std::string("Inline declaration is only allowed for 'out' ports (port '") +
+                 std::string(arg->name) + "' is not out)";
+        });
       }
       // Direction marker is implicitly out for inline decl.
       if (arg_dir != PortDirection::Out) {
@@ -999,16 +1022,17 @@ void TypeChecker::check_node_stmt(NodeStmt * node)
 
     // Spec 6.4.3: explicit ref/mut/out argument markers require an lvalue.
     if (arg_dir != PortDirection::In && !is_lvalue_expr(arg->valueExpr)) {
-      report_error(
-        arg->get_range(), std::string("Direction '") + std::string(to_string(arg_dir)) +
-                            "' requires an lvalue argument");
+      report_error(arg->get_range(), [&] {
+        return std::string("Direction '") + std::string(to_string(arg_dir)) +
+               "' requires an lvalue argument";
+      });
     }
 
     // Spec 6.4.3: ref/mut/out ports require an lvalue argument.
     if (has_signature && port_requires_lvalue(port_dir) && !is_lvalue_expr(arg->valueExpr)) {
-      report_error(
-        arg->get_range(),
-        std::string("Port '") + std::string(arg->name) + "' requires an lvalue argument");
+      report_error(arg->get_range(), [&] {
+        return std::string("Port '") + std::string(arg->name) + "' requires an lvalue argument";
+      });
       // Don't attempt type/direction checks further; expression isn't a legal argument here.
       continue;
     }
@@ -1022,15 +1046,16 @@ void TypeChecker::check_node_stmt(NodeStmt * node)
         if (
           (arg_dir == PortDirection::Mut || arg_dir == PortDirection::Out) &&
           (param_dir == PortDirection::In || param_dir == PortDirection::Ref)) {
-          report_error(
-            arg->get_range(), std::string("Tree parameter '") + std::string(base_sym->name) +
-                                "' cannot be passed with '" + std::string(to_string(arg_dir)) +
-                                "' direction");
+          report_error(arg->get_range(), [&] {
+            return std::string("Tree parameter '") + std::string(base_sym->name) +
+                   "' cannot be passed with '" + std::string(to_string(arg_dir)) + "' direction";
+          });
         }
         if (arg_dir == PortDirection::Ref && param_dir == PortDirection::Out) {
-          report_error(
-            arg->get_range(), std::string("Tree parameter '") + std::string(base_sym->name) +
-                                "' declared as 'out' cannot be passed with 'ref' direction");
+          report_error(arg->get_range(), [&] {
+            return std::string("Tree parameter '") + std::string(base_sym->name) +
+                   "' declared as 'out' cannot be passed with 'ref' direction";
+          });
         }
       }
     }
@@ -1040,10 +1065,11 @@ void TypeChecker::check_node_stmt(NodeStmt * node)
     if (has_signature) {
       const DirDiagKind m = check_dir_matrix(arg_dir, port_dir);
       if (m == DirDiagKind::Error) {
-        report_error(
-          arg->get_range(), std::string("Direction mismatch: port '") + std::string(arg->name) +
-                              "' is '" + std::string(to_string(port_dir)) + "' but argument is '" +
-                              std::string(to_string(arg_dir)) + "'.");
+        report_error(arg->get_range(), [&] {
+          return std::string("Direction mismatch: port '") + std::string(arg->name) + "' is '" +
+                 std::string(to_string(port_dir)) + "' but argument is '" +
+                 std::string(to_string(arg_dir)) + "'.";
+        });
         dir_mismatch_error = true;
       } else if (m == DirDiagKind::Warning) {
         if (diags_) {
@@ -1071,10 +1097,11 @@ void TypeChecker::check_node_stmt(NodeStmt * node)
       if (port_dir == PortDirection::In) {
         const Type * expr_type = check_expr_with_expected(arg->valueExpr, expected_type);
         if (!is_assignable_for_port_check(expected_type, expr_type)) {
-          report_error(
-            arg->get_range(), std::string("Type mismatch: cannot assign '") + to_string(expr_type) +
-                                "' to port '" + std::string(arg->name) + "' of type '" +
-                                to_string(expected_type) + "'");
+          report_error(arg->get_range(), [&] {
+            return std::string("Type mismatch: cannot assign '") + to_string(expr_type) +
+                   "' to port '" + std::string(arg->name) + "' of type '" +
+                   to_string(expected_type) + "'";
+          });
         }
       } else {
         // For out/ref/mut, the signature can constrain the lvalue variable type.
@@ -1110,11 +1137,11 @@ void TypeChecker::check_node_stmt(NodeStmt * node)
               break;
           }
           if (!ok) {
-            report_error(
-              arg->get_range(), std::string("Type mismatch: argument of type '") +
-                                  to_string(lv_type) + "' is incompatible with port '" +
-                                  std::string(arg->name) + "' of type '" +
-                                  to_string(expected_type) + "'");
+            report_error(arg->get_range(), [&] {
+              return std::string("Type mismatch: argument of type '") + to_string(lv_type) +
+                     "' is incompatible with port '" + std::string(arg->name) + "' of type '" +
+                     to_string(expected_type) + "'";
+            });
           }
         }
       }
@@ -1160,9 +1187,9 @@ void TypeChecker::check_node_stmt(NodeStmt * node)
       }();
 
       if (required) {
-        report_error(
-          node->get_range(),
-          std::string("missing required ") + std::string(kind) + " '" + std::string(p_name) + "'");
+        report_error(node->get_range(), [&] {
+          return DiagnosticMessage::format("missing required {} '{}'", kind, p_name);
+        });
       }
     };
 
@@ -1182,16 +1209,9 @@ void TypeChecker::check_node_stmt(NodeStmt * node)
   }
 
   // Recursively check children
-  const Scope * prev_scope = current_scope_;
-  if (node->resolvedBlockScope) {
-    current_scope_ = node->resolvedBlockScope;
-  }
-
   for (auto * child : node->children) {
     check_stmt(child);
   }
-
-  current_scope_ = prev_scope;
 }
 
 void TypeChecker::check_assignment_stmt(AssignmentStmt * node)
@@ -1247,15 +1267,16 @@ void TypeChecker::check_assignment_stmt(AssignmentStmt * node)
   // Verify assignment compatibility
   if (target_type && value_type && !is_assignable(target_type, value_type)) {
     const SourceRange rhs_range = node->value ? node->value->get_range() : node->get_range();
-    report_error(
-      rhs_range, std::string("type mismatch in assignment: cannot assign '") +
-                   to_string(value_type) + "' to '" + to_string(target_type) + "'");
+    report_error(rhs_range, [&] {
+      return std::string("type mismatch in assignment: cannot assign '") + to_string(value_type) +
+             "' to '" + to_string(target_type) + "'";
+    });
   }
 }
 
 void TypeChecker::check_blackboard_decl_stmt(BlackboardDeclStmt * node)
 {
-  const Symbol * sym = (current_scope_ ? current_scope_->lookup_local(node->name) : nullptr);
+  const Symbol * sym = values_.symbol_at(node->binding);
 
   // Get declared type if any
   const Type * declared_type = nullptr;
@@ -1277,10 +1298,10 @@ void TypeChecker::check_blackboard_decl_stmt(BlackboardDeclStmt * node)
     }
 
     if (declared_type && !declared_is_infer && !is_assignable(declared_type, init_type)) {
-      report_error(
-        node->initialValue->get_range(),
-        std::string("initializer type mismatch: cannot initialize '") + to_string(declared_type) +
-          "' with '" + to_string(init_type) + "'");
+      report_error(node->initialValue->get_range(), [&] {
+        return std::string("initializer type mismatch: cannot initialize '") +
+               to_string(declared_type) + "' with '" + to_string(init_type) + "'";
+      });
     }
 
     // var inference: no declared type or wildcard declared type.
@@ -1315,10 +1336,10 @@ void TypeChecker::check_const_decl_stmt(ConstDeclStmt * node)
   }
 
   if (declared_type && !is_assignable(declared_type, value_type)) {
-    report_error(
-      node->value->get_range(),
-      std::string("const initializer type mismatch: cannot initialize '") +
-        to_string(declared_type) + "' with '" + to_string(value_type) + "'");
+    report_error(node->value->get_range(), [&] {
+      return std::string("const initializer type mismatch: cannot initialize '") +
+             to_string(declared_type) + "' with '" + to_string(value_type) + "'";
+    });
   }
 }
 
@@ -1329,9 +1350,6 @@ void TypeChecker::check_tree_decl(TreeDecl * decl)
   infer_parent_.clear();
   unresolved_vars_.clear();
 
-  const Scope * prev_scope = current_scope_;
-  current_scope_ = values_.get_tree_scope(decl->name);
-
   // Check each statement in the tree body
   for (auto * stmt : decl->body) {
     check_stmt(stmt);
@@ -1345,14 +1363,12 @@ void TypeChecker::check_tree_decl(TreeDecl * decl)
     const auto it = inferred_symbol_types_.find(sym);
     const Type * t = (it != inferred_symbol_types_.end()) ? it->second : nullptr;
     if (contains_unknown(t)) {
-      report_error(
-        sym->definitionRange,
-        std::string("could not infer type of variable '") + std::string(sym->name) + "'");
+      report_error(sym->definitionRange, [&] {
+        return DiagnosticMessage::format("could not infer type of variable '{}'", sym->name);
+      });
     }
   }
 
-  current_scope_ = prev_scope;
-
   // Spec 6.3.2: warn on mut/out tree parameters never used for writing.
   warn_unused_write_params(decl, diags_);
 }
@@ -1381,10 +1397,10 @@ void TypeChecker::check_global_var_decl(GlobalVarDecl * decl)
         report_error(decl->initialValue->get_range(), "initializer type mismatch");
       }
     } else if (declared_type && !is_assignable(declared_type, init_type)) {
-      report_error(
-        decl->initialValue->get_range(),
-        std::string("initializer type mismatch: cannot initialize '") + to_string(declared_type) +
-          "' with '" + to_string(init_type) + "'");
+      report_error(decl->initialValue->get_range(), [&] {
+        return std::string("initializer type mismatch: cannot initialize '") +
+               to_string(declared_type) + "' with '" + to_string(init_type) + "'";
+      });
     }
   }
 }
@@ -1404,10 +1420,10 @@ void TypeChecker::check_global_const_decl(GlobalConstDecl * decl)
   }
 
   if (declared_type && !is_assignable(declared_type, value_type)) {
-    report_error(
-      decl->value->get_range(),
-      std::string("const initializer type mismatch: cannot initialize '") +
-        to_string(declared_type) + "' with '" + to_string(value_type) + "'");
+    report_error(decl->value->get_range(), [&] {
+      return std::string("const initializer type mismatch: cannot initialize '") +
+             to_string(declared_type) + "' with '" + to_string(value_type) + "'";
+    });
   }
 }
 
@@ -1440,15 +1456,17 @@ const Type * TypeChecker::resolve_type(const TypeNode * node)
     const Scope * global = values_.get_global_scope();
     const Symbol * sym = global ? global->lookup(token) : nullptr;
     if (!sym) {
-      report_error(
-        range, std::string("Unknown identifier '") + std::string(token) + "' used as " +
-                 std::string(what));
+      report_error(range, [&] {
+        return std::string("Unknown identifier '") + std::string(token) + "' used as " +
+               std::string(what);
+      });
       return std::nullopt;
     }
     if (!sym->is_const()) {
-      report_error(
-        range, std::string("Identifier '") + std::string(token) + "' used as " + std::string(what) +
-                 " must be a const");
+      report_error(range, [&] {
+        return std::string("Identifier '") + std::string(token) + "' used as " + std::string(what) +
+               " must be a const";
+      });
       return std::nullopt;
     }
 
@@ -1461,20 +1479,24 @@ const Type * TypeChecker::resolve_type(const TypeNode * node)
       }
     }
     if (!cv || cv->is_error()) {
-      report_error(
-        range, std::string("Identifier '") + std::string(token) + "' used as " + std::string(what) +
-                 " is not a constant integer");
+      report_error(range, [&] {
+        return std::string("Identifier '") + std::string(token) + "' used as " + std::string(what) +
+               " is not a constant integer";
+      });
       return std::nullopt;
     }
     if (!cv->is_integer()) {
-      report_error(
-        range, std::string("Identifier '") + std::string(token) + "' used as " + std::string(what) +
-                 " must be an integer constant");
+      report_error(range, [&] {
+        return std::string("Identifier '") + std::string(token) + "' used as " + std::string(what) +
+               " must be an integer constant";
+      });
       return std::nullopt;
     }
     const int64_t v = cv->as_integer();
     if (v < 0) {
-      report_error(range, std::string(what) + " must be a non-negative integer");
+      report_error(range, [&] {
+        return std::string(what) + " must be a non-negative integer";
+      });
       return std::nullopt;
     }
     return static_cast<uint64_t>(v);
@@ -1482,7 +1504,8 @@ const Type * TypeChecker::resolve_type(const TypeNode * node)
 
   std::vector<const TypeAliasDecl *> alias_stack;
 
-  std::function<const Type *(const TypeNode *)> go = [&](const TypeNode * n) -> const Type * {
+  std::function<const Type *(const TypeNode *)> go;
+  auto compute = [&](const TypeNode * n) -> const Type * {
     if (!n) return types_.error_type();
 
     switch (n->get_kind()) {
@@ -1506,8 +1529,11 @@ const Type * TypeChecker::resolve_type(const TypeNode * node)
           return builtin;
         }
 
-        // User-defined / extern / alias types.
-        if (const TypeSymbol * sym = type_table_.lookup(primary->name)) {
+        // User-defined / extern / alias types. Prefer the binding recorded by
+        // NameResolver so imported types resolve the same way in every module.
+        const TypeSymbol * sym =
+          primary->resolvedType ? primary->resolvedType : type_table_.lookup(primary->name);
+        if (sym) {
           if (sym->is_extern_type()) {
             return types_.get_extern_type(sym->name, sym->decl);
           }
@@ -1523,13 +1549,15 @@ const Type * TypeChecker::resolve_type(const TypeNode * node)
 
               const TypeAliasDecl * anchor = alias_stack[i];
               if (reported_alias_cycles_.insert(anchor).second) {
-                std::string msg = "circular type alias is not allowed: ";
-                for (size_t j = i; j < alias_stack.size(); ++j) {
-                  msg += std::string(alias_stack[j]->name);
-                  msg += " -> ";
-                }
-                msg += std::string(alias_decl->name);
-                report_error(primary->get_range(), msg);
+                report_error(primary->get_range(), [&] {
+                  std::string msg = "circular type alias is not allowed: ";
+                  for (size_t j = i; j < alias_stack.size(); ++j) {
+                    msg += std::string(alias_stack[j]->name);
+                    msg += " -> ";
+                  }
+                  msg += std::string(alias_decl->name);
+                  return msg;
+                });
               }
               return types_.error_type();
             }
@@ -1541,8 +1569,9 @@ const Type * TypeChecker::resolve_type(const TypeNode * node)
           }
         }
 
-        report_error(
-          primary->get_range(), std::string("Unknown type '") + std::string(primary->name) + "'");
+        report_error(primary->get_range(), [&] {
+          return DiagnosticMessage::format("Unknown type '{}'", primary->name);
+        });
         return types_.error_type();
       }
 
@@ -1581,6 +1610,19 @@ const Type * TypeChecker::resolve_type(const TypeNode * node)
     }
   };
 
+  // Every TypeNode is resolved at most once per TypeContext; diagnostics for
+  // unknown types and invalid sizes are therefore reported once as well.
+  go = [&](const TypeNode * n) -> const Type * {
+    if (const Type * cached = get_resolved_type(n, types_)) {
+      return cached;
+    }
+    const Type * resolved = compute(n);
+    if (n) {
+      types_.set_resolved_type(n, resolved);
+    }
+    return resolved;
+  };
+
   return go(node);
 }
 
@@ -1624,9 +1666,10 @@ void TypeChecker::unify_infer_vars(const Symbol * a, const Symbol * b, SourceRan
   if (!merged || merged->is_error()) {
     const bool suppress = (ta && ta->is_error()) || (tb && tb->is_error());
     if (!suppress) {
-      report_error(
-        where, std::string("conflicting type constraints: cannot unify '") + to_string(ta) +
-                 "' with '" + to_string(tb) + "'");
+      report_error(where, [&] {
+        return std::string("conflicting type constraints: cannot unify '") + to_string(ta) +
+               "' with '" + to_string(tb) + "'";
+      });
     }
     merged = types_.error_type();
   }
@@ -1744,9 +1787,10 @@ void TypeChecker::constrain_var_type(
     const bool suppress =
       (current && current->is_error()) || (normalized && normalized->is_error());
     if (!suppress) {
-      report_error(
-        where, std::string("conflicting type constraints: cannot unify '") + to_string(current) +
-                 "' with '" + to_string(normalized) + "'");
+      report_error(where, [&] {
+        return std::string("conflicting type constraints: cannot unify '") + to_string(current) +
+               "' with '" + to_string(normalized) + "'";
+      });
     }
     merged = types_.error_type();
   }
@@ -1857,14 +1901,23 @@ const Type * TypeChecker::apply_defaults(const Type * type)
   return bt_dsl::apply_defaults(types_, type);
 }
 
-void TypeChecker::report_error(SourceRange range, std::string_view message)
+void TypeChecker::report_error(SourceRange range, DiagnosticMessage message)
 {
   has_errors_ = true;
   ++error_count_;
 
   if (diags_) {
-    diags_->report_error(range, std::string(message));
+    diags_->report_error(range, std::move(message));
   }
 }
 
+// ============================================================================
+// Helper Functions
+// ============================================================================
+
+const Type * get_resolved_type(const TypeNode * node, const TypeContext & types)
+{
+  return node ? types.resolved_type(node) : nullptr;
+}
+
 }  // namespace bt_dsl
@@ -1,6 +1,8 @@
 // bt_dsl/syntax/frontend.cpp - High-level parse pipeline
 #include "bt_dsl/syntax/frontend.hpp"
 
+#include <utility>
+
 #include "bt_dsl/syntax/lexer.hpp"
 #include "bt_dsl/syntax/parser.hpp"
 
@@ -37,6 +39,7 @@ ParseOutput parse_source(
 
   bt_dsl::syntax::Parser parser(ast, out.file_id, *source, diags, std::move(parser_tokens));
   out.program = parser.parse_program();
+  out.tokens = std::move(tokens);
   return out;
 }
 
@@ -124,6 +124,29 @@ void fail_diff_hint(
   std::cerr << actual.substr(start, end - start) << "\n";
 }
 
+/// Number of elements inside all <BehaviorTree> bodies.
+size_t count_tree_nodes(const std::string & xml)
+{
+  tinyxml2::XMLDocument doc;
+  doc.Parse(xml.c_str());
+  if (doc.Error() || doc.RootElement() == nullptr) {
+    return 0;
+  }
+
+  size_t count = 0;
+  const auto count_subtree = [&count](const tinyxml2::XMLElement * e, const auto & self) -> void {
+    for (const auto * c = e->FirstChildElement(); c != nullptr; c = c->NextSiblingElement()) {
+      ++count;
+      self(c, self);
+    }
+  };
+  for (const auto * bt = doc.RootElement()->FirstChildElement("BehaviorTree"); bt != nullptr;
+       bt = bt->NextSiblingElement("BehaviorTree")) {
+    count_subtree(bt, count_subtree);
+  }
+  return count;
+}
+
 std::string dump_program_ast(const ModuleInfo & m)
 {
   std::ostringstream ss;
@@ -217,18 +240,37 @@ void run_one(const std::filesystem::path & bt_file)
   // Produced AST dump
   const std::string produced_ast = normalize_text(dump_program_ast(*entry));
 
+  // Same input at -O1 (peephole-optimized tree).
+  const std::filesystem::path o1_out_dir = out_dir / "O1";
+  CompileOptions opt_opts = opts;
+  opt_opts.output_dir = o1_out_dir;
+  opt_opts.codegen.opt_level = OptimizationLevel::O1;
+  const CompileResult opt_res = Compiler::compile_single_file(bt_file, opt_opts);
+  ASSERT_TRUE(opt_res.success) << "-O1 compilation failed for: " << bt_file.string();
+  const std::string produced_o1_xml =
+    canonicalize_xml(read_file(o1_out_dir / (stem + ".xml")));
+
   const std::filesystem::path exp_xml_path = expected_dir() / (stem + ".xml");
   const std::filesystem::path exp_ast_path = expected_dir() / (stem + ".ast.txt");
+  const std::filesystem::path exp_o1_xml_path = expected_dir() / (stem + ".O1.xml");
+
+  // -O1 must never grow the tree, and the goldens below show by how much it shrinks.
+  const size_t o0_nodes = count_tree_nodes(produced_xml);
+  const size_t o1_nodes = count_tree_nodes(produced_o1_xml);
+  EXPECT_LE(o1_nodes, o0_nodes) << stem;
 
   if (should_update_golden()) {
+    std::cerr << "[nodes] " << stem << ": -O0 " << o0_nodes << ", -O1 " << o1_nodes << "\n";
     write_file(exp_xml_path, produced_xml);
     write_file(exp_ast_path, produced_ast);
+    write_file(exp_o1_xml_path, produced_o1_xml);
     std::cerr << "[golden updated] " << stem << "\n";
     return;
   }
 
   const std::string expected_xml = canonicalize_xml(read_file(exp_xml_path));
   const std::string expected_ast = normalize_text(read_file(exp_ast_path));
+  const std::string expected_o1_xml = canonicalize_xml(read_file(exp_o1_xml_path));
 
   if (expected_xml != produced_xml) {
     std::cerr << "XML golden mismatch for: " << stem << "\n";
@@ -243,6 +285,13 @@ void run_one(const std::filesystem::path & bt_file)
     FAIL() << "AST golden mismatch for: " << stem;
     return;
   }
+
+  if (expected_o1_xml != produced_o1_xml) {
+    std::cerr << "-O1 XML golden mismatch for: " << stem << "\n";
+    fail_diff_hint("xml -O1", expected_o1_xml, produced_o1_xml);
+    FAIL() << "-O1 XML golden mismatch for: " << stem;
+    return;
+  }
 }
 
 }  // namespace
@@ -25,7 +25,7 @@ TEST(AstParser, InvalidAttributeRecovery)
   // Check specific error message about misplaced attribute
   bool found_misplaced = false;
   for (const auto & d : unit.diags.all()) {
-    if (d.message.find("unexpected attribute on this declaration") != std::string::npos) {
+    if (d.message.str().find("unexpected attribute on this declaration") != std::string::npos) {
       found_misplaced = true;
       break;
     }
@@ -60,10 +60,10 @@ TEST(AstParser, MissingBraceRecovery)
   // Check that we DON'T have "keyword cannot be used as identifier" error for 'tree'
   bool keyword_as_ident = false;
   for (const auto & d : unit.diags.all()) {
-    if (d.message.find("keyword cannot be used") != std::string::npos) {
+    if (d.message.str().find("keyword cannot be used") != std::string::npos) {
       keyword_as_ident = true;
     }
-    if (d.message.find("use of undeclared node 'tree'") != std::string::npos) {
+    if (d.message.str().find("use of undeclared node 'tree'") != std::string::npos) {
       keyword_as_ident = true;
     }
   }
@@ -90,7 +90,7 @@ TEST(AstParser, SemicolonErrorLocation)
   for (const auto & d : unit.diags.all()) {
     const auto r = d.primary_range();
     auto loc = unit.sources.get_line_column(r.get_begin());
-    if (d.message.find("expected ';'") != std::string::npos) {
+    if (d.message.str().find("expected ';'") != std::string::npos) {
       found_semi = true;
       error_line = loc.line;
       break;
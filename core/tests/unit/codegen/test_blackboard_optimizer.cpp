@@ -0,0 +1,160 @@
+#include <gtest/gtest.h>
+
+#include <initializer_list>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "bt_dsl/codegen/blackboard_optimizer.hpp"
+#include "bt_dsl/codegen/btcpp_model.hpp"
+#include "bt_dsl/codegen/xml_generator.hpp"
+
+using namespace bt_dsl;
+
+namespace
+{
+
+class TreeFixture
+{
+public:
+  btcpp::BehaviorTreeModel tree;
+
+  btcpp::Node node(
+    std::string_view tag,
+    std::initializer_list<std::pair<std::string_view, std::string_view>> attrs = {},
+    std::initializer_list<btcpp::Node> children = {})
+  {
+    btcpp::NodeBuilder b(*tree.arena, tag);
+    for (const auto & [key, value] : attrs) {
+      b.add_attribute(key, value);
+    }
+    for (const auto & ch : children) {
+      b.add_child(ch);
+    }
+    return b.build();
+  }
+
+  btcpp::Node script(std::string_view code) { return node("Script", {{"code", code}}); }
+
+  btcpp::Node use(std::string_view value) { return node("Use", {{"in", value}}); }
+
+  /// Serialize the tree as `Tag[attr=value,...](children)` for compact assertions.
+  std::string dump() const { return tree.root ? dump(*tree.root) : std::string{}; }
+
+private:
+  static std::string dump(const btcpp::Node & n)
+  {
+    std::string out(n.tag);
+    if (!n.attributes.empty()) {
+      out += "[";
+      for (size_t i = 0; i < n.attributes.size(); ++i) {
+        if (i > 0) out += ",";
+        out += std::string(n.attributes[i].key) + "=" + std::string(n.attributes[i].value);
+      }
+      out += "]";
+    }
+    if (!n.children.empty()) {
+      out += "(";
+      for (size_t i = 0; i < n.children.size(); ++i) {
+        if (i > 0) out += " ";
+        out += dump(n.children[i]);
+      }
+      out += ")";
+    }
+    return out;
+  }
+};
+
+}  // namespace
+
+TEST(CodegenBlackboardOptimizer, CoalescesKeysOfOneTypeWithDisjointLifetimes)
+{
+  TreeFixture t;
+  t.tree.root = t.node(
+    "Sequence", {},
+    {t.script(" _expr#1 := (a + 1) "), t.use("{_expr#1}"), t.script(" _expr#2 := 'x#9' "),
+     t.use("{_expr#2}"), t.script(" _expr#3 := (b + 2) "), t.use("{_expr#3}"),
+     t.script(" _expr#4 := c "), t.use("{_expr#4}")});
+  // _expr#4 has no known type.
+  t.tree.key_types = {{"_expr#1", "int32"}, {"_expr#2", "string"}, {"_expr#3", "int32"}};
+
+  const auto stats = BlackboardKeyOptimizer::run(t.tree);
+
+  EXPECT_EQ(stats.keys_before, 4U);
+  EXPECT_EQ(stats.keys_after, 3U);
+  EXPECT_EQ(
+    t.dump(),
+    "Sequence(Script[code= _expr#1 := (a + 1) ] Use[in={_expr#1}] "
+    "Script[code= _expr#2 := 'x#9' ] Use[in={_expr#2}] "
+    "Script[code= _expr#1 := (b + 2) ] Use[in={_expr#1}] "
+    "Script[code= _expr#4 := c ] Use[in={_expr#4}])");
+  EXPECT_EQ(t.tree.key_types.count("_expr#3"), 0U);
+}
+
+TEST(CodegenBlackboardOptimizer, KeepsOverlappingAndUnsetFirstKeysApart)
+{
+  TreeFixture t;
+  t.tree.root = t.node(
+    "Sequence", {},
+    {t.script(" a#1 := 1 "), t.script(" b#2 := a#1 "), t.use("{b#2}"),
+     // Nullable variable: first written with `=` (entry absent until then).
+     t.script(" n#3 = 2 "), t.node("BlackboardExists", {{"key", "n#3"}})});
+  t.tree.key_types = {{"a#1", "int32"}, {"b#2", "int32"}, {"n#3", "int32"}};
+
+  const auto stats = BlackboardKeyOptimizer::run(t.tree);
+
+  EXPECT_EQ(stats.keys_after, 3U);
+  EXPECT_EQ(
+    t.dump(),
+    "Sequence(Script[code= a#1 := 1 ] Script[code= b#2 := a#1 ] Use[in={b#2}] "
+    "Script[code= n#3 = 2 ] BlackboardExists[key=n#3])");
+}
+
+TEST(CodegenBlackboardOptimizer, DoesNotShareKeysUnderInterleavingControls)
+{
+  TreeFixture t;
+  t.tree.root = t.node(
+    "ReactiveSequence", {},
+    {t.node("Sequence", {}, {t.script(" x#1 := 1 "), t.use("{x#1}")}),
+     t.node("Sequence", {}, {t.script(" y#2 := 2 "), t.use("{y#2}")})});
+  t.tree.key_types = {{"x#1", "int32"}, {"y#2", "int32"}};
+
+  const auto stats = BlackboardKeyOptimizer::run(t.tree);
+
+  EXPECT_EQ(stats.keys_after, 2U);
+}
+
+TEST(CodegenBlackboardOptimizer, RemovesWriteOnlyHelpers)
+{
+  TreeFixture t;
+  t.tree.root = t.node(
+    "Fallback", {},
+    {t.node("Sequence", {}, {t.script(" y#1 := 1 "), t.script(" x#2 := y#1 "), t.use("{a}")}),
+     t.script(" z#3 := 0 ")});
+
+  const auto stats = BlackboardKeyOptimizer::run(t.tree);
+
+  EXPECT_EQ(stats.scripts_removed, 3U);
+  EXPECT_EQ(stats.keys_after, 0U);
+  EXPECT_EQ(t.dump(), "Fallback(Sequence(Use[in={a}]) AlwaysSuccess)");
+}
+
+TEST(CodegenBlackboardOptimizer, DocumentPassRewritesEveryTree)
+{
+  btcpp::Document doc;
+  TreeFixture t;
+  t.tree.id = "Main";
+  t.tree.root = t.node(
+    "Sequence", {},
+    {t.script(" _default#1 := 3 "), t.use("{_default#1}"), t.script(" _default#2 := 4 "),
+     t.use("{_default#2}")});
+  t.tree.key_types = {{"_default#1", "int32"}, {"_default#2", "int32"}};
+  doc.behavior_trees.push_back(t.tree);
+  doc.main_tree_to_execute = "Main";
+
+  (void)BlackboardKeyOptimizer::run(doc);
+  const std::string xml = BtCppXmlSerializer::serialize(doc);
+
+  EXPECT_EQ(xml.find("_default#2"), std::string::npos) << xml;
+  EXPECT_NE(xml.find("_default#1 := 4"), std::string::npos) << xml;
+}
@@ -0,0 +1,46 @@
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "bt_dsl/codegen/btcpp_model.hpp"
+
+using namespace bt_dsl;
+
+TEST(CodegenBtCppModel, TagsAndKeysAreInternedValuesAreCopied)
+{
+  btcpp::ModelArena arena;
+
+  std::string value = "{x#1}";
+  btcpp::NodeBuilder a(arena, std::string("Action"));
+  a.add_attribute(std::string("port"), value);
+  const btcpp::Node first = a.build();
+  value = "changed";
+
+  const btcpp::Node second = btcpp::NodeBuilder(arena, "Action").add_attribute("port", "v").build();
+
+  EXPECT_EQ(first.tag.data(), second.tag.data());
+  EXPECT_EQ(first.attributes[0].key.data(), second.attributes[0].key.data());
+  EXPECT_EQ(first.attributes[0].value, "{x#1}");
+  // Arena strings are NUL-terminated for C APIs.
+  EXPECT_EQ(first.attributes[0].value.data()[first.attributes[0].value.size()], '\0');
+}
+
+TEST(CodegenBtCppModel, ReopenedNodeKeepsChildrenAndAppendsAttributes)
+{
+  btcpp::ModelArena arena;
+
+  btcpp::NodeBuilder seq(arena, "Sequence");
+  seq.add_child(btcpp::NodeBuilder(arena, "A").build());
+  seq.add_child(btcpp::NodeBuilder(arena, "B").build());
+  const btcpp::Node original = seq.build();
+
+  const btcpp::Node guarded =
+    btcpp::NodeBuilder(arena, original).add_attribute("_while", "true").build();
+
+  ASSERT_EQ(guarded.children.size(), 2U);
+  EXPECT_EQ(guarded.children[0].tag, "A");
+  EXPECT_EQ(guarded.children[1].tag, "B");
+  ASSERT_EQ(guarded.attributes.size(), 1U);
+  EXPECT_EQ(guarded.attributes[0].key, "_while");
+  EXPECT_TRUE(original.attributes.empty());
+}
@@ -0,0 +1,97 @@
+#include <gtest/gtest.h>
+
+#include <initializer_list>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "bt_dsl/codegen/btcpp_model.hpp"
+#include "bt_dsl/codegen/cpp_generator.hpp"
+
+using namespace bt_dsl;
+
+static void expect_contains(const std::string & haystack, const std::string & needle)
+{
+  EXPECT_NE(haystack.find(needle), std::string::npos)
+    << "Expected to find: " << needle << "\nIn output:\n"
+    << haystack;
+}
+
+static btcpp::Node make_node(
+  btcpp::ModelArena & arena, std::string_view tag,
+  std::initializer_list<std::pair<std::string_view, std::string_view>> attrs = {})
+{
+  btcpp::NodeBuilder n(arena, tag);
+  for (const auto & [key, value] : attrs) {
+    n.add_attribute(key, value);
+  }
+  return n.build();
+}
+
+static btcpp::Document make_document()
+{
+  btcpp::Document doc;
+  doc.main_tree_to_execute = "Main";
+
+  btcpp::BehaviorTreeModel main;
+  main.id = "Main";
+  btcpp::NodeBuilder seq(*main.arena, "Sequence");
+  seq.add_child(
+    make_node(*main.arena, "Say", {{"msg", "he said \"hi\"\n"}, {"_skipIf", "x > 1"}}));
+  seq.add_child(
+    make_node(*main.arena, "SubTree", {{"ID", "_SubTree_1_Sub"}, {"target", "{goal#1}"}}));
+  main.root = seq.build();
+  doc.behavior_trees.push_back(std::move(main));
+
+  btcpp::BehaviorTreeModel sub;
+  sub.id = "_SubTree_1_Sub";
+  sub.root = make_node(*sub.arena, "AlwaysSuccess");
+  doc.behavior_trees.push_back(std::move(sub));
+
+  btcpp::NodeModel say;
+  say.kind = btcpp::NodeModelKind::Action;
+  say.id = "Say";
+  say.ports.push_back(btcpp::PortModel{btcpp::PortKind::Input, "msg", std::string{"string"}});
+  doc.node_models.push_back(std::move(say));
+
+  return doc;
+}
+
+TEST(CodegenCppGenerator, EmitsBuilderPerBehaviorTree)
+{
+  const std::string src = BtCppSourceSerializer::serialize(make_document(), "mission");
+
+  expect_contains(src, "#include <behaviortree_cpp/bt_factory.h>");
+  expect_contains(src, "BT::TreeNode * build_tree_0(Builder & b);  // Main");
+  expect_contains(src, "BT::TreeNode * build_tree_1(Builder & b);  // _SubTree_1_Sub");
+  expect_contains(src, "return b.node(\"AlwaysSuccess\", {}, {});");
+  expect_contains(
+    src, "b.subtree(\"_SubTree_1_Sub\", {{\"target\", \"{goal#1}\"}}, &build_tree_1)");
+  expect_contains(src, "BT::Tree create_mission(");
+  expect_contains(src, "builder.root(\"Main\", std::move(blackboard), &build_tree_0);");
+}
+
+TEST(CodegenCppGenerator, EscapesAttributeValuesAsCppStringLiterals)
+{
+  const std::string src = BtCppSourceSerializer::serialize(make_document(), "mission");
+
+  expect_contains(
+    src, "b.node(\"Say\", {{\"msg\", \"he said \\\"hi\\\"\\n\"}, {\"_skipIf\", \"x > 1\"}}, {})");
+}
+
+TEST(CodegenCppGenerator, EmitsDeclaredPortsForValidation)
+{
+  const std::string src = BtCppSourceSerializer::serialize(make_document(), "my-mission");
+
+  expect_contains(src, "const std::array<const char *, 1> k_declared_nodes = {{\n  \"Say\",\n}};");
+  expect_contains(src, "{\"Say\", \"msg\", BT::PortDirection::INPUT},");
+  expect_contains(src, "void validate_my_mission(const BT::BehaviorTreeFactory & factory)");
+}
+
+TEST(CodegenCppGenerator, UnknownSubTreeIdThrows)
+{
+  btcpp::Document doc = make_document();
+  doc.behavior_trees.pop_back();
+
+  EXPECT_THROW((void)BtCppSourceSerializer::serialize(doc, "mission"), std::runtime_error);
+}
@@ -0,0 +1,129 @@
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "bt_dsl/codegen/model_converter.hpp"
+
+using namespace bt_dsl;
+
+namespace
+{
+
+namespace fs = std::filesystem;
+
+constexpr const char * k_nav_manifest = R"(<?xml version="1.0"?>
+<!-- exported by plugin catalog -->
+<root BTCPP_format="4">
+  <BehaviorTree ID="Ignored"><Action ID="NotAModel"/></BehaviorTree>
+  <TreeNodesModel>
+    <Condition ID="IsBatteryOk">
+      <input_port name="min" type="double"/>
+    </Condition>
+    <Action ID="MoveTo">
+      <output_port name="error" type="std::string"/>
+      <input_port name="goal" type="geometry_msgs::msg::PoseStamped">
+        Target &lt;pose&gt;
+      </input_port>
+      <inout_port name="path"/>
+    </Action>
+  </TreeNodesModel>
+</root>
+)";
+
+void write_file(const fs::path & path, const std::string & content)
+{
+  std::ofstream out(path, std::ios::binary);
+  out << content;
+}
+
+}  // namespace
+
+TEST(CodegenModelConverter, ParsesManifestWithoutDom)
+{
+  const auto nodes = ModelConverter::parse_xml(k_nav_manifest);
+
+  ASSERT_EQ(nodes.size(), 2U);
+  // Categories keep the converter's fixed order (Action before Condition).
+  EXPECT_EQ(nodes[0].category, "Action");
+  EXPECT_EQ(nodes[0].name, "MoveTo");
+  ASSERT_EQ(nodes[0].ports.size(), 3U);
+  EXPECT_EQ(nodes[0].ports[0].name, "goal");
+  EXPECT_EQ(nodes[0].ports[0].type_name, "geometry_msgs__msg__PoseStamped");
+  EXPECT_EQ(nodes[0].ports[0].description, "Target <pose>");
+  EXPECT_EQ(nodes[0].ports[1].direction, ManifestPortDirection::Out);
+  EXPECT_EQ(nodes[0].ports[2].type_name, "any");
+  EXPECT_EQ(nodes[1].name, "IsBatteryOk");
+
+  const std::string bt = ModelConverter::render_bt(nodes);
+  EXPECT_NE(bt.find("    /// Target <pose>\n    in goal: geometry_msgs__msg__PoseStamped,"),
+            std::string::npos);
+  EXPECT_NE(bt.find("extern node Condition IsBatteryOk(in min: double)\n"), std::string::npos);
+}
+
+TEST(CodegenModelConverter, AcceptsBareModelAndNodesUnderRoot)
+{
+  const auto bare = ModelConverter::parse_xml(
+    "<TreeNodesModel><Action ID='A'><input_port name='x' type='int'/></Action></TreeNodesModel>");
+  ASSERT_EQ(bare.size(), 1U);
+  EXPECT_EQ(bare[0].ports[0].type_name, "int");
+
+  const auto direct = ModelConverter::parse_xml(
+    "<root><Decorator ID=\"D\"/><![CDATA[ignored]]><Action/></root>");
+  ASSERT_EQ(direct.size(), 1U);
+  EXPECT_EQ(direct[0].category, "Decorator");
+}
+
+TEST(CodegenModelConverter, ReportsMalformedXml)
+{
+  EXPECT_THROW((void)ModelConverter::parse_xml(""), std::runtime_error);
+  EXPECT_THROW((void)ModelConverter::parse_xml("<root><Action ID='A'></root>"), std::runtime_error);
+  EXPECT_THROW((void)ModelConverter::parse_xml("<root><Action ID='A/></root>"), std::runtime_error);
+}
+
+TEST(CodegenModelConverter, MergesManifestsParsedInParallel)
+{
+  const fs::path dir = fs::temp_directory_path() / "bt_dsl_model_converter_merge";
+  fs::remove_all(dir);
+  fs::create_directories(dir);
+
+  std::vector<std::string> paths;
+  for (int i = 0; i < 6; ++i) {
+    const fs::path p = dir / ("pkg" + std::to_string(i) + ".xml");
+    // Every package re-exports MoveTo; each also declares its own action.
+    write_file(p, k_nav_manifest);
+    const fs::path q = dir / ("own" + std::to_string(i) + ".xml");
+    write_file(q, "<root><TreeNodesModel><Action ID=\"Own" + std::to_string(i) +
+                    "\"/></TreeNodesModel></root>");
+    paths.push_back(p.string());
+    paths.push_back(q.string());
+  }
+  const fs::path conflicting = dir / "conflict.xml";
+  write_file(conflicting, "<TreeNodesModel><Condition ID=\"MoveTo\"/></TreeNodesModel>");
+  paths.push_back(conflicting.string());
+  paths.push_back((dir / "missing.xml").string());
+
+  auto files = ModelConverter::parse_files(paths, 4);
+  ASSERT_EQ(files.size(), paths.size());
+  EXPECT_EQ(files[1].nodes.size(), 1U);
+  EXPECT_FALSE(files.back().error.empty());
+
+  const auto merged = ModelConverter::merge(std::move(files));
+  ASSERT_EQ(merged.nodes.size(), 8U);
+  EXPECT_EQ(merged.nodes[0].name, "MoveTo");
+  EXPECT_EQ(merged.nodes[1].name, "IsBatteryOk");
+  EXPECT_EQ(merged.nodes[2].name, "Own0");
+  EXPECT_EQ(merged.duplicates_merged, 10U);
+  ASSERT_EQ(merged.conflicts.size(), 1U);
+  EXPECT_NE(merged.conflicts[0].find("conflict.xml"), std::string::npos);
+
+  std::ostringstream streamed;
+  ModelConverter::render_bt(merged.nodes, streamed);
+  EXPECT_EQ(streamed.str(), ModelConverter::render_bt(merged.nodes));
+
+  fs::remove_all(dir);
+}
@@ -0,0 +1,166 @@
+#include <gtest/gtest.h>
+
+#include <initializer_list>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "bt_dsl/codegen/btcpp_model.hpp"
+#include "bt_dsl/codegen/peephole_optimizer.hpp"
+#include "bt_dsl/codegen/xml_generator.hpp"
+
+using namespace bt_dsl;
+
+namespace
+{
+
+class TreeFixture
+{
+public:
+  btcpp::BehaviorTreeModel tree;
+
+  btcpp::Node node(
+    std::string_view tag,
+    std::initializer_list<std::pair<std::string_view, std::string_view>> attrs = {},
+    std::initializer_list<btcpp::Node> children = {})
+  {
+    btcpp::NodeBuilder b(*tree.arena, tag);
+    for (const auto & [key, value] : attrs) {
+      b.add_attribute(key, value);
+    }
+    for (const auto & ch : children) {
+      b.add_child(ch);
+    }
+    return b.build();
+  }
+
+  btcpp::Node seq(std::initializer_list<btcpp::Node> children)
+  {
+    return node("Sequence", {}, children);
+  }
+
+  btcpp::Node script(std::string_view code) { return node("Script", {{"code", code}}); }
+
+  btcpp::Node exists(std::string_view key) { return node("BlackboardExists", {{"key", key}}); }
+
+  /// Serialize the tree as `Tag[attr=value,...](children)` for compact assertions.
+  std::string dump() const { return tree.root ? dump(*tree.root) : std::string{}; }
+
+private:
+  static std::string dump(const btcpp::Node & n)
+  {
+    std::string out(n.tag);
+    if (!n.attributes.empty()) {
+      out += "[";
+      for (size_t i = 0; i < n.attributes.size(); ++i) {
+        if (i > 0) out += ",";
+        out += std::string(n.attributes[i].key) + "=" + std::string(n.attributes[i].value);
+      }
+      out += "]";
+    }
+    if (!n.children.empty()) {
+      out += "(";
+      for (size_t i = 0; i < n.children.size(); ++i) {
+        if (i > 0) out += " ";
+        out += dump(n.children[i]);
+      }
+      out += ")";
+    }
+    return out;
+  }
+};
+
+}  // namespace
+
+TEST(CodegenPeepholeOptimizer, FlattensNestedSequencesAndMergesScripts)
+{
+  TreeFixture t;
+  t.tree.root = t.seq(
+    {t.script(" a#1 := 1 "), t.seq({t.script(" b#2 := a#1 "), t.node("Act")}),
+     t.seq({t.script(" c#3 := 2 ")}), t.script(" d#4 := 3 ")});
+
+  const auto stats = PeepholeOptimizer::run(t.tree);
+
+  EXPECT_EQ(
+    t.dump(),
+    "Sequence(Script[code= a#1 := 1; b#2 := a#1 ] Act Script[code= c#3 := 2; d#4 := 3 ])");
+  EXPECT_EQ(stats.nodes_before, 8U);
+  EXPECT_EQ(stats.nodes_after, 4U);
+  EXPECT_EQ(stats.controls_removed, 2U);
+  EXPECT_EQ(stats.scripts_merged, 2U);
+}
+
+TEST(CodegenPeepholeOptimizer, UnwrapsSingleChildControls)
+{
+  TreeFixture t;
+  t.tree.root = t.node(
+    "Fallback", {},
+    {t.seq({t.node("Act")}), t.node("Fallback", {}, {t.node("A"), t.node("B")})});
+
+  const auto stats = PeepholeOptimizer::run(t.tree);
+
+  EXPECT_EQ(t.dump(), "Fallback(Act A B)");
+  EXPECT_EQ(stats.nodes_before - stats.nodes_after, 2U);
+}
+
+TEST(CodegenPeepholeOptimizer, KeepsControlsAndScriptsWithAttributes)
+{
+  TreeFixture t;
+  t.tree.root = t.seq(
+    {t.node("Sequence", {{"_skipIf", "{s}"}}, {t.node("A"), t.node("B")}),
+     t.node("Script", {{"code", " x := 1 "}, {"_while", "{w}"}}), t.script(" y := 2 "),
+     t.node("Fallback", {}, {t.node("C"), t.node("D")})});
+
+  const auto stats = PeepholeOptimizer::run(t.tree);
+
+  EXPECT_EQ(stats.nodes_before, stats.nodes_after);
+  EXPECT_EQ(
+    t.dump(),
+    "Sequence(Sequence[_skipIf={s}](A B) Script[code= x := 1 ,_while={w}] "
+    "Script[code= y := 2 ] Fallback(C D))");
+}
+
+TEST(CodegenPeepholeOptimizer, DropsRepeatedExistsChecksOnlyWhileStillValid)
+{
+  TreeFixture t;
+  t.tree.root = t.seq(
+    {t.exists("x#1"), t.script(" y#2 := x#1 "), t.seq({t.exists("x#1"), t.node("Act")}),
+     // Act may have removed the entry, so this check stays.
+     t.exists("x#1"), t.node("Use")});
+
+  const auto stats = PeepholeOptimizer::run(t.tree);
+
+  EXPECT_EQ(stats.exists_removed, 1U);
+  EXPECT_EQ(
+    t.dump(),
+    "Sequence(BlackboardExists[key=x#1] Script[code= y#2 := x#1 ] Act BlackboardExists[key=x#1] "
+    "Use)");
+}
+
+TEST(CodegenPeepholeOptimizer, FallbackChildrenAreNotMerged)
+{
+  TreeFixture t;
+  t.tree.root = t.node(
+    "Fallback", {}, {t.script(" a := 1 "), t.script(" b := 2 "), t.exists("k"), t.exists("k")});
+
+  const auto stats = PeepholeOptimizer::run(t.tree);
+
+  EXPECT_EQ(stats.nodes_before, stats.nodes_after);
+}
+
+TEST(CodegenPeepholeOptimizer, DocumentPassSerializesOptimizedTrees)
+{
+  btcpp::Document doc;
+  TreeFixture t;
+  t.tree.id = "Main";
+  t.tree.root = t.seq({t.seq({t.script(" a := 1 "), t.script(" b := 2 ")})});
+  doc.behavior_trees.push_back(t.tree);
+  doc.main_tree_to_execute = "Main";
+
+  const auto stats = PeepholeOptimizer::run(doc);
+  const std::string xml = BtCppXmlSerializer::serialize(doc);
+
+  EXPECT_EQ(stats.nodes_after, 1U);
+  EXPECT_EQ(xml.find("<Sequence"), std::string::npos) << xml;
+  EXPECT_NE(xml.find("a := 1; b := 2"), std::string::npos) << xml;
+}
@@ -0,0 +1,293 @@
+#include <gtest/gtest.h>
+
+#include <initializer_list>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "bt_dsl/codegen/btcpp_model.hpp"
+#include "bt_dsl/codegen/subtree_optimizer.hpp"
+
+using namespace bt_dsl;
+
+namespace
+{
+
+using Attrs = std::initializer_list<std::pair<std::string_view, std::string_view>>;
+
+class DocFixture
+{
+public:
+  btcpp::Document doc;
+
+  // Trees are returned by reference while the next ones are added.
+  DocFixture() { doc.behavior_trees.reserve(16); }
+
+  /// Add a BehaviorTree (with a SubTree model when it has parameters).
+  btcpp::BehaviorTreeModel & tree(std::string id, std::initializer_list<std::string> params = {})
+  {
+    btcpp::BehaviorTreeModel tm;
+    tm.id = id;
+    doc.behavior_trees.push_back(std::move(tm));
+    if (params.size() > 0) {
+      btcpp::SubTreeModel st;
+      st.id = id;
+      for (const auto & p : params) {
+        st.ports.push_back(btcpp::PortModel{btcpp::PortKind::InOut, p, std::nullopt});
+      }
+      doc.subtree_models.push_back(std::move(st));
+    }
+    return doc.behavior_trees.back();
+  }
+
+  static btcpp::Node node(
+    btcpp::BehaviorTreeModel & t, std::string_view tag, Attrs attrs = {},
+    std::initializer_list<btcpp::Node> children = {})
+  {
+    btcpp::NodeBuilder b(*t.arena, tag);
+    for (const auto & [key, value] : attrs) {
+      b.add_attribute(key, value);
+    }
+    for (const auto & ch : children) {
+      b.add_child(ch);
+    }
+    return b.build();
+  }
+
+  [[nodiscard]] const btcpp::BehaviorTreeModel * find(std::string_view id) const
+  {
+    for (const auto & t : doc.behavior_trees) {
+      if (t.id == id) return &t;
+    }
+    return nullptr;
+  }
+
+  [[nodiscard]] std::string dump(std::string_view id) const
+  {
+    const auto * t = find(id);
+    return (t && t->root) ? dump(*t->root) : std::string{};
+  }
+
+private:
+  static std::string dump(const btcpp::Node & n)
+  {
+    std::string out(n.tag);
+    if (!n.attributes.empty()) {
+      out += "[";
+      for (size_t i = 0; i < n.attributes.size(); ++i) {
+        if (i > 0) out += ",";
+        out += std::string(n.attributes[i].key) + "=" + std::string(n.attributes[i].value);
+      }
+      out += "]";
+    }
+    if (!n.children.empty()) {
+      out += "(";
+      for (size_t i = 0; i < n.children.size(); ++i) {
+        if (i > 0) out += " ";
+        out += dump(n.children[i]);
+      }
+      out += ")";
+    }
+    return out;
+  }
+};
+
+}  // namespace
+
+TEST(CodegenSubtreeOptimizer, InlinesSmallCalleeWithRenamedLocals)
+{
+  DocFixture f;
+  f.doc.main_tree_to_execute = "Main";
+  constexpr std::string_view add_id = "_SubTree_lib_Add";
+
+  auto & main = f.tree("Main");
+  main.root = DocFixture::node(
+    main, "Sequence", {},
+    {DocFixture::node(main, "Script", {{"code", " x#1 := 1 "}}),
+     DocFixture::node(main, "SubTree", {{"ID", add_id}, {"v", "{x#1}"}, {"g", "@{G}"}}),
+     DocFixture::node(main, "SubTree", {{"ID", add_id}, {"v", "{x#1}"}, {"g", "@{G}"}})});
+
+  auto & add = f.tree(std::string(add_id), {"v", "g"});
+  add.root = DocFixture::node(
+    add, "Sequence", {},
+    {DocFixture::node(add, "Script", {{"code", " t#1 := v + 'v' "}}),
+     DocFixture::node(add, "Use", {{"in", "{t#1}"}, {"out", "{g}"}}),
+     DocFixture::node(add, "Script", {{"code", " v = {g} + t#1 "}, {"_skipIf", "v > 3"}})});
+
+  const auto stats = SubtreeOptimizer::inline_calls(f.doc, SubtreeInlineLimits{});
+
+  EXPECT_EQ(stats.calls_inlined, 2U);
+  EXPECT_EQ(stats.trees_removed, 1U);
+  EXPECT_EQ(f.find(add_id), nullptr);
+  EXPECT_TRUE(f.doc.subtree_models.empty());
+  EXPECT_EQ(
+    f.dump("Main"),
+    "Sequence(Script[code= x#1 := 1 ] "
+    "Sequence(Script[code= t#2 := x#1 + 'v' ] Use[in={t#2},out=@{G}] "
+    "Script[code= x#1 = @{G} + t#2 ,_skipIf=x#1 > 3]) "
+    "Sequence(Script[code= t#3 := x#1 + 'v' ] Use[in={t#3},out=@{G}] "
+    "Script[code= x#1 = @{G} + t#3 ,_skipIf=x#1 > 3]))");
+}
+
+TEST(CodegenSubtreeOptimizer, RespectsSizeLimitsButInlinesSingleUseCallees)
+{
+  DocFixture f;
+  f.doc.main_tree_to_execute = "Main";
+
+  auto & main = f.tree("Main");
+  main.root = DocFixture::node(
+    main, "Sequence", {},
+    {DocFixture::node(main, "SubTree", {{"ID", "Big"}}),
+     DocFixture::node(main, "SubTree", {{"ID", "_SubTree_lib_Once"}, {"_while", "{ok}"}}),
+     DocFixture::node(main, "SubTree", {{"ID", "Big"}})});
+
+  auto & big = f.tree("Big");
+  big.root = DocFixture::node(
+    big, "Sequence", {}, {DocFixture::node(big, "A"), DocFixture::node(big, "B")});
+  auto & once = f.tree("_SubTree_lib_Once");
+  once.root = DocFixture::node(
+    once, "Sequence", {}, {DocFixture::node(once, "C"), DocFixture::node(once, "D")});
+
+  SubtreeInlineLimits limits;
+  limits.max_nodes = 2;
+  const auto stats = SubtreeOptimizer::inline_calls(f.doc, limits);
+
+  EXPECT_EQ(stats.calls_inlined, 1U);
+  EXPECT_NE(f.find("Big"), nullptr);
+  EXPECT_EQ(f.find("_SubTree_lib_Once"), nullptr);
+  EXPECT_EQ(
+    f.dump("Main"),
+    "Sequence(SubTree[ID=Big] Sequence[_while={ok}](Sequence(C D)) SubTree[ID=Big])");
+}
+
+TEST(CodegenSubtreeOptimizer, KeepsRecursiveAndLiteralArgumentCalls)
+{
+  DocFixture f;
+  f.doc.main_tree_to_execute = "Main";
+
+  auto & main = f.tree("Main");
+  main.root = DocFixture::node(
+    main, "Sequence", {},
+    {DocFixture::node(main, "SubTree", {{"ID", "Loop"}}),
+     DocFixture::node(main, "SubTree", {{"ID", "Leaf"}, {"n", "3"}})});
+
+  auto & loop = f.tree("Loop");
+  loop.root = DocFixture::node(
+    loop, "Fallback", {},
+    {DocFixture::node(loop, "A"), DocFixture::node(loop, "SubTree", {{"ID", "Loop"}})});
+  auto & leaf = f.tree("Leaf", {"n"});
+  leaf.root = DocFixture::node(leaf, "Use", {{"in", "{n}"}});
+
+  const auto stats = SubtreeOptimizer::inline_calls(f.doc, SubtreeInlineLimits{});
+
+  EXPECT_EQ(stats.calls_inlined, 0U);
+  EXPECT_EQ(f.doc.behavior_trees.size(), 3U);
+}
+
+TEST(CodegenSubtreeOptimizer, UnmappedParameterBecomesPrivateKey)
+{
+  DocFixture f;
+  f.doc.main_tree_to_execute = "Main";
+
+  auto & main = f.tree("Main");
+  main.root = DocFixture::node(
+    main, "Sequence", {},
+    {DocFixture::node(main, "Script", {{"code", " a#4 := 0 "}}),
+     DocFixture::node(main, "SubTree", {{"ID", "Leaf"}})});
+  auto & leaf = f.tree("Leaf", {"n"});
+  leaf.root = DocFixture::node(leaf, "BlackboardExists", {{"key", "n"}});
+
+  (void)SubtreeOptimizer::inline_calls(f.doc, SubtreeInlineLimits{});
+
+  EXPECT_EQ(f.dump("Main"), "Sequence(Script[code= a#4 := 0 ] BlackboardExists[key=n#5])");
+}
+
+TEST(CodegenSubtreeOptimizer, DeduplicatesIdenticalTreesTransitively)
+{
+  DocFixture f;
+  f.doc.main_tree_to_execute = "Main";
+
+  auto & main = f.tree("Main");
+  main.root = DocFixture::node(
+    main, "Sequence", {},
+    {DocFixture::node(main, "SubTree", {{"ID", "WrapA"}}),
+     DocFixture::node(main, "SubTree", {{"ID", "_SubTree_m_WrapB"}})});
+
+  auto & wrap_a = f.tree("WrapA");
+  wrap_a.root = DocFixture::node(wrap_a, "SubTree", {{"ID", "HelperA"}});
+  auto & wrap_b = f.tree("_SubTree_m_WrapB");
+  wrap_b.root = DocFixture::node(wrap_b, "SubTree", {{"ID", "_SubTree_m_HelperB"}});
+  auto & helper_a = f.tree("HelperA", {"p"});
+  helper_a.root = DocFixture::node(helper_a, "Use", {{"in", "{p}"}});
+  auto & helper_b = f.tree("_SubTree_m_HelperB", {"p"});
+  helper_b.root = DocFixture::node(helper_b, "Use", {{"in", "{p}"}});
+  // Same body, different interface: not merged.
+  auto & helper_c = f.tree("HelperC", {"p", "q"});
+  helper_c.root = DocFixture::node(helper_c, "Use", {{"in", "{p}"}});
+
+  const auto stats = SubtreeOptimizer::deduplicate(f.doc);
+
+  EXPECT_EQ(stats.trees_merged, 2U);
+  EXPECT_EQ(f.find("_SubTree_m_HelperB"), nullptr);
+  EXPECT_EQ(f.find("_SubTree_m_WrapB"), nullptr);
+  EXPECT_NE(f.find("HelperC"), nullptr);
+  EXPECT_EQ(f.doc.subtree_models.size(), 2U);
+  EXPECT_EQ(f.dump("Main"), "Sequence(SubTree[ID=WrapA] SubTree[ID=WrapA])");
+}
+
+TEST(CodegenSubtreeOptimizer, KeepsEntryModuleTrees)
+{
+  DocFixture f;
+  f.doc.main_tree_to_execute = "Main";
+
+  auto & main = f.tree("Main");
+  main.root = DocFixture::node(
+    main, "Sequence", {},
+    {DocFixture::node(main, "SubTree", {{"ID", "Step"}}),
+     DocFixture::node(main, "SubTree", {{"ID", "Again"}})});
+  auto & step = f.tree("Step");
+  step.root = DocFixture::node(step, "A");
+  auto & again = f.tree("Again");
+  again.root = DocFixture::node(again, "A");
+
+  // Inlined everywhere, yet still loadable by name.
+  const auto inlined = SubtreeOptimizer::inline_calls(f.doc, SubtreeInlineLimits{});
+  EXPECT_EQ(inlined.calls_inlined, 2U);
+  EXPECT_EQ(inlined.trees_removed, 0U);
+  EXPECT_NE(f.find("Step"), nullptr);
+  EXPECT_NE(f.find("Again"), nullptr);
+
+  // Identical entry trees: callers move to the first, both IDs stay.
+  auto & caller = f.tree("Caller");
+  caller.root = DocFixture::node(caller, "SubTree", {{"ID", "Again"}});
+  const auto merged = SubtreeOptimizer::deduplicate(f.doc);
+  EXPECT_EQ(merged.trees_merged, 0U);
+  EXPECT_NE(f.find("Again"), nullptr);
+  EXPECT_EQ(f.dump("Caller"), "SubTree[ID=Step]");
+}
+
+TEST(CodegenSubtreeOptimizer, ShortensMangledIdsOnly)
+{
+  DocFixture f;
+  f.doc.main_tree_to_execute = "Main";
+
+  auto & main = f.tree("Main");
+  main.root = DocFixture::node(
+    main, "Sequence", {},
+    {DocFixture::node(main, "SubTree", {{"ID", "_SubTree_1_Nav"}, {"goal", "{g#1}"}}),
+     DocFixture::node(main, "SubTree", {{"ID", "Local"}})});
+  auto & nav = f.tree("_SubTree_1_Nav", {"goal"});
+  nav.root = DocFixture::node(nav, "SubTree", {{"ID", "_SubTree_2_Drive"}});
+  auto & drive = f.tree("_SubTree_2_Drive");
+  drive.root = DocFixture::node(drive, "AlwaysSuccess");
+  // Already taken, so the generator skips it.
+  auto & local = f.tree("_1");
+  local.root = DocFixture::node(local, "AlwaysSuccess");
+
+  EXPECT_EQ(SubtreeOptimizer::shorten_ids(f.doc), 2U);
+  EXPECT_EQ(f.dump("Main"), "Sequence(SubTree[ID=_2,goal={g#1}] SubTree[ID=Local])");
+  EXPECT_EQ(f.dump("_2"), "SubTree[ID=_3]");
+  EXPECT_NE(f.find("_3"), nullptr);
+  ASSERT_EQ(f.doc.subtree_models.size(), 1U);
+  EXPECT_EQ(f.doc.subtree_models[0].id, "_2");
+}
@@ -349,6 +349,76 @@ TEST(CodegenXmlGenerator, WrapsBinaryExpressionsInParenthesesInScript)
   expect_contains(xml, "(@{a} + @{b})");
 }
 
+TEST(CodegenXmlGenerator, FoldsConstantSubexpressionsInScript)
+{
+  SingleModulePipeline ctx;
+  ASSERT_TRUE(ctx.parse(R"(
+    extern control Sequence();
+    const LIMIT = 10;
+    var a: int32 = 1;
+    var result: int32;
+    tree Main() {
+      Sequence {
+        result = a + LIMIT * 2 + 1;
+        @skip_if(a > LIMIT - 3)
+        result = 0;
+      }
+    }
+  )"));
+  ASSERT_TRUE(ctx.analyze());
+
+  const std::string xml = XmlGenerator::generate(ctx.module);
+  expect_contains(xml, "((@{a} + 20) + 1)");
+  expect_contains(xml, "_skipIf=\"(@{a} &gt; 7)\"");
+  expect_not_contains(xml, "LIMIT");
+}
+
+TEST(CodegenXmlGenerator, DropsStaticallyTruePreconditions)
+{
+  SingleModulePipeline ctx;
+  ASSERT_TRUE(ctx.parse(R"(
+    extern control Sequence();
+    const ENABLED = true;
+    var counter: int32;
+    tree Main() {
+      Sequence {
+        @guard(ENABLED)
+        @skip_if(!ENABLED)
+        @run_while(1 < 2)
+        counter = 1;
+      }
+    }
+  )"));
+  ASSERT_TRUE(ctx.analyze());
+
+  const std::string xml = XmlGenerator::generate(ctx.module);
+  expect_contains(xml, "@{counter} = 1");
+  expect_not_contains(xml, "_while");
+  expect_not_contains(xml, "_skipIf");
+  expect_not_contains(xml, "AlwaysSuccess");
+}
+
+TEST(CodegenXmlGenerator, StaticallyFalseGuardReplacesNodeWithAlwaysFailure)
+{
+  SingleModulePipeline ctx;
+  ASSERT_TRUE(ctx.parse(R"(
+    extern control Sequence();
+    extern action Work();
+    const ENABLED = false;
+    tree Main() {
+      Sequence {
+        @guard(ENABLED)
+        Work();
+      }
+    }
+  )"));
+  ASSERT_TRUE(ctx.analyze());
+
+  const std::string xml = XmlGenerator::generate(ctx.module);
+  expect_contains(xml, "<AlwaysFailure/>");
+  expect_not_contains(xml, "<Work");
+}
+
 TEST(CodegenXmlGenerator, NullAssignmentGeneratesUnsetBlackboard)
 {
   SingleModulePipeline ctx;
@@ -392,6 +462,27 @@ TEST(CodegenXmlGenerator, OutVarGeneratesPreScriptDeclaration)
   EXPECT_LT(script, dowork);
 }
 
+TEST(CodegenXmlGenerator, OutVarDefaultSeesThroughAliasWithTypeContext)
+{
+  SingleModulePipeline ctx;
+  ASSERT_TRUE(ctx.parse(R"(
+    type Label = string;
+    extern action Describe(out text: Label);
+    tree Main() { Describe(text: out var x); }
+  )"));
+  ASSERT_TRUE(ctx.analyze());
+
+  const std::string xml =
+    BtCppXmlSerializer::serialize(AstToBtCppModelConverter::convert(ctx.module, &ctx.types));
+  expect_contains(xml, ":= &apos;&apos;");
+
+  // Another context has no memo for this AST; the annotation is read as written.
+  const TypeContext other;
+  const std::string plain =
+    BtCppXmlSerializer::serialize(AstToBtCppModelConverter::convert(ctx.module, &other));
+  expect_contains(plain, ":= 0");
+}
+
 TEST(CodegenXmlGenerator, InPortExpressionGeneratesPreScript)
 {
   SingleModulePipeline ctx;
@@ -534,4 +625,94 @@ TEST(CodegenXmlGenerator, ManglesImportedTreeIdsAndSubtreeReferences)
 
   expect_contains(xml, "<BehaviorTree ID=\"_SubTree_1_Sub\"");
   expect_contains(xml, "<SubTree ID=\"_SubTree_1_Sub\"");
+
+  CodegenOptions compact;
+  compact.xml_compact = true;
+  const std::string small = XmlGenerator::generate_single_output(*main_mod, compact);
+  expect_not_contains(small, "_SubTree_");
+  expect_not_contains(small, "<?xml");
+  expect_not_contains(small, "\n");
+  EXPECT_LT(small.size(), xml.size());
+}
+
+TEST(CodegenXmlGenerator, ParallelSingleOutputMatchesSerialConversion)
+{
+  // Enough trees to spread over several workers; each declares locals so
+  // blackboard key numbering is exercised per tree.
+  std::string src = "extern action Log(in msg: string);\n";
+  constexpr int k_trees = 64;
+  for (int i = 0; i < k_trees; ++i) {
+    const std::string name = i == 0 ? "Main" : "T" + std::to_string(i);
+    src += "tree " + name + "() {\n";
+    src += "  var x: int32 = " + std::to_string(i) + ";\n";
+    src += "  Log(msg: \"" + name + "\");\n";
+    if (i + 1 < k_trees) {
+      src += "  T" + std::to_string(i + 1) + "();\n";
+    }
+    src += "}\n";
+  }
+
+  SingleModulePipeline p;
+  ASSERT_TRUE(p.parse(src));
+  ASSERT_TRUE(p.analyze());
+
+  const std::string serial =
+    BtCppXmlSerializer::serialize(AstToBtCppModelConverter::convert_single_output(p.module, 1));
+  const std::string parallel =
+    BtCppXmlSerializer::serialize(AstToBtCppModelConverter::convert_single_output(p.module, 4));
+
+  EXPECT_EQ(serial, parallel);
+  expect_contains(serial, "<BehaviorTree ID=\"T63\"");
+  expect_contains(serial, "<SubTree ID=\"T1\"");
+}
+
+TEST(CodegenXmlGenerator, SplitOutputWritesIndexAndOneFilePerTree)
+{
+  btcpp::Document doc;
+  doc.main_tree_to_execute = "Main";
+  for (const char * id : {"Main", "Helper"}) {
+    btcpp::BehaviorTreeModel tm;
+    tm.id = id;
+    tm.root = btcpp::NodeBuilder(*tm.arena, "AlwaysSuccess").build();
+    doc.behavior_trees.push_back(std::move(tm));
+  }
+  doc.node_models.push_back(btcpp::NodeModel{btcpp::NodeModelKind::Action, "AlwaysSuccess", {}});
+
+  const auto files = BtCppXmlSerializer::serialize_split(doc, "mission");
+
+  ASSERT_EQ(files.size(), 3U);
+  EXPECT_TRUE(files[0].relative_path.empty());
+  expect_contains(files[0].content, "main_tree_to_execute=\"Main\"");
+  expect_contains(files[0].content, "<include path=\"mission/Main.xml\"/>");
+  expect_contains(files[0].content, "<include path=\"mission/Helper.xml\"/>");
+  expect_contains(files[0].content, "<TreeNodesModel>");
+  expect_not_contains(files[0].content, "<BehaviorTree");
+
+  EXPECT_EQ(files[1].relative_path, "mission/Main.xml");
+  expect_contains(files[1].content, "<BehaviorTree ID=\"Main\">");
+  expect_not_contains(files[1].content, "Helper");
+  expect_not_contains(files[1].content, "TreeNodesModel");
+  EXPECT_EQ(files[2].relative_path, "mission/Helper.xml");
+}
+
+TEST(CodegenXmlGenerator, KnownNodeModelsAreLeftOutOfManifest)
+{
+  SingleModulePipeline ctx;
+  ASSERT_TRUE(ctx.parse(R"(
+    extern action Log(in msg: string);
+    extern action Move(in speed: int32);
+    tree Main() {
+      Log(msg: "hi");
+      Move(speed: 1);
+    }
+  )"));
+  ASSERT_TRUE(ctx.analyze());
+
+  CodegenOptions options;
+  options.known_node_models = {"Log"};
+  const std::string xml = XmlGenerator::generate_single_output(ctx.module, options);
+
+  expect_contains(xml, "<Log msg=\"hi\"/>");
+  expect_not_contains(xml, "<Action ID=\"Log\"");
+  expect_contains(xml, "<Action ID=\"Move\">");
 }
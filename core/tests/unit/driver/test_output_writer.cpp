@@ -0,0 +1,112 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "bt_dsl/driver/output_writer.hpp"
+
+using namespace bt_dsl;
+
+namespace
+{
+
+namespace fs = std::filesystem;
+
+class OutputWriterTest : public ::testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    const auto * info = ::testing::UnitTest::GetInstance()->current_test_info();
+    dir_ = fs::temp_directory_path() / ("bt_dsl_output_writer_" + std::string(info->name()));
+    fs::remove_all(dir_);
+  }
+
+  void TearDown() override { fs::remove_all(dir_); }
+
+  static std::string read(const fs::path & p)
+  {
+    std::ifstream in(p, std::ios::binary);
+    std::ostringstream ss;
+    ss << in.rdbuf();
+    return ss.str();
+  }
+
+  fs::path dir_;
+};
+
+}  // namespace
+
+TEST_F(OutputWriterTest, SkipsFilesWhoseContentIsUnchanged)
+{
+  const fs::path path = dir_ / "sub" / "main.xml";
+
+  EXPECT_EQ(OutputWriter::write_if_changed({path, "<root/>"}).status, WriteStatus::Written);
+  EXPECT_EQ(read(path), "<root/>");
+
+  // Back-date the file so an accidental rewrite would be visible.
+  const auto old_time = fs::last_write_time(path) - std::chrono::hours(1);
+  fs::last_write_time(path, old_time);
+
+  EXPECT_EQ(OutputWriter::write_if_changed({path, "<root/>"}).status, WriteStatus::Unchanged);
+  EXPECT_EQ(fs::last_write_time(path), old_time);
+
+  EXPECT_EQ(OutputWriter::write_if_changed({path, "<root2/>"}).status, WriteStatus::Written);
+  EXPECT_EQ(read(path), "<root2/>");
+  EXPECT_NE(fs::last_write_time(path), old_time);
+}
+
+TEST_F(OutputWriterTest, RewriteKeepsFilePermissions)
+{
+  const fs::path path = dir_ / "run.sh";
+  ASSERT_EQ(OutputWriter::write_if_changed({path, "a"}).status, WriteStatus::Written);
+
+  const auto perms = fs::perms::owner_read | fs::perms::owner_write | fs::perms::owner_exec;
+  fs::permissions(path, perms);
+
+  EXPECT_EQ(OutputWriter::write_if_changed({path, "b"}).status, WriteStatus::Written);
+  EXPECT_EQ(read(path), "b");
+  EXPECT_EQ(fs::status(path).permissions(), perms);
+}
+
+TEST_F(OutputWriterTest, ParallelWritesLeaveNoTemporaryFiles)
+{
+  std::vector<OutputFile> files;
+  for (int i = 0; i < 32; ++i) {
+    files.push_back({dir_ / ("tree" + std::to_string(i) + ".xml"), std::to_string(i)});
+  }
+
+  const auto first = OutputWriter::write_all(files, 4);
+  ASSERT_EQ(first.size(), files.size());
+  for (size_t i = 0; i < files.size(); ++i) {
+    EXPECT_EQ(first[i].status, WriteStatus::Written);
+    EXPECT_EQ(first[i].path, files[i].path);
+    EXPECT_EQ(read(files[i].path), files[i].content);
+  }
+
+  files[7].content = "changed";
+  const auto second = OutputWriter::write_all(files, 4);
+  for (size_t i = 0; i < files.size(); ++i) {
+    EXPECT_EQ(second[i].status, i == 7 ? WriteStatus::Written : WriteStatus::Unchanged) << i;
+  }
+
+  size_t entries = 0;
+  for ([[maybe_unused]] const auto & e : fs::directory_iterator(dir_)) {
+    ++entries;
+  }
+  EXPECT_EQ(entries, files.size());
+}
+
+TEST_F(OutputWriterTest, ReportsUnwritableTarget)
+{
+  // The parent "directory" is a regular file.
+  ASSERT_EQ(OutputWriter::write_if_changed({dir_ / "blocker", "x"}).status, WriteStatus::Written);
+
+  const auto r = OutputWriter::write_if_changed({dir_ / "blocker" / "out.xml", "x"});
+  EXPECT_EQ(r.status, WriteStatus::Failed);
+  EXPECT_FALSE(r.error.empty());
+}
@@ -0,0 +1,120 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "bt_dsl/lsp/ast_index.hpp"
+#include "bt_dsl/lsp/lsp.hpp"
+#include "bt_dsl/test_support/parse_helpers.hpp"
+
+using namespace bt_dsl::lsp;
+
+namespace
+{
+
+constexpr const char * k_uri = "file:///tmp/test_ast_index.bt";
+
+const char * source()
+{
+  return "extern action Act(in x: int32, out y: int32);\n"
+         "var G: int32 = 0;\n"
+         "tree Main() {\n"
+         "  var a: int32 = 1;\n"
+         "  Sequence {\n"
+         "    Act(x: a, y: out var b);\n"
+         "    Act(x: G, y: out G);\n"
+         "  }\n"
+         "  a = a + 1;\n"
+         "}\n"
+         "tree Other() {\n"
+         "  Act(x: G, y: out G);\n"
+         "}\n";
+}
+
+uint32_t off_at(const std::string & s, const std::string & needle, uint32_t delta = 0)
+{
+  const auto pos = s.find(needle);
+  EXPECT_NE(pos, std::string::npos);
+  return static_cast<uint32_t>(pos) + delta;
+}
+
+/// "line:text:kind" per highlight.
+std::vector<std::string> describe(
+  const std::string & text, const std::vector<DocumentHighlight> & highlights)
+{
+  std::vector<std::string> out;
+  for (const auto & h : highlights) {
+    const auto line = std::count(text.begin(), text.begin() + h.range.startByte, '\n');
+    const char * kind = h.kind == HighlightKind::Write  ? "Write"
+                        : h.kind == HighlightKind::Read ? "Read"
+                                                        : "Text";
+    out.push_back(
+      std::to_string(line) + ":" +
+      text.substr(h.range.startByte, h.range.endByte - h.range.startByte) + ":" + kind);
+  }
+  return out;
+}
+
+}  // namespace
+
+TEST(LspAstIndex, HitTestingFindsInnermostNodes)
+{
+  const std::string src = source();
+  auto unit = bt_dsl::test_support::parse(src);
+  ASSERT_NE(unit.program, nullptr);
+  const AstIndex index(*unit.program);
+
+  const auto in_arg = index.hit_at(off_at(src, "x: a", 3));
+  ASSERT_NE(in_arg.tree, nullptr);
+  EXPECT_EQ(in_arg.tree->name, "Main");
+  ASSERT_NE(in_arg.node_stmt, nullptr);
+  EXPECT_EQ(in_arg.node_stmt->nodeName, "Act");
+  ASSERT_NE(in_arg.var_ref, nullptr);
+  EXPECT_EQ(in_arg.var_ref->name, "a");
+  EXPECT_EQ(in_arg.inline_decl, nullptr);
+
+  const auto on_parent = index.hit_at(off_at(src, "Sequence", 2));
+  ASSERT_NE(on_parent.node_stmt, nullptr);
+  EXPECT_EQ(on_parent.node_stmt->nodeName, "Sequence");
+  EXPECT_EQ(on_parent.var_ref, nullptr);
+
+  const auto on_decl = index.hit_at(off_at(src, "var b", 4));
+  ASSERT_NE(on_decl.inline_decl, nullptr);
+  EXPECT_EQ(on_decl.inline_decl->name, "b");
+
+  // Between the two calls: still inside Sequence.
+  const auto between = index.hit_at(off_at(src, "b);\n", 4));
+  ASSERT_NE(between.node_stmt, nullptr);
+  EXPECT_EQ(between.node_stmt->nodeName, "Sequence");
+
+  const auto outside = index.hit_at(off_at(src, "var G", 4));
+  EXPECT_EQ(outside.tree, nullptr);
+  EXPECT_EQ(outside.var_ref, nullptr);
+
+  ASSERT_NE(index.tree_at(off_at(src, "tree Other", 6)), nullptr);
+  EXPECT_EQ(index.tree_at(off_at(src, "tree Other", 6))->name, "Other");
+}
+
+TEST(LspAstIndex, HighlightsStayInTheTreeUnderTheCursor)
+{
+  const std::string src = source();
+  Workspace ws;
+  ws.set_document(k_uri, src);
+
+  // Local variable: declaration, then references and the assignment.
+  EXPECT_EQ(
+    describe(src, ws.document_highlights(k_uri, off_at(src, "x: a", 3))),
+    (std::vector<std::string>{"3:a:Write", "5:a:Read", "8:a:Write", "8:a:Read"}));
+
+  // Global: only occurrences in Main, not in Other.
+  EXPECT_EQ(
+    describe(src, ws.document_highlights(k_uri, off_at(src, "x: G", 3))),
+    (std::vector<std::string>{"1:G:Write", "6:G:Read", "6:G:Read"}));
+
+  // Node calls in this tree, then the declaration.
+  EXPECT_EQ(
+    describe(src, ws.document_highlights(k_uri, off_at(src, "Act(x: a", 1))),
+    (std::vector<std::string>{"5:Act:Text", "6:Act:Text", "0:Act:Text"}));
+}
@@ -4,8 +4,10 @@
 #include <string>
 
 #include "bt_dsl/lsp/completion_context.hpp"
+#include "bt_dsl/syntax/lexer.hpp"
 
 using bt_dsl::lsp::classify_completion_context;
+using bt_dsl::lsp::CompletionContextIndex;
 using bt_dsl::lsp::CompletionContextKind;
 
 namespace
@@ -158,3 +160,37 @@ TEST(LspCompletionContext, CallableNameWithNestedBraces)
     EXPECT_EQ(*ctxv.tree_name, "Main");
   }
 }
+
+TEST(LspCompletionContext, IndexResumesFromCheckpoints)
+{
+  // Enough trees for many checkpoints; every query replays from a different one.
+  std::string src;
+  for (int i = 0; i < 40; ++i) {
+    const std::string n = std::to_string(i);
+    src += "tree T" + n + "() {\n  Seq" + n + " {\n    Foo" + n + "(a: 1, b: x);\n  }\n}\n";
+  }
+
+  bt_dsl::syntax::Lexer lex(bt_dsl::FileId{0}, src);
+  const CompletionContextIndex index(lex.lex_all(), src.size());
+
+  for (int i = 0; i < 40; ++i) {
+    const std::string n = std::to_string(i);
+    const uint32_t call = off_at(src, "Foo" + n + "(");
+
+    const auto value = index.classify(off_at(src.substr(call), "a: ") + call + 3);
+    ASSERT_TRUE(value.has_value());
+    EXPECT_EQ(value->kind, CompletionContextKind::ArgValue);
+    EXPECT_EQ(value->tree_name, "T" + n);
+    EXPECT_EQ(value->callable_name, "Foo" + n);
+
+    const auto body = index.classify(call);
+    ASSERT_TRUE(body.has_value());
+    EXPECT_EQ(body->kind, CompletionContextKind::TreeBody);
+    EXPECT_EQ(body->tree_name, "T" + n);
+    EXPECT_EQ(body->callable_name, "Seq" + n);
+  }
+
+  const auto top = index.classify(static_cast<uint32_t>(src.size()));
+  ASSERT_TRUE(top.has_value());
+  EXPECT_EQ(top->kind, CompletionContextKind::TopLevelKeywords);
+}
@@ -0,0 +1,132 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "bt_dsl/lsp/lsp.hpp"
+#include "bt_dsl/lsp/semantic_tokens.hpp"
+#include "bt_dsl/lsp/text_edit.hpp"
+
+using namespace bt_dsl::lsp;
+
+namespace
+{
+
+constexpr const char * k_uri = "file:///tmp/test_semantic_tokens.bt";
+
+std::string source(const std::string & extra_line)
+{
+  return "extern action DoWork(in x: int32);\n"
+         "\n"
+         "tree Main() {\n"
+         "  var x: int32;\n" +
+         extra_line +
+         "  DoWork(x: x);\n"
+         "}\n";
+}
+
+std::vector<uint32_t> apply_edits(
+  std::vector<uint32_t> data, const std::vector<SemanticTokensEdit> & edits)
+{
+  // Edits refer to the original array; apply back to front.
+  for (auto it = edits.rbegin(); it != edits.rend(); ++it) {
+    const auto first = data.begin() + it->start;
+    data.erase(first, first + it->delete_count);
+    data.insert(data.begin() + it->start, it->data.begin(), it->data.end());
+  }
+  return data;
+}
+
+}  // namespace
+
+TEST(LspSemanticTokens, EncodesRelativePositions)
+{
+  const std::string text = "ab \xC3\xA9x yy\n  \xF0\x9F\x98\x80z\n";
+  std::vector<SemanticToken> tokens = {
+    {{16, 17}, SemanticTokenType::Variable, false},  // z, after an astral character
+    {{0, 2}, SemanticTokenType::Keyword, false},
+    {{3, 6}, SemanticTokenType::Function, true},  // éx
+    {{4, 5}, SemanticTokenType::Property, false},  // overlaps éx: dropped
+    {{7, 9}, SemanticTokenType::Parameter, false},
+  };
+  normalize_semantic_tokens(tokens);
+  ASSERT_EQ(tokens.size(), 4U);
+
+  const auto offsets = build_line_offsets(text);
+  EXPECT_EQ(
+    encode_semantic_tokens(text, offsets, tokens, PositionEncoding::Utf16),
+    (std::vector<uint32_t>{0, 0, 2, 2, 0, 0, 3, 2, 1, 1, 0, 3, 2, 5, 0, 1, 4, 1, 6, 0}));
+  EXPECT_EQ(
+    encode_semantic_tokens(text, offsets, tokens, PositionEncoding::Utf8),
+    (std::vector<uint32_t>{0, 0, 2, 2, 0, 0, 3, 3, 1, 1, 0, 4, 2, 5, 0, 1, 6, 1, 6, 0}));
+}
+
+TEST(LspSemanticTokens, DiffReplacesOnlyChangedTokens)
+{
+  const std::vector<uint32_t> prev = {0, 0, 2, 2, 0, 1, 2, 3, 1, 1, 1, 0, 4, 6, 0};
+  const std::vector<uint32_t> next = {0, 0, 2, 2, 0, 2, 2, 3, 1, 1, 1, 0, 4, 6, 0};
+
+  const auto edits = diff_semantic_tokens(prev, next);
+  ASSERT_EQ(edits.size(), 1U);
+  EXPECT_EQ(edits[0].start, 5U);
+  EXPECT_EQ(edits[0].delete_count, 5U);
+  EXPECT_EQ(apply_edits(prev, edits), next);
+
+  EXPECT_TRUE(diff_semantic_tokens(next, next).empty());
+  EXPECT_EQ(apply_edits(next, diff_semantic_tokens(next, {})), std::vector<uint32_t>{});
+  EXPECT_EQ(apply_edits({}, diff_semantic_tokens({}, next)), next);
+}
+
+TEST(LspSemanticTokens, WorkspaceServesDeltasAgainstThePreviousResult)
+{
+  Workspace ws;
+  ws.set_document(k_uri, source(""));
+
+  const auto first = ws.semantic_tokens_full(k_uri);
+  ASSERT_FALSE(first.result_id.empty());
+  ASSERT_FALSE(first.data.empty());
+  EXPECT_EQ(first.data.size() % 5, 0U);
+
+  // Unchanged: same result, no edits.
+  const auto same = ws.semantic_tokens_delta(k_uri, first.result_id);
+  EXPECT_EQ(same.result_id, first.result_id);
+  ASSERT_TRUE(same.edits.has_value());
+  EXPECT_TRUE(same.edits->empty());
+
+  ws.set_document(k_uri, source("  var y: int32;\n"));
+  const auto delta = ws.semantic_tokens_delta(k_uri, first.result_id);
+  EXPECT_NE(delta.result_id, first.result_id);
+  ASSERT_TRUE(delta.edits.has_value());
+  ASSERT_EQ(delta.edits->size(), 1U);
+  EXPECT_LT(delta.edits->front().data.size(), first.data.size());
+
+  const auto full = ws.semantic_tokens_full(k_uri);
+  EXPECT_EQ(full.result_id, delta.result_id);
+  EXPECT_EQ(apply_edits(first.data, *delta.edits), full.data);
+
+  // An unknown previous result gets the full encoding.
+  const auto unknown = ws.semantic_tokens_delta(k_uri, "no-such-result");
+  EXPECT_FALSE(unknown.edits.has_value());
+  EXPECT_EQ(unknown.data, full.data);
+}
+
+TEST(LspSemanticTokens, RangeEncodesOverlappingTokensOnly)
+{
+  const std::string src = source("");
+  Workspace ws;
+  ws.set_document(k_uri, src);
+
+  const auto line = static_cast<uint32_t>(src.find("  DoWork"));
+  const auto data = ws.semantic_tokens_range(k_uri, ByteRange{line, line + 10U});
+
+  // `DoWork` and the `x` port name, the first relative to the document start.
+  ASSERT_EQ(data.size(), 10U);
+  EXPECT_EQ(data[0], 4U);
+  EXPECT_EQ(data[1], 2U);
+  EXPECT_EQ(data[2], 6U);
+  EXPECT_EQ(data[5], 0U);
+  EXPECT_EQ(data[6], 7U);
+
+  EXPECT_TRUE(ws.semantic_tokens_range("file:///tmp/missing.bt", ByteRange{0, 10}).empty());
+}
@@ -0,0 +1,227 @@
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "bt_dsl/lsp/symbol_index.hpp"
+
+using namespace bt_dsl::lsp;
+
+namespace
+{
+
+namespace fs = std::filesystem;
+
+constexpr const char * k_lib_uri = "file:///proj/lib.bt";
+constexpr const char * k_main_uri = "file:///proj/main.bt";
+constexpr const char * k_other_uri = "file:///proj/other.bt";
+
+const char * lib_source()
+{
+  return "extern type Pose;\n"
+         "type Goal = Pose;\n"
+         "var Target: Goal;\n"
+         "extern action Move(in goal: Goal);\n"
+         "tree Approach() {\n"
+         "  Move(goal: Target);\n"
+         "}\n"
+         "tree _Helper() {\n"
+         "  Approach();\n"
+         "}\n";
+}
+
+const char * main_source()
+{
+  return "import \"./lib.bt\";\n"
+         "tree Main(Target: Pose) {\n"
+         "  Approach();\n"
+         "  Move(goal: Target);\n"
+         "  _Helper();\n"
+         "}\n";
+}
+
+SymbolIndex make_index()
+{
+  SymbolIndex index;
+  index.update(index_source(k_lib_uri, lib_source()));
+  index.update(index_source(k_main_uri, main_source()));
+  // Same names, but does not import lib.bt.
+  index.update(index_source(k_other_uri, "tree Other() {\n  Approach();\n}\n"));
+  return index;
+}
+
+std::vector<std::string> describe(const std::vector<ReferenceLocation> & refs)
+{
+  std::vector<std::string> out;
+  for (const auto & r : refs) {
+    out.push_back(
+      r.uri + ":" + std::to_string(r.range.line) + ":" + std::to_string(r.range.column));
+  }
+  return out;
+}
+
+class SymbolIndexFiles : public ::testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    const auto * info = ::testing::UnitTest::GetInstance()->current_test_info();
+    dir_ = fs::temp_directory_path() / ("bt_dsl_symbol_index_" + std::string(info->name()));
+    fs::remove_all(dir_);
+    fs::create_directories(dir_);
+  }
+
+  void TearDown() override { fs::remove_all(dir_); }
+
+  void write(const fs::path & rel, const std::string & content) const
+  {
+    fs::create_directories((dir_ / rel).parent_path());
+    std::ofstream(dir_ / rel, std::ios::binary) << content;
+  }
+
+  fs::path dir_;
+};
+
+}  // namespace
+
+TEST(LspSymbolIndex, IndexesDeclarationsReferencesAndImports)
+{
+  const FileIndex lib = index_source(k_lib_uri, lib_source());
+
+  ASSERT_EQ(lib.symbols.size(), 6U);
+  EXPECT_EQ(lib.symbols[0].name, "Pose");
+  EXPECT_EQ(lib.symbols[0].kind, IndexSymbolKind::Type);
+  EXPECT_EQ(lib.symbols[3].name, "Move");
+  EXPECT_EQ(lib.symbols[3].kind, IndexSymbolKind::Node);
+  EXPECT_EQ(lib.symbols[3].range.line, 3U);
+  EXPECT_EQ(lib.symbols[3].range.column, 14U);
+  EXPECT_EQ(lib.symbols[3].range.length, 4U);
+
+  const FileIndex main = index_source(k_main_uri, main_source());
+  EXPECT_EQ(main.imports, std::vector<std::string>{k_lib_uri});
+
+  // The `Target` parameter hides the global: only the type and calls count.
+  std::vector<std::string> names;
+  for (const auto & r : main.references) {
+    names.push_back(r.name);
+  }
+  EXPECT_EQ(names, (std::vector<std::string>{"Pose", "Approach", "Move", "_Helper"}));
+}
+
+TEST(LspSymbolIndex, ReferencesFollowImportsAndVisibility)
+{
+  const SymbolIndex index = make_index();
+
+  // From the call in main.bt to the declaration in lib.bt.
+  const auto decl = index.symbol_at(k_main_uri, 2, 3);
+  ASSERT_TRUE(decl.has_value());
+  EXPECT_EQ(decl->uri, k_lib_uri);
+  EXPECT_EQ(decl->symbol.name, "Approach");
+  EXPECT_EQ(decl->symbol.range.line, 4U);
+
+  EXPECT_EQ(
+    describe(index.references(*decl)),
+    (std::vector<std::string>{"file:///proj/lib.bt:8:2", "file:///proj/main.bt:2:2"}));
+
+  // Private trees are not visible to importers.
+  EXPECT_FALSE(index.symbol_at(k_main_uri, 4, 3).has_value());
+
+  const auto target = index.symbol_at(k_lib_uri, 2, 4);
+  ASSERT_TRUE(target.has_value());
+  EXPECT_EQ(
+    describe(index.references(*target)), std::vector<std::string>{"file:///proj/lib.bt:5:13"});
+}
+
+TEST(LspSymbolIndex, UpdateAndRemoveReplaceAFilesEntries)
+{
+  SymbolIndex index = make_index();
+  const auto decl = index.symbol_at(k_lib_uri, 4, 6);
+  ASSERT_TRUE(decl.has_value());
+
+  index.update(index_source(k_main_uri, "import \"./lib.bt\";\ntree Main() {\n}\n"));
+  EXPECT_EQ(index.references(*decl).size(), 1U);
+
+  index.remove(k_lib_uri);
+  EXPECT_EQ(index.file(k_lib_uri), nullptr);
+  EXPECT_TRUE(index.references(*decl).empty());
+  EXPECT_EQ(index.uris(), (std::vector<std::string>{k_main_uri, k_other_uri}));
+}
+
+TEST(LspSymbolIndex, FindSymbolsRanksPrefixMatchesFirst)
+{
+  const SymbolIndex index = make_index();
+
+  const auto matches = index.find_symbols("ap", 10);
+  ASSERT_EQ(matches.size(), 1U);
+  EXPECT_EQ(matches[0].symbol.name, "Approach");
+
+  const auto fuzzy = index.find_symbols("m", 10);
+  ASSERT_EQ(fuzzy.size(), 2U);
+  EXPECT_EQ(fuzzy[0].symbol.name, "Main");
+  EXPECT_EQ(fuzzy[1].symbol.name, "Move");
+
+  EXPECT_EQ(index.find_symbols("", 3).size(), 3U);
+  EXPECT_TRUE(index.find_symbols("zzz", 10).empty());
+}
+
+TEST(LspSymbolIndex, ValidatesNewNames)
+{
+  EXPECT_TRUE(is_valid_symbol_name("Approach2"));
+  EXPECT_TRUE(is_valid_symbol_name("_private"));
+  EXPECT_FALSE(is_valid_symbol_name(""));
+  EXPECT_FALSE(is_valid_symbol_name("tree"));
+  EXPECT_FALSE(is_valid_symbol_name("out"));
+  EXPECT_FALSE(is_valid_symbol_name("true"));
+  EXPECT_FALSE(is_valid_symbol_name("2x"));
+  EXPECT_FALSE(is_valid_symbol_name("a b"));
+}
+
+TEST_F(SymbolIndexFiles, SavedIndexLoadsBack)
+{
+  SymbolIndex index = make_index();
+  FileIndex stamped = index_source(k_other_uri, "tree Other() {\n}\n");
+  stamped.mtime = 42;
+  stamped.size = 17;
+  index.update(std::move(stamped));
+
+  const fs::path path = dir_ / "cache" / "index.json";
+  ASSERT_TRUE(index.save(path));
+
+  SymbolIndex loaded;
+  ASSERT_TRUE(loaded.load(path));
+  EXPECT_EQ(loaded.uris(), index.uris());
+  ASSERT_NE(loaded.file(k_other_uri), nullptr);
+  EXPECT_EQ(loaded.file(k_other_uri)->mtime, 42);
+  EXPECT_EQ(loaded.file(k_other_uri)->size, 17U);
+
+  const auto decl = loaded.symbol_at(k_main_uri, 2, 3);
+  ASSERT_TRUE(decl.has_value());
+  EXPECT_EQ(describe(loaded.references(*decl)), describe(index.references(*decl)));
+
+  write("cache/index.json", "{\"format\": 0, \"files\": []}");
+  EXPECT_FALSE(loaded.load(path));
+  EXPECT_TRUE(loaded.uris().empty());
+}
+
+TEST_F(SymbolIndexFiles, FindsProjectRootsAndSources)
+{
+  write("app/btc.yaml", "package:\n  name: app\ndependencies:\n  - path: ../libs/common\n");
+  write("app/main.bt", "");
+  write("app/sub/more.bt", "");
+  write("app/.cache/skipped.bt", "");
+  write("app/notes.txt", "");
+  write("libs/common/common.bt", "");
+  write("unrelated/loose.bt", "");
+
+  const auto roots = find_index_roots({dir_});
+  const auto canonical = fs::weakly_canonical(dir_);
+  EXPECT_EQ(roots, (std::vector<fs::path>{canonical / "app", canonical / "libs" / "common"}));
+
+  EXPECT_EQ(
+    list_index_sources(roots),
+    (std::vector<fs::path>{
+      canonical / "app" / "main.bt", canonical / "app" / "sub" / "more.bt",
+      canonical / "libs" / "common" / "common.bt"}));
+}
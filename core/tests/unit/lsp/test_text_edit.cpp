@@ -0,0 +1,57 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "bt_dsl/lsp/text_edit.hpp"
+
+using bt_dsl::lsp::apply_text_edit;
+using bt_dsl::lsp::build_line_offsets;
+using bt_dsl::lsp::ByteRange;
+
+namespace
+{
+
+struct Edit
+{
+  ByteRange range;
+  std::string text;
+};
+
+}  // namespace
+
+TEST(LspTextEdit, LineOffsetsMatchRebuildAfterEachEdit)
+{
+  std::string text = "tree Main() {\n  A();\n  B();\n}\n";
+  std::vector<uint32_t> offsets = build_line_offsets(text);
+
+  const std::vector<Edit> edits = {
+    {{14, 14}, "  X();\n"},           // insert a line
+    {{16, 17}, "Y"},                  // same-length change within a line
+    {{13, 28}, ""},                   // join lines
+    {{0, 0}, "// a\n// b\n\n"},       // insert at start
+    {{5, 9}, "\n\n"},                 // replace a newline with two
+    {{200, 300}, "\nend"},            // out of range: clamped to the end
+    {{0, 10'000}, "x"},               // replace everything
+  };
+
+  for (const auto & e : edits) {
+    const auto placed = apply_text_edit(text, offsets, e.range, e.text);
+    EXPECT_EQ(text.substr(placed.startByte, placed.endByte - placed.startByte), e.text);
+    EXPECT_EQ(offsets, build_line_offsets(text)) << "after inserting '" << e.text << "'";
+  }
+  EXPECT_EQ(text, "x");
+}
+
+TEST(LspTextEdit, ReversedRangeIsTreatedAsInsertion)
+{
+  std::string text = "ab\ncd\n";
+  std::vector<uint32_t> offsets = build_line_offsets(text);
+
+  const auto placed = apply_text_edit(text, offsets, ByteRange{4, 1}, "\n");
+
+  EXPECT_EQ(text, "ab\nc\nd\n");
+  EXPECT_EQ(placed.startByte, 4U);
+  EXPECT_EQ(offsets, build_line_offsets(text));
+}
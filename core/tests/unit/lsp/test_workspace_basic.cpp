@@ -1,9 +1,11 @@
 #include <gtest/gtest.h>
 
+#include <algorithm>
 #include <cstdint>
 #include <iostream>
 #include <nlohmann/json.hpp>
 #include <string>
+#include <vector>
 
 #include "bt_dsl/lsp/lsp.hpp"
 
@@ -133,6 +135,49 @@ TEST(LspWorkspace, DefinitionPointsToDecl)
   EXPECT_TRUE(start_byte <= decl_pos && decl_pos < end_byte);
 }
 
+TEST(LspWorkspace, TypedQueriesReturnByteRanges)
+{
+  using json = nlohmann::json;
+  using namespace bt_dsl::lsp;
+
+  const std::string src = basic_source();
+  Workspace ws;
+  ws.set_document(k_uri, src);
+
+  const uint32_t use = static_cast<uint32_t>(src.rfind("in x")) + 3U;
+  const uint32_t decl = find_byte_offset(src, "var x") + 4U;
+
+  const auto defs = ws.definition(k_uri, use);
+  ASSERT_EQ(defs.size(), 1U);
+  EXPECT_EQ(defs[0].uri, k_uri);
+  EXPECT_EQ(defs[0].range.startByte, decl);
+  EXPECT_EQ(defs[0].range.endByte, decl + 1U);
+
+  const auto hover = ws.hover(k_uri, use);
+  ASSERT_TRUE(hover.has_value());
+  EXPECT_EQ(hover->range.startByte, use);
+
+  const auto symbols = ws.document_symbols(k_uri);
+  ASSERT_EQ(symbols.size(), 3U);
+  EXPECT_EQ(symbols[2].name, "Main");
+  EXPECT_EQ(symbols[2].kind, DocumentSymbolKind::Tree);
+
+  const auto tokens = ws.semantic_tokens(k_uri);
+  ASSERT_FALSE(tokens.empty());
+  EXPECT_EQ(to_string(tokens[0].type), "keyword");  // extern control Sequence
+  EXPECT_TRUE(tokens[0].declaration);
+
+  // The JSON adapter carries the same ranges, plus line/column.
+  const auto j = json::parse(ws.definition_json(k_uri, use));
+  const auto & r = j["locations"][0]["range"];
+  EXPECT_EQ(r["startByte"].get<uint32_t>(), decl);
+  EXPECT_EQ(r["startLine"].get<int>(), 5);
+  EXPECT_EQ(r["startColumn"].get<int>(), 7);
+
+  EXPECT_TRUE(ws.diagnostics(k_uri).empty());
+  EXPECT_TRUE(ws.definition("file:///tmp/missing.bt", 0).empty());
+}
+
 TEST(LspWorkspace, DocumentSymbols)
 {
   using json = nlohmann::json;
@@ -295,3 +340,170 @@ TEST(LspWorkspace, PortCompletionWithJapaneseCommentBefore)
   EXPECT_TRUE(has_pos) << "Expected 'pos' port in completions with Japanese comment";
   EXPECT_TRUE(has_found) << "Expected 'found' port in completions with Japanese comment";
 }
+
+TEST(LspWorkspace, ApplyEditTracksEditedRangeUntilReparse)
+{
+  using json = nlohmann::json;
+
+  bt_dsl::lsp::Workspace ws;
+  const std::string uri = "file:///tmp/test_workspace_edit.bt";
+  ws.set_document(uri, basic_source());
+  EXPECT_FALSE(ws.edited_range(uri).has_value());
+  EXPECT_FALSE(ws.apply_edit("file:///tmp/missing.bt", {0, 0}, "x"));
+
+  // `x = 0;` -> `x = 10;`, then a new statement before it.
+  const uint32_t zero = find_byte_offset(basic_source(), "x = 0;") + 4U;
+  ASSERT_TRUE(ws.apply_edit(uri, {zero, zero}, "1"));
+  const uint32_t stmt = zero - 4U;
+  ASSERT_TRUE(ws.apply_edit(uri, {stmt, stmt}, "y = 1;\n    "));
+
+  const auto edited = ws.edited_range(uri);
+  ASSERT_TRUE(edited.has_value());
+  EXPECT_EQ(edited->startByte, stmt);
+  EXPECT_EQ(edited->endByte, zero + 11U + 1U);
+
+  // The edited text is what gets analyzed.
+  const auto j = json::parse(ws.diagnostics_json(uri));
+  EXPECT_TRUE(j["items"].empty()) << j.dump();
+  EXPECT_FALSE(ws.edited_range(uri).has_value());
+
+  ws.set_document(uri, "tree Main() {}\n");
+  ASSERT_TRUE(ws.apply_edit(uri, {0, 4}, "tree"));
+  ws.set_document(uri, "tree Main() {}\n");
+  EXPECT_FALSE(ws.edited_range(uri).has_value());
+}
+
+TEST(LspWorkspace, EditingAnImportInvalidatesTransitiveImporters)
+{
+  bt_dsl::lsp::Workspace ws;
+  const std::string lib = "file:///tmp/ws_deps/lib.bt";
+  const std::string mid = "file:///tmp/ws_deps/mid.bt";
+  const std::string top = "file:///tmp/ws_deps/top.bt";
+  const std::string other = "file:///tmp/ws_deps/other.bt";
+
+  ws.set_document(lib, "extern action Work();\n");
+  ws.set_document(mid, "import \"./lib.bt\";\ntree Mid() {\n  Work();\n}\n");
+  ws.set_document(top, "import \"./mid.bt\";\ntree Main() {\n  Mid();\n}\n");
+  ws.set_document(other, "tree Other() {}\n");
+
+  const auto mid_imports = ws.resolve_imports(mid);
+  const auto top_imports = ws.resolve_imports(top);
+  ASSERT_EQ(mid_imports, std::vector<std::string>{lib});
+  ASSERT_EQ(top_imports, std::vector<std::string>{mid});
+
+  EXPECT_TRUE(ws.diagnostics(mid, mid_imports).empty());
+  EXPECT_TRUE(ws.diagnostics(top, top_imports).empty());
+  EXPECT_TRUE(ws.diagnostics(other).empty());
+
+  auto deps = ws.dependents(lib);
+  std::sort(deps.begin(), deps.end());
+  EXPECT_EQ(deps, (std::vector<std::string>{mid, top}));
+  EXPECT_TRUE(ws.dependents(other).empty());
+
+  // Same import list as before: only the content version tells mid it is stale.
+  ASSERT_TRUE(ws.apply_edit(lib, {14, 18}, "Rest"));
+  const auto diags = ws.diagnostics(mid, mid_imports);
+  ASSERT_EQ(diags.size(), 1U);
+  EXPECT_NE(diags[0].message.find("'Work'"), std::string::npos);
+  EXPECT_TRUE(ws.diagnostics(top, top_imports).empty());
+
+  ws.set_document(lib, "extern action Work();\n");
+  EXPECT_TRUE(ws.diagnostics(mid, mid_imports).empty());
+
+  // Removing an import keeps the edge, so reloading it invalidates again.
+  ws.remove_document(lib);
+  EXPECT_FALSE(ws.diagnostics(mid, mid_imports).empty());
+  ws.set_document(lib, "extern action Work();\n");
+  EXPECT_TRUE(ws.diagnostics(mid, mid_imports).empty());
+}
+
+TEST(LspWorkspace, RecursionAcrossDocumentsIsReportedWhereTheCycleCloses)
+{
+  bt_dsl::lsp::Workspace ws;
+  const std::string a = "file:///tmp/ws_calls/a.bt";
+  const std::string b = "file:///tmp/ws_calls/b.bt";
+
+  ws.set_document(a, "import \"./b.bt\";\ntree A() {\n  B();\n}\n");
+  ws.set_document(b, "import \"./a.bt\";\ntree B() {\n  A();\n}\n");
+
+  // Each document alone is fine; the cycle closes at B's call once both are
+  // in the call graph.
+  EXPECT_TRUE(ws.diagnostics(a, {b}).empty());
+  const auto diags = ws.diagnostics(b, {a});
+  ASSERT_EQ(diags.size(), 1U);
+  EXPECT_NE(diags[0].message.find("A -> B -> A"), std::string::npos);
+
+  // Breaking the cycle drops both documents from the graph, stale trees too.
+  ws.set_document(a, "import \"./b.bt\";\ntree A() {}\n");
+  EXPECT_TRUE(ws.diagnostics(a, {b}).empty());
+  EXPECT_TRUE(ws.diagnostics(b, {a}).empty());
+}
+
+TEST(LspWorkspace, MemoryBudgetReleasesLeastRecentlyUsedDocuments)
+{
+  bt_dsl::lsp::Workspace ws;
+  const std::string lib = "file:///tmp/ws_memory/lib.bt";
+  const std::string main = "file:///tmp/ws_memory/main.bt";
+  const std::string a = "file:///tmp/ws_memory/a.bt";
+  const std::string b = "file:///tmp/ws_memory/b.bt";
+
+  ws.set_document(lib, "extern action Work();\n");
+  ws.set_document(main, "import \"./lib.bt\";\ntree Main() {\n  Work();\n}\n");
+  ws.set_document(a, "tree A() {\n  Missing();\n}\n");
+  ws.set_document(b, "tree B() {}\n");
+  ws.set_pinned(main, true);
+
+  const auto main_imports = ws.resolve_imports(main);
+  EXPECT_TRUE(ws.diagnostics(main, main_imports).empty());
+  const auto a_diags = ws.diagnostics(a);
+  ASSERT_EQ(a_diags.size(), 1U);
+  EXPECT_TRUE(ws.diagnostics(b).empty());
+
+  auto usage = ws.memory_usage();
+  EXPECT_EQ(usage.budget_bytes, 0U);
+  EXPECT_EQ(usage.evictions, 0U);
+  ASSERT_EQ(usage.documents.size(), 4U);
+  size_t arena = 0;
+  for (const auto & d : usage.documents) {
+    EXPECT_GT(d.arena_bytes, 0U) << d.uri;
+    EXPECT_GT(d.text_bytes, 0U) << d.uri;
+    arena += d.arena_bytes;
+  }
+  EXPECT_EQ(usage.arena_bytes, arena);
+
+  auto state_of = [&](const std::string & uri) {
+    for (const auto & d : ws.memory_usage().documents) {
+      if (d.uri == uri) {
+        return d.arena_bytes + d.other_bytes;
+      }
+    }
+    return size_t{0};
+  };
+
+  // lib is older, but main is open and analyzed against it: a goes first.
+  ws.set_memory_budget(usage.arena_bytes + usage.other_bytes - 1);
+  EXPECT_EQ(state_of(a), 0U);
+  EXPECT_GT(state_of(b), 0U);
+  EXPECT_GT(state_of(lib), 0U);
+  EXPECT_EQ(ws.memory_usage().evictions, 1U);
+
+  // Released documents are re-analyzed on their next query.
+  const auto again = ws.diagnostics(a);
+  ASSERT_EQ(again.size(), 1U);
+  EXPECT_EQ(again[0].message, a_diags[0].message);
+  EXPECT_EQ(again[0].range.startByte, a_diags[0].range.startByte);
+
+  ws.set_memory_budget(1);
+  EXPECT_EQ(state_of(a), 0U);
+  EXPECT_EQ(state_of(b), 0U);
+  EXPECT_GT(state_of(lib), 0U);
+  EXPECT_GT(state_of(main), 0U);
+  EXPECT_EQ(ws.memory_usage().text_bytes, usage.text_bytes);
+
+  // Unpinned, main goes along with its import.
+  ws.set_pinned(main, false);
+  ws.set_memory_budget(1);
+  EXPECT_EQ(state_of(lib), 0U);
+  EXPECT_EQ(state_of(main), 0U);
+  EXPECT_TRUE(ws.diagnostics(main, main_imports).empty());
+}
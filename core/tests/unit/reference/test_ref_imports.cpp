@@ -16,6 +16,7 @@
 #include "bt_dsl/sema/resolution/module_graph.hpp"
 #include "bt_dsl/sema/resolution/module_resolver.hpp"
 #include "bt_dsl/sema/resolution/name_resolver.hpp"
+#include "bt_dsl/sema/types/type_checker.hpp"
 
 using namespace bt_dsl;
 
@@ -199,3 +200,106 @@ TEST(RefImports, AmbiguousImportNoUseOk)
 
   EXPECT_TRUE(ctx.resolve_names("Main.bt"));
 }
+
+TEST(RefImports, ImportIndexMergesPublicNames)
+{
+  // The merged index holds public names only, flags names exported by more
+  // than one import, and is consulted for all three namespaces.
+  ImportTestContext ctx;
+  ctx.create_file("LibA.bt", R"(
+    extern type Pose;
+    extern action Foo();
+    extern action _Hidden();
+    var Shared: int32 = 1;
+  )");
+  ctx.create_file("LibB.bt", R"(
+    extern type Pose;
+    extern action Bar();
+    var Shared: int32 = 2;
+  )");
+  ctx.create_file("Main.bt", R"(
+    import "./LibA.bt";
+    import "./LibB.bt";
+    var Shared: int32 = 0;
+    tree Main() {
+      Foo();
+      Bar();
+    }
+  )");
+
+  ASSERT_TRUE(ctx.resolve_names("Main.bt"));
+
+  const ModuleInfo * main_mod = ctx.graph.get_module(ctx.temp_dir.path / "Main.bt");
+  ASSERT_NE(main_mod, nullptr);
+  const ImportIndex & index = main_mod->import_index;
+
+  const auto * foo = index.find_node("Foo");
+  ASSERT_NE(foo, nullptr);
+  EXPECT_FALSE(foo->ambiguous);
+  ASSERT_NE(index.find_node("Bar"), nullptr);
+  EXPECT_EQ(index.find_node("_Hidden"), nullptr);
+
+  const auto * pose = index.find_type("Pose");
+  ASSERT_NE(pose, nullptr);
+  EXPECT_TRUE(pose->ambiguous);
+  EXPECT_EQ(index.find_type("int32"), nullptr);
+
+  // Indexed as ambiguous, but the local declaration shadows it.
+  const auto * shared = index.find_value("Shared");
+  ASSERT_NE(shared, nullptr);
+  EXPECT_TRUE(shared->ambiguous);
+}
+
+TEST(RefImports, AmbiguousImportedTypeError)
+{
+  ImportTestContext ctx;
+  ctx.create_file("LibA.bt", "extern type Pose;");
+  ctx.create_file("LibB.bt", "extern type Pose;");
+  ctx.create_file("Main.bt", R"(
+    import "./LibA.bt";
+    import "./LibB.bt";
+    var P: Pose?;
+    tree Main() {}
+  )");
+
+  EXPECT_FALSE(ctx.resolve_names("Main.bt"));
+}
+
+TEST(RefImports, ImportedTypeResolvesInTypeChecker)
+{
+  // Type annotations use the binding recorded by NameResolver, so an
+  // imported extern type is known to the importing module's TypeChecker.
+  ImportTestContext ctx;
+  ctx.create_file("Lib.bt", R"(
+    extern type Pose;
+    extern action Act(in p: Pose?);
+  )");
+  ctx.create_file("Main.bt", R"(
+    import "./Lib.bt";
+    var Target: Pose?;
+    tree Main() {
+      Act(p: Target);
+    }
+  )");
+
+  ASSERT_TRUE(ctx.resolve_names("Main.bt"));
+  ModuleInfo * main_mod = ctx.graph.get_module(ctx.temp_dir.path / "Main.bt");
+  ModuleInfo * lib_mod = ctx.graph.get_module(ctx.temp_dir.path / "Lib.bt");
+  ASSERT_NE(main_mod, nullptr);
+  ASSERT_NE(lib_mod, nullptr);
+  NameResolver lib_resolver(*lib_mod, &ctx.diags);
+  ASSERT_TRUE(lib_resolver.resolve());
+
+  TypeContext types;
+  TypeChecker checker(types, main_mod->types, main_mod->values, &ctx.diags);
+  EXPECT_TRUE(checker.check(*main_mod->program));
+  EXPECT_FALSE(ctx.diags.has_errors());
+
+  const auto * var = main_mod->program->global_vars()[0];
+  const Type * t = get_resolved_type(var->type, types);
+  ASSERT_NE(t, nullptr);
+  ASSERT_EQ(t->kind, TypeKind::Nullable);
+  ASSERT_NE(t->base_type, nullptr);
+  EXPECT_EQ(t->base_type->kind, TypeKind::Extern);
+  EXPECT_EQ(t->base_type->name, "Pose");
+}
@@ -255,8 +255,8 @@ TEST(RefXmlMapping, PreconditionFailureIf)
   XmlTestContext ctx;
   ASSERT_TRUE(ctx.parse(R"(
     extern action Foo();
-    tree Main() {
-      @failure_if(false)
+    tree Main(in failed: bool) {
+      @failure_if(failed)
       Foo();
     }
   )"));
@@ -283,8 +283,8 @@ TEST(RefXmlMapping, PreconditionRunWhile)
   XmlTestContext ctx;
   ASSERT_TRUE(ctx.parse(R"(
     extern action Foo();
-    tree Main() {
-      @run_while(true)
+    tree Main(in active: bool) {
+      @run_while(active)
       Foo();
     }
   )"));
@@ -409,8 +409,8 @@ TEST(RefXmlMapping, GuardTransformation)
   XmlTestContext ctx;
   ASSERT_TRUE(ctx.parse(R"(
     extern action DoWork();
-    tree Main() {
-      @guard(true)
+    tree Main(in ready: bool) {
+      @guard(ready)
       DoWork();
     }
   )"));
@@ -523,6 +523,32 @@ TEST(SemaConstEvaluator, ConstChain)
   EXPECT_EQ(val_c->as_integer(), 3);
 }
 
+TEST(SemaConstEvaluator, PrivateResultsAreNotPublishedToDeclarations)
+{
+  TestContext ctx;
+  ASSERT_TRUE(ctx.parse(R"(
+    const A = 1;
+    const B = A + 1;
+  )"));
+  ASSERT_TRUE(ctx.resolve_names());
+
+  // Values live in the evaluator's own arena and must not leak into the AST.
+  AstContext scratch;
+  ConstEvaluator eval(scratch, ctx.types, ctx.module.values);
+  eval.keep_results_private();
+  const ConstValue val = eval.evaluate(ctx.program->global_consts()[1]->value);
+  ASSERT_TRUE(val.is_integer());
+  EXPECT_EQ(val.as_integer(), 2);
+  EXPECT_EQ(ctx.get_global_const_value(0), nullptr);
+  EXPECT_EQ(ctx.get_global_const_value(1), nullptr);
+
+  // By default, constants evaluated on demand are published.
+  ConstEvaluator publishing(*ctx.module.ast, ctx.types, ctx.module.values);
+  (void)publishing.evaluate(ctx.program->global_consts()[1]->value);
+  ASSERT_NE(ctx.get_global_const_value(0), nullptr);
+  EXPECT_EQ(ctx.get_global_const_value(0)->as_integer(), 1);
+}
+
 // ============================================================================
 // Array Literal Tests
 // ============================================================================
@@ -57,7 +57,7 @@ TEST(ErrorMessagesTest, SemanticErrorsReportedWithSyntaxErrors)
   // Check that we have both syntax and semantic-related parse errors
   bool found_semicolon_error = false;
   for (const auto & d : unit.diags.all()) {
-    if (d.message.find("';'") != std::string::npos) {
+    if (d.message.str().find("';'") != std::string::npos) {
       found_semicolon_error = true;
       break;
     }
@@ -160,14 +160,14 @@ TEST(ErrorMessagesTest, RedefinitionErrorsAreDeduplicated)
   bool has_prev_def_note = false;
 
   for (const auto & d : diags.all()) {
-    if (d.message.find("redefinition of node 'T'") != std::string::npos) {
+    if (d.message.str().find("redefinition of node 'T'") != std::string::npos) {
       redef_count++;
     }
-    if (d.message.find("previous definition is here") != std::string::npos) {
+    if (d.message.str().find("previous definition is here") != std::string::npos) {
       has_prev_def_note = true;
     }
     for (const auto & l : d.labels) {
-      if (l.message.find("previous definition is here") != std::string::npos) {
+      if (l.message.str().find("previous definition is here") != std::string::npos) {
         has_prev_def_note = true;
       }
     }
@@ -192,8 +192,8 @@ TEST(ErrorMessagesTest, MissingRequiredPortIsReported)
   bool found_missing_port = false;
   for (const auto & d : diags.all()) {
     if (
-      d.message.find("missing required parameter 'req'") != std::string::npos ||
-      d.message.find("missing required port 'req'") != std::string::npos) {
+      d.message.str().find("missing required parameter 'req'") != std::string::npos ||
+      d.message.str().find("missing required port 'req'") != std::string::npos) {
       found_missing_port = true;
     }
   }
@@ -201,4 +201,55 @@ TEST(ErrorMessagesTest, MissingRequiredPortIsReported)
   EXPECT_TRUE(found_missing_port) << "Should report 'missing required port/parameter'";
 }
 
+// =============================================================================
+// Test: DiagnosticBag counters, views and deferred messages
+// =============================================================================
+
+TEST(ErrorMessagesTest, DiagnosticBagCountsAndDefersFormatting)
+{
+  bt_dsl::DiagnosticBag bag;
+  bag.report_warning(bt_dsl::SourceRange{}, "unused value");
+  bag.report_error(
+    bt_dsl::SourceRange{},
+    bt_dsl::DiagnosticMessage::format("use of undeclared node '{}' ({} args)", "Foo", 2));
+  bag.report_hint(bt_dsl::SourceRange{}, std::string("owned hint"));
+
+  EXPECT_EQ(bag.error_count(), 1U);
+  EXPECT_EQ(bag.warning_count(), 1U);
+  EXPECT_EQ(bag.count(bt_dsl::Severity::Hint), 1U);
+  EXPECT_TRUE(bag.has_errors());
+
+  const auto errors = bag.errors();
+  ASSERT_EQ(errors.size(), 1U);
+  const bt_dsl::Diagnostic & err = *errors.begin();
+  EXPECT_TRUE(err.message.is_deferred());
+  EXPECT_EQ(err.message.str(), "use of undeclared node 'Foo' (2 args)");
+  EXPECT_TRUE(err.labels.front().message.empty());
+
+  size_t warnings = 0;
+  for (const auto & w : bag.warnings()) {
+    EXPECT_EQ(w.message.str(), "unused value");
+    ++warnings;
+  }
+  EXPECT_EQ(warnings, 1U);
+  EXPECT_TRUE(bag.by_severity(bt_dsl::Severity::Info).empty());
+
+  bt_dsl::DiagnosticBag merged;
+  merged.merge(std::move(bag));
+  EXPECT_EQ(merged.error_count(), 1U);
+  EXPECT_EQ(merged.size(), 3U);
+}
+
+TEST(ErrorMessagesTest, DiagnosticMessageCopiesUnlessLiteral)
+{
+  std::string text = "temporary text";
+  const bt_dsl::DiagnosticMessage copied(text.c_str());
+  text.assign(text.size(), 'x');
+  EXPECT_EQ(copied.str(), "temporary text");
+
+  const auto literal = bt_dsl::DiagnosticMessage::literal("static text");
+  EXPECT_FALSE(literal.is_deferred());
+  EXPECT_EQ(literal.str(), "static text");
+}
+
 }  // namespace
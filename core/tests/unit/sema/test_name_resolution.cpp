@@ -254,6 +254,63 @@ TEST(SemaNameResolver, ResolveParameter)
   EXPECT_EQ(var_ref->resolvedSymbol->name, "x");
 }
 
+TEST(SemaNameResolver, RecordsLexicalBindings)
+{
+  const std::string src = R"(
+    extern action Log(value: int);
+    extern control Sequence();
+    var counter: int = 0;
+    tree Main(in x: int) {
+      var y: int = x;
+      Sequence {
+        Log(value: y);
+      }
+      counter = y;
+    }
+  )";
+  const auto unit = test_support::parse(src);
+  ASSERT_FALSE(unit.diags.has_errors());
+  Program * program = unit.program;
+  ASSERT_NE(program, nullptr);
+
+  ModuleInfo module = create_test_module(*program);
+
+  NameResolver resolver(module);
+  ASSERT_TRUE(resolver.resolve());
+
+  auto * tree = program->trees()[0];
+  ASSERT_EQ(tree->body.size(), 3U);
+
+  // Declaration sites record their own slot at depth 0.
+  const ParamDecl * param = tree->params[0];
+  ASSERT_TRUE(param->binding.is_local_slot());
+  EXPECT_EQ(param->binding.depth, 0U);
+  EXPECT_EQ(module.values.symbol_at(param->binding)->astNode, param);
+
+  auto * decl = cast<BlackboardDeclStmt>(tree->body[0]);
+  ASSERT_TRUE(decl->binding.is_local_slot());
+  EXPECT_EQ(module.values.symbol_at(decl->binding)->astNode, decl);
+
+  // Initializer `x` resolves to the parameter in the same (tree) scope.
+  auto * init = cast<VarRefExpr>(decl->initialValue);
+  EXPECT_EQ(init->binding.slot, param->binding.slot);
+  EXPECT_EQ(init->binding.depth, 0U);
+
+  // Inside the children block, `y` is one scope up.
+  auto * seq = cast<NodeStmt>(tree->body[1]);
+  auto * log = cast<NodeStmt>(seq->children[0]);
+  auto * y_ref = cast<VarRefExpr>(log->args[0]->valueExpr);
+  EXPECT_EQ(y_ref->binding.slot, decl->binding.slot);
+  EXPECT_EQ(y_ref->binding.depth, 1U);
+  EXPECT_EQ(module.values.symbol_at(y_ref->binding), y_ref->resolvedSymbol);
+
+  // Assignment target resolves to the global scope (parent of the tree scope).
+  auto * assign = cast<AssignmentStmt>(tree->body[2]);
+  ASSERT_TRUE(assign->targetBinding.is_local_slot());
+  EXPECT_EQ(assign->targetBinding.depth, 1U);
+  EXPECT_EQ(module.values.symbol_at(assign->targetBinding), assign->resolvedTarget);
+}
+
 // ============================================================================
 // Error Detection Tests
 // ============================================================================
@@ -61,7 +61,7 @@ static bool has_error_containing(const DiagnosticBag & diags, std::string_view n
   const auto & all = diags.all();
   return std::any_of(all.begin(), all.end(), [&](const Diagnostic & d) {
     if (d.severity != Severity::Error) return false;
-    return d.message.find(n) != std::string::npos;
+    return d.message.str().find(n) != std::string::npos;
   });
 }
 
@@ -124,3 +124,105 @@ TEST(SemaTreeRecursion, IndirectRecursionIsError)
   EXPECT_TRUE(has_error_containing(diags, "Recursive tree call is not allowed"));
   EXPECT_TRUE(has_error_containing(diags, "A -> B -> C -> A"));
 }
+
+TEST(SemaTreeRecursion, CallGraphRecomputesOnlyAffectedComponents)
+{
+  const auto lib = test_support::parse(R"(
+    tree Leaf() {}
+    tree Helper() {
+      Leaf();
+    }
+  )");
+  const auto before = test_support::parse(R"(
+    tree Main() {}
+  )");
+  const auto after = test_support::parse(R"(
+    tree Main() {
+      Loop();
+    }
+    tree Loop() {
+      Main();
+    }
+  )");
+  ASSERT_NE(lib.program, nullptr);
+  ASSERT_NE(before.program, nullptr);
+  ASSERT_NE(after.program, nullptr);
+
+  DiagnosticBag diags;
+  ModuleInfo lib_mod = create_test_module(*lib.program, &diags);
+  ModuleInfo before_mod = create_test_module(*before.program, &diags);
+  ModuleInfo after_mod = create_test_module(*after.program, &diags);
+  ASSERT_TRUE(NameResolver(lib_mod, &diags).resolve());
+  ASSERT_TRUE(NameResolver(before_mod, &diags).resolve());
+  ASSERT_TRUE(NameResolver(after_mod, &diags).resolve());
+
+  const FileId lib_id{0};
+  const FileId main_id{1};
+
+  TreeCallGraph calls;
+  EXPECT_TRUE(calls.update_module(lib_id, *lib.program));
+  EXPECT_TRUE(calls.update_module(main_id, *before.program));
+  EXPECT_EQ(calls.recompute(), 3U);
+  EXPECT_TRUE(calls.recursive_components().empty());
+
+  // Unchanged module: nothing to recompute.
+  EXPECT_FALSE(calls.update_module(lib_id, *lib.program));
+  EXPECT_EQ(calls.recompute(), 0U);
+
+  // Editing the main module only revisits its own trees.
+  EXPECT_TRUE(calls.update_module(main_id, *after.program));
+  EXPECT_EQ(calls.recompute(), 2U);
+
+  const auto * main_tree = *after.program->trees().begin();
+  ASSERT_TRUE(calls.is_recursive(main_tree));
+  ASSERT_NE(calls.component_of(main_tree), nullptr);
+  EXPECT_EQ(calls.component_of(main_tree)->members.size(), 2U);
+
+  const auto * helper = *std::next(lib.program->trees().begin());
+  EXPECT_FALSE(calls.is_recursive(helper));
+  ASSERT_EQ(calls.callees(helper).size(), 1U);
+  EXPECT_EQ(calls.callers(calls.callees(helper)[0].callee).size(), 1U);
+
+  TreeRecursionChecker checker(&diags);
+  EXPECT_FALSE(checker.check(calls));
+  EXPECT_TRUE(has_error_containing(diags, "Main -> Loop -> Main"));
+}
+
+TEST(SemaTreeRecursion, CrossModuleRecursionIsError)
+{
+  const auto a = test_support::parse(R"(
+    tree A() {
+      B();
+    }
+  )");
+  const auto b = test_support::parse(R"(
+    tree B() {
+      A();
+    }
+  )");
+  ASSERT_NE(a.program, nullptr);
+  ASSERT_NE(b.program, nullptr);
+
+  DiagnosticBag diags;
+  ModuleGraph graph;
+  ModuleInfo * mod_a = graph.add_module(FileId{0});
+  ModuleInfo * mod_b = graph.add_module(FileId{1});
+  *mod_a = create_test_module(*a.program, &diags);
+  *mod_b = create_test_module(*b.program, &diags);
+  mod_a->file_id = FileId{0};
+  mod_b->file_id = FileId{1};
+  mod_a->imports = {mod_b};
+  mod_b->imports = {mod_a};
+
+  ASSERT_TRUE(NameResolver(*mod_a, &diags).resolve());
+  ASSERT_TRUE(NameResolver(*mod_b, &diags).resolve());
+
+  // Each module on its own is fine; the cycle only shows up globally.
+  EXPECT_TRUE(TreeRecursionChecker().check(*a.program));
+
+  TreeRecursionChecker checker(&diags);
+  EXPECT_FALSE(checker.check(graph));
+  EXPECT_EQ(checker.error_count(), 1U);
+  EXPECT_TRUE(has_error_containing(diags, "A -> B -> A"));
+  EXPECT_FALSE(graph.call_graph().is_dirty());
+}
@@ -29,7 +29,7 @@ static bool has_warning_containing(const DiagnosticBag & diags, std::string_view
   const std::string needle_str(needle);
   const auto warns = diags.warnings();
   return std::any_of(warns.begin(), warns.end(), [&](const Diagnostic & d) {
-    return d.message.find(needle_str) != std::string::npos;
+    return d.message.str().find(needle_str) != std::string::npos;
   });
 }
 
@@ -530,3 +530,51 @@ TEST(SemaTypeChecker, NoWarningWhenMutParamUsedAsOutIndexTarget)
   EXPECT_FALSE(has_warning_containing(
     ctx.diags, "Parameter 'arr' is declared as mut/out but never used for write access"));
 }
+
+// ============================================================================
+// Declared Type Memoization
+// ============================================================================
+
+TEST(SemaTypeChecker, PortAndParamTypesAreMemoized)
+{
+  TestContext ctx;
+  ASSERT_TRUE(ctx.parse(R"(
+    type Name = string;
+    extern action Say(in msg: Name, in count: int32?);
+    tree Main(in greeting: Name) {
+      Say(msg: "hi", count: null);
+      Say(msg: greeting, count: null);
+    }
+  )"));
+  ASSERT_TRUE(ctx.run_all());
+  EXPECT_FALSE(ctx.diags.has_errors());
+
+  const auto * ext = ctx.program->externs()[0];
+  ASSERT_EQ(ext->ports.size(), 2U);
+
+  const Type * msg = get_resolved_type(ext->ports[0]->type, ctx.types);
+  ASSERT_NE(msg, nullptr);
+  EXPECT_EQ(msg->kind, TypeKind::String);
+
+  const Type * count = get_resolved_type(ext->ports[1]->type, ctx.types);
+  ASSERT_NE(count, nullptr);
+  EXPECT_EQ(count->kind, TypeKind::Nullable);
+  EXPECT_EQ(count->base_type, ctx.types.int32_type());
+
+  const auto * tree = ctx.program->trees()[0];
+  ASSERT_EQ(tree->params.size(), 1U);
+  EXPECT_EQ(get_resolved_type(tree->params[0]->type, ctx.types), msg);
+
+  // The cache is scoped to the TypeContext that interned the types.
+  TypeContext other;
+  EXPECT_EQ(get_resolved_type(ext->ports[0]->type, other), nullptr);
+
+  // Checking the same AST in another context (as an importer does) keeps
+  // both memos apart.
+  TypeChecker other_checker(other, ctx.module.types, ctx.module.values, nullptr);
+  EXPECT_TRUE(other_checker.check(*ctx.program));
+  const Type * other_msg = get_resolved_type(ext->ports[0]->type, other);
+  ASSERT_NE(other_msg, nullptr);
+  EXPECT_EQ(other_msg, other.string_type());
+  EXPECT_EQ(get_resolved_type(ext->ports[0]->type, ctx.types), msg);
+}
@@ -2,21 +2,35 @@
 //
 // This is a thin wrapper around bt_dsl::lsp::Workspace (serverless APIs).
 // It implements the subset of LSP needed by the VS Code extension e2e tests.
+// Requests run on a small worker pool so that slow diagnostics do not hold
+// up completion or hover (see Server).
 //
 #include <algorithm>
+#include <atomic>
 #include <bt_dsl/driver/stdlib_finder.hpp>
 #include <bt_dsl/lsp/lsp.hpp>
+#include <bt_dsl/lsp/symbol_index.hpp>
+#include <bt_dsl/lsp/text_edit.hpp>
+#include <cctype>
+#include <chrono>
+#include <condition_variable>
 #include <cstdint>
 #include <cstdlib>
+#include <deque>
 #include <filesystem>
 #include <fstream>
+#include <functional>
 #include <iostream>
+#include <memory>
+#include <mutex>
 #include <nlohmann/json.hpp>
 #include <optional>
 #include <sstream>
 #include <string>
 #include <string_view>
+#include <thread>
 #include <unordered_map>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 
@@ -31,6 +45,7 @@ struct DocState
   std::string text;
   std::vector<uint32_t> line_offsets;      // byte offsets of each line start
   std::vector<std::string> imported_uris;  // resolved direct imports (+ stdlib)
+  uint64_t version = 0;                    // bumped on every edit (server-wide counter)
 };
 
 // -----------------------------
@@ -147,18 +162,6 @@ uint32_t utf16_units_from_utf8_prefix(std::string_view s, uint32_t byte_limit)
   return units;
 }
 
-std::vector<uint32_t> build_line_offsets(std::string_view text)
-{
-  std::vector<uint32_t> offsets;
-  offsets.push_back(0);
-  for (size_t i = 0; i < text.size(); ++i) {
-    if (text[i] == '\n') {
-      offsets.push_back(static_cast<uint32_t>(i + 1));
-    }
-  }
-  return offsets;
-}
-
 bool starts_with(std::string_view s, std::string_view prefix)
 {
   return s.size() >= prefix.size() && s.substr(0, prefix.size()) == prefix;
@@ -264,43 +267,116 @@ std::optional<std::string> read_file_to_string(const std::string & path)
   return ss.str();
 }
 
-int lsp_severity(std::string_view s)
+int lsp_severity(bt_dsl::Severity s)
 {
   // LSP DiagnosticSeverity:
   // 1 Error, 2 Warning, 3 Information, 4 Hint
-  if (s == "Error") return 1;
-  if (s == "Warning") return 2;
-  if (s == "Info") return 3;
-  if (s == "Hint") return 4;
+  switch (s) {
+    case bt_dsl::Severity::Error:
+      return 1;
+    case bt_dsl::Severity::Warning:
+      return 2;
+    case bt_dsl::Severity::Info:
+      return 3;
+    case bt_dsl::Severity::Hint:
+      return 4;
+  }
   return 3;
 }
 
-int completion_kind(std::string_view s)
+int completion_kind(bt_dsl::lsp::CompletionItemKind k)
 {
   // LSP CompletionItemKind (subset)
-  if (s == "Keyword") return 14;
-  if (s == "Variable") return 6;
-  if (s == "Function") return 3;
-  if (s == "Method") return 2;
-  if (s == "Field") return 5;
-  if (s == "Property") return 10;
-  if (s == "Class") return 7;
-  if (s == "Interface") return 8;
-  if (s == "Module") return 9;
-  if (s == "Enum") return 13;
+  switch (k) {
+    case bt_dsl::lsp::CompletionItemKind::Keyword:
+      return 14;
+    case bt_dsl::lsp::CompletionItemKind::Variable:
+      return 6;
+    case bt_dsl::lsp::CompletionItemKind::Port:
+    case bt_dsl::lsp::CompletionItemKind::Node:
+      break;
+  }
   return 1;  // Text
 }
 
-int symbol_kind(std::string_view s)
+int symbol_kind(bt_dsl::lsp::DocumentSymbolKind k)
 {
   // LSP SymbolKind (subset)
-  if (s == "Tree") return 12;         // Function
-  if (s == "Declare") return 13;      // Variable (extern node/type-ish)
-  if (s == "GlobalVar") return 13;    // Variable
-  if (s == "GlobalConst") return 14;  // Constant
+  switch (k) {
+    case bt_dsl::lsp::DocumentSymbolKind::Tree:
+      return 12;  // Function
+    case bt_dsl::lsp::DocumentSymbolKind::Declare:
+      return 13;  // Variable (extern node/type-ish)
+    case bt_dsl::lsp::DocumentSymbolKind::GlobalVar:
+      return 13;  // Variable
+    case bt_dsl::lsp::DocumentSymbolKind::GlobalConst:
+      return 14;  // Constant
+  }
   return 13;
 }
 
+int index_symbol_kind(bt_dsl::lsp::IndexSymbolKind k)
+{
+  // Same kinds as documentSymbol
+  switch (k) {
+    case bt_dsl::lsp::IndexSymbolKind::Tree:
+      return 12;  // Function
+    case bt_dsl::lsp::IndexSymbolKind::Node:
+    case bt_dsl::lsp::IndexSymbolKind::Type:
+    case bt_dsl::lsp::IndexSymbolKind::Global:
+      return 13;  // Variable
+  }
+  return 13;
+}
+
+/// Index of a file as saved on disk, stamped with its mtime and size.
+std::optional<bt_dsl::lsp::FileIndex> index_from_disk(
+  const std::string & uri, const fs::path & path)
+{
+  std::error_code ec;
+  const auto mtime = fs::last_write_time(path, ec);
+  if (ec) {
+    return std::nullopt;
+  }
+  auto text = read_file_to_string(path.string());
+  if (!text) {
+    return std::nullopt;
+  }
+
+  auto file = bt_dsl::lsp::index_source(uri, *text);
+  file.mtime = static_cast<int64_t>(mtime.time_since_epoch().count());
+  file.size = text->size();
+  return file;
+}
+
+/**
+ * Where the index of a set of roots is kept between sessions:
+ * `$XDG_CACHE_HOME/bt-dsl/` (or `~/.cache/bt-dsl/`), one file per root set.
+ * Empty if neither variable is set.
+ */
+fs::path index_cache_path(const std::vector<fs::path> & roots)
+{
+  fs::path base;
+  if (const char * xdg = std::getenv("XDG_CACHE_HOME"); xdg != nullptr && *xdg != '\0') {
+    base = xdg;
+  } else if (const char * home = std::getenv("HOME"); home != nullptr && *home != '\0') {
+    base = fs::path(home) / ".cache";
+  } else {
+    return {};
+  }
+
+  // FNV-1a over the root list
+  uint64_t hash = 14695981039346656037ULL;
+  for (const auto & root : roots) {
+    for (const char c : root.string() + '\n') {
+      hash = (hash ^ static_cast<unsigned char>(c)) * 1099511628211ULL;
+    }
+  }
+  std::ostringstream name;
+  name << "index-" << std::hex << hash << ".json";
+  return base / "bt-dsl" / name.str();
+}
+
 std::optional<uint32_t> utf8_position_to_byte_offset(
   const DocState & doc, uint32_t line, uint32_t character)
 {
@@ -366,9 +442,13 @@ std::optional<uint32_t> utf16_position_to_byte_offset(
   return line_start + std::min<uint32_t>(byte_index, static_cast<uint32_t>(slice.size()));
 }
 
+// stdout is shared by the dispatcher and the workers.
+std::mutex g_output_mutex;
+
 void write_message(const json & msg)
 {
   const std::string body = msg.dump();
+  const std::lock_guard<std::mutex> lock(g_output_mutex);
   std::cout << "Content-Length: " << body.size() << "\r\n\r\n";
   std::cout << body;
   std::cout.flush();
@@ -418,209 +498,361 @@ std::optional<json> read_message()
   }
 }
 
-}  // namespace
+json empty_lsp_range()
+{
+  return json{
+    {"start", json{{"line", 0}, {"character", 0}}}, {"end", json{{"line", 0}, {"character", 0}}}};
+}
 
-int main()
+// -----------------------------
+// Threading
+// -----------------------------
+
+// JSON-RPC / LSP error codes
+constexpr int k_method_not_found = -32601;
+constexpr int k_request_cancelled = -32800;
+constexpr int k_content_modified = -32801;
+
+// Analysis state the Workspace keeps for documents that are not open.
+constexpr size_t k_default_memory_budget_mb = 512;
+
+// Diagnostics and indexing wait for this long a pause in typing.
+constexpr std::chrono::milliseconds k_edit_quiet_period{250};
+
+/// FIFO of incoming messages, filled by the reader thread.
+class MessageQueue
 {
-  try {
-    bt_dsl::lsp::Workspace ws;
-
-    std::unordered_map<std::string, DocState> docs;
-    std::string stdlib_base;  // Base directory containing std/ (parent of stdlib dir)
-    // LSP defaults to UTF-16 when position encodings are not negotiated.
-    std::string negotiated_position_encoding = "utf-16";
-
-    const bool debug = (std::getenv("BT_DSL_LSP_DEBUG") != nullptr);
-
-    auto upsert_doc = [&](const std::string & uri, const std::string & text) -> DocState & {
-      auto & d = docs[uri];
-      d.uri = uri;
-      d.text = text;
-      d.line_offsets = build_line_offsets(d.text);
-      ws.set_document(uri, text);
-      return d;
-    };
+public:
+  void push(json msg)
+  {
+    {
+      const std::lock_guard<std::mutex> lock(mutex_);
+      items_.push_back(std::move(msg));
+    }
+    cv_.notify_one();
+  }
 
-    auto ensure_loaded = [&](const std::string & uri) {
-      if (ws.has_document(uri)) {
-        return;
-      }
+  /// Block until a message is available; nullopt once closed and drained.
+  std::optional<json> pop()
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [&] { return !items_.empty() || closed_; });
+    if (items_.empty()) {
+      return std::nullopt;
+    }
+    json msg = std::move(items_.front());
+    items_.pop_front();
+    return msg;
+  }
 
-      std::string resolved_uri = uri;
+  void close()
+  {
+    {
+      const std::lock_guard<std::mutex> lock(mutex_);
+      closed_ = true;
+    }
+    cv_.notify_all();
+  }
 
-      // Try to resolve bt-dsl-pkg:// URIs to file:// URIs
-      if (starts_with(uri, "bt-dsl-pkg://")) {
-        auto file_uri = resolve_package_uri(uri, stdlib_base);
-        if (!file_uri) {
-          return;  // Cannot resolve package URI
-        }
-        resolved_uri = *file_uri;
-      }
+private:
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::deque<json> items_;
+  bool closed_ = false;
+};
 
-      const auto p = file_uri_to_path(resolved_uri);
-      if (!p) {
-        return;
-      }
-      const auto text = read_file_to_string(*p);
-      if (!text) {
-        return;
-      }
-      // Store under resolved file:// URI so go-to-definition works
-      upsert_doc(resolved_uri, *text);
-    };
+enum class JobPriority : uint8_t {
+  Interactive,  ///< Requests the user is waiting for
+  Background,   ///< Diagnostics
+};
 
-    // Resolve a URI (potentially bt-dsl-pkg://) to a file:// URI
-    auto resolve_uri = [&](const std::string & uri) -> std::string {
-      if (starts_with(uri, "bt-dsl-pkg://")) {
-        auto file_uri = resolve_package_uri(uri, stdlib_base);
-        if (file_uri) {
-          return *file_uri;
-        }
-      }
-      return uri;  // Already a file:// URI or unresolvable
-    };
+/// Fixed-size thread pool; queued interactive jobs always run first.
+class WorkerPool
+{
+public:
+  explicit WorkerPool(unsigned threads)
+  {
+    threads_.reserve(threads);
+    for (unsigned i = 0; i < threads; ++i) {
+      threads_.emplace_back([this] { run(); });
+    }
+  }
 
-    auto refresh_imports = [&](DocState & doc) {
-      // Ask workspace for direct import URIs. Host then loads them.
-      // Note: stdlib_uri is empty since we handle package URIs in ensure_loaded
-      const json r = json::parse(ws.resolve_imports_json(doc.uri, ""));
-      doc.imported_uris.clear();
-      if (r.contains("uris") && r["uris"].is_array()) {
-        for (const auto & u : r["uris"]) {
-          if (u.is_string()) {
-            // Resolve bt-dsl-pkg:// to file:// and store resolved URI
-            const std::string resolved = resolve_uri(u.get<std::string>());
-            doc.imported_uris.push_back(resolved);
-          }
-        }
-      }
+  /// Stops the workers; jobs that have not started are discarded.
+  ~WorkerPool()
+  {
+    {
+      const std::lock_guard<std::mutex> lock(mutex_);
+      stopping_ = true;
+    }
+    cv_.notify_all();
+    for (auto & t : threads_) {
+      t.join();
+    }
+  }
 
-      for (const auto & u : doc.imported_uris) {
-        ensure_loaded(u);
-      }
-    };
+  WorkerPool(const WorkerPool &) = delete;
+  WorkerPool & operator=(const WorkerPool &) = delete;
 
-    auto pos_to_byte_offset = [&](const DocState & doc, const json & pos) -> uint32_t {
-      const auto line = pos.value<uint32_t>("line", 0U);
-      const auto character = pos.value<uint32_t>("character", 0U);
+  void submit(JobPriority priority, std::function<void()> job)
+  {
+    {
+      const std::lock_guard<std::mutex> lock(mutex_);
+      (priority == JobPriority::Interactive ? interactive_ : background_)
+        .push_back(std::move(job));
+    }
+    cv_.notify_one();
+  }
 
-      if (negotiated_position_encoding == "utf-16") {
-        if (auto off = utf16_position_to_byte_offset(doc, line, character)) {
-          return *off;
+private:
+  void run()
+  {
+    for (;;) {
+      std::function<void()> job;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [&] { return stopping_ || !interactive_.empty() || !background_.empty(); });
+        if (stopping_) {
+          return;
         }
-        return 0;
+        auto & queue = interactive_.empty() ? background_ : interactive_;
+        job = std::move(queue.front());
+        queue.pop_front();
+      }
+      try {
+        job();
+      } catch (const std::exception & e) {
+        std::cerr << "bt_dsl_lsp_server: job failed: " << e.what() << "\n";
+      } catch (...) {
+        std::cerr << "bt_dsl_lsp_server: job failed\n";
       }
+    }
+  }
 
-      // Default to utf-8 (bytes).
-      if (auto off = utf8_position_to_byte_offset(doc, line, character)) {
-        return *off;
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::deque<std::function<void()>> interactive_;
+  std::deque<std::function<void()>> background_;
+  bool stopping_ = false;
+  std::vector<std::thread> threads_;
+};
+
+/**
+ * Runs actions once their key has been quiet for a delay, on its own thread.
+ * Scheduling a key again replaces its action and restarts the delay, so a
+ * burst of edits costs one run. Actions due together run highest rank first;
+ * they should only hand work off (e.g. to a WorkerPool).
+ */
+class Debouncer
+{
+public:
+  using Clock = std::chrono::steady_clock;
+
+  Debouncer() : thread_([this] { run(); }) {}
+
+  /// Stops the thread; pending actions are discarded.
+  ~Debouncer()
+  {
+    {
+      const std::lock_guard<std::mutex> lock(mutex_);
+      stopping_ = true;
+    }
+    cv_.notify_all();
+    thread_.join();
+  }
+
+  Debouncer(const Debouncer &) = delete;
+  Debouncer & operator=(const Debouncer &) = delete;
+
+  void schedule(
+    const std::string & key, Clock::duration delay, uint64_t rank, std::function<void()> action)
+  {
+    {
+      const std::lock_guard<std::mutex> lock(mutex_);
+      entries_[key] = Entry{Clock::now() + delay, rank, std::move(action)};
+    }
+    cv_.notify_one();
+  }
+
+  void cancel(const std::string & key)
+  {
+    const std::lock_guard<std::mutex> lock(mutex_);
+    entries_.erase(key);
+  }
+
+private:
+  struct Entry
+  {
+    Clock::time_point due;
+    uint64_t rank = 0;
+    std::function<void()> action;
+  };
+
+  void run()
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+      if (stopping_) {
+        return;
+      }
+      if (entries_.empty()) {
+        cv_.wait(lock);
+        continue;
       }
-      return 0;
-    };
 
-    auto byte_offset_to_lsp_position = [&](const DocState & doc, uint32_t byte_offset) -> json {
-      if (doc.line_offsets.empty()) {
-        return json{{"line", 0}, {"character", 0}};
+      const auto now = Clock::now();
+      auto next = Clock::time_point::max();
+      std::vector<Entry> due;
+      for (auto it = entries_.begin(); it != entries_.end();) {
+        if (it->second.due <= now) {
+          due.push_back(std::move(it->second));
+          it = entries_.erase(it);
+        } else {
+          next = std::min(next, it->second.due);
+          ++it;
+        }
+      }
+      if (due.empty()) {
+        cv_.wait_until(lock, next);
+        continue;
       }
 
-      const uint32_t clamped =
-        std::min<uint32_t>(byte_offset, static_cast<uint32_t>(doc.text.size()));
+      std::sort(due.begin(), due.end(), [](const Entry & a, const Entry & b) {
+        return a.rank > b.rank;
+      });
+      lock.unlock();
+      for (auto & e : due) {
+        e.action();
+      }
+      lock.lock();
+    }
+  }
 
-      // Find the line containing clamped.
-      const auto it = std::upper_bound(doc.line_offsets.begin(), doc.line_offsets.end(), clamped);
-      const uint32_t line = (it == doc.line_offsets.begin())
-                              ? 0U
-                              : static_cast<uint32_t>((it - doc.line_offsets.begin()) - 1);
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::unordered_map<std::string, Entry> entries_;
+  bool stopping_ = false;
+  std::thread thread_;  // Last: started once the rest is constructed
+};
 
-      const uint32_t line_start = doc.line_offsets[line];
-      const uint32_t next_line_start = (line + 1 < doc.line_offsets.size())
-                                         ? doc.line_offsets[line + 1]
-                                         : static_cast<uint32_t>(doc.text.size());
-      const uint32_t line_end =
-        std::min<uint32_t>(next_line_start, static_cast<uint32_t>(doc.text.size()));
+/**
+ * Requests that were read but have not been answered yet, and which of them
+ * the client cancelled. Requests are registered by the reader thread, so a
+ * `$/cancelRequest` that overtakes its request in the queue still applies.
+ */
+class PendingRequests
+{
+public:
+  void add(const json & id)
+  {
+    const std::lock_guard<std::mutex> lock(mutex_);
+    pending_.emplace(id.dump(), false);
+  }
 
-      const uint32_t byte_in_line = (clamped >= line_start) ? (clamped - line_start) : 0U;
-      const uint32_t byte_in_line_clamped =
-        std::min<uint32_t>(byte_in_line, (line_end >= line_start) ? (line_end - line_start) : 0U);
+  void cancel(const json & id)
+  {
+    const std::lock_guard<std::mutex> lock(mutex_);
+    auto it = pending_.find(id.dump());
+    if (it != pending_.end()) {
+      it->second = true;
+    }
+  }
 
-      const std::string_view slice =
-        std::string_view(doc.text).substr(line_start, line_end - line_start);
+  [[nodiscard]] bool is_cancelled(const json & id)
+  {
+    const std::lock_guard<std::mutex> lock(mutex_);
+    auto it = pending_.find(id.dump());
+    return it != pending_.end() && it->second;
+  }
 
-      uint32_t character = 0;
-      if (negotiated_position_encoding == "utf-16") {
-        character = utf16_units_from_utf8_prefix(slice, byte_in_line_clamped);
-      } else {
-        // utf-8: character is a byte offset.
-        character = byte_in_line_clamped;
-      }
+  void remove(const json & id)
+  {
+    const std::lock_guard<std::mutex> lock(mutex_);
+    pending_.erase(id.dump());
+  }
 
-      return json{{"line", static_cast<int>(line)}, {"character", static_cast<int>(character)}};
-    };
+private:
+  std::mutex mutex_;
+  std::unordered_map<std::string, bool> pending_;
+};
 
-    auto byte_range_to_lsp_range = [&](const DocState & doc, uint32_t sb, uint32_t eb) -> json {
-      return json{
-        {"start", byte_offset_to_lsp_position(doc, sb)},
-        {"end", byte_offset_to_lsp_position(doc, eb)},
-      };
-    };
+// -----------------------------
+// Server
+// -----------------------------
 
-    auto to_lsp_range_from_full_range_with_doc = [&](
-                                                   const DocState * doc, const json & fr) -> json {
-      if (doc != nullptr && fr.is_object() && fr.contains("startByte") && fr.contains("endByte")) {
-        const auto sb = fr.value<uint32_t>("startByte", 0U);
-        const auto eb = fr.value<uint32_t>("endByte", 0U);
-        return byte_range_to_lsp_range(*doc, sb, eb);
-      }
-      // Fallback: FullSourceRange uses 1-indexed line/column; LSP uses 0-indexed.
-      const int sl = std::max(0, fr.value("startLine", 1) - 1);
-      const int sc = std::max(0, fr.value("startColumn", 1) - 1);
-      const int el = std::max(0, fr.value("endLine", 1) - 1);
-      const int ec = std::max(0, fr.value("endColumn", 1) - 1);
-      return json{
-        {"start", json{{"line", sl}, {"character", sc}}},
-        {"end", json{{"line", el}, {"character", ec}}},
-      };
-    };
+using DocSnapshot = std::shared_ptr<const DocState>;
+
+/**
+ * stdio LSP server.
+ *
+ * A reader thread parses messages off stdin. The main thread dispatches them
+ * in arrival order: document sync is applied right away, requests and
+ * diagnostics go to a WorkerPool. Each job carries an immutable snapshot of
+ * the server-side document (text, line table, imports, version), so
+ * position conversion needs no locking.
+ *
+ * The Workspace analyzes lazily and is not thread-safe, so calls into it are
+ * serialized by `ws_mutex_`. Every edit bumps the document version; a job
+ * whose snapshot is older than the Workspace text when it gets the lock is
+ * dropped (diagnostics) or answered with ContentModified (requests).
+ *
+ * Diagnostics are analyzed on a second Workspace (`diag_ws_`, serialized by
+ * `diag_mutex_`) that is brought up to date from the snapshot and the
+ * imports' text just before each analysis. Background analysis therefore
+ * never holds `ws_mutex_` for longer than that copy, and completion or hover
+ * only wait for each other.
+ *
+ * Diagnostics are pushed after a document has been quiet for a short while,
+ * most recently used documents first, or pulled (`textDocument/diagnostic`)
+ * by clients that support it; then nothing is pushed. A pull whose previous
+ * result ID still matches the document and import versions is answered
+ * `unchanged` without analysis.
+ *
+ * Workspace symbols, references and rename are served from a SymbolIndex of
+ * the workspace's projects (guarded by `index_mutex_`). It is built in the
+ * background on `initialized`, follows open documents' text and watched
+ * file changes, and is cached on disk between sessions.
+ *
+ * Only open documents have a snapshot. Imports loaded from disk live in the
+ * Workspaces alone, which keep their analysis within a memory budget
+ * (`initializationOptions.memoryBudgetMB`, split between the two) and
+ * release the least recently used first; `bt-dsl/memoryUsage` reports what
+ * they hold.
+ */
+class Server
+{
+public:
+  Server()
+  : debug_(std::getenv("BT_DSL_LSP_DEBUG") != nullptr),
+    pool_(std::clamp(std::thread::hardware_concurrency(), 2U, 4U))
+  {
+  }
 
-    auto publish_diagnostics = [&](const DocState & doc) {
-      json dj;
-      try {
-        dj = json::parse(ws.diagnostics_json(doc.uri, doc.imported_uris));
-      } catch (...) {
-        dj = json{{"uri", doc.uri}, {"items", json::array()}};
-      }
-
-      json lsp_diags = json::array();
-      if (dj.contains("items") && dj["items"].is_array()) {
-        for (const auto & it : dj["items"]) {
-          if (!it.is_object()) continue;
-          json d0;
-          d0["message"] = it.value("message", "");
-          d0["severity"] = lsp_severity(it.value("severity", "Info"));
-          if (it.contains("source") && it["source"].is_string()) {
-            d0["source"] = it["source"];
-          }
-          if (it.contains("range") && it["range"].is_object()) {
-            d0["range"] = to_lsp_range_from_full_range_with_doc(&doc, it["range"]);
-          } else {
-            d0["range"] = json{
-              {"start", json{{"line", 0}, {"character", 0}}},
-              {"end", json{{"line", 0}, {"character", 0}}}};
-          }
-          lsp_diags.push_back(std::move(d0));
-        }
+  int run()
+  {
+    // The reader may be blocked on stdin after `exit`; it must not keep the
+    // process alive, so it is detached and shares ownership of what it fills
+    // instead of referring to the server.
+    std::thread reader([incoming = incoming_, pending = pending_] {
+      read_loop(*incoming, *pending);
+    });
+    reader.detach();
+
+    while (auto msg = incoming_->pop()) {
+      if (!dispatch(*msg)) {
+        break;
       }
+    }
+    return 0;
+  }
 
-      json notif;
-      notif["jsonrpc"] = "2.0";
-      notif["method"] = "textDocument/publishDiagnostics";
-      notif["params"] = json{{"uri", doc.uri}, {"diagnostics", lsp_diags}};
-      write_message(notif);
-    };
+private:
+  // ---- reader thread ----
 
-    bool running = true;
-    while (running) {
-      const auto msg_opt = read_message();
+  static void read_loop(MessageQueue & incoming, PendingRequests & pending)
+  {
+    for (;;) {
+      auto msg_opt = read_message();
       if (!msg_opt) {
         if (!std::cin.good()) {
           break;
@@ -628,357 +860,1367 @@ int main()
         continue;
       }
 
-      const json & msg = *msg_opt;
+      json & msg = *msg_opt;
       const std::string method = msg.value("method", "");
-      const bool is_request = msg.contains("id");
-
-      auto respond = [&](const json & id, const json & result) {
-        json resp;
-        resp["jsonrpc"] = "2.0";
-        resp["id"] = id;
-        resp["result"] = result;
-        write_message(resp);
-      };
+      if (method == "$/cancelRequest") {
+        const json params = msg.value("params", json::object());
+        if (params.contains("id")) {
+          pending.cancel(params["id"]);
+        }
+        continue;
+      }
+      if (msg.contains("id") && !method.empty()) {
+        pending.add(msg["id"]);
+      }
+      incoming.push(std::move(msg));
+    }
+    incoming.close();
+  }
 
-      auto respond_error = [&](const json & id, int code, std::string message) {
-        json resp;
-        resp["jsonrpc"] = "2.0";
-        resp["id"] = id;
-        resp["error"] = json{{"code", code}, {"message", std::move(message)}};
-        write_message(resp);
-      };
+  // ---- dispatcher (main thread) ----
 
-      const json params = msg.value("params", json::object());
-
-      if (method == "initialize" && is_request) {
-        // Determine position encoding
-        negotiated_position_encoding = "utf-16";
-        try {
-          if (params.contains("capabilities") && params["capabilities"].is_object()) {
-            const auto & caps = params["capabilities"];
-            if (caps.contains("general") && caps["general"].is_object()) {
-              const auto & gen = caps["general"];
-              if (gen.contains("positionEncodings") && gen["positionEncodings"].is_array()) {
-                bool has_utf8 = false;
-                bool has_utf16 = false;
-                for (const auto & e : gen["positionEncodings"]) {
-                  if (!e.is_string()) continue;
-                  const auto s = e.get<std::string>();
-                  if (s == "utf-8") has_utf8 = true;
-                  if (s == "utf-16") has_utf16 = true;
-                }
-                // Prefer UTF-16 when available. VS Code consistently supports
-                // UTF-16 and many client-side Position values originate as
-                // UTF-16 code unit offsets.
-                negotiated_position_encoding = (has_utf8 && !has_utf16) ? "utf-8" : "utf-16";
-              }
-            }
-          }
-        } catch (...) {
-          negotiated_position_encoding = "utf-16";
-        }
+  /// Handle one message; false once the server should exit.
+  bool dispatch(const json & msg)
+  {
+    const std::string method = msg.value("method", "");
+    const bool is_request = msg.contains("id");
+    const json params = msg.value("params", json::object());
 
-        // Auto-detect stdlib directory using find_stdlib().
-        // find_stdlib() returns the `std/` directory itself, so we use its parent
-        // as the base for resolving package imports like `std/nodes.bt`.
-        if (auto detected = bt_dsl::find_stdlib()) {
-          stdlib_base = detected->parent_path().string();
-        }
+    if (method == "initialize" && is_request) {
+      respond(msg["id"], initialize(params));
+      return true;
+    }
 
-        json caps;
-        caps["positionEncoding"] = negotiated_position_encoding;
-        caps["textDocumentSync"] = json{{"openClose", true}, {"change", 1}};  // Full sync
-        caps["completionProvider"] = json{{"resolveProvider", false}};
-        caps["hoverProvider"] = true;
-        caps["definitionProvider"] = true;
-        caps["documentSymbolProvider"] = true;
+    if (method == "initialized") {
+      start_indexing();
+      return true;
+    }
 
-        const json result = json{{"capabilities", caps}};
+    if (method == "shutdown" && is_request) {
+      stopping_ = true;
+      save_index();
+      respond(msg["id"], json());
+      return true;
+    }
 
-        if (debug) {
-          std::cerr << "bt_dsl_lsp_server: negotiated positionEncoding="
-                    << negotiated_position_encoding << "\n";
-        }
+    if (method == "exit") {
+      return false;
+    }
 
-        respond(msg["id"], result);
-        continue;
+    if (method == "textDocument/didOpen") {
+      const auto td = params.value("textDocument", json::object());
+      const std::string uri = td.value("uri", "");
+      if (!uri.empty()) {
+        open_uris_.insert(uri);
+        touch(uri);
+        auto doc = update_document(uri, td.value("text", ""));
+        schedule_indexing(doc, {});
+        schedule_diagnostics(std::move(doc), {});
+        refresh_dependents(uri, {});
       }
+      return true;
+    }
 
-      if (method == "initialized") {
-        // no-op
-        continue;
+    if (method == "textDocument/didChange") {
+      const auto td = params.value("textDocument", json::object());
+      const std::string uri = td.value("uri", "");
+      if (uri.empty()) {
+        return true;
       }
 
-      if (method == "shutdown" && is_request) {
-        respond(msg["id"], json());
-        continue;
+      const auto changes = params.value("contentChanges", json::array());
+      if (!changes.is_array() || changes.empty()) {
+        return true;
+      }
+      touch(uri);
+      if (auto doc = change_document(uri, changes)) {
+        schedule_indexing(doc, k_edit_quiet_period);
+        schedule_diagnostics(std::move(doc), k_edit_quiet_period);
+        refresh_dependents(uri, k_edit_quiet_period);
       }
+      return true;
+    }
 
-      if (method == "exit") {
-        running = false;
-        continue;
+    if (method == "textDocument/didClose") {
+      const auto td = params.value("textDocument", json::object());
+      const std::string uri = td.value("uri", "");
+      if (!uri.empty()) {
+        close_document(uri);
+        {
+          const std::lock_guard<std::mutex> lock(index_mutex_);
+          index_versions_.erase(uri);
+        }
+        refresh_index_from_disk(uri);
       }
+      return true;
+    }
 
-      if (method == "textDocument/didOpen") {
-        const auto td = params.value("textDocument", json::object());
-        const std::string uri = td.value("uri", "");
-        const std::string text = td.value("text", "");
-        if (!uri.empty()) {
-          auto & doc = upsert_doc(uri, text);
-          refresh_imports(doc);
-          publish_diagnostics(doc);
+    if (method == "workspace/didChangeWatchedFiles") {
+      for (const auto & change : params.value("changes", json::array())) {
+        const std::string uri = change.is_object() ? change.value("uri", "") : "";
+        if (
+          uri.size() > 3 && uri.compare(uri.size() - 3, 3, ".bt") == 0 &&
+          open_uris_.count(uri) == 0) {
+          refresh_index_from_disk(uri);
         }
-        continue;
       }
+      return true;
+    }
 
-      if (method == "textDocument/didChange") {
-        const auto td = params.value("textDocument", json::object());
-        const std::string uri = td.value("uri", "");
-        if (uri.empty()) {
-          continue;
+    // Without a method: the client's response to one of our requests.
+    if (is_request && !method.empty()) {
+      submit_request(msg["id"], method, params);
+    }
+    return true;
+  }
+
+  json initialize(const json & params)
+  {
+    // Determine position encoding
+    negotiated_position_encoding_ = "utf-16";
+    try {
+      if (params.contains("capabilities") && params["capabilities"].is_object()) {
+        const auto & caps = params["capabilities"];
+        if (caps.contains("general") && caps["general"].is_object()) {
+          const auto & gen = caps["general"];
+          if (gen.contains("positionEncodings") && gen["positionEncodings"].is_array()) {
+            bool has_utf8 = false;
+            bool has_utf16 = false;
+            for (const auto & e : gen["positionEncodings"]) {
+              if (!e.is_string()) continue;
+              const auto s = e.get<std::string>();
+              if (s == "utf-8") has_utf8 = true;
+              if (s == "utf-16") has_utf16 = true;
+            }
+            // Prefer UTF-16 when available. VS Code consistently supports
+            // UTF-16 and many client-side Position values originate as
+            // UTF-16 code unit offsets.
+            negotiated_position_encoding_ = (has_utf8 && !has_utf16) ? "utf-8" : "utf-16";
+          }
         }
+      }
+    } catch (...) {
+      negotiated_position_encoding_ = "utf-16";
+    }
+
+    // Auto-detect stdlib directory using find_stdlib().
+    // find_stdlib() returns the `std/` directory itself, so we use its parent
+    // as the base for resolving package imports like `std/nodes.bt`.
+    if (auto detected = bt_dsl::find_stdlib()) {
+      stdlib_base_ = detected->parent_path().string();
+    }
 
-        // Full sync: take first change text
-        const auto changes = params.value("contentChanges", json::array());
-        if (!changes.is_array() || changes.empty()) {
+    size_t budget_mb = k_default_memory_budget_mb;
+    const auto options = params.value("initializationOptions", json::object());
+    if (options.is_object() && options.contains("memoryBudgetMB")) {
+      const auto & mb = options["memoryBudgetMB"];
+      if (mb.is_number_unsigned()) {
+        budget_mb = mb.get<size_t>();  // 0: no limit
+      }
+    }
+    // Shared evenly by the two Workspaces.
+    const size_t budget = budget_mb * size_t{1024} * size_t{1024} / 2;
+    {
+      const std::lock_guard<std::mutex> lock(ws_mutex_);
+      ws_.set_memory_budget(budget);
+    }
+    {
+      const std::lock_guard<std::mutex> lock(diag_mutex_);
+      diag_ws_.set_memory_budget(budget);
+    }
+
+    // Folders to index; the root URI/path is the pre-workspaceFolders form.
+    if (params.contains("workspaceFolders") && params["workspaceFolders"].is_array()) {
+      for (const auto & folder : params["workspaceFolders"]) {
+        if (!folder.is_object() || !folder.contains("uri") || !folder["uri"].is_string()) {
           continue;
         }
-        const auto & c0 = changes.at(0);
-        if (!c0.is_object() || !c0.contains("text") || !c0["text"].is_string()) {
+        if (auto p = file_uri_to_path(folder["uri"].get<std::string>())) {
+          workspace_folders_.emplace_back(*p);
+        }
+      }
+    }
+    if (workspace_folders_.empty()) {
+      if (params.contains("rootUri") && params["rootUri"].is_string()) {
+        if (auto p = file_uri_to_path(params["rootUri"].get<std::string>())) {
+          workspace_folders_.emplace_back(*p);
+        }
+      } else if (params.contains("rootPath") && params["rootPath"].is_string()) {
+        workspace_folders_.emplace_back(params["rootPath"].get<std::string>());
+      }
+    }
+
+    const auto client_caps = params.value("capabilities", json::object());
+    if (client_caps.is_object()) {
+      const auto text_document = client_caps.value("textDocument", json::object());
+      pull_diagnostics_ = text_document.is_object() && text_document.contains("diagnostic");
+      const auto ws_caps = client_caps.value("workspace", json::object());
+      const auto ws_diags =
+        ws_caps.is_object() ? ws_caps.value("diagnostics", json::object()) : json::object();
+      diagnostics_refresh_ = ws_diags.is_object() && ws_diags.value("refreshSupport", false);
+    }
+
+    json caps;
+    caps["positionEncoding"] = negotiated_position_encoding_;
+    caps["textDocumentSync"] = json{{"openClose", true}, {"change", 2}};  // Incremental
+    caps["completionProvider"] = json{{"resolveProvider", false}};
+    caps["hoverProvider"] = true;
+    caps["definitionProvider"] = true;
+    caps["documentSymbolProvider"] = true;
+    caps["workspaceSymbolProvider"] = true;
+    caps["referencesProvider"] = true;
+    caps["renameProvider"] = json{{"prepareProvider", true}};
+    caps["diagnosticProvider"] =
+      json{{"interFileDependencies", true}, {"workspaceDiagnostics", false}};
+
+    json token_types = json::array();
+    for (size_t i = 0; i < bt_dsl::lsp::k_semantic_token_type_count; ++i) {
+      token_types.push_back(
+        bt_dsl::lsp::to_string(static_cast<bt_dsl::lsp::SemanticTokenType>(i)));
+    }
+    caps["semanticTokensProvider"] = json{
+      {"legend",
+       json{{"tokenTypes", token_types}, {"tokenModifiers", json::array({"declaration"})}}},
+      {"full", json{{"delta", true}}},
+      {"range", true},
+    };
+
+    if (debug_) {
+      std::cerr << "bt_dsl_lsp_server: negotiated positionEncoding="
+                << negotiated_position_encoding_ << "\n";
+    }
+
+    return json{{"capabilities", caps}};
+  }
+
+  /// Replace a document's text and load its imports. Dispatcher only.
+  DocSnapshot update_document(const std::string & uri, std::string text)
+  {
+    auto doc = std::make_shared<DocState>();
+    doc->uri = uri;
+    doc->text = std::move(text);
+    doc->line_offsets = bt_dsl::lsp::build_line_offsets(doc->text);
+    doc->version = ++last_version_;
+
+    {
+      const std::lock_guard<std::mutex> lock(ws_mutex_);
+      ws_.set_document(uri, doc->text);
+      ws_.set_pinned(uri, true);
+      ws_versions_[uri] = doc->version;
+      doc->imported_uris = resolve_imports(uri);
+    }
+
+    const std::lock_guard<std::mutex> lock(docs_mutex_);
+    docs_[uri] = doc;
+    return doc;
+  }
+
+  /**
+   * Apply didChange content changes, in order, to the document and the
+   * Workspace. Dispatcher only.
+   *
+   * The document is edited in place when no job holds a snapshot of it, and
+   * copied first otherwise. Changes without a range replace the whole text.
+   *
+   * @return The new snapshot, or nullptr if the document is not open
+   */
+  DocSnapshot change_document(const std::string & uri, const json & changes)
+  {
+    const std::lock_guard<std::mutex> ws_lock(ws_mutex_);
+    std::shared_ptr<DocState> doc;
+    {
+      const std::lock_guard<std::mutex> lock(docs_mutex_);
+      auto it = docs_.find(uri);
+      if (it == docs_.end()) {
+        return nullptr;
+      }
+      // Snapshots are only handed out under docs_mutex_, so a count of 1
+      // cannot grow while we hold it. The fence pairs with the release in
+      // the last holder's shared_ptr destructor.
+      if (it->second.use_count() == 1) {
+        std::atomic_thread_fence(std::memory_order_acquire);
+      } else {
+        it->second = std::make_shared<DocState>(*it->second);
+      }
+      doc = it->second;
+
+      bool ws_in_sync = true;
+      for (const auto & change : changes) {
+        if (!change.is_object() || !change.contains("text") || !change["text"].is_string()) {
           continue;
         }
+        const auto & text = change["text"].get_ref<const std::string &>();
+        bt_dsl::lsp::ByteRange range{0, static_cast<uint32_t>(doc->text.size())};
+        if (change.contains("range") && change["range"].is_object()) {
+          const auto & r = change["range"];
+          range.startByte = pos_to_byte_offset(*doc, r.value("start", json::object()));
+          range.endByte = pos_to_byte_offset(*doc, r.value("end", json::object()));
+        }
+        ws_in_sync = ws_in_sync && ws_.apply_edit(uri, range, text);
+        (void)bt_dsl::lsp::apply_text_edit(doc->text, doc->line_offsets, range, text);
+      }
+      if (!ws_in_sync) {
+        ws_.set_document(uri, doc->text);
+      }
+      doc->version = ++last_version_;
+    }
 
-        auto & doc = upsert_doc(uri, c0["text"].get<std::string>());
-        refresh_imports(doc);
-        publish_diagnostics(doc);
-        continue;
+    ws_versions_[uri] = doc->version;
+    // Only ws_mutex_ guards imported_uris once the snapshot is visible.
+    doc->imported_uris = resolve_imports(uri);
+    return doc;
+  }
+
+  /// Direct imports of `uri` as file:// URIs, loading them if needed.
+  /// Caller holds ws_mutex_.
+  std::vector<std::string> resolve_imports(const std::string & uri)
+  {
+    // Ask workspace for direct import URIs. Host then loads them.
+    // Note: stdlib_uri is empty since we handle package URIs in ensure_loaded
+    std::vector<std::string> imported = ws_.resolve_imports(uri);
+    for (auto & u : imported) {
+      // Resolve bt-dsl-pkg:// to file:// and store resolved URI
+      u = resolve_uri(u);
+    }
+
+    for (const auto & u : imported) {
+      ensure_loaded(u);
+    }
+    return imported;
+  }
+
+  /// Caller holds ws_mutex_.
+  void ensure_loaded(const std::string & uri)
+  {
+    if (ws_.has_document(uri)) {
+      return;
+    }
+
+    const auto p = file_uri_to_path(uri);
+    if (!p) {
+      return;
+    }
+    auto text = read_file_to_string(*p);
+    if (!text) {
+      return;
+    }
+
+    // No snapshot: the Workspace holds the only copy of the text.
+    ws_.set_document(uri, std::move(*text));
+    ws_versions_[uri] = ++last_version_;
+  }
+
+  /// A snapshot of a loaded document that is not open (no imports, version 0).
+  /// Caller holds ws_mutex_.
+  [[nodiscard]] DocSnapshot loaded_doc(const std::string & uri) const
+  {
+    const auto text = ws_.document_text(uri);
+    if (!text) {
+      return nullptr;
+    }
+    auto doc = std::make_shared<DocState>();
+    doc->uri = uri;
+    doc->text = std::string(*text);
+    doc->line_offsets = bt_dsl::lsp::build_line_offsets(doc->text);
+    return doc;
+  }
+
+  // Resolve a URI (potentially bt-dsl-pkg://) to a file:// URI
+  [[nodiscard]] std::string resolve_uri(const std::string & uri) const
+  {
+    if (starts_with(uri, "bt-dsl-pkg://")) {
+      auto file_uri = resolve_package_uri(uri, stdlib_base_);
+      if (file_uri) {
+        return *file_uri;
       }
+    }
+    return uri;  // Already a file:// URI or unresolvable
+  }
 
-      if (method == "textDocument/didClose") {
-        const auto td = params.value("textDocument", json::object());
-        const std::string uri = td.value("uri", "");
-        if (!uri.empty()) {
-          ws.remove_document(uri);
-          docs.erase(uri);
+  /// Documents that imported `uri` when their diagnostics were last
+  /// analyzed; requests only record the importers they analyzed in ws_.
+  [[nodiscard]] std::vector<std::string> diagnosed_dependents(const std::string & uri)
+  {
+    const std::lock_guard<std::mutex> lock(diag_mutex_);
+    return diag_ws_.dependents(uri);
+  }
 
-          // Clear diagnostics on close
-          json notif;
-          notif["jsonrpc"] = "2.0";
-          notif["method"] = "textDocument/publishDiagnostics";
-          notif["params"] = json{{"uri", uri}, {"diagnostics", json::array()}};
-          write_message(notif);
+  /// Re-check open documents that import `uri` after it changed, after
+  /// `delay`. Others are re-analyzed by the Workspace when next queried.
+  /// Dispatcher only.
+  void refresh_dependents(const std::string & uri, std::chrono::milliseconds delay)
+  {
+    std::vector<std::string> dependents = diagnosed_dependents(uri);
+    {
+      const std::lock_guard<std::mutex> lock(ws_mutex_);
+      for (auto & dep : ws_.dependents(uri)) {
+        if (std::find(dependents.begin(), dependents.end(), dep) == dependents.end()) {
+          dependents.push_back(std::move(dep));
         }
+      }
+      const uint64_t stamp = ++imports_stamp_;
+      for (const auto & dep : dependents) {
+        imports_changed_[dep] = stamp;
+      }
+    }
+
+    bool open_dependent = false;
+    for (const auto & dep : dependents) {
+      if (open_uris_.count(dep) == 0) {
         continue;
       }
+      open_dependent = true;
+      if (auto doc = find_doc(dep)) {
+        schedule_diagnostics(std::move(doc), delay);
+      }
+    }
 
-      if (method == "textDocument/completion" && is_request) {
-        const auto td = params.value("textDocument", json::object());
-        const std::string uri = td.value("uri", "");
-        const auto pos = params.value("position", json::object());
-        auto it = docs.find(uri);
-        if (it == docs.end()) {
-          respond(msg["id"], json{{"isIncomplete", false}, {"items", json::array()}});
-          continue;
+    if (pull_diagnostics_ && diagnostics_refresh_ && open_dependent) {
+      // Pulled results of the importers are stale; ask the client to pull again.
+      debouncer_.schedule("workspace/diagnostic/refresh", delay, 0, [this] {
+        write_message(json{
+          {"jsonrpc", "2.0"},
+          {"id", "bt-dsl/" + std::to_string(++server_requests_)},
+          {"method", "workspace/diagnostic/refresh"},
+        });
+      });
+    }
+  }
+
+  void close_document(const std::string & uri)
+  {
+    open_uris_.erase(uri);
+    last_used_.erase(uri);
+    debouncer_.cancel("diagnostics " + uri);
+    debouncer_.cancel("index " + uri);
+    bool still_imported = !diagnosed_dependents(uri).empty();
+    {
+      const std::lock_guard<std::mutex> lock(ws_mutex_);
+      still_imported = still_imported || !ws_.dependents(uri).empty();
+      ws_.remove_document(uri);
+      ws_versions_.erase(uri);
+      imports_changed_.erase(uri);
+    }
+    {
+      // Importers' jobs copy it back from ws_ if they still need it.
+      const std::lock_guard<std::mutex> lock(diag_mutex_);
+      diag_ws_.remove_document(uri);
+    }
+
+    {
+      // Under publish_mutex_ so that no diagnostics computed earlier can be
+      // published after the clear.
+      const std::lock_guard<std::mutex> publish_lock(publish_mutex_);
+      {
+        const std::lock_guard<std::mutex> lock(docs_mutex_);
+        docs_.erase(uri);
+      }
+      diagnostics_tickets_.erase(uri);
+
+      // Clear diagnostics on close
+      json notif;
+      notif["jsonrpc"] = "2.0";
+      notif["method"] = "textDocument/publishDiagnostics";
+      notif["params"] = json{{"uri", uri}, {"diagnostics", json::array()}};
+      write_message(notif);
+    }
+
+    if (still_imported) {
+      // Importers go back to the saved file, as if it had never been opened.
+      {
+        const std::lock_guard<std::mutex> lock(ws_mutex_);
+        ensure_loaded(uri);
+      }
+      refresh_dependents(uri, {});
+    }
+  }
+
+  [[nodiscard]] DocSnapshot find_doc(const std::string & uri)
+  {
+    const std::lock_guard<std::mutex> lock(docs_mutex_);
+    auto it = docs_.find(uri);
+    return it == docs_.end() ? nullptr : it->second;
+  }
+
+  void submit_request(const json & id, const std::string & method, const json & params)
+  {
+    // Requests that are not about one document
+    using WorkspaceHandler = json (Server::*)(const json &);
+    static const std::unordered_map<std::string, WorkspaceHandler> workspace_handlers = {
+      {"workspace/symbol", &Server::workspace_symbols},
+      {"bt-dsl/memoryUsage", &Server::memory_usage},
+    };
+
+    if (auto w = workspace_handlers.find(method); w != workspace_handlers.end()) {
+      pool_.submit(JobPriority::Interactive, [this, id, params, handler = w->second] {
+        if (pending_->is_cancelled(id)) {
+          respond_error(id, k_request_cancelled, "Request cancelled");
+          return;
         }
-        const DocState & doc = it->second;
-        const uint32_t off = pos_to_byte_offset(doc, pos);
-
-        if (debug) {
-          const auto line = pos.value<uint32_t>("line", 0U);
-          const auto ch = pos.value<uint32_t>("character", 0U);
-          const uint32_t s = (off > 24U) ? (off - 24U) : 0U;
-          const uint32_t e = std::min<uint32_t>(static_cast<uint32_t>(doc.text.size()), off + 24U);
-          std::string snippet = doc.text.substr(s, e - s);
-          for (char & c : snippet) {
-            if (c == '\n') c = ' ';
-            if (c == '\r') c = ' ';
-          }
-          std::cerr << "bt_dsl_lsp_server: completion pos " << line << ":" << ch
-                    << " -> byteOff=" << off << " snippet=\"" << snippet << "\"\n";
+        json result = (this->*handler)(params);
+        if (pending_->is_cancelled(id)) {
+          respond_error(id, k_request_cancelled, "Request cancelled");
+        } else {
+          respond(id, result);
         }
+      });
+      return;
+    }
 
-        json cj;
-        try {
-          cj = json::parse(ws.completion_json(uri, off, doc.imported_uris));
-        } catch (...) {
-          cj = json{{"isIncomplete", false}, {"items", json::array()}};
-        }
+    using Handler =
+      json (Server::*)(const DocState &, const json &, std::unique_lock<std::mutex> &);
+    static const std::unordered_map<std::string, std::pair<Handler, json>> handlers = {
+      {"textDocument/completion",
+       {&Server::completion, json{{"isIncomplete", false}, {"items", json::array()}}}},
+      {"textDocument/hover", {&Server::hover, nullptr}},
+      {"textDocument/definition", {&Server::definition, json::array()}},
+      {"textDocument/documentSymbol", {&Server::document_symbols, json::array()}},
+      {"textDocument/semanticTokens/full",
+       {&Server::semantic_tokens_full, json{{"data", json::array()}}}},
+      {"textDocument/semanticTokens/full/delta",
+       {&Server::semantic_tokens_delta, json{{"data", json::array()}}}},
+      {"textDocument/semanticTokens/range",
+       {&Server::semantic_tokens_range, json{{"data", json::array()}}}},
+      {"textDocument/references", {&Server::references, json::array()}},
+      {"textDocument/prepareRename", {&Server::prepare_rename, nullptr}},
+      {"textDocument/rename", {&Server::rename, nullptr}},
+      {"textDocument/diagnostic",
+       {&Server::pull_diagnostics, json{{"kind", "full"}, {"items", json::array()}}}},
+    };
 
-        json items = json::array();
-        if (cj.contains("items") && cj["items"].is_array()) {
-          for (const auto & it0 : cj["items"]) {
-            if (!it0.is_object()) continue;
-            const std::string label = it0.value("label", "");
-            const std::string kind = it0.value("kind", "Text");
-            const std::string detail = it0.value("detail", "");
-            const std::string insert = it0.value("insertText", label);
-
-            json item;
-            item["label"] = label;
-            item["kind"] = completion_kind(kind);
-            if (!detail.empty()) {
-              item["detail"] = detail;
-            }
+    auto h = handlers.find(method);
+    if (h == handlers.end()) {
+      respond_error(id, k_method_not_found, "Method not found");
+      return;
+    }
 
-            // textEdit: replaceRange is in bytes (absolute)
-            if (it0.contains("replaceRange") && it0["replaceRange"].is_object()) {
-              const auto sb = it0["replaceRange"].value<uint32_t>("startByte", 0U);
-              const auto eb = it0["replaceRange"].value<uint32_t>("endByte", 0U);
-              item["textEdit"] = json{
-                {"range", byte_range_to_lsp_range(doc, sb, eb)},
-                {"newText", insert},
-              };
-            } else {
-              item["insertText"] = insert;
-            }
+    const auto td = params.value("textDocument", json::object());
+    const std::string uri = td.value("uri", "");
+    DocSnapshot doc = find_doc(uri);
+    const auto [handler, empty_result] = h->second;
+    if (doc) {
+      touch(uri);
+    }
+
+    pool_.submit(JobPriority::Interactive, [this, id, uri, params, doc, handler = handler,
+                                            empty_result = empty_result] {
+      if (pending_->is_cancelled(id)) {
+        respond_error(id, k_request_cancelled, "Request cancelled");
+        return;
+      }
+
+      if (!doc) {
+        respond(id, empty_result);
+        return;
+      }
+
+      std::unique_lock<std::mutex> ws_lock(ws_mutex_);
+      if (!is_current(*doc)) {
+        // A later edit already reached the Workspace; positions in this
+        // request refer to text that no longer exists.
+        ws_lock.unlock();
+        respond_error(id, k_content_modified, "Content modified");
+        return;
+      }
+
+      json result = (this->*handler)(*doc, params, ws_lock);
+      if (ws_lock.owns_lock()) {
+        ws_lock.unlock();
+      }
+
+      if (pending_->is_cancelled(id)) {
+        respond_error(id, k_request_cancelled, "Request cancelled");
+      } else {
+        respond(id, result);
+      }
+    });
+  }
+
+  /// Whether `doc` is the text the Workspace currently holds.
+  /// Caller holds ws_mutex_.
+  [[nodiscard]] bool is_current(const DocState & doc) const
+  {
+    auto it = ws_versions_.find(doc.uri);
+    return it != ws_versions_.end() && it->second == doc.version;
+  }
+
+  void respond(const json & id, const json & result)
+  {
+    json resp;
+    resp["jsonrpc"] = "2.0";
+    resp["id"] = id;
+    resp["result"] = result;
+    pending_->remove(id);
+    write_message(resp);
+  }
 
-            items.push_back(std::move(item));
+  void respond_error(const json & id, int code, std::string message)
+  {
+    json resp;
+    resp["jsonrpc"] = "2.0";
+    resp["id"] = id;
+    resp["error"] = json{{"code", code}, {"message", std::move(message)}};
+    pending_->remove(id);
+    write_message(resp);
+  }
+
+  // ---- diagnostics (background jobs) ----
+
+  /// Note a use of an open document, for ordering its background work.
+  /// Dispatcher only.
+  void touch(const std::string & uri) { last_used_[uri] = ++use_clock_; }
+
+  /// Rank of `uri` for the debouncer: more recently used is higher.
+  [[nodiscard]] uint64_t use_rank(const std::string & uri) const
+  {
+    auto it = last_used_.find(uri);
+    return it == last_used_.end() ? 0 : it->second;
+  }
+
+  /// Publish diagnostics for `doc` once it has been quiet for `delay`, unless
+  /// the client pulls them. Dispatcher only.
+  void schedule_diagnostics(DocSnapshot doc, std::chrono::milliseconds delay)
+  {
+    if (pull_diagnostics_) {
+      return;
+    }
+
+    uint64_t ticket = 0;
+    {
+      const std::lock_guard<std::mutex> lock(publish_mutex_);
+      ticket = ++diagnostics_tickets_[doc->uri];
+    }
+    const std::string key = "diagnostics " + doc->uri;
+    const uint64_t rank = use_rank(doc->uri);
+    debouncer_.schedule(key, delay, rank, [this, doc = std::move(doc), ticket] {
+      pool_.submit(JobPriority::Background, [this, doc, ticket] {
+        {
+          const std::lock_guard<std::mutex> lock(ws_mutex_);
+          if (!is_current(*doc)) {
+            return;  // Superseded by a later edit; its own job will publish.
           }
         }
+        publish_diagnostics(*doc, ticket, analyze_diagnostics(*doc));
+      });
+    });
+  }
 
-        const json result =
-          json{{"isIncomplete", cj.value("isIncomplete", false)}, {"items", items}};
-        respond(msg["id"], result);
-        continue;
+  /**
+   * Diagnostics of `doc` against its imports as `ws_` holds them now.
+   *
+   * The analysis runs on `diag_ws_`; `ws_mutex_` is held only to copy the
+   * imports' text, and only documents whose text changed are replaced, so
+   * imports keep their parse between jobs.
+   */
+  std::vector<bt_dsl::lsp::DiagnosticItem> analyze_diagnostics(const DocState & doc)
+  {
+    std::vector<std::pair<std::string, std::optional<std::string>>> imports;
+    imports.reserve(doc.imported_uris.size());
+    {
+      const std::lock_guard<std::mutex> lock(ws_mutex_);
+      for (const auto & u : doc.imported_uris) {
+        const auto text = ws_.document_text(u);
+        imports.emplace_back(u, text ? std::optional<std::string>(*text) : std::nullopt);
       }
+    }
 
-      if (method == "textDocument/hover" && is_request) {
-        const auto td = params.value("textDocument", json::object());
-        const std::string uri = td.value("uri", "");
-        const auto pos = params.value("position", json::object());
-        auto it = docs.find(uri);
-        if (it == docs.end()) {
-          respond(msg["id"], nullptr);
-          continue;
-        }
-        const DocState & doc = it->second;
-        const uint32_t off = pos_to_byte_offset(doc, pos);
-
-        if (debug) {
-          const auto line = pos.value<uint32_t>("line", 0U);
-          const auto ch = pos.value<uint32_t>("character", 0U);
-          std::cerr << "bt_dsl_lsp_server: hover pos " << line << ":" << ch << " -> byteOff=" << off
-                    << "\n";
+    const std::lock_guard<std::mutex> lock(diag_mutex_);
+    const auto sync = [this](const std::string & uri, const std::optional<std::string> & text) {
+      if (!text) {
+        diag_ws_.remove_document(uri);
+      } else if (diag_ws_.document_text(uri) != std::string_view(*text)) {
+        diag_ws_.set_document(uri, *text);
+      }
+    };
+    sync(doc.uri, doc.text);
+    diag_ws_.set_pinned(doc.uri, true);
+    for (const auto & [uri, text] : imports) {
+      sync(uri, text);
+    }
+    return diag_ws_.diagnostics(doc.uri, doc.imported_uris);
+  }
+
+  [[nodiscard]] json lsp_diagnostics(
+    const DocState & doc, const std::vector<bt_dsl::lsp::DiagnosticItem> & items) const
+  {
+    json out = json::array();
+    for (const auto & it : items) {
+      json d0;
+      d0["message"] = it.message;
+      d0["severity"] = lsp_severity(it.severity);
+      d0["source"] = bt_dsl::lsp::to_string(it.source);
+      d0["range"] = byte_range_to_lsp_range(doc, it.range);
+      out.push_back(std::move(d0));
+    }
+    return out;
+  }
+
+  void publish_diagnostics(
+    const DocState & doc, uint64_t ticket, const std::vector<bt_dsl::lsp::DiagnosticItem> & items)
+  {
+    const json lsp_diags = lsp_diagnostics(doc, items);
+
+    json notif;
+    notif["jsonrpc"] = "2.0";
+    notif["method"] = "textDocument/publishDiagnostics";
+    notif["params"] = json{{"uri", doc.uri}, {"diagnostics", lsp_diags}};
+
+    // Jobs may finish out of order, including two for the same version when
+    // an import changed in between; only the last one scheduled publishes.
+    const std::lock_guard<std::mutex> publish_lock(publish_mutex_);
+    auto t = diagnostics_tickets_.find(doc.uri);
+    if (t == diagnostics_tickets_.end() || t->second != ticket) {
+      return;
+    }
+    const DocSnapshot current = find_doc(doc.uri);
+    if (!current || current->version != doc.version) {
+      return;
+    }
+    write_message(notif);
+  }
+
+  // ---- symbol index (background jobs) ----
+
+  /// Index the workspace folders' projects, reusing the cached entries of
+  /// files that did not change since the last session.
+  void start_indexing()
+  {
+    pool_.submit(JobPriority::Background, [this, folders = workspace_folders_] {
+      const auto roots = bt_dsl::lsp::find_index_roots(folders);
+      const fs::path cache = index_cache_path(roots);
+
+      bt_dsl::lsp::SymbolIndex cached;
+      if (!cache.empty()) {
+        (void)cached.load(cache);
+      }
+
+      {
+        const std::lock_guard<std::mutex> lock(index_mutex_);
+        for (const auto & root : roots) {
+          index_roots_.push_back((root / "").string());
         }
+        index_cache_ = cache;
+      }
 
-        json hj;
-        try {
-          hj = json::parse(ws.hover_json(uri, off, doc.imported_uris));
-        } catch (...) {
-          hj = json::object();
+      size_t reused = 0;
+      const auto sources = bt_dsl::lsp::list_index_sources(roots);
+      for (const auto & path : sources) {
+        if (stopping_) {
+          return;
         }
+        const std::string uri = path_to_file_uri(path.string());
 
+        std::optional<bt_dsl::lsp::FileIndex> entry;
+        std::error_code ec;
+        const auto mtime = fs::last_write_time(path, ec);
+        const auto size = fs::file_size(path, ec);
+        const auto * old = cached.file(uri);
         if (
-          !hj.contains("contents") || !hj["contents"].is_string() ||
-          hj["contents"].get<std::string>().empty()) {
-          respond(msg["id"], nullptr);
-          continue;
+          !ec && old != nullptr && old->size == size &&
+          old->mtime == static_cast<int64_t>(mtime.time_since_epoch().count())) {
+          entry = *old;
+          ++reused;
+        } else {
+          entry = index_from_disk(uri, path);
         }
 
-        json out;
-        out["contents"] = json{{"kind", "markdown"}, {"value", hj["contents"]}};
-        if (hj.contains("range") && hj["range"].is_object()) {
-          out["range"] = to_lsp_range_from_full_range_with_doc(&doc, hj["range"]);
+        const std::lock_guard<std::mutex> lock(index_mutex_);
+        // Open documents are indexed from the editor's text.
+        if (entry && index_versions_.count(uri) == 0) {
+          index_.update(std::move(*entry));
         }
+      }
 
-        respond(msg["id"], out);
-        continue;
+      {
+        const std::lock_guard<std::mutex> lock(index_mutex_);
+        index_dirty_ = true;
       }
+      save_index();
 
-      if (method == "textDocument/definition" && is_request) {
-        const auto td = params.value("textDocument", json::object());
-        const std::string uri = td.value("uri", "");
-        const auto pos = params.value("position", json::object());
-        auto it = docs.find(uri);
-        if (it == docs.end()) {
-          respond(msg["id"], json::array());
-          continue;
+      if (debug_) {
+        std::cerr << "bt_dsl_lsp_server: indexed " << sources.size() << " files under "
+                  << roots.size() << " roots (" << reused << " from cache)\n";
+      }
+    });
+  }
+
+  /// Re-index an open document from its text once it has been quiet for
+  /// `delay`, unless a later edit did. Dispatcher only.
+  void schedule_indexing(DocSnapshot doc, std::chrono::milliseconds delay)
+  {
+    const std::string key = "index " + doc->uri;
+    const uint64_t rank = use_rank(doc->uri);
+    debouncer_.schedule(key, delay, rank, [this, doc = std::move(doc)] {
+      pool_.submit(JobPriority::Background, [this, doc] {
+        auto file = bt_dsl::lsp::index_source(doc->uri, doc->text);
+
+        const std::lock_guard<std::mutex> lock(index_mutex_);
+        const DocSnapshot current = find_doc(doc->uri);
+        if (!current || current->version != doc->version) {
+          return;  // Edited or closed since
         }
-        const DocState & doc = it->second;
-        const uint32_t off = pos_to_byte_offset(doc, pos);
-
-        json dj;
-        try {
-          dj = json::parse(ws.definition_json(uri, off, doc.imported_uris));
-        } catch (...) {
-          dj = json{{"locations", json::array()}};
+        auto & indexed = index_versions_[doc->uri];
+        if (indexed < doc->version) {
+          indexed = doc->version;
+          index_.update(std::move(file));
+          index_dirty_ = true;
         }
+      });
+    });
+  }
 
-        json locs = json::array();
-        if (dj.contains("locations") && dj["locations"].is_array()) {
-          for (const auto & loc : dj["locations"]) {
-            if (!loc.is_object()) continue;
-            json out;
-            out["uri"] = loc.value("uri", "");
-            if (loc.contains("range") && loc["range"].is_object()) {
-              const std::string target_uri = out["uri"].get<std::string>();
-              const DocState * tdoc = nullptr;
-              if (!target_uri.empty()) {
-                auto tit = docs.find(target_uri);
-                if (tit != docs.end()) {
-                  tdoc = &tit->second;
-                }
-              }
-              out["range"] = to_lsp_range_from_full_range_with_doc(tdoc, loc["range"]);
-            } else {
-              out["range"] = json{
-                {"start", json{{"line", 0}, {"character", 0}}},
-                {"end", json{{"line", 0}, {"character", 0}}}};
-            }
-            locs.push_back(std::move(out));
-          }
+  /// Go back to the saved file for a document that is not open (any more):
+  /// re-index it if it is in an indexed project, drop it otherwise.
+  void refresh_index_from_disk(const std::string & uri)
+  {
+    pool_.submit(JobPriority::Background, [this, uri] {
+      const auto path = file_uri_to_path(uri);
+      bool in_roots = false;
+      {
+        const std::lock_guard<std::mutex> lock(index_mutex_);
+        for (const auto & root : index_roots_) {
+          in_roots = in_roots || (path && starts_with(*path, root));
         }
+      }
+      auto entry = in_roots ? index_from_disk(uri, *path) : std::nullopt;
 
-        respond(msg["id"], locs);
-        continue;
+      const std::lock_guard<std::mutex> lock(index_mutex_);
+      if (index_versions_.count(uri) != 0) {
+        return;  // Reopened since
       }
+      if (entry) {
+        index_.update(std::move(*entry));
+      } else {
+        index_.remove(uri);
+      }
+      index_dirty_ = true;
+    });
+  }
 
-      if (method == "textDocument/documentSymbol" && is_request) {
-        const auto td = params.value("textDocument", json::object());
-        const std::string uri = td.value("uri", "");
+  void save_index()
+  {
+    const std::lock_guard<std::mutex> lock(index_mutex_);
+    if (!index_dirty_ || index_cache_.empty()) {
+      return;
+    }
+    if (index_.save(index_cache_)) {
+      index_dirty_ = false;
+    } else if (debug_) {
+      std::cerr << "bt_dsl_lsp_server: failed to write " << index_cache_ << "\n";
+    }
+  }
 
-        json sj;
-        try {
-          sj = json::parse(ws.document_symbols_json(uri));
-        } catch (...) {
-          sj = json{{"symbols", json::array()}};
-        }
+  /**
+   * Declaration at, or referred to at, a position of `doc`, indexing the
+   * document's text first if the background job has not yet.
+   * Caller holds index_mutex_.
+   */
+  std::optional<bt_dsl::lsp::SymbolLocation> indexed_symbol_at(
+    const DocState & doc, const json & pos)
+  {
+    // Until the document's text is indexed, the index may hold the saved
+    // file. Once closed, didClose has gone back to that file.
+    if (find_doc(doc.uri) != nullptr) {
+      auto indexed = index_versions_.find(doc.uri);
+      if (indexed == index_versions_.end() || indexed->second < doc.version) {
+        index_.update(bt_dsl::lsp::index_source(doc.uri, doc.text));
+        // Recorded so the startup scan does not replace it with the file.
+        index_versions_[doc.uri] = doc.version;
+        index_dirty_ = true;
+      }
+    }
 
-        json out = json::array();
-        if (sj.contains("symbols") && sj["symbols"].is_array()) {
-          for (const auto & s0 : sj["symbols"]) {
-            if (!s0.is_object()) continue;
-            json ds;
-            ds["name"] = s0.value("name", "");
-            ds["kind"] = symbol_kind(s0.value("kind", ""));
-            if (s0.contains("range") && s0["range"].is_object()) {
-              auto it = docs.find(uri);
-              const DocState * docp = (it == docs.end()) ? nullptr : &it->second;
-              ds["range"] = to_lsp_range_from_full_range_with_doc(docp, s0["range"]);
-              ds["selectionRange"] =
-                to_lsp_range_from_full_range_with_doc(docp, s0["selectionRange"]);
-            } else {
-              ds["range"] = json{
-                {"start", json{{"line", 0}, {"character", 0}}},
-                {"end", json{{"line", 0}, {"character", 0}}}};
-              ds["selectionRange"] = ds["range"];
-            }
-            ds["children"] = json::array();
-            out.push_back(std::move(ds));
-          }
-        }
+    const uint32_t off = pos_to_byte_offset(doc, pos);
+    const auto it = std::upper_bound(doc.line_offsets.begin(), doc.line_offsets.end(), off);
+    if (it == doc.line_offsets.begin()) {
+      return std::nullopt;
+    }
+    const auto line = static_cast<uint32_t>((it - doc.line_offsets.begin()) - 1);
+    return index_.symbol_at(doc.uri, line, off - doc.line_offsets[line]);
+  }
 
-        respond(msg["id"], out);
-        continue;
+  /// Identifiers are ASCII, so their end is `length` units after the start
+  /// in either encoding.
+  [[nodiscard]] json index_range_to_lsp_range(const bt_dsl::lsp::IndexRange & r) const
+  {
+    const uint32_t character = utf16() ? r.column_utf16 : r.column;
+    return json{
+      {"start", json{{"line", r.line}, {"character", character}}},
+      {"end", json{{"line", r.line}, {"character", character + r.length}}},
+    };
+  }
+
+  json workspace_symbols(const json & params)
+  {
+    constexpr size_t k_max_symbols = 256;
+    const std::string query = params.value("query", "");
+
+    std::vector<bt_dsl::lsp::SymbolLocation> matches;
+    {
+      const std::lock_guard<std::mutex> lock(index_mutex_);
+      matches = index_.find_symbols(query, k_max_symbols);
+    }
+
+    json out = json::array();
+    for (const auto & m : matches) {
+      out.push_back(json{
+        {"name", m.symbol.name},
+        {"kind", index_symbol_kind(m.symbol.kind)},
+        {"location", json{{"uri", m.uri}, {"range", index_range_to_lsp_range(m.symbol.range)}}},
+      });
+    }
+    return out;
+  }
+
+  /// `bt-dsl/memoryUsage`: what the Workspace holds, in bytes, with the
+  /// diagnostics Workspace under `diagnostics`.
+  json memory_usage(const json & /*params*/)
+  {
+    bt_dsl::lsp::MemoryUsage usage;
+    {
+      const std::lock_guard<std::mutex> lock(ws_mutex_);
+      usage = ws_.memory_usage();
+    }
+    bt_dsl::lsp::MemoryUsage diag_usage;
+    {
+      const std::lock_guard<std::mutex> lock(diag_mutex_);
+      diag_usage = diag_ws_.memory_usage();
+    }
+
+    json out = memory_usage_json(usage);
+    out["diagnostics"] = memory_usage_json(diag_usage);
+    return out;
+  }
+
+  [[nodiscard]] static json memory_usage_json(const bt_dsl::lsp::MemoryUsage & usage)
+  {
+    json documents = json::array();
+    for (const auto & d : usage.documents) {
+      documents.push_back(json{
+        {"uri", d.uri},
+        {"open", d.pinned},
+        {"analyzed", d.analyzed},
+        {"textBytes", d.text_bytes},
+        {"arenaBytes", d.arena_bytes},
+        {"otherBytes", d.other_bytes},
+      });
+    }
+    return json{
+      {"budgetBytes", usage.budget_bytes},
+      {"textBytes", usage.text_bytes},
+      {"arenaBytes", usage.arena_bytes},
+      {"otherBytes", usage.other_bytes},
+      {"evictions", usage.evictions},
+      {"documents", std::move(documents)},
+    };
+  }
+
+  // ---- request handlers (workers, called with ws_mutex_ held) ----
+
+  json completion(const DocState & doc, const json & params, std::unique_lock<std::mutex> & ws_lock)
+  {
+    const auto pos = params.value("position", json::object());
+    const uint32_t off = pos_to_byte_offset(doc, pos);
+
+    if (debug_) {
+      const auto line = pos.value<uint32_t>("line", 0U);
+      const auto ch = pos.value<uint32_t>("character", 0U);
+      const uint32_t s = (off > 24U) ? (off - 24U) : 0U;
+      const uint32_t e = std::min<uint32_t>(static_cast<uint32_t>(doc.text.size()), off + 24U);
+      std::string snippet = doc.text.substr(s, e - s);
+      for (char & c : snippet) {
+        if (c == '\n') c = ' ';
+        if (c == '\r') c = ' ';
+      }
+      std::cerr << "bt_dsl_lsp_server: completion pos " << line << ":" << ch
+                << " -> byteOff=" << off << " snippet=\"" << snippet << "\"\n";
+    }
+
+    const auto list = ws_.completion(doc.uri, off, doc.imported_uris);
+    ws_lock.unlock();
+
+    json items = json::array();
+    for (const auto & c : list.items) {
+      json item;
+      item["label"] = c.label;
+      item["kind"] = completion_kind(c.kind);
+      if (!c.detail.empty()) {
+        item["detail"] = c.detail;
+      }
+      item["textEdit"] = json{
+        {"range", byte_range_to_lsp_range(doc, c.replace_range)},
+        {"newText", c.insert_text},
+      };
+      items.push_back(std::move(item));
+    }
+
+    return json{{"isIncomplete", list.is_incomplete}, {"items", items}};
+  }
+
+  json hover(const DocState & doc, const json & params, std::unique_lock<std::mutex> & ws_lock)
+  {
+    const auto pos = params.value("position", json::object());
+    const uint32_t off = pos_to_byte_offset(doc, pos);
+
+    if (debug_) {
+      const auto line = pos.value<uint32_t>("line", 0U);
+      const auto ch = pos.value<uint32_t>("character", 0U);
+      std::cerr << "bt_dsl_lsp_server: hover pos " << line << ":" << ch << " -> byteOff=" << off
+                << "\n";
+    }
+
+    const auto h = ws_.hover(doc.uri, off, doc.imported_uris);
+    ws_lock.unlock();
+
+    if (!h || h->contents.empty()) {
+      return nullptr;
+    }
+
+    json out;
+    out["contents"] = json{{"kind", "markdown"}, {"value", h->contents}};
+    out["range"] = byte_range_to_lsp_range(doc, h->range);
+    return out;
+  }
+
+  json definition(const DocState & doc, const json & params, std::unique_lock<std::mutex> & ws_lock)
+  {
+    const auto pos = params.value("position", json::object());
+    const uint32_t off = pos_to_byte_offset(doc, pos);
+
+    const auto targets = ws_.definition(doc.uri, off, doc.imported_uris);
+    // Targets are open or imported documents; the latter have no snapshot.
+    std::unordered_map<std::string, DocSnapshot> target_docs;
+    for (const auto & loc : targets) {
+      if (loc.uri != doc.uri && target_docs.count(loc.uri) == 0) {
+        DocSnapshot tdoc = find_doc(loc.uri);
+        target_docs.emplace(loc.uri, tdoc ? std::move(tdoc) : loaded_doc(loc.uri));
+      }
+    }
+    ws_lock.unlock();
+
+    json locs = json::array();
+    for (const auto & loc : targets) {
+      const DocState * target = loc.uri == doc.uri ? &doc : target_docs[loc.uri].get();
+      locs.push_back(json{
+        {"uri", loc.uri},
+        {"range", target ? byte_range_to_lsp_range(*target, loc.range) : empty_lsp_range()},
+      });
+    }
+    return locs;
+  }
+
+  json document_symbols(
+    const DocState & doc, const json & /*params*/, std::unique_lock<std::mutex> & ws_lock)
+  {
+    const auto symbols = ws_.document_symbols(doc.uri);
+    ws_lock.unlock();
+
+    json out = json::array();
+    for (const auto & sym : symbols) {
+      json ds;
+      ds["name"] = sym.name;
+      ds["kind"] = symbol_kind(sym.kind);
+      ds["range"] = byte_range_to_lsp_range(doc, sym.range);
+      ds["selectionRange"] = byte_range_to_lsp_range(doc, sym.selection_range);
+      ds["children"] = json::array();
+      out.push_back(std::move(ds));
+    }
+    return out;
+  }
+
+  json semantic_tokens_full(
+    const DocState & doc, const json & /*params*/, std::unique_lock<std::mutex> & ws_lock)
+  {
+    auto tokens = ws_.semantic_tokens_full(doc.uri, doc.imported_uris, position_encoding());
+    ws_lock.unlock();
+    return json{{"resultId", std::move(tokens.result_id)}, {"data", std::move(tokens.data)}};
+  }
+
+  json semantic_tokens_delta(
+    const DocState & doc, const json & params, std::unique_lock<std::mutex> & ws_lock)
+  {
+    const std::string previous = params.value("previousResultId", "");
+    auto tokens =
+      ws_.semantic_tokens_delta(doc.uri, previous, doc.imported_uris, position_encoding());
+    ws_lock.unlock();
+
+    if (!tokens.edits) {
+      return json{{"resultId", std::move(tokens.result_id)}, {"data", std::move(tokens.data)}};
+    }
+    json edits = json::array();
+    for (auto & e : *tokens.edits) {
+      edits.push_back(
+        json{{"start", e.start}, {"deleteCount", e.delete_count}, {"data", std::move(e.data)}});
+    }
+    return json{{"resultId", std::move(tokens.result_id)}, {"edits", std::move(edits)}};
+  }
+
+  json semantic_tokens_range(
+    const DocState & doc, const json & params, std::unique_lock<std::mutex> & ws_lock)
+  {
+    const auto range = params.value("range", json::object());
+    const uint32_t start = pos_to_byte_offset(doc, range.value("start", json::object()));
+    const uint32_t end = pos_to_byte_offset(doc, range.value("end", json::object()));
+
+    auto data = ws_.semantic_tokens_range(
+      doc.uri, bt_dsl::lsp::ByteRange{start, std::max(start, end)}, doc.imported_uris,
+      position_encoding());
+    ws_lock.unlock();
+    return json{{"data", std::move(data)}};
+  }
+
+  /// Pulled diagnostics. The result ID names the document version and the
+  /// last change to its imports, so an unchanged ID needs no analysis.
+  json pull_diagnostics(
+    const DocState & doc, const json & params, std::unique_lock<std::mutex> & ws_lock)
+  {
+    auto changed = imports_changed_.find(doc.uri);
+    const std::string result_id =
+      std::to_string(doc.version) + "." +
+      std::to_string(changed == imports_changed_.end() ? 0 : changed->second);
+    if (params.value("previousResultId", "") == result_id) {
+      return json{{"kind", "unchanged"}, {"resultId", result_id}};
+    }
+
+    ws_lock.unlock();
+    const auto items = analyze_diagnostics(doc);
+    return json{{"kind", "full"}, {"resultId", result_id}, {"items", lsp_diagnostics(doc, items)}};
+  }
+
+  // The index-backed handlers only need the snapshot.
+
+  json references(const DocState & doc, const json & params, std::unique_lock<std::mutex> & ws_lock)
+  {
+    ws_lock.unlock();
+    const bool include_declaration =
+      params.value("context", json::object()).value("includeDeclaration", false);
+
+    std::optional<bt_dsl::lsp::SymbolLocation> decl;
+    std::vector<bt_dsl::lsp::ReferenceLocation> refs;
+    {
+      const std::lock_guard<std::mutex> lock(index_mutex_);
+      decl = indexed_symbol_at(doc, params.value("position", json::object()));
+      if (!decl) {
+        return json::array();
+      }
+      refs = index_.references(*decl);
+    }
+
+    json out = json::array();
+    if (include_declaration) {
+      out.push_back(
+        json{{"uri", decl->uri}, {"range", index_range_to_lsp_range(decl->symbol.range)}});
+    }
+    for (const auto & r : refs) {
+      out.push_back(json{{"uri", r.uri}, {"range", index_range_to_lsp_range(r.range)}});
+    }
+    return out;
+  }
+
+  json prepare_rename(
+    const DocState & doc, const json & params, std::unique_lock<std::mutex> & ws_lock)
+  {
+    ws_lock.unlock();
+    const auto pos = params.value("position", json::object());
+
+    std::optional<bt_dsl::lsp::SymbolLocation> decl;
+    {
+      const std::lock_guard<std::mutex> lock(index_mutex_);
+      decl = indexed_symbol_at(doc, pos);
+    }
+    if (!decl) {
+      return nullptr;
+    }
+
+    // The identifier under the cursor
+    const auto is_ident = [](char c) {
+      return std::isalnum(static_cast<unsigned char>(c)) != 0 || c == '_';
+    };
+    uint32_t start = pos_to_byte_offset(doc, pos);
+    uint32_t end = start;
+    while (start > 0 && is_ident(doc.text[start - 1])) --start;
+    while (end < doc.text.size() && is_ident(doc.text[end])) ++end;
+
+    return json{
+      {"range", byte_range_to_lsp_range(doc, bt_dsl::lsp::ByteRange{start, end})},
+      {"placeholder", decl->symbol.name},
+    };
+  }
+
+  json rename(const DocState & doc, const json & params, std::unique_lock<std::mutex> & ws_lock)
+  {
+    ws_lock.unlock();
+    const std::string new_name = params.value("newName", "");
+    if (!bt_dsl::lsp::is_valid_symbol_name(new_name)) {
+      return nullptr;
+    }
+
+    std::optional<bt_dsl::lsp::SymbolLocation> decl;
+    std::vector<bt_dsl::lsp::ReferenceLocation> refs;
+    {
+      const std::lock_guard<std::mutex> lock(index_mutex_);
+      decl = indexed_symbol_at(doc, params.value("position", json::object()));
+      if (!decl) {
+        return nullptr;
       }
+      refs = index_.references(*decl);
+    }
 
-      // Unknown method
-      if (is_request) {
-        respond_error(msg["id"], -32601, "Method not found");
+    json changes = json::object();
+    const auto add_edit = [&](const std::string & uri, const bt_dsl::lsp::IndexRange & range) {
+      if (!changes.contains(uri)) {
+        changes[uri] = json::array();
       }
+      changes[uri].push_back(
+        json{{"range", index_range_to_lsp_range(range)}, {"newText", new_name}});
+    };
+    add_edit(decl->uri, decl->symbol.range);
+    for (const auto & r : refs) {
+      add_edit(r.uri, r.range);
     }
+    return json{{"changes", std::move(changes)}};
+  }
+
+  // ---- position conversion (snapshot-local, lock-free) ----
 
+  [[nodiscard]] bool utf16() const { return negotiated_position_encoding_ == "utf-16"; }
+
+  [[nodiscard]] bt_dsl::lsp::PositionEncoding position_encoding() const
+  {
+    return utf16() ? bt_dsl::lsp::PositionEncoding::Utf16 : bt_dsl::lsp::PositionEncoding::Utf8;
+  }
+
+  [[nodiscard]] uint32_t pos_to_byte_offset(const DocState & doc, const json & pos) const
+  {
+    const auto line = pos.value<uint32_t>("line", 0U);
+    const auto character = pos.value<uint32_t>("character", 0U);
+
+    if (utf16()) {
+      if (auto off = utf16_position_to_byte_offset(doc, line, character)) {
+        return *off;
+      }
+      return 0;
+    }
+
+    // Default to utf-8 (bytes).
+    if (auto off = utf8_position_to_byte_offset(doc, line, character)) {
+      return *off;
+    }
     return 0;
+  }
+
+  [[nodiscard]] json byte_offset_to_lsp_position(const DocState & doc, uint32_t byte_offset) const
+  {
+    if (doc.line_offsets.empty()) {
+      return json{{"line", 0}, {"character", 0}};
+    }
+
+    const uint32_t clamped =
+      std::min<uint32_t>(byte_offset, static_cast<uint32_t>(doc.text.size()));
+
+    // Find the line containing clamped.
+    const auto it = std::upper_bound(doc.line_offsets.begin(), doc.line_offsets.end(), clamped);
+    const uint32_t line = (it == doc.line_offsets.begin())
+                            ? 0U
+                            : static_cast<uint32_t>((it - doc.line_offsets.begin()) - 1);
+
+    const uint32_t line_start = doc.line_offsets[line];
+    const uint32_t next_line_start = (line + 1 < doc.line_offsets.size())
+                                       ? doc.line_offsets[line + 1]
+                                       : static_cast<uint32_t>(doc.text.size());
+    const uint32_t line_end =
+      std::min<uint32_t>(next_line_start, static_cast<uint32_t>(doc.text.size()));
+
+    const uint32_t byte_in_line = (clamped >= line_start) ? (clamped - line_start) : 0U;
+    const uint32_t byte_in_line_clamped =
+      std::min<uint32_t>(byte_in_line, (line_end >= line_start) ? (line_end - line_start) : 0U);
+
+    const std::string_view slice =
+      std::string_view(doc.text).substr(line_start, line_end - line_start);
+
+    uint32_t character = 0;
+    if (utf16()) {
+      character = utf16_units_from_utf8_prefix(slice, byte_in_line_clamped);
+    } else {
+      // utf-8: character is a byte offset.
+      character = byte_in_line_clamped;
+    }
+
+    return json{{"line", static_cast<int>(line)}, {"character", static_cast<int>(character)}};
+  }
+
+  [[nodiscard]] json byte_range_to_lsp_range(
+    const DocState & doc, bt_dsl::lsp::ByteRange range) const
+  {
+    return json{
+      {"start", byte_offset_to_lsp_position(doc, range.startByte)},
+      {"end", byte_offset_to_lsp_position(doc, range.endByte)},
+    };
+  }
+
+  // Set while handling `initialize`, before any job is submitted.
+  std::string stdlib_base_;  // Base directory containing std/ (parent of stdlib dir)
+  // LSP defaults to UTF-16 when position encodings are not negotiated.
+  std::string negotiated_position_encoding_ = "utf-16";
+  const bool debug_;
+
+  // Shared with the detached reader thread, which may outlive the server.
+  std::shared_ptr<MessageQueue> incoming_ = std::make_shared<MessageQueue>();
+  std::shared_ptr<PendingRequests> pending_ = std::make_shared<PendingRequests>();
+
+  std::mutex ws_mutex_;
+  bt_dsl::lsp::Workspace ws_;
+  std::unordered_map<std::string, uint64_t> ws_versions_;  // text version held by ws_
+
+  std::mutex diag_mutex_;
+  bt_dsl::lsp::Workspace diag_ws_;  // see analyze_diagnostics
+
+  std::mutex docs_mutex_;
+  std::unordered_map<std::string, std::shared_ptr<DocState>> docs_;
+  uint64_t last_version_ = 0;  // dispatcher only
+
+  std::mutex publish_mutex_;
+  std::unordered_map<std::string, uint64_t> diagnostics_tickets_;  // latest job per URI
+
+  std::unordered_set<std::string> open_uris_;  // dispatcher only
+  // Dispatcher only: use_clock_ at the last use of each open document.
+  std::unordered_map<std::string, uint64_t> last_used_;
+  uint64_t use_clock_ = 0;
+
+  // Set in `initialize`: the client pulls diagnostics (none are pushed), and
+  // can be asked to pull again.
+  bool pull_diagnostics_ = false;
+  bool diagnostics_refresh_ = false;
+  std::atomic<uint64_t> server_requests_{0};  // IDs of our requests to the client
+
+  // Guarded by ws_mutex_: per document, the stamp of the last change to one
+  // of its imports, for pulled result IDs.
+  std::unordered_map<std::string, uint64_t> imports_changed_;
+  uint64_t imports_stamp_ = 0;
+
+  std::vector<fs::path> workspace_folders_;  // set in `initialize`
+  std::atomic<bool> stopping_{false};        // set on `shutdown`
+
+  std::mutex index_mutex_;
+  bt_dsl::lsp::SymbolIndex index_;
+  std::unordered_map<std::string, uint64_t> index_versions_;  // open docs: text version indexed
+  std::vector<std::string> index_roots_;                       // with a trailing separator
+  fs::path index_cache_;
+  bool index_dirty_ = false;
+
+  // Declared last: workers are joined before the state they use goes away.
+  WorkerPool pool_;
+  // After the pool: its thread submits to it, so it is stopped first.
+  Debouncer debouncer_;
+};
+
+}  // namespace
+
+int main()
+{
+  try {
+    Server server;
+    return server.run();
   } catch (const std::exception & e) {
     std::cerr << "bt_dsl_lsp_server: fatal error: " << e.what() << "\n";
     return 1;
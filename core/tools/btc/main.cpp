@@ -1,17 +1,17 @@
 // btc - BT-DSL Compiler Command Line Interface
 //
 // Usage:
-//   btc build [file.bt | --project] [-o output]
+//   btc build [file.bt | --project] [-o output] [--target name]
 //   btc check [file.bt | --project]
 //   btc init <project-name>
-//   btc model-convert <file.xml> [-o output.bt]
+//   btc model-convert <file.xml>... [-o output.bt]
 //
 #include <cstring>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
-#include <sstream>
 #include <string>
+#include <vector>
 
 #ifdef _WIN32
 #include <io.h>
@@ -43,12 +43,21 @@ void print_usage(const char * program_name)
             << "  build [file.bt]          Build a file or project\n"
             << "  check [file.bt]          Check syntax and semantics (no codegen)\n"
             << "  init <project-name>      Initialize a new project\n"
-            << "  model-convert <file.xml> Convert XML to BT-DSL\n\n"
+            << "  model-convert <xml>...   Convert XML manifests to BT-DSL\n\n"
             << "Options:\n"
             << "  -o, --output <path>      Output directory or file\n"
             << "  --project                Build project from btc.yaml\n"
+            << "  --target <name>          btcpp_v4 | btcpp_v4_strict (XML) | btcpp_v4_cpp (C++)\n"
             << "  --pkg <path>             Register package (folder name = pkg name, repeatable)\n"
             << "  --no-stdlib              Disable automatic stdlib detection\n"
+            << "  -O0, -O1, -O2            Optimization level of the generated tree (default -O0)\n"
+            << "  --split-output           Write one XML file per tree plus an index\n"
+            << "  --coalesce-keys          Reuse blackboard keys with disjoint lifetimes\n"
+            << "  --inline-subtrees        Inline small and single-use subtrees (implied by -O2)\n"
+            << "  --inline-max-nodes <n>   Size limit for inlining at every call site (default 8)\n"
+            << "  --dedup-trees            Merge structurally identical trees (implied by -O2)\n"
+            << "  --xml-compact            Minify XML output and shorten imported tree IDs\n"
+            << "  --known-models <xml>     Omit node models listed in a manifest (repeatable)\n"
             << "  -v, --verbose            Verbose output\n"
             << "  -h, --help               Show this help message\n";
 }
@@ -101,10 +110,20 @@ struct CommandArgs
 {
   std::string command;
   std::string input_file;
+  std::vector<std::string> extra_inputs;  // model-convert only
   std::string output_path;
+  std::string target;
   std::vector<std::string> pkg_paths;
   bool use_project = false;
   bool no_stdlib = false;
+  bool split_output = false;
+  bool coalesce_keys = false;
+  bt_dsl::OptimizationLevel opt_level = bt_dsl::OptimizationLevel::O0;
+  bool inline_subtrees = false;
+  std::string inline_max_nodes;
+  bool dedup_trees = false;
+  bool xml_compact = false;
+  std::vector<std::string> known_model_manifests;
   bool verbose = false;
   bool show_help = false;
 };
@@ -132,6 +151,10 @@ CommandArgs parse_args(int argc, char * argv[])
       if (i + 1 < argc) {
         args.output_path = argv[++i];
       }
+    } else if (arg == "--target") {
+      if (i + 1 < argc) {
+        args.target = argv[++i];
+      }
     } else if (arg == "--project") {
       args.use_project = true;
     } else if (arg == "--pkg") {
@@ -140,12 +163,38 @@ CommandArgs parse_args(int argc, char * argv[])
       }
     } else if (arg == "--no-stdlib") {
       args.no_stdlib = true;
+    } else if (arg == "-O0") {
+      args.opt_level = bt_dsl::OptimizationLevel::O0;
+    } else if (arg == "-O1") {
+      args.opt_level = bt_dsl::OptimizationLevel::O1;
+    } else if (arg == "-O2") {
+      args.opt_level = bt_dsl::OptimizationLevel::O2;
+    } else if (arg == "--split-output") {
+      args.split_output = true;
+    } else if (arg == "--coalesce-keys") {
+      args.coalesce_keys = true;
+    } else if (arg == "--inline-subtrees") {
+      args.inline_subtrees = true;
+    } else if (arg == "--inline-max-nodes") {
+      if (i + 1 < argc) {
+        args.inline_max_nodes = argv[++i];
+      }
+    } else if (arg == "--dedup-trees") {
+      args.dedup_trees = true;
+    } else if (arg == "--xml-compact") {
+      args.xml_compact = true;
+    } else if (arg == "--known-models") {
+      if (i + 1 < argc) {
+        args.known_model_manifests.emplace_back(argv[++i]);
+      }
     } else if (arg == "-v" || arg == "--verbose") {
       args.verbose = true;
     } else if (arg == "-h" || arg == "--help") {
       args.show_help = true;
     } else if (arg[0] != '-' && args.input_file.empty()) {
       args.input_file = arg;
+    } else if (arg[0] != '-') {
+      args.extra_inputs.push_back(arg);
     }
   }
 
@@ -162,9 +211,39 @@ int cmd_build(const CommandArgs & args)
   options.mode = bt_dsl::CompileMode::Build;
   options.verbose = args.verbose;
   options.auto_detect_stdlib = !args.no_stdlib;
+  options.split_output = args.split_output;
+  options.codegen.coalesce_blackboard_keys = args.coalesce_keys;
+  options.codegen.opt_level = args.opt_level;
+  options.codegen.inline_subtrees = args.inline_subtrees;
+  options.codegen.dedup_trees = args.dedup_trees;
+  options.codegen.xml_compact = args.xml_compact;
+  if (!args.inline_max_nodes.empty()) {
+    try {
+      options.codegen.inline_limits.max_nodes = std::stoul(args.inline_max_nodes);
+    } catch (const std::exception &) {
+      std::cerr << "error: --inline-max-nodes expects a number, got '" << args.inline_max_nodes
+                << "'\n";
+      return 1;
+    }
+  }
+  if (!args.known_model_manifests.empty()) {
+    // Node models the runtime already registers from its plugins.
+    for (auto & f : bt_dsl::ModelConverter::parse_files(args.known_model_manifests)) {
+      if (!f.error.empty()) {
+        std::cerr << "error: " << f.error << "\n";
+        return 1;
+      }
+      for (auto & node : f.nodes) {
+        options.codegen.known_node_models.insert(std::move(node.name));
+      }
+    }
+  }
   if (!args.output_path.empty()) {
     options.output_dir = args.output_path;
   }
+  if (!args.target.empty()) {
+    options.target = args.target;
+  }
 
   // Register user-specified packages
   for (const auto & path : args.pkg_paths) {
@@ -221,6 +300,14 @@ int cmd_build(const CommandArgs & args)
   for (const auto & file : result.generated_files) {
     std::cerr << "Generated: " << file.string() << "\n";
   }
+  for (const auto & file : result.removed_files) {
+    std::cerr << "Removed: " << file.string() << "\n";
+  }
+  if (args.verbose) {
+    for (const auto & file : result.unchanged_files) {
+      std::cerr << "Unchanged: " << file.string() << "\n";
+    }
+  }
 
   return 0;
 }
@@ -345,50 +432,64 @@ int cmd_model_convert(const CommandArgs & args)
 {
   if (args.input_file.empty()) {
     std::cerr << "error: input XML file required\n";
-    std::cerr << "usage: btc model-convert <file.xml> [-o output.bt]\n";
+    std::cerr << "usage: btc model-convert <file.xml>... [-o output.bt]\n";
     return 1;
   }
 
-  const fs::path input_path = fs::absolute(args.input_file);
+  std::vector<std::string> inputs;
+  inputs.push_back(fs::absolute(args.input_file).string());
+  for (const auto & extra : args.extra_inputs) {
+    inputs.push_back(fs::absolute(extra).string());
+  }
 
-  if (!fs::exists(input_path)) {
-    std::cerr << "error: file not found: " << input_path.string() << "\n";
-    return 1;
+  for (const auto & input : inputs) {
+    if (!fs::exists(input)) {
+      std::cerr << "error: file not found: " << input << "\n";
+      return 1;
+    }
   }
 
-  // Read XML file
-  std::ifstream file(input_path);
-  if (!file.is_open()) {
-    std::cerr << "error: failed to open file: " << input_path.string() << "\n";
+  // Manifests are parsed in parallel; the merged result is streamed out.
+  auto files = bt_dsl::ModelConverter::parse_files(inputs);
+  bool failed = false;
+  for (const auto & f : files) {
+    if (!f.error.empty()) {
+      std::cerr << "error: " << f.error << "\n";
+      failed = true;
+    }
+  }
+  if (failed) {
     return 1;
   }
 
-  std::stringstream buffer;
-  buffer << file.rdbuf();
-  const std::string xml_content = buffer.str();
-
-  try {
-    auto result = bt_dsl::ModelConverter::convert(xml_content);
-
-    if (args.output_path.empty()) {
-      // Output to stdout
-      std::cout << result.bt_text;
-    } else {
-      // Write to file
-      std::ofstream out(args.output_path);
-      if (!out.is_open()) {
-        std::cerr << "error: failed to open output file: " << args.output_path << "\n";
-        return 1;
-      }
-      out << result.bt_text;
-      std::cerr << "Converted " << result.nodes_count << " nodes to " << args.output_path << "\n";
-    }
+  const auto merged = bt_dsl::ModelConverter::merge(std::move(files));
+  for (const auto & conflict : merged.conflicts) {
+    std::cerr << "warning: " << conflict << "\n";
+  }
 
+  if (args.output_path.empty()) {
+    // Output to stdout
+    bt_dsl::ModelConverter::render_bt(merged.nodes, std::cout);
     return 0;
-  } catch (const std::exception & e) {
-    std::cerr << "error: " << e.what() << "\n";
+  }
+
+  std::ofstream out(args.output_path);
+  if (!out.is_open()) {
+    std::cerr << "error: failed to open output file: " << args.output_path << "\n";
     return 1;
   }
+  bt_dsl::ModelConverter::render_bt(merged.nodes, out);
+  out.close();
+  if (!out) {
+    std::cerr << "error: failed to write output file: " << args.output_path << "\n";
+    return 1;
+  }
+
+  std::cerr << "Converted " << merged.nodes.size() << " nodes to " << args.output_path << "\n";
+  if (args.verbose && merged.duplicates_merged > 0) {
+    std::cerr << "Merged " << merged.duplicates_merged << " duplicate declarations\n";
+  }
+  return 0;
 }
 
 }  // namespace
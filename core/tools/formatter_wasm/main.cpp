@@ -119,7 +119,7 @@ std::string parse_to_ast_json(const std::string & source_text)
     diagnostics.push_back(json{
       {"severity", sev},
       {"range", j_range(d.primary_range())},
-      {"message", d.message},
+      {"message", d.message.str()},
       {"code", d.code}});
   }
 
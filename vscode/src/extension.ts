@@ -61,6 +61,13 @@ export async function activate(context: vscode.ExtensionContext): Promise<void>
       { scheme: 'file', language: 'bt-dsl' },
       { scheme: 'untitled', language: 'bt-dsl' },
     ],
+    // Keeps the server's project index in step with files changed outside the editor.
+    synchronize: { fileEvents: vscode.workspace.createFileSystemWatcher('**/*.bt') },
+    initializationOptions: {
+      memoryBudgetMB: vscode.workspace
+        .getConfiguration('btDsl.server')
+        .get<number>('memoryBudgetMB', 512),
+    },
   };
 
   client = new LanguageClient('bt-dsl', 'BT DSL Language Server', serverOptions, clientOptions);